@@ -177,6 +177,83 @@ DB_NetworkResult db_find_studies(const char* localAE,
                                   void* userData,
                                   int timeoutSeconds);
 
+/// Per-node outcome of a federated query
+typedef struct {
+    DB_NetworkResult result;    // Status of this node's C-FIND
+    int matchCount;             // Responses received from this node
+    int uniqueCount;            // Responses not already reported by another node
+    int timedOut;               // 1 if the node missed its deadline
+    double elapsedSeconds;      // Time until the node finished or was abandoned
+} DB_FederatedNodeResult;
+
+/// Callback invoked once per unique study in a federated query.
+/// Calls are serialized but arrive on worker threads.
+/// - nodeIndex: Index into remoteNodes of the node that reported it first
+typedef void (*DB_FederatedQueryCallback)(void* userData,
+                                          const DB_DicomTags* tags,
+                                          int nodeIndex);
+
+/// Query several PACS nodes for studies concurrently (C-FIND at STUDY level)
+/// - localAE: Local Application Entity Title
+/// - remoteNodes: Array of remote PACS node configurations
+/// - nodeCount: Number of nodes in array
+/// - searchCriteria: DICOM tags to use as search criteria (NULL fields are wildcards)
+/// - onResult: Callback invoked for each study, de-duplicated by StudyInstanceUID
+/// - userData: User context passed to callback
+/// - perNodeTimeoutSeconds: Deadline for each node, measured from the call;
+///   slow nodes are cancelled and never delay the return beyond it
+/// - outNodeResults: Optional array of nodeCount per-node results
+/// Returns DB_STATUS_OK if at least one node answered
+DB_NetworkResult db_find_studies_federated(const char* localAE,
+                                            const DB_DicomNode* remoteNodes,
+                                            int nodeCount,
+                                            const DB_DicomTags* searchCriteria,
+                                            DB_FederatedQueryCallback onResult,
+                                            void* userData,
+                                            int perNodeTimeoutSeconds,
+                                            DB_FederatedNodeResult* outNodeResults);
+
+// --- C-FIND result cache ---
+
+/// Opaque cache of C-FIND results keyed by node + normalized criteria
+typedef struct DB_QueryCache DB_QueryCache;
+
+/// Cache counters
+typedef struct {
+    int hits;               // Served without contacting the PACS
+    int misses;             // Full C-FIND issued
+    int partialRefreshes;   // Stale entry refreshed over the trailing window only
+    int evictions;          // Entries dropped to honour the size bounds
+    int entryCount;         // Entries currently cached
+    int resultCount;        // Studies currently cached across all entries
+} DB_QueryCacheStats;
+
+/// Create a query cache. Thread-safe; share one per process.
+/// - maxEntries: Maximum number of cached queries (LRU eviction)
+/// - maxTotalResults: Maximum studies held across all entries (0 = unbounded)
+/// - ttlSeconds: Age after which an entry is refreshed from the PACS
+/// Returns NULL on invalid bounds
+DB_QueryCache* db_query_cache_create(int maxEntries, int maxTotalResults, int ttlSeconds);
+void db_query_cache_destroy(DB_QueryCache* cache);
+void db_query_cache_clear(DB_QueryCache* cache);
+void db_query_cache_get_stats(DB_QueryCache* cache, DB_QueryCacheStats* outStats);
+
+/// Query PACS for studies through the cache (C-FIND at STUDY level)
+/// Same parameters as db_find_studies, plus:
+/// - cache: Cache created with db_query_cache_create
+/// - refreshTrailingDays: When > 0, an expired entry is refreshed by
+///   re-querying only studies dated within the last N days and keeping
+///   older cached studies. 0 re-runs the full query, as does an entry
+///   holding studies without a StudyDate.
+DB_NetworkResult db_find_studies_cached(DB_QueryCache* cache,
+                                         const char* localAE,
+                                         const DB_DicomNode* remoteNode,
+                                         const DB_DicomTags* searchCriteria,
+                                         int refreshTrailingDays,
+                                         DB_QueryCallback onResult,
+                                         void* userData,
+                                         int timeoutSeconds);
+
 /// Retrieve study from PACS (C-MOVE)
 /// - localAE: Local Application Entity Title (also used as move destination)
 /// - remoteNode: Remote PACS node configuration
@@ -194,6 +271,84 @@ DB_NetworkResult db_move_study(const char* localAE,
                                 void* userData,
                                 int timeoutSeconds);
 
+// --- Prioritized retrieval ---
+
+/// How the retrieve scheduler fetches instances
+typedef enum {
+    DB_RETRIEVE_GET = 0,    // C-GET; instances arrive on the same association
+    DB_RETRIEVE_MOVE = 1    // C-MOVE to localAE; a storage SCP must receive them
+} DB_RetrieveMode;
+
+/// Opaque retrieve scheduler for one study
+typedef struct DB_RetrieveScheduler DB_RetrieveScheduler;
+
+/// Callback invoked for each retrieved instance.
+/// - filePath: Written file for C-GET, NULL for C-MOVE
+typedef void (*DB_RetrieveInstanceCallback)(void* userData,
+                                            const char* seriesInstanceUID,
+                                            const char* sopInstanceUID,
+                                            const char* filePath);
+
+/// Create a scheduler that retrieves a study at IMAGE level in priority
+/// order: the middle slice of each series first, then every series from
+/// its middle outward, small series (localizers) last.
+/// - localAE: Local Application Entity Title (also the C-MOVE destination)
+/// - remoteNode: Remote PACS node configuration
+/// - studyInstanceUID: Study to retrieve
+/// - destinationFolder: Folder for C-GET files, created if missing
+/// - mode: C-GET or C-MOVE
+/// - batchSize: Instances per C-GET/C-MOVE request; smaller batches react
+///   faster to reprioritization
+/// - timeoutSeconds: Timeout for each network operation
+/// Returns NULL on invalid parameters
+DB_RetrieveScheduler* db_retrieve_scheduler_create(const char* localAE,
+                                                   const DB_DicomNode* remoteNode,
+                                                   const char* studyInstanceUID,
+                                                   const char* destinationFolder,
+                                                   DB_RetrieveMode mode,
+                                                   int batchSize,
+                                                   int timeoutSeconds);
+void db_retrieve_scheduler_destroy(DB_RetrieveScheduler* scheduler);
+
+/// Move a series to the front of the queue; it is then retrieved
+/// completely before anything else. Thread-safe, may be called while
+/// db_retrieve_scheduler_run is in progress (takes effect at the next batch).
+/// Returns DB_STATUS_NOT_FOUND if the study has no such series.
+DB_Status db_retrieve_scheduler_prioritize_series(DB_RetrieveScheduler* scheduler,
+                                                  const char* seriesInstanceUID);
+
+/// Track received SOP Instance UIDs in a journal so that a later run of an
+/// interrupted job only retrieves the instances still missing (found via
+/// the IMAGE level C-FIND). Must be called before db_retrieve_scheduler_run.
+/// - journalPath: Journal file, or NULL for
+///   <destinationFolder>/.retrieve-<StudyInstanceUID>.journal
+DB_Status db_retrieve_scheduler_enable_resume(DB_RetrieveScheduler* scheduler,
+                                              const char* journalPath);
+
+/// Stop after the batch in progress. Thread-safe.
+void db_retrieve_scheduler_cancel(DB_RetrieveScheduler* scheduler);
+
+/// List the study's series, then retrieve them; each series' instances
+/// are queried just before its first batch, so retrieval starts after
+/// one SERIES and one IMAGE level C-FIND.
+/// Blocks until done, cancelled or failed.
+DB_NetworkResult db_retrieve_scheduler_run(DB_RetrieveScheduler* scheduler,
+                                           DB_RetrieveInstanceCallback onInstance,
+                                           DB_MoveProgressCallback onProgress,
+                                           void* userData);
+
+/// Retrieve a whole study, resuming a previous interrupted attempt.
+/// Equivalent to a scheduler with resume enabled and the default journal.
+/// Same parameters as db_move_study, plus the retrieve mode.
+DB_NetworkResult db_retrieve_study_resumable(const char* localAE,
+                                              const DB_DicomNode* remoteNode,
+                                              const char* studyInstanceUID,
+                                              const char* destinationFolder,
+                                              DB_RetrieveMode mode,
+                                              DB_MoveProgressCallback onProgress,
+                                              void* userData,
+                                              int timeoutSeconds);
+
 /// Send study to PACS (C-STORE)
 /// - localAE: Local Application Entity Title
 /// - remoteNode: Remote PACS node configuration
@@ -211,18 +366,304 @@ DB_NetworkResult db_store_study(const char* localAE,
                                  void* userData,
                                  int timeoutSeconds);
 
+// --- Network instrumentation ---
+
+/// Kind of instrumented network operation
+typedef enum {
+    DB_NET_OP_ECHO = 0,
+    DB_NET_OP_FIND = 1,
+    DB_NET_OP_MOVE = 2,
+    DB_NET_OP_GET = 3,
+    DB_NET_OP_STORE = 4
+} DB_NetworkOperation;
+
+/// Timings and transfer counters of one network operation.
+/// Phase durations are -1 when the phase was never reached.
+typedef struct {
+    DB_NetworkOperation operation;
+    char remoteAE[17];
+    char hostname[256];
+    int port;
+    DB_Status status;               // Outcome of the operation
+    int dimseStatus;
+    double startTime;               // Unix time in seconds
+    double connectSeconds;          // Until the TCP connection was established
+    double negotiateSeconds;        // TCP connected until A-ASSOCIATE-AC/RJ
+    double firstResponseSeconds;    // Association established until first P-DATA from peer
+    double totalSeconds;            // Whole operation including release
+    uint64_t bytesSent;
+    uint64_t bytesReceived;
+    uint32_t pdusSent;
+    uint32_t pdusReceived;
+    int instances;                  // C-FIND matches or instances transferred
+    double instancesPerSecond;
+} DB_NetworkStats;
+
+/// Stats of the last operation that finished on the calling thread.
+/// Returns DB_STATUS_NOT_FOUND if this thread has not run one yet.
+DB_Status db_network_stats_last(DB_NetworkStats* outStats);
+
+/// Copy up to maxCount of the most recent operations (all threads), newest first.
+/// Returns the number of entries written. The last 256 operations are kept.
+int db_network_stats_recent(DB_NetworkStats* outStats, int maxCount);
+
+/// Forget the recent operations.
+void db_network_stats_clear(void);
+
+/// Append one JSON object per finished operation to a log file.
+/// - path: Log file path, or NULL to stop logging
+DB_Status db_network_stats_set_log(const char* path);
+
+// --- DICOM TLS ---
+
+/// TLS settings for associations with one node. Strings are copied.
+typedef struct {
+    const char* certificateFile;          // PEM certificate (chain) presented to the node, or NULL
+    const char* privateKeyFile;           // PEM key of certificateFile (NULL = in certificateFile)
+    const char* privateKeyPassword;       // NULL if the key is not encrypted
+    const char* trustedCertificatesFile;  // PEM CA certificates for verifying the node, or NULL
+    const char* trustedCertificatesDir;   // Hashed CA certificate directory, or NULL
+    int verifyPeer;                       // 1 = require a trusted certificate naming the host
+    int sessionLifetimeSeconds;           // Resume the last TLS session for this long
+                                          // (0 = full handshake on every association)
+} DB_TLSConfig;
+
+/// TLS handshakes with a node since it was configured
+typedef struct {
+    int fullHandshakes;
+    int resumedHandshakes;
+} DB_TLSSessionStats;
+
+/// Use TLS for all associations with a node (matched by hostname and port).
+/// Certificates and keys are loaded now, so errors are reported here.
+/// Replaces an earlier configuration of the node and its cached session.
+DB_NetworkResult db_tls_configure_node(const DB_DicomNode* node, const DB_TLSConfig* config);
+
+/// Go back to plain TCP for a node.
+void db_tls_remove_node(const DB_DicomNode* node);
+
+/// Handshake counters of a TLS node.
+/// Returns DB_STATUS_NOT_FOUND if the node is not configured for TLS.
+DB_Status db_tls_session_stats(const DB_DicomNode* node, DB_TLSSessionStats* outStats);
+
+// --- Bandwidth throttling ---
+
+/// Priority of an association's traffic on a limited link
+typedef enum {
+    DB_TRAFFIC_AUTO = 0,            // C-ECHO, C-FIND, C-GET and C-MOVE interactive,
+                                    // C-STORE uploads background
+    DB_TRAFFIC_INTERACTIVE = 1,     // Served first
+    DB_TRAFFIC_BACKGROUND = 2       // Gets what interactive traffic leaves
+} DB_TrafficClass;
+
+/// Bandwidth limit per direction in bytes per second (0 = unlimited)
+typedef struct {
+    double sendBytesPerSecond;
+    double receiveBytesPerSecond;
+} DB_BandwidthLimit;
+
+/// Limit the combined traffic of all associations. NULL removes the limit.
+/// New rates apply at once to associations already throttled; associations
+/// opened while a direction was unlimited stay unlimited in it.
+DB_Status db_throttle_set_global_limit(const DB_BandwidthLimit* limit);
+
+/// Limit the traffic with one node (matched by hostname and port), on top
+/// of the global limit. NULL removes the node's limit.
+DB_Status db_throttle_set_node_limit(const DB_DicomNode* node, const DB_BandwidthLimit* limit);
+
+/// Traffic class of associations the calling thread opens from now on.
+void db_throttle_set_thread_class(DB_TrafficClass trafficClass);
+
+// --- Store-and-forward queue ---
+
+/// Opaque outbound C-STORE queue persisted in a folder. Queued files are
+/// referenced by path, not copied, and must stay in place until sent.
+typedef struct DB_StoreQueue DB_StoreQueue;
+
+/// Store queue configuration (0 = default)
+typedef struct {
+    int batchSize;                  // Instances per association (256)
+    int maxAttempts;                // Rejections before an instance is given up (5)
+    int initialBackoffSeconds;      // Retry delay after the first failure, doubled
+                                    // on each further one (5)
+    int maxBackoffSeconds;          // Retry delay cap (600)
+    int timeoutSeconds;             // Network timeout (30)
+} DB_StoreQueueConfig;
+
+/// Delivery state of a queued job
+typedef struct {
+    int total;
+    int sent;
+    int failed;                     // Given up: unreadable or rejected maxAttempts times
+    int pending;
+    double nextAttemptTime;         // Unix time the destination is retried, 0 if not waiting
+    char lastError[256];
+} DB_StoreJobStatus;
+
+/// Open the queue in queueFolder (created if missing) and start delivering
+/// in the background, including jobs left unfinished by an earlier run.
+/// Only one queue may use a folder at a time. Returns NULL on failure.
+/// - config: NULL for defaults
+DB_StoreQueue* db_store_queue_open(const char* queueFolder, const DB_StoreQueueConfig* config);
+
+/// Stop after the instance in progress and close the queue. Pending
+/// instances are delivered when the folder is opened again.
+void db_store_queue_close(DB_StoreQueue* queue);
+
+/// Queue files for C-STORE to remoteNode. The job is on disk when this
+/// returns. Association failures never give an instance up; the
+/// destination is retried with exponential backoff until it is back.
+/// - outJobID: Receives the job ID, may be NULL
+DB_Status db_store_queue_enqueue(DB_StoreQueue* queue,
+                                 const char* localAE,
+                                 const DB_DicomNode* remoteNode,
+                                 const char* const* filePaths,
+                                 int fileCount,
+                                 uint64_t* outJobID);
+
+/// State of a job queued since the queue was opened, or unfinished when
+/// it was opened. Returns DB_STATUS_NOT_FOUND otherwise.
+DB_Status db_store_queue_job_status(DB_StoreQueue* queue, uint64_t jobID,
+                                    DB_StoreJobStatus* outStatus);
+
+/// Instances not yet sent or given up, over all jobs.
+int db_store_queue_pending_count(DB_StoreQueue* queue);
+
+/// Retry waiting destinations and instances now instead of after their backoff.
+void db_store_queue_retry_now(DB_StoreQueue* queue);
+
+// --- Modality Worklist ---
+
+/// One scheduled procedure step from a Modality Worklist C-FIND
+typedef struct {
+    char patientName[128];
+    char patientID[64];
+    char birthDate[16];
+    char patientSex[16];
+    char accessionNumber[64];
+    char studyInstanceUID[128];
+    char referringPhysician[128];
+    char requestedProcedureID[64];
+    char requestedProcedureDescription[256];
+    char scheduledStationAETitle[17];
+    char scheduledStartDate[16];
+    char scheduledStartTime[16];
+    char modality[16];
+    char performingPhysician[128];
+    char stepDescription[256];
+    char stepID[64];
+    char stepStatus[16];
+} DB_WorklistItem;
+
+/// Worklist query over a scheduled date window around today
+typedef struct {
+    char scheduledStationAETitle[17];   // Empty = any station
+    char modality[16];                  // Empty = any modality
+    int daysBefore;                     // Window starts this many days before today
+    int daysAfter;                      // Window ends this many days after today
+    int fullRefreshInterval;            // Poller only: every Nth poll covers the whole
+                                        // window, the others today only (0/1 = always whole)
+} DB_WorklistQuery;
+
+/// Kind of change a worklist poll found
+typedef enum {
+    DB_WORKLIST_ADDED = 0,
+    DB_WORKLIST_CHANGED = 1,
+    DB_WORKLIST_REMOVED = 2
+} DB_WorklistChange;
+
+typedef void (*DB_WorklistCallback)(void* userData, const DB_WorklistItem* item);
+typedef void (*DB_WorklistChangeCallback)(void* userData, DB_WorklistChange change,
+                                          const DB_WorklistItem* item);
+
+/// Opaque worklist poller holding the last known worklist of one query
+typedef struct DB_WorklistPoller DB_WorklistPoller;
+
+/// Query the Modality Worklist once (C-FIND, whole date window).
+DB_NetworkResult db_worklist_find(const char* localAE,
+                                  const DB_DicomNode* remoteNode,
+                                  const DB_WorklistQuery* query,
+                                  DB_WorklistCallback onItem,
+                                  void* userData,
+                                  int timeoutSeconds);
+
+/// Create a poller for a worklist query. Returns NULL on invalid parameters.
+DB_WorklistPoller* db_worklist_poller_create(const char* localAE,
+                                             const DB_DicomNode* remoteNode,
+                                             const DB_WorklistQuery* query,
+                                             int timeoutSeconds);
+void db_worklist_poller_destroy(DB_WorklistPoller* poller);
+
+/// Query the worklist and report only the items that were added, changed
+/// (any returned value differs) or removed since the previous poll. The
+/// first poll reports every item as added. A failed poll changes nothing.
+DB_NetworkResult db_worklist_poller_poll(DB_WorklistPoller* poller,
+                                         DB_WorklistChangeCallback onChange,
+                                         void* userData);
+
+/// Copy up to maxCount items of the current worklist.
+/// Returns the number written, or the item count if outItems is NULL.
+int db_worklist_poller_items(DB_WorklistPoller* poller, DB_WorklistItem* outItems, int maxCount);
+
+// --- Modality Performed Procedure Step ---
+
+/// State of a performed procedure step. A step is created IN PROGRESS and
+/// set COMPLETED or DISCONTINUED once; the SCP refuses changes after that.
+typedef enum {
+    DB_MPPS_IN_PROGRESS = 0,
+    DB_MPPS_COMPLETED = 1,
+    DB_MPPS_DISCONTINUED = 2
+} DB_MppsStatus;
+
+/// A series acquired during a performed procedure step
+typedef struct {
+    char seriesInstanceUID[65];
+    char seriesDescription[65];
+    char protocolName[65];              // Empty = the series description
+    char sopClassUID[65];               // Of every instance listed
+    const char* const* sopInstanceUIDs; // Instances of the series, may be NULL
+    int instanceCount;
+} DB_MppsSeries;
+
+/// Report that a scheduled step has started (MPPS N-CREATE): a performed
+/// procedure step IN PROGRESS on localAE's station, started now, with the
+/// patient and request attributes of the worklist item.
+/// - outSOPInstanceUID: Receives the new step's SOP Instance UID (65
+///   bytes), which db_mpps_set needs
+DB_NetworkResult db_mpps_create(const char* localAE,
+                                const DB_DicomNode* remoteNode,
+                                const DB_WorklistItem* step,
+                                char* outSOPInstanceUID,
+                                int timeoutSeconds);
+
+/// Update a performed procedure step (MPPS N-SET) with its status and,
+/// if series is not NULL, the series acquired so far. COMPLETED and
+/// DISCONTINUED also set the end date and time to now.
+DB_NetworkResult db_mpps_set(const char* localAE,
+                             const DB_DicomNode* remoteNode,
+                             const char* sopInstanceUID,
+                             DB_MppsStatus status,
+                             const DB_MppsSeries* series,
+                             int seriesCount,
+                             int timeoutSeconds);
+
 // ============================================================================
 // ANONYMIZATION FUNCTIONS
 // ============================================================================
 
-/// Action to perform on a DICOM tag
+/// Action to perform on a DICOM tag. Rules apply at every depth of
+/// sequence items; the PS3.15 Basic Profile action code is given where
+/// there is one.
 typedef enum {
-    DB_TAG_ACTION_REMOVE = 0,      // Remove tag entirely
+    DB_TAG_ACTION_REMOVE = 0,      // Remove tag entirely (X)
     DB_TAG_ACTION_REPLACE = 1,     // Replace with specified value
     DB_TAG_ACTION_HASH = 2,        // Replace with hash of original
-    DB_TAG_ACTION_EMPTY = 3,       // Replace with empty string
-    DB_TAG_ACTION_KEEP = 4,        // Keep original value
-    DB_TAG_ACTION_GENERATE_UID = 5 // Generate new UID
+    DB_TAG_ACTION_EMPTY = 3,       // Replace with empty string, empty a sequence (Z)
+    DB_TAG_ACTION_KEEP = 4,        // Keep original value (K)
+    DB_TAG_ACTION_GENERATE_UID = 5, // Generate new UID (U)
+    DB_TAG_ACTION_DUMMY = 6,       // Replace with a dummy value valid for the VR (D)
+    DB_TAG_ACTION_CLEAN = 7        // Shift dates, remap UIDs, clean sequence items,
+                                   // dummy for other values (C)
 } DB_TagAction;
 
 /// Rule for anonymizing a specific DICOM tag
@@ -233,15 +674,106 @@ typedef struct {
     char replacementValue[256]; // Used when action is REPLACE
 } DB_TagRule;
 
+/// Private attribute kept when private tags are removed. Private element
+/// numbers depend on the block the creator was given in each file, so the
+/// attribute is named the way its vendor documents it: creator and offset
+/// within the block, e.g. (0019,"SIEMENS MR HEADER",0C) for the diffusion
+/// b-value.
+typedef struct {
+    unsigned short group;      // Odd private group (e.g., 0x0019)
+    char privateCreator[65];   // Private Creator value, compared without padding
+    unsigned char offset;      // Low byte of the element number (e.g., 0x0C)
+} DB_PrivateTagRule;
+
+/// Rectangle of pixels to blank, in image coordinates
+typedef struct {
+    int x;
+    int y;
+    int width;
+    int height;
+} DB_RedactionRect;
+
+/// Regions of burned-in annotation for one kind of device, blanked in
+/// every frame. An empty modality or manufacturer, or zero rows or columns,
+/// matches any image; manufacturer matches as a case-insensitive prefix.
+/// Every matching rule applies.
+typedef struct {
+    char modality[16];
+    char manufacturer[64];
+    int rows;
+    int columns;
+    const DB_RedactionRect* rects;
+    int rectCount;
+} DB_RedactionRule;
+
+/// Sides of a frame whose border looks like burned-in text
+enum {
+    DB_TEXT_BORDER_TOP = 1,
+    DB_TEXT_BORDER_BOTTOM = 2,
+    DB_TEXT_BORDER_LEFT = 4,
+    DB_TEXT_BORDER_RIGHT = 8
+};
+
+/// Opaque map from original to replacement UIDs shared by the files of a
+/// batch, so every file of a study gets the same new Study, Series and
+/// Frame of Reference UIDs and references between files stay intact.
+typedef struct DB_UIDMap DB_UIDMap;
+
+/// Values that replace the configuration's for the files of one patient
+typedef struct {
+    char patientID[65];        // New PatientID (0010,0020); empty = the tag rules decide
+    int dateShiftDays;         // Date shift for the patient's files, as dateShiftDays
+} DB_PatientOverride;
+
+/// Resolves the values for one patient, identified by the PatientID of the
+/// files (empty if they have none). outOverride holds the configuration's
+/// values on entry; return false to keep them. Called once per distinct
+/// PatientID of a call, before that patient's first file, and never
+/// concurrently.
+typedef bool (*DB_PatientOverrideCallback)(void* userData,
+                                           const char* patientID,
+                                           DB_PatientOverride* outOverride);
+
 /// Anonymization configuration
 typedef struct {
     DB_TagRule* tagRules;      // Array of tag rules
     int tagRuleCount;          // Number of rules in array
-    bool removePrivateTags;    // Remove all private tags
+    bool removePrivateTags;    // Remove all private tags but those in privateTagRules
     bool replaceStudyUID;      // Replace Study Instance UID
     bool replaceSeriesUID;     // Replace Series Instance UID
     bool replaceSOPUID;        // Replace SOP Instance UID
-    int dateShiftDays;         // Number of days to shift dates (0 = no shift, -1 = remove dates)
+    int dateShiftDays;         // Number of days to shift every DA and DT value, in sequences
+                               // too (0 = no shift, -1 = remove all DA, DT and TM elements)
+    bool preserveTransferSyntax; // Keep the original transfer syntax and copy the encoded
+                                 // PixelData bytes unchanged (never decoded or held in
+                                 // memory); otherwise save as explicit little endian
+    DB_UIDMap* uidMap;         // Optional. UIDs are remapped through it instead of being
+                               // generated per file: those selected by the replace flags
+                               // and GENERATE_UID rules, at any depth, and the references
+                               // to them (ReferencedSOPInstanceUID follows SOP Instance
+                               // UID, ReferencedFrameOfReferenceUID and
+                               // RelatedFrameOfReferenceUID follow FrameOfReferenceUID).
+                               // Other UIDs are kept. Explicit rules for a tag take
+                               // precedence.
+    const char* hashKey;       // Optional project secret. HASH becomes HMAC-SHA256 with
+                               // this key, and new UIDs are derived from the keyed hash
+                               // of the original UID, so every machine with the key
+                               // produces identical output
+    const char* uidRoot;       // Root for derived UIDs (digits and dots, at most 32
+                               // characters); NULL = "2.25"
+    const DB_RedactionRule* redactionRules; // Burned-in annotation blanked in the pixels
+    int redactionRuleCount;
+    int textScanBorder;        // Width in pixels of the image edges scanned for burned-in
+                               // text, bands that look like text are blanked (0 = off)
+    const DB_PrivateTagRule* privateTagRules; // Private attributes removePrivateTags keeps,
+                                              // with their Private Creator elements; tag
+                                              // rules, date shift and UID remapping still
+                                              // apply to them
+    int privateTagRuleCount;
+    DB_PatientOverrideCallback patientOverride; // Optional. Per-patient PatientID and
+                                                // date shift, so one batch can span
+                                                // patients
+    void* patientOverrideUserData;
 } DB_AnonymizationConfig;
 
 /// Anonymize a DICOM file
@@ -253,14 +785,162 @@ DB_Status db_anonymize_file(const char* inputPath,
                              const char* outputPath,
                              const DB_AnonymizationConfig* config);
 
-/// Anonymize a DICOM file in-place
+/// Anonymize a DICOM file in-place. The result is written to a temporary
+/// file beside it, synced, and renamed over the original, so a crash
+/// leaves either the original or the anonymized file, never neither.
 /// - filePath: Path to DICOM file to anonymize
 /// - config: Anonymization configuration
 /// Returns DB_STATUS_OK on success, error code otherwise
 DB_Status db_anonymize_file_inplace(const char* filePath,
                                      const DB_AnonymizationConfig* config);
 
-/// Generate a hash string for patient ID mapping
+/// Callback invoked as each file of a batch completes. Calls are
+/// serialized but come from the worker threads.
+/// - filesDone: Files completed so far, including this one
+/// - fileIndex: Index of this file in the batch
+/// - status: Result for this file
+typedef void (*DB_AnonymizeProgressCallback)(void* userData,
+                                             int filesDone,
+                                             int fileCount,
+                                             int fileIndex,
+                                             DB_Status status);
+
+/// Anonymize many files with one configuration. The configuration is
+/// compiled once into a sorted rule table and each dataset is rewritten in
+/// a single walk; files are processed concurrently. With a patientOverride
+/// the files of several patients share the batch, each patient's values
+/// resolved as the first of their files is read.
+/// - inputPaths / outputPaths: fileCount paths each, output i for input i
+/// - config: Anonymization configuration
+/// - threadCount: Worker threads, 0 = one per core
+/// - outStatuses: Optional array of fileCount per-file results
+/// - onProgress: Optional progress callback
+/// - userData: User context passed to callback
+/// Returns DB_STATUS_OK if every file was anonymized, DB_STATUS_ERROR otherwise
+DB_Status db_anonymize_batch(const char* const* inputPaths,
+                             const char* const* outputPaths,
+                             int fileCount,
+                             const DB_AnonymizationConfig* config,
+                             int threadCount,
+                             DB_Status* outStatuses,
+                             DB_AnonymizeProgressCallback onProgress,
+                             void* userData);
+
+/// Anonymize many files in place, each replaced atomically as by
+/// db_anonymize_file_inplace. Each replacement is recorded in a journal
+/// before the rename, so a batch interrupted by a crash can be run again
+/// with the same journal: files already replaced are skipped (reported
+/// DB_STATUS_OK) rather than anonymized twice, and a replacement cut short
+/// between sync and rename is completed. The journal is deleted once every
+/// file has succeeded. Pass a persisted uidMap in config so resumed files
+/// map UIDs the way the first run did.
+/// - filePaths: fileCount paths
+/// - config: Anonymization configuration
+/// - journalPath: Journal file, created if missing
+/// - threadCount: Worker threads, 0 = one per core
+/// - outStatuses: Optional array of fileCount per-file results
+/// - onProgress: Optional progress callback
+/// - userData: User context passed to callback
+/// Returns DB_STATUS_OK if every file was anonymized, DB_STATUS_ERROR otherwise
+DB_Status db_anonymize_batch_inplace(const char* const* filePaths,
+                                     int fileCount,
+                                     const DB_AnonymizationConfig* config,
+                                     const char* journalPath,
+                                     int threadCount,
+                                     DB_Status* outStatuses,
+                                     DB_AnonymizeProgressCallback onProgress,
+                                     void* userData);
+
+/// What anonymizing one file would change
+typedef struct {
+    DB_Status status;           // DB_STATUS_OK, or why the file could not be read
+    int tagsRemoved;            // Elements removed, at any depth
+    int tagsReplaced;           // Values set by a rule
+    int tagsAdded;              // Elements a rule creates
+    int datesShifted;           // DA and DT values shifted
+    int uidsRemapped;           // UI values replaced or remapped
+    int privateGroupCount;      // Distinct private groups in the file
+    uint16_t privateGroups[16]; // The first 16 of them, ascending
+} DB_AnonymizationFileReport;
+
+/// Changes to one tag across a dry run
+typedef struct {
+    uint16_t group;
+    uint16_t element;
+    int removed;
+    int replaced;
+    int added;
+    int shifted;
+    int remapped;
+} DB_TagChangeCount;
+
+/// Totals of a dry run
+typedef struct {
+    int filesScanned;
+    int filesFailed;
+    int filesWithPrivateTags;
+    int64_t tagsRemoved;
+    int64_t tagsReplaced;
+    int64_t tagsAdded;
+    int64_t datesShifted;
+    int64_t uidsRemapped;
+    int privateGroupCount;              // Distinct private groups in all files
+    uint16_t privateGroups[64];         // The first 64 of them, ascending
+    int tagChangeCount;                 // Distinct tags changed
+    DB_TagChangeCount tagChanges[256];  // The most changed first
+} DB_AnonymizationSummary;
+
+/// Preview an anonymization: apply config to each file in memory, in
+/// parallel, and report the changes without writing anything. A batch UID
+/// map in config is left untouched; a scratch map stands in for it. Pixel
+/// redaction is not previewed.
+/// - outReports: Optional array of fileCount per-file reports
+/// - outSummary: Optional totals
+/// Returns DB_STATUS_OK if every file could be read, DB_STATUS_ERROR otherwise
+DB_Status db_anonymize_dry_run(const char* const* inputPaths,
+                               int fileCount,
+                               const DB_AnonymizationConfig* config,
+                               int threadCount,
+                               DB_AnonymizationFileReport* outReports,
+                               DB_AnonymizationSummary* outSummary,
+                               DB_AnonymizeProgressCallback onProgress,
+                               void* userData);
+
+/// Create a UID map.
+/// - persistPath: Optional file the mappings are loaded from and appended
+///   to, so a later batch (or a resumed one) maps UIDs the same way
+/// Returns NULL if persistPath cannot be read or written
+DB_UIDMap* db_uid_map_create(const char* persistPath);
+void db_uid_map_destroy(DB_UIDMap* uidMap);
+
+/// Replacement UID for originalUID, assigned on first use. Thread-safe.
+/// - outUID: Buffer for the UID (must be at least 65 bytes)
+DB_Status db_uid_map_get(DB_UIDMap* uidMap,
+                         const char* originalUID,
+                         char* outUID,
+                         size_t outSize);
+
+/// Number of UIDs mapped so far.
+int db_uid_map_count(DB_UIDMap* uidMap);
+
+/// Scan each frame's edges, border pixels wide, for burned-in text.
+/// - outFrameFlags: DB_TEXT_BORDER_* sides flagged, per frame (up to maxFrames)
+/// - outFrameCount: Number of frames in the file (may be NULL)
+DB_Status db_detect_burned_in_text(const char* filePath,
+                                   int border,
+                                   uint8_t* outFrameFlags,
+                                   int maxFrames,
+                                   int* outFrameCount);
+
+/// Action for a PS3.15 Basic Profile action code: "X", "Z", "D", "K",
+/// "C" or "U". Combined codes ("Z/D", "X/Z", "X/D", "X/Z/D", "X/Z/U*")
+/// take the action valid whatever the attribute's type in the IOD.
+/// Returns DB_STATUS_ERROR for an unknown code.
+DB_Status db_tag_action_from_profile_code(const char* code,
+                                          DB_TagAction* outAction);
+
+/// Generate a hash string for patient ID mapping (SHA-256, lower case
+/// hex, the same on every platform)
 /// - input: Original value to hash
 /// - output: Buffer to store hash (must be at least 65 bytes)
 /// - outputSize: Size of output buffer
@@ -268,6 +948,239 @@ void db_generate_hash(const char* input,
                       char* output,
                       size_t outputSize);
 
+/// Keyed hash for pseudonyms (HMAC-SHA256, lower case hex). Without the
+/// key a pseudonym cannot be recomputed from a guessed original value.
+/// - key: Project secret
+/// - output: Buffer to store hash (must be at least 65 bytes)
+DB_Status db_generate_keyed_hash(const char* key,
+                                 const char* input,
+                                 char* output,
+                                 size_t outputSize);
+
+/// UID derived from the keyed hash of originalUID, as anonymization with
+/// hashKey and uidRoot assigns it.
+/// - uidRoot: NULL = "2.25"
+/// - outUID: Buffer for the UID (must be at least 65 bytes)
+DB_Status db_generate_derived_uid(const char* key,
+                                  const char* uidRoot,
+                                  const char* originalUID,
+                                  char* outUID,
+                                  size_t outSize);
+
+// ============================================================================
+// IMAGE EXPORT FUNCTIONS
+// ============================================================================
+
+/// Image file format of an export
+typedef enum {
+    DB_EXPORT_FORMAT_PNG = 0,
+    DB_EXPORT_FORMAT_JPEG = 1,
+    DB_EXPORT_FORMAT_TIFF = 2
+} DB_ExportFormat;
+
+/// Window applied to grayscale frames; color frames are exported as they are
+typedef enum {
+    DB_EXPORT_WINDOW_FILE = 0,          // First WindowCenter/Width of the file,
+                                        // full range without one
+    DB_EXPORT_WINDOW_CUSTOM = 1,        // windowCenter and windowWidth of the options
+    DB_EXPORT_WINDOW_FULL_RANGE = 2     // Minimum to maximum of each frame
+} DB_ExportWindowMode;
+
+/// One frame to export
+typedef struct {
+    const char* inputPath;
+    int frameIndex;
+    const char* outputPath;     // Its directory must exist
+} DB_ExportItem;
+
+/// Export settings shared by every item of a batch
+typedef struct {
+    DB_ExportFormat format;
+    DB_ExportWindowMode windowMode;
+    double windowCenter;        // In modality units (after Rescale Slope and
+    double windowWidth;         // Intercept), for DB_EXPORT_WINDOW_CUSTOM
+    int quality;                // JPEG quality 1-100 (0 = 90)
+    int bitDepth;               // 16 = 16-bit grayscale PNG and TIFF, windowed to
+                                // 0-65535; otherwise (and for JPEG and color) 8
+    int threadCount;            // Worker threads, 0 = one per core
+    int queueDepth;             // Frames waiting between two stages, bounding
+                                // memory (0 = two per thread)
+} DB_ExportOptions;
+
+/// Callback invoked as each item of an export completes. Calls are
+/// serialized but come from the worker threads.
+typedef void (*DB_ExportProgressCallback)(void* userData,
+                                          int itemsDone,
+                                          int itemCount,
+                                          int itemIndex,
+                                          DB_Status status);
+
+/// Export frames as image files. Decoding, windowing and encoding run as
+/// a pipeline, each stage on its own threads with bounded queues between
+/// them, so every core works and at most a few frames are held in memory.
+/// - items: itemCount frames, written to their outputPath
+/// - outStatuses: Optional array of itemCount per-item results
+/// Returns DB_STATUS_OK if every item was exported, DB_STATUS_ERROR otherwise
+DB_Status db_export_images(const DB_ExportItem* items,
+                           int itemCount,
+                           const DB_ExportOptions* options,
+                           DB_Status* outStatuses,
+                           DB_ExportProgressCallback onProgress,
+                           void* userData);
+
+/// Check the vectorized PNG row filters (Sub, Up, Average, Paeth) and the
+/// residual cost that picks between them against their one-byte-at-a-time
+/// definitions, over generated rows of bitDepth 8 or 16 and 1, 3 and 4
+/// channels. DB_STATUS_OK if every result is identical.
+DB_Status db_png_filters_self_check(int bitDepth);
+
+// ============================================================================
+// TRANSCODING FUNCTIONS
+// ============================================================================
+
+/// Transfer syntax a transcode writes
+typedef enum {
+    DB_TRANSFER_SYNTAX_EXPLICIT_LITTLE = 0,         // Uncompressed, Explicit VR Little Endian
+    DB_TRANSFER_SYNTAX_JPEG_LOSSLESS = 1,           // JPEG Lossless, Process 14 SV1
+    DB_TRANSFER_SYNTAX_JPEG_LS_LOSSLESS = 2,
+    DB_TRANSFER_SYNTAX_JPEG_LS_NEAR_LOSSLESS = 3,   // Lossy: new SOP Instance UID
+    DB_TRANSFER_SYNTAX_RLE = 4
+} DB_TransferSyntax;
+
+/// Transcode settings shared by every file of a batch
+typedef struct {
+    DB_TransferSyntax transferSyntax;
+    int nearLosslessError;      // Largest sample error of JPEG-LS near-lossless
+                                // (0 = 2)
+    int threadCount;            // Worker threads, 0 = one per core
+} DB_TranscodeOptions;
+
+/// Callback invoked as each file of a transcode completes. Calls are
+/// serialized but come from the worker threads.
+typedef void (*DB_TranscodeProgressCallback)(void* userData,
+                                             int filesDone,
+                                             int fileCount,
+                                             int fileIndex,
+                                             DB_Status status);
+
+/// Convert files to another transfer syntax, several files at a time.
+/// Frames are decoded and encoded one at a time, so a multi-frame object
+/// never has all of its uncompressed pixels in memory unless it is being
+/// written uncompressed. Files already in the target syntax are copied.
+/// - inputPaths, outputPaths: fileCount paths each; an output may be its
+///   input, which is replaced atomically
+/// - outStatuses: Optional array of fileCount per-file results
+/// Returns DB_STATUS_OK if every file was transcoded, DB_STATUS_ERROR otherwise
+DB_Status db_transcode_files(const char* const* inputPaths,
+                             const char* const* outputPaths,
+                             int fileCount,
+                             const DB_TranscodeOptions* options,
+                             DB_Status* outStatuses,
+                             DB_TranscodeProgressCallback onProgress,
+                             void* userData);
+
+// ============================================================================
+// CINE EXPORT FUNCTIONS
+// ============================================================================
+
+/// Container and frame encoding of a cine export
+typedef enum {
+    DB_CINE_FORMAT_AVI_UNCOMPRESSED = 0,    // 24-bit RGB frames
+    DB_CINE_FORMAT_AVI_MJPEG = 1,           // Baseline JPEG frames
+    DB_CINE_FORMAT_APNG = 2                 // Animated PNG, looping
+} DB_CineFormat;
+
+/// Cine export settings
+typedef struct {
+    DB_CineFormat format;
+    DB_ExportWindowMode windowMode;     // As for db_export_images, except that
+    double windowCenter;                // DB_EXPORT_WINDOW_FILE without a window
+    double windowWidth;                 // uses the full stored range, the same
+                                        // for every frame
+    int quality;                        // MJPEG quality 1-100 (0 = 90)
+    double framesPerSecond;             // 0 = each input's FrameTimeVector, else
+                                        // CineRate, FrameTime or
+                                        // RecommendedDisplayFrameRate (else 10)
+    int threadCount;                    // Worker threads, 0 = one per core
+    int queueDepth;                     // Frames between decoding and writing,
+                                        // bounding memory (0 = two per thread)
+} DB_CineOptions;
+
+/// Callback invoked as each frame of a cine export is written, in order.
+/// Called on the exporting thread.
+typedef void (*DB_CineProgressCallback)(void* userData,
+                                        int framesDone,
+                                        int frameCount);
+
+/// Export a cine loop as one video file: every frame of inputPaths, in
+/// order, so either one multi-frame object or an ordered series of images.
+/// Frames are decoded and windowed on some threads and encoded on others
+/// while this thread writes them, so decoding and encoding overlap.
+/// All frames must have the same size and be all grayscale or all color.
+/// AVI output is AVI 1.0, so at most 4 GB.
+/// - frame pacing: options->framesPerSecond, else each input's
+///   FrameTimeVector (APNG per frame, AVI its mean), else the rate of the
+///   first input
+/// The file is written beside outputPath and renamed over it at the end.
+/// Returns DB_STATUS_NOT_FOUND if an input cannot be read, DB_STATUS_ERROR
+/// on any other failure, in which case any earlier file at outputPath is
+/// left as it was
+DB_Status db_export_cine(const char* const* inputPaths,
+                         int inputCount,
+                         const char* outputPath,
+                         const DB_CineOptions* options,
+                         DB_CineProgressCallback onProgress,
+                         void* userData);
+
+// ============================================================================
+// MEDIA EXPORT FUNCTIONS
+// ============================================================================
+
+/// One instance to put on media, with the tags its directory records take
+typedef struct {
+    const char* inputPath;
+    DB_DicomTags tags;          // As extracted by db_extract_tags; text as UTF-8
+} DB_MediaItem;
+
+/// Media export settings
+typedef struct {
+    const char* fileSetID;      // Up to 16 of A-Z, 0-9, space and _ (NULL = none)
+    int transcode;              // 1 = write files in transferSyntax, 0 = copy them
+    DB_TransferSyntax transferSyntax;
+    int nearLosslessError;      // As for DB_TranscodeOptions
+    int threadCount;            // Worker threads, 0 = one per core
+} DB_MediaOptions;
+
+/// Callback invoked as each file of a media export is written. Calls are
+/// serialized but come from the worker threads (skipped duplicates last,
+/// from the exporting thread).
+typedef void (*DB_MediaProgressCallback)(void* userData,
+                                         int filesDone,
+                                         int fileCount,
+                                         int fileIndex,
+                                         DB_Status status);
+
+/// Write a PS3.10 file set for media such as a patient CD: each instance
+/// as DICOM/PATnnnnn/STUnnnnn/SERnnnnn/IMGnnnnn under outputDirectory and
+/// a DICOMDIR at its root. Files are copied, or transcoded, several at a
+/// time. The directory records are built from items' tags and each
+/// written file's meta header; only the records other than IMAGE that a
+/// SOP class calls for (SR DOCUMENT, PRESENTATION, RT DOSE, ...) read
+/// their keys from the file. Instances whose SOP Instance UID came earlier
+/// in items are skipped and get the result of the first.
+/// - outputDirectory: Created if missing; must not hold a DICOMDIR yet
+/// - outStatuses: Optional array of itemCount per-item results
+/// Returns DB_STATUS_OK if every item and the DICOMDIR were written,
+/// DB_STATUS_ERROR otherwise. The DICOMDIR is only written once every
+/// item is, so a failed export can be run again into the same directory
+DB_Status db_export_media(const DB_MediaItem* items,
+                          int itemCount,
+                          const char* outputDirectory,
+                          const DB_MediaOptions* options,
+                          DB_Status* outStatuses,
+                          DB_MediaProgressCallback onProgress,
+                          void* userData);
+
 #ifdef __cplusplus
 }
 #endif
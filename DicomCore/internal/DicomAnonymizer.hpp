@@ -0,0 +1,172 @@
+//
+//  DicomAnonymizer.hpp
+//  DicomCore
+//
+//  Internal C++ header. NOT exposed to Swift.
+//  A DB_AnonymizationConfig compiled once into a tag-sorted rule table and
+//  applied to each dataset in a single ordered walk that descends into
+//  sequence items.
+//
+
+#ifndef DICOM_ANONYMIZER_HPP
+#define DICOM_ANONYMIZER_HPP
+
+#include "DicomBridge.h"
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/dcmdata/dcfilefo.h"
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace dicomcore {
+
+class HmacSha256;
+class RedactionPlan;
+class UIDMap;
+
+/// Unkeyed hash (SHA-256, hex) for DB_TAG_ACTION_HASH and db_generate_hash.
+std::string hashString(const std::string& input);
+
+/// One rule of a compiled program.
+struct CompiledRule {
+    uint32_t tag;               // group << 16 | element
+    DB_TagAction action;
+    std::string replacement;
+};
+
+/// What applying a program changed in one dataset, for dry runs.
+struct AnonymizationReport {
+    enum Change { kRemoved, kReplaced, kAdded, kShifted, kRemapped, kChangeCount };
+
+    void record(uint32_t tag, Change change) {
+        totals[change]++;
+        tags[tag][change]++;
+    }
+
+    std::array<int, kChangeCount> totals = {};
+    std::map<uint32_t, std::array<int, kChangeCount>> tags;    // By tag
+    std::set<uint16_t> privateGroups;                           // Seen, removed or not
+};
+
+/// Immutable once built, so one program is shared by all worker threads.
+/// With a patientOverride, each patient's files go through a program of
+/// their own, compiled on that patient's first file.
+class AnonymizationProgram {
+public:
+    explicit AnonymizationProgram(const DB_AnonymizationConfig& config);
+    ~AnonymizationProgram();
+
+    /// Apply the program to a loaded file (dataset and meta header),
+    /// recording each change in report if one is given.
+    void apply(DcmFileFormat& fileFormat, AnonymizationReport* report = nullptr) const;
+
+    /// Load inputPath, apply the program and save to outputPath.
+    DB_Status anonymizeFile(const char* inputPath, const char* outputPath) const;
+
+    /// Load inputPath and apply the program, writing nothing. Pixel
+    /// redaction is not part of a dry run.
+    DB_Status dryRun(const char* inputPath, AnonymizationReport& report) const;
+
+private:
+    /// The program for the patient of dataset: this one, or the one
+    /// compiled with the values patientOverride gave for the patient.
+    const AnonymizationProgram& programFor(DcmDataset* dataset) const;
+
+    /// Redact, apply and save a loaded file.
+    DB_Status anonymizeLoaded(DcmFileFormat& fileFormat, const char* inputPath,
+                              const char* outputPath) const;
+
+    /// New value for an element under rule.
+    bool ruleValue(const CompiledRule& rule, DcmEVR vr, bool present,
+                   const OFString& original, std::string& value) const;
+
+    /// New UID for an original one: through the batch's UID map if there is
+    /// one, derived from the keyed hash if there is a key, else generated.
+    std::string replacementUID(const std::string& original) const;
+    std::string assignUID(const std::string& original) const;
+
+    /// Map each instance UID of a UI element.
+    void remapUIDElement(DcmElement* elem, AnonymizationReport* report) const;
+
+    /// Whether elem refers to a UID the program replaces (a
+    /// ReferencedSOPInstanceUID while SOP Instance UIDs are replaced, ...).
+    bool followsReplacedUID(DcmElement* elem) const;
+    bool replacesUID(uint32_t tag) const;
+
+    /// Date shift or removal for a value of vr; false if it is removed.
+    bool dateValue(DcmEVR vr, std::string& value) const;
+
+    /// Private creators of the blocks of one group of an item, resolved
+    /// to the offsets kept in each block.
+    struct PrivateBlocks {
+        uint16_t group = 0;
+        const std::bitset<256>* keptOffsets[256];
+    };
+
+    /// Whether a private element survives removePrivateTags: a creator
+    /// with kept offsets, or an element at one of them. Creators precede
+    /// their blocks in tag order, so blocks is filled as the walk goes.
+    bool keepsPrivate(DcmElement* elem, const DcmTagKey& key, PrivateBlocks& blocks) const;
+
+    /// Apply the rules to the elements of item and, through sequences, to
+    /// every item below it. Elements are removed after the walk. Rules
+    /// whose tag item lacks are added to missing if it is given.
+    void applyRules(DcmItem* item, std::vector<const CompiledRule*>* missing,
+                    AnonymizationReport* report) const;
+
+    /// What happens to elements without a rule, or kept: DA and DT shifted
+    /// (DA, DT and TM removed for dateShiftDays -1), references to replaced
+    /// UIDs remapped, and sequence items walked with the rules.
+    /// False if elem is to be removed from its item.
+    bool applyDefaults(DcmElement* elem, AnonymizationReport* report) const;
+
+    /// Handler of one action, false if elem is to be removed.
+    typedef bool (AnonymizationProgram::*ActionHandler)(DcmElement* elem,
+                                                        const CompiledRule& rule,
+                                                        AnonymizationReport* report) const;
+    static const ActionHandler kActionHandlers[];
+
+    bool removeElement(DcmElement* elem, const CompiledRule& rule,
+                       AnonymizationReport* report) const;
+    bool keepElement(DcmElement* elem, const CompiledRule& rule,
+                     AnonymizationReport* report) const;
+    bool replaceElement(DcmElement* elem, const CompiledRule& rule,     // Value rules
+                        AnonymizationReport* report) const;
+    bool cleanElement(DcmElement* elem, const CompiledRule& rule,
+                      AnonymizationReport* report) const;
+
+    /// Save in the original transfer syntax, copying the encoded PixelData
+    /// bytes from inputPath instead of writing them from memory.
+    DB_Status saveStreaming(DcmFileFormat& fileFormat, const char* inputPath,
+                            const char* outputPath) const;
+
+    CompiledRule& ruleFor(uint32_t tag);     // Inserted as KEEP if missing
+    void overrideRule(uint32_t tag, DB_TagAction action);
+
+    std::vector<CompiledRule> rules;    // Sorted by tag, one per tag
+    bool removePrivateTags;
+    std::unordered_map<std::string, std::bitset<256>> privateKeeps;    // By group and creator
+    int dateShiftDays;
+    bool preserveTransferSyntax;
+    UIDMap* uidMap;                     // Shared by the batch, thread-safe
+    bool walksSequences;
+    std::unique_ptr<HmacSha256> hmac;   // Set when the config has a hashKey
+    std::unique_ptr<RedactionPlan> redaction;   // Set when there is pixel redaction
+    std::string uidRoot;
+
+    // Per-patient programs; the configuration outlives the program
+    DB_AnonymizationConfig config;
+    mutable std::mutex patientMutex;
+    mutable std::map<std::string, std::unique_ptr<AnonymizationProgram>> patientPrograms;  // Null = this
+};
+
+}  // namespace dicomcore
+
+#endif /* DICOM_ANONYMIZER_HPP */
@@ -0,0 +1,109 @@
+//
+//  DicomCodecs.hpp
+//  DicomCore
+//
+//  Internal C++ header. NOT exposed to Swift.
+//  Frame-by-frame access to PixelData, native or encapsulated, through
+//  DCMTK's JPEG, JPEG-LS and RLE codecs.
+//
+
+#ifndef DICOM_CODECS_HPP
+#define DICOM_CODECS_HPP
+
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/dcmdata/dctk.h"
+#include "dcmtk/dcmdata/dcfcache.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dicomcore {
+
+/// Register DCMTK's decoders and encoders, once per process.
+void registerCodecs();
+
+/// Image Pixel module attributes that address frames of PixelData.
+struct FrameLayout {
+    uint32_t rows = 0;
+    uint32_t columns = 0;
+    uint32_t frameCount = 1;
+    uint16_t samplesPerPixel = 1;
+    uint16_t bitsAllocated = 0;
+    uint16_t bitsStored = 0;
+    uint16_t highBit = 0;
+    bool isSigned = false;
+    bool planar = false;            // Color by plane (PlanarConfiguration 1)
+    std::string photometric;
+
+    size_t frameBytes() const {
+        return (size_t)rows * columns * samplesPerPixel * (bitsAllocated / 8);
+    }
+};
+
+/// Read the layout of dataset's image; false if it has none with 8 or 16
+/// bits allocated.
+bool readFrameLayout(DcmItem* dataset, FrameLayout& layout);
+
+/// Compress one frame alone into xfer, with parameter or the codec's
+/// defaults if it is null. The fragments are left in encoded, the pixel
+/// sequence of frameSet, which owns them until they are moved out.
+bool encodeFrame(const FrameLayout& layout, const uint8_t* pixels, E_TransferSyntax xfer,
+                 const DcmRepresentationParameter* parameter, DcmDataset& frameSet,
+                 DcmPixelSequence*& encoded);
+
+/// One frame at a time from a loaded dataset. Native frames are addressed
+/// in place; encapsulated ones are decoded into a buffer and, once
+/// changed, re-encoded in the original transfer syntax in place of their
+/// own fragments, so frames nobody touched keep their compressed bytes.
+class FrameAccess {
+public:
+    /// False if the dataset has no PixelData this can address. Without
+    /// writable, native frames are read from the file one at a time
+    /// instead of loading all of PixelData.
+    bool open(DcmDataset* dataset, bool writable = true);
+
+    /// Layout of the frames as frame() returns them: after decoding the
+    /// photometric interpretation and planar configuration are those the
+    /// codec produces.
+    const FrameLayout& layout() const { return frameLayout; }
+    bool isEncapsulated() const { return encapsulated; }
+
+    /// Pixels of frame index, frameBytes() of them, nullptr on failure.
+    /// Writable: native frames opened writable change in the dataset
+    /// directly, decoded ones only when passed to replaceFrame.
+    uint8_t* frame(uint32_t index);
+
+    /// Re-encode a decoded frame after changing it. Nothing to do for
+    /// native frames.
+    bool replaceFrame(uint32_t index);
+
+    /// After replacing frames: the offset tables no longer match, so the
+    /// Basic Offset Table is emptied and the Extended one removed.
+    void finish();
+
+private:
+    bool mapFragments();
+
+    DcmDataset* dataset = nullptr;
+    DcmPixelData* pixelData = nullptr;
+    DcmPixelSequence* sequence = nullptr;
+    E_TransferSyntax xfer = EXS_Unknown;
+    FrameLayout frameLayout;
+    bool encapsulated = false;
+    bool replaced = false;
+
+    uint8_t* nativePixels = nullptr;
+    std::vector<uint8_t> decoded;       // Decoded, or read, frame
+    DcmFileCache fileCache;             // Keeps the file open between frames
+    uint32_t decodedIndex = UINT32_MAX;
+
+    // First pixel item and item count of each frame (item 0 is the
+    // Basic Offset Table)
+    std::vector<std::pair<unsigned long, unsigned long>> fragments;
+};
+
+}  // namespace dicomcore
+
+#endif /* DICOM_CODECS_HPP */
@@ -0,0 +1,38 @@
+//
+//  DicomDateShift.hpp
+//  DicomCore
+//
+//  Internal C++ header. NOT exposed to Swift.
+//  Shifting DA and DT values by whole days with proleptic Gregorian
+//  calendar arithmetic.
+//
+
+#ifndef DICOM_DATE_SHIFT_HPP
+#define DICOM_DATE_SHIFT_HPP
+
+#include <cstdint>
+#include <string>
+
+namespace dicomcore {
+
+/// Days since 1970-01-01 of a civil date (month 1-12, day 1-31).
+int64_t daysFromCivil(int64_t year, unsigned month, unsigned day);
+
+/// Civil date of a day count since 1970-01-01.
+void civilFromDays(int64_t days, int64_t& year, unsigned& month, unsigned& day);
+
+/// Shift a DA value by days: single dates (YYYYMMDD, or the old
+/// YYYY.MM.DD which is rewritten as YYYYMMDD), ranges with either end
+/// open, and several values separated by backslashes. False if the value
+/// is not a valid DA, shifted is then unchanged.
+bool shiftDA(const std::string& value, int days, std::string& shifted);
+
+/// Shift a DT value by days. The date part moves, time of day, fraction
+/// and UTC offset are kept. A value of year or month precision is shifted
+/// from the first day of that period and keeps its precision. Ranges and
+/// multiple values as for shiftDA.
+bool shiftDT(const std::string& value, int days, std::string& shifted);
+
+}  // namespace dicomcore
+
+#endif /* DICOM_DATE_SHIFT_HPP */
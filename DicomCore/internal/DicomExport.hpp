@@ -0,0 +1,42 @@
+//
+//  DicomExport.hpp
+//  DicomCore
+//
+//  Internal C++ header. NOT exposed to Swift.
+//  Decoding frames and windowing them for display, shared by the image
+//  and cine exports.
+//
+
+#ifndef DICOM_EXPORT_HPP
+#define DICOM_EXPORT_HPP
+
+#include "DicomBridge.h"
+#include "DicomCodecs.hpp"
+#include "DicomImageEncode.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace dicomcore {
+
+/// A frame as stored, with what windowing needs from its dataset.
+struct DecodedFrame {
+    size_t index = 0;
+    FrameLayout layout;
+    std::vector<uint8_t> samples;
+    double slope = 1.0;
+    double intercept = 0.0;
+    bool hasWindow = false;
+    double windowCenter = 0.0;
+    double windowWidth = 0.0;
+};
+
+/// Copy frame index of dataset, opened in access, into decoded.
+bool readFrame(DcmDataset* dataset, FrameAccess& access, uint32_t index, DecodedFrame& decoded);
+
+/// Window a grayscale frame, or convert a color one to RGB, for display.
+/// The window mode, and bit depth, are those of options.
+bool renderFrame(const DecodedFrame& frame, const DB_ExportOptions& options, RenderedImage& image);
+
+}  // namespace dicomcore
+
+#endif /* DICOM_EXPORT_HPP */
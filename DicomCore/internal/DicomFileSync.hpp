@@ -0,0 +1,41 @@
+//
+//  DicomFileSync.hpp
+//  DicomCore
+//
+//  Internal C++ header. NOT exposed to Swift.
+//  Durable writes: flushing files and directory entries to storage, and
+//  replacing a file so a crash leaves either the old or the new one.
+//
+
+#ifndef DICOM_FILE_SYNC_HPP
+#define DICOM_FILE_SYNC_HPP
+
+#include <string>
+
+namespace dicomcore {
+
+/// Flush a file's data to storage, past the drive cache where the
+/// platform allows it.
+bool syncFile(const std::string& path);
+
+/// Flush the directory entry changes (creations, renames) of the
+/// directory holding path.
+bool syncParentDirectory(const std::string& path);
+
+/// The temporary file a replacement of path is written to: a sibling,
+/// since rename is only atomic within one file system.
+std::string replacementPath(const std::string& path);
+
+/// Give tempPath, fully written, the permissions of targetPath and sync
+/// it; it can then be renamed over the target at any later time.
+bool prepareReplacement(const std::string& tempPath, const std::string& targetPath);
+
+/// Rename a prepared tempPath over targetPath and sync the directory.
+bool commitReplacement(const std::string& tempPath, const std::string& targetPath);
+
+/// Both steps: a crash at any point leaves a complete file at targetPath.
+bool replaceFile(const std::string& tempPath, const std::string& targetPath);
+
+}  // namespace dicomcore
+
+#endif /* DICOM_FILE_SYNC_HPP */
@@ -0,0 +1,69 @@
+//
+//  DicomHash.hpp
+//  DicomCore
+//
+//  Internal C++ header. NOT exposed to Swift.
+//  SHA-256 and HMAC-SHA256 for pseudonymization, identical on every
+//  platform and build, and UIDs derived from them.
+//
+
+#ifndef DICOM_HASH_HPP
+#define DICOM_HASH_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace dicomcore {
+
+using Digest = std::array<uint8_t, 32>;
+
+class Sha256 {
+public:
+    Sha256();
+
+    void update(const void* data, size_t length);
+    Digest finish();
+
+private:
+    friend class HmacSha256;
+
+    uint32_t state[8];
+    uint8_t buffer[64];
+    size_t buffered = 0;
+    uint64_t totalLength = 0;
+};
+
+/// The key is absorbed once: the hashing state after the inner and outer
+/// key blocks is kept, so each message costs only its own blocks plus one
+/// block for the outer hash. Immutable once built, shared by threads.
+class HmacSha256 {
+public:
+    explicit HmacSha256(const std::string& key);
+
+    Digest digest(const void* data, size_t length) const;
+    Digest digest(const std::string& message) const {
+        return digest(message.data(), message.size());
+    }
+
+private:
+    Sha256 inner;
+    Sha256 outer;
+};
+
+/// Lower case hex of a digest (64 characters).
+std::string toHex(const Digest& digest);
+
+/// root if it is usable for derived UIDs (digits and dots, at most 32
+/// characters), else "2.25".
+std::string derivedUIDRoot(const char* root);
+
+/// UID made of root and the leading 128 bits of digest as a decimal
+/// number, shortened to the 64 characters a UID may have. root "2.25" gives
+/// the form PS3.5 uses for UUID-derived UIDs.
+std::string uidFromDigest(const std::string& root, const Digest& digest);
+
+}  // namespace dicomcore
+
+#endif /* DICOM_HASH_HPP */
@@ -0,0 +1,43 @@
+//
+//  DicomImageEncode.hpp
+//  DicomCore
+//
+//  Internal C++ header. NOT exposed to Swift.
+//  Encoding rendered frames as PNG, JPEG and TIFF files in memory.
+//
+
+#ifndef DICOM_IMAGE_ENCODE_HPP
+#define DICOM_IMAGE_ENCODE_HPP
+
+#include <cstdint>
+#include <vector>
+
+namespace dicomcore {
+
+/// A frame rendered for display: gray or RGB samples, rows top to bottom
+/// without padding.
+struct RenderedImage {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    unsigned channels = 1;          // 1 = gray, 3 = RGB
+    unsigned bitDepth = 8;          // 8, or 16 with samples as host-order uint16
+    std::vector<uint8_t> pixels;
+};
+
+/// 8- or 16-bit PNG. Each row gets the filter type with the smallest
+/// residuals, and deflate runs at its fastest setting.
+bool encodePNG(const RenderedImage& image, std::vector<uint8_t>& out);
+
+/// Whether the PNG row filters and their residual cost give exactly what
+/// the scalar definitions give, for rows of bitDepth 8 or 16.
+bool pngFiltersMatchReference(unsigned bitDepth);
+
+/// Baseline JPEG with a JFIF header; quality 1-100. 8-bit only.
+bool encodeJPEG(const RenderedImage& image, int quality, std::vector<uint8_t>& out);
+
+/// Uncompressed baseline TIFF, one strip, 8 or 16 bits.
+bool encodeTIFF(const RenderedImage& image, std::vector<uint8_t>& out);
+
+}  // namespace dicomcore
+
+#endif /* DICOM_IMAGE_ENCODE_HPP */
@@ -0,0 +1,61 @@
+//
+//  DicomNetworkStats.hpp
+//  DicomCore
+//
+//  Internal C++ header. NOT exposed to Swift.
+//  Per-operation network instrumentation: phase timings, bytes and PDUs
+//  counted at the transport layer, and throughput.
+//
+
+#ifndef DICOM_NETWORK_STATS_HPP
+#define DICOM_NETWORK_STATS_HPP
+
+#include "DicomBridge.h"
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/dcmnet/assoc.h"
+#include "dcmtk/dcmnet/dcmlayer.h"
+#include <chrono>
+#include <memory>
+
+namespace dicomcore {
+
+struct TransportCounters;
+
+/// One network operation on the calling thread. Operations nest: the
+/// innermost one is current() until it goes out of scope.
+/// createAssociation instruments the connection of the current operation,
+/// and finish() publishes the stats to the ring buffer and the log.
+class NetworkOperation {
+public:
+    NetworkOperation(DB_NetworkOperation operation, const DB_DicomNode* remoteNode);
+    ~NetworkOperation();
+    NetworkOperation(const NetworkOperation&) = delete;
+    NetworkOperation& operator=(const NetworkOperation&) = delete;
+
+    /// Innermost operation of the calling thread, or nullptr.
+    static NetworkOperation* current();
+
+    /// Layer that counts bytes and PDUs of the connections of inner (plain
+    /// TCP if nullptr), which it takes ownership of. Starts the connect
+    /// timer, so call right before ASC_requestAssociation.
+    DcmTransportLayer* instrument(DcmTransportLayer* inner);
+
+    DB_NetworkOperation kind() const { return stats.operation; }
+
+    /// Instances transferred (or matches returned) so far.
+    void addInstances(int count) { stats.instances += count; }
+
+    /// Record the operation with its outcome; returns result unchanged.
+    DB_NetworkResult finish(const DB_NetworkResult& result);
+
+private:
+    DB_NetworkStats stats;
+    std::chrono::steady_clock::time_point started;
+    std::shared_ptr<TransportCounters> counters;
+    NetworkOperation* previous;
+    bool finished;
+};
+
+}  // namespace dicomcore
+
+#endif /* DICOM_NETWORK_STATS_HPP */
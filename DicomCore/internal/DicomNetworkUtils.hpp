@@ -0,0 +1,68 @@
+//
+//  DicomNetworkUtils.hpp
+//  DicomCore
+//
+//  Internal C++ header. NOT exposed to Swift.
+//  Helpers shared by the DCMTK-based networking translation units.
+//
+
+#ifndef DICOM_NETWORK_UTILS_HPP
+#define DICOM_NETWORK_UTILS_HPP
+
+#include "DicomBridge.h"
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/dcmnet/assoc.h"
+#include "dcmtk/dcmdata/dcdatset.h"
+#include <cstddef>
+
+namespace dicomcore {
+
+/// Build a DB_NetworkResult with a bounded copy of the message.
+DB_NetworkResult makeResult(DB_Status status, const char* message = "", int dimseStatus = 0);
+
+/// Convert an OFCondition to a DB_NetworkResult prefixed with the operation name.
+DB_NetworkResult conditionToResult(const OFCondition& cond, const char* operation);
+
+/// Open an association proposing a single abstract syntax.
+/// On failure nothing is left allocated. The TCP connect is bounded by
+/// DCMTK's process-global dcmConnectionTimeout, which is held at the
+/// longest timeoutSeconds of the associations connecting at the time, so
+/// a connect may take longer than its own timeout but never less.
+OFCondition createAssociation(const char* localAE,
+                              const DB_DicomNode* remoteNode,
+                              const char* abstractSyntax,
+                              T_ASC_Network*& net,
+                              T_ASC_Association*& assoc,
+                              int timeoutSeconds);
+
+/// A presentation context to propose when opening an association.
+struct PresentationContextSpec {
+    const char* abstractSyntax;
+    T_ASC_SC_ROLE role;     // ASC_SC_ROLE_SCP for C-STORE sub-operations of C-GET
+    bool required;          // Fail the association if not accepted
+    const char* transferSyntax = nullptr;   // Propose only this one instead of
+                                            // the uncompressed syntaxes
+};
+
+/// Open an association proposing several abstract syntaxes (at most 128).
+OFCondition createAssociation(const char* localAE,
+                              const DB_DicomNode* remoteNode,
+                              const PresentationContextSpec* contexts,
+                              size_t contextCount,
+                              T_ASC_Network*& net,
+                              T_ASC_Association*& assoc,
+                              int timeoutSeconds);
+
+/// Release and drop an association and its network.
+void releaseAssociation(T_ASC_Association* assoc, T_ASC_Network* net);
+
+/// Fill a STUDY level C-FIND identifier from search criteria.
+/// Empty criteria fields become universal matching keys.
+void buildStudyFindRequest(const DB_DicomTags& criteria, DcmDataset& request);
+
+/// Extract the study level return keys of a C-FIND response.
+void extractStudyTags(DcmDataset* identifiers, DB_DicomTags& tags);
+
+}  // namespace dicomcore
+
+#endif /* DICOM_NETWORK_UTILS_HPP */
@@ -0,0 +1,38 @@
+//
+//  DicomPixelStream.hpp
+//  DicomCore
+//
+//  Internal C++ header. NOT exposed to Swift.
+//  Locating the encoded PixelData element in a file and copying it to
+//  another file without decoding or holding it in memory.
+//
+
+#ifndef DICOM_PIXEL_STREAM_HPP
+#define DICOM_PIXEL_STREAM_HPP
+
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/dcmdata/dcxfer.h"
+#include <cstdint>
+#include <cstdio>
+
+namespace dicomcore {
+
+/// Bytes of one encoded element (tag, VR, length and value, including the
+/// items and delimiter of an encapsulated pixel sequence).
+struct ElementRange {
+    uint64_t offset = 0;
+    uint64_t length = 0;
+};
+
+/// Find the top-level PixelData element of a Part 10 file (or a bare
+/// dataset) whose dataset is encoded in xfer. Only element headers are
+/// read; values are skipped. False if the file has no PixelData or its
+/// encoding cannot be walked (deflate).
+bool findPixelDataRange(const char* path, E_TransferSyntax xfer, ElementRange& range);
+
+/// Append range of source to destination in large chunks.
+bool copyRange(FILE* source, const ElementRange& range, FILE* destination);
+
+}  // namespace dicomcore
+
+#endif /* DICOM_PIXEL_STREAM_HPP */
@@ -0,0 +1,71 @@
+//
+//  DicomRedaction.hpp
+//  DicomCore
+//
+//  Internal C++ header. NOT exposed to Swift.
+//  Blanking burned-in annotation in pixel data: configured regions per
+//  kind of device, and image borders that look like text.
+//
+
+#ifndef DICOM_REDACTION_HPP
+#define DICOM_REDACTION_HPP
+
+#include "DicomBridge.h"
+#include "DicomCodecs.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dicomcore {
+
+struct RedactionRect {
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+};
+
+/// DB_TEXT_BORDER_* sides of a frame whose border band, border pixels
+/// wide, holds rows of high-contrast strokes the way a line of text does.
+/// A heuristic: it flags, it does not read.
+unsigned scanBorderText(const uint8_t* frame, const FrameLayout& layout, uint32_t border);
+
+/// The bands of the given sides as rectangles.
+void borderBands(unsigned sides, const FrameLayout& layout, uint32_t border,
+                 std::vector<RedactionRect>& rects);
+
+/// Set rect, clipped to the frame, to the darkest value the photometric
+/// interpretation has. False if it was blank already.
+bool blankRect(uint8_t* frame, const FrameLayout& layout, const RedactionRect& rect);
+
+/// Redaction settings of a DB_AnonymizationConfig, compiled once.
+class RedactionPlan {
+public:
+    explicit RedactionPlan(const DB_AnonymizationConfig& config);
+
+    /// Nothing to redact in any file.
+    bool empty() const { return rules.empty() && textBorder == 0; }
+
+    /// Blank the regions of every rule matching dataset, and text-like
+    /// border bands, in each frame; only frames that change are re-encoded.
+    /// Runs before the tag rules, which may remove Modality or
+    /// Manufacturer. An image a rule matches but whose pixels cannot be
+    /// redacted is an error, so it is never written unredacted.
+    DB_Status apply(DcmDataset* dataset, bool& redacted) const;
+
+private:
+    struct Rule {
+        std::string modality;
+        std::string manufacturer;
+        uint32_t rows;
+        uint32_t columns;
+        std::vector<RedactionRect> rects;
+    };
+
+    std::vector<Rule> rules;
+    uint32_t textBorder;
+};
+
+}  // namespace dicomcore
+
+#endif /* DICOM_REDACTION_HPP */
@@ -0,0 +1,121 @@
+//
+//  DicomRetrieve.hpp
+//  DicomCore
+//
+//  Internal C++ header. NOT exposed to Swift.
+//  Series/instance level query and C-GET/C-MOVE primitives used by
+//  the retrieve scheduler.
+//
+
+#ifndef DICOM_RETRIEVE_HPP
+#define DICOM_RETRIEVE_HPP
+
+#include "DicomBridge.h"
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/dcmnet/assoc.h"
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace dicomcore {
+
+struct SeriesRef {
+    std::string seriesInstanceUID;
+    std::string modality;
+    int seriesNumber = 0;
+    int instanceCount = 0;      // NumberOfSeriesRelatedInstances, 0 if unknown
+};
+
+struct InstanceRef {
+    std::string sopInstanceUID;
+    int instanceNumber = 0;
+};
+
+/// Counters reported by the final C-GET/C-MOVE response of a batch.
+struct RetrieveCounts {
+    int completed = 0;
+    int failed = 0;
+    int warning = 0;
+    int dimseStatus = 0;        // Status of the final response
+};
+
+/// Called for each instance stored by a C-GET sub-operation.
+using StoredInstanceHandler =
+    std::function<void(const std::string& sopInstanceUID, const std::string& filePath)>;
+
+/// Open an association for retrieving: Study Root FIND plus GET (with the
+/// storage SOP classes proposed in SCP role) or MOVE.
+OFCondition createRetrieveAssociation(const char* localAE,
+                                      const DB_DicomNode* remoteNode,
+                                      DB_RetrieveMode mode,
+                                      T_ASC_Network*& net,
+                                      T_ASC_Association*& assoc,
+                                      int timeoutSeconds);
+
+/// C-FIND at SERIES level for all series of a study.
+OFCondition findSeries(T_ASC_Association* assoc,
+                       const std::string& studyInstanceUID,
+                       std::vector<SeriesRef>& series,
+                       int timeoutSeconds);
+
+/// C-FIND at IMAGE level for all instances of a series.
+OFCondition findInstances(T_ASC_Association* assoc,
+                          const std::string& studyInstanceUID,
+                          const std::string& seriesInstanceUID,
+                          std::vector<InstanceRef>& instances,
+                          int timeoutSeconds);
+
+/// C-GET a list of instances of one series at IMAGE level, writing each
+/// received object to destinationFolder/<SOPInstanceUID>.dcm.
+OFCondition getInstances(T_ASC_Association* assoc,
+                         const std::string& studyInstanceUID,
+                         const std::string& seriesInstanceUID,
+                         const std::vector<std::string>& sopInstanceUIDs,
+                         const std::string& destinationFolder,
+                         const StoredInstanceHandler& onStored,
+                         RetrieveCounts& counts,
+                         int timeoutSeconds);
+
+/// C-MOVE a list of instances of one series at IMAGE level to moveDestination.
+OFCondition moveInstances(T_ASC_Network* net,
+                          T_ASC_Association* assoc,
+                          const std::string& studyInstanceUID,
+                          const std::string& seriesInstanceUID,
+                          const std::vector<std::string>& sopInstanceUIDs,
+                          const char* moveDestination,
+                          RetrieveCounts& counts,
+                          int timeoutSeconds);
+
+/// Append-only record of the SOP Instance UIDs a retrieve job has received.
+/// Each UID is flushed as it arrives so an interrupted job can resume.
+class RetrieveJournal {
+public:
+    RetrieveJournal() = default;
+    ~RetrieveJournal();
+    RetrieveJournal(const RetrieveJournal&) = delete;
+    RetrieveJournal& operator=(const RetrieveJournal&) = delete;
+
+    /// Load an existing journal for the study, or start a new one.
+    /// Fails if the file belongs to a different study.
+    bool open(const std::string& path, const std::string& studyInstanceUID);
+
+    bool contains(const std::string& sopInstanceUID) const;
+    void record(const std::string& sopInstanceUID);
+    size_t size() const { return received.size(); }
+
+private:
+    FILE* file = nullptr;
+    std::unordered_set<std::string> received;
+};
+
+/// UID restricted to [0-9.] so it is safe as a file name component.
+std::string sanitizeUID(const std::string& uid);
+
+/// File name used for a received instance.
+std::string instanceFileName(const std::string& sopInstanceUID);
+
+}  // namespace dicomcore
+
+#endif /* DICOM_RETRIEVE_HPP */
@@ -0,0 +1,70 @@
+//
+//  DicomStore.hpp
+//  DicomCore
+//
+//  Internal C++ header. NOT exposed to Swift.
+//  C-STORE SCU building blocks shared by db_store_study and the outbound
+//  store queue.
+//
+
+#ifndef DICOM_STORE_HPP
+#define DICOM_STORE_HPP
+
+#include "DicomBridge.h"
+#include "DicomNetworkUtils.hpp"
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/dcmnet/assoc.h"
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dicomcore {
+
+/// An instance to send, identified from its file.
+struct StoreItem {
+    std::string path;
+    std::string sopClassUID;
+    std::string sopInstanceUID;
+    std::string transferSyntaxUID;
+};
+
+/// Identify a file from its meta header (or dataset if it has none).
+bool readStoreItem(const std::string& path, StoreItem& item);
+
+/// Presentation contexts for a batch of instances: one per SOP class for
+/// the uncompressed transfer syntaxes, and one per SOP class and
+/// compressed transfer syntax so those files are sent as they are.
+class StoreContexts {
+public:
+    /// Add the context item needs. False if that would exceed the 128
+    /// contexts an association can carry.
+    bool add(const StoreItem& item);
+
+    bool empty() const { return keys.empty(); }
+
+    /// Specs pointing into this object, valid while it is unchanged.
+    std::vector<PresentationContextSpec> specs() const;
+
+private:
+    std::set<std::pair<std::string, std::string>> keys;    // SOP class, compressed syntax or ""
+};
+
+enum class StoreOutcome {
+    Stored,             // Success or warning status
+    Rejected,           // Failure status, unreadable file, no accepted context or
+                        // a failure before the request reached the network
+    ConnectionLost      // The association is unusable
+};
+
+/// Send one instance. On anything but Stored, error describes why and
+/// dimseStatus holds the response status if there was one.
+StoreOutcome storeInstance(T_ASC_Association* assoc,
+                           const StoreItem& item,
+                           int timeoutSeconds,
+                           std::string& error,
+                           int& dimseStatus);
+
+}  // namespace dicomcore
+
+#endif /* DICOM_STORE_HPP */
@@ -0,0 +1,24 @@
+//
+//  DicomTLS.hpp
+//  DicomCore
+//
+//  Internal C++ header. NOT exposed to Swift.
+//  TLS transport for nodes configured with db_tls_configure_node.
+//
+
+#ifndef DICOM_TLS_HPP
+#define DICOM_TLS_HPP
+
+#include "DicomBridge.h"
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/dcmnet/dcmlayer.h"
+
+namespace dicomcore {
+
+/// TLS transport layer for associations with remoteNode, or nullptr when
+/// the node is not configured for TLS. The caller owns the layer.
+DcmTransportLayer* createTLSTransportLayer(const DB_DicomNode* remoteNode);
+
+}  // namespace dicomcore
+
+#endif /* DICOM_TLS_HPP */
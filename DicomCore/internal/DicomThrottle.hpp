@@ -0,0 +1,60 @@
+//
+//  DicomThrottle.hpp
+//  DicomCore
+//
+//  Internal C++ header. NOT exposed to Swift.
+//  Token bucket bandwidth limits for associations, global and per node.
+//
+
+#ifndef DICOM_THROTTLE_HPP
+#define DICOM_THROTTLE_HPP
+
+#include "DicomBridge.h"
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/dcmnet/dcmlayer.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+namespace dicomcore {
+
+/// Token bucket shared by all connections it limits. A caller may take
+/// more tokens than are available and then waits off the debt, so large
+/// PDUs pass without a burst size to match. Interactive callers are served
+/// before background callers waiting on the same bucket.
+class TokenBucket {
+public:
+    TokenBucket() = default;
+    TokenBucket(const TokenBucket&) = delete;
+    TokenBucket& operator=(const TokenBucket&) = delete;
+
+    /// Bytes per second, 0 = unlimited. Takes effect for waiting callers.
+    void setRate(double bytesPerSecond);
+
+    /// Take bytes tokens, blocking while the bucket is in debt.
+    void acquire(size_t bytes, DB_TrafficClass trafficClass);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void refill(Clock::time_point now);
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    double rate = 0.0;
+    double tokens = 0.0;
+    Clock::time_point refilled = Clock::now();
+    int interactiveWaiting = 0;
+};
+
+/// Layer that throttles the connections of inner (plain TCP if nullptr)
+/// to the global limits and those of remoteNode, or inner itself when no
+/// limit is set. Takes ownership of inner. The traffic class is the one
+/// of the calling thread, see db_throttle_set_thread_class.
+DcmTransportLayer* createThrottledTransportLayer(const DB_DicomNode* remoteNode,
+                                                 DcmTransportLayer* inner);
+
+}  // namespace dicomcore
+
+#endif /* DICOM_THROTTLE_HPP */
@@ -0,0 +1,35 @@
+//
+//  DicomTranscode.hpp
+//  DicomCore
+//
+//  Internal C++ header. NOT exposed to Swift.
+//  Writing a file in another transfer syntax, shared by batch transcoding
+//  and media export.
+//
+
+#ifndef DICOM_TRANSCODE_HPP
+#define DICOM_TRANSCODE_HPP
+
+#include "DicomBridge.h"
+#include "dcmtk/dcmdata/dctk.h"
+#include <memory>
+
+namespace dicomcore {
+
+/// What a DB_TranscodeOptions asks for, resolved once per batch.
+struct TargetSyntax {
+    E_TransferSyntax xfer = EXS_LittleEndianExplicit;
+    std::unique_ptr<DcmRepresentationParameter> parameter;    // Codec defaults if null
+    bool lossy = false;
+};
+
+/// False if options name no transfer syntax this can write.
+bool resolveTarget(const DB_TranscodeOptions& options, TargetSyntax& target);
+
+/// Write inputPath to outputPath in target, frame by frame. The output is
+/// written beside outputPath and renamed over it, so it may be inputPath.
+DB_Status transcodeFile(const char* inputPath, const char* outputPath, const TargetSyntax& target);
+
+}  // namespace dicomcore
+
+#endif /* DICOM_TRANSCODE_HPP */
@@ -0,0 +1,96 @@
+//
+//  DicomTransport.hpp
+//  DicomCore
+//
+//  Internal C++ header. NOT exposed to Swift.
+//  Building blocks for transport connections layered over DCMTK's, used
+//  to observe or shape the byte stream of an association.
+//
+
+#ifndef DICOM_TRANSPORT_HPP
+#define DICOM_TRANSPORT_HPP
+
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/dcmnet/dcmtrans.h"
+#include "dcmtk/dcmnet/dcmlayer.h"
+
+namespace dicomcore {
+
+/// Transport connection that forwards everything to the connection it owns.
+/// Subclasses override read()/write() and call the base implementation.
+class ForwardingConnection : public DcmTransportConnection {
+public:
+    explicit ForwardingConnection(DcmTransportConnection* inner);
+    ~ForwardingConnection() override;
+
+    DcmTransportLayerStatus serverSideHandshake() override;
+    DcmTransportLayerStatus clientSideHandshake() override;
+    DcmTransportLayerStatus renegotiate(const char* newSuite) override;
+    ssize_t read(void* buf, size_t nbyte) override;
+    ssize_t write(void* buf, size_t nbyte) override;
+    void close() override;
+    unsigned long getPeerCertificateLength() override;
+    unsigned long getPeerCertificate(void* buf, unsigned long bufLen) override;
+    OFBool networkDataAvailable(int timeout) override;
+    OFBool isTransparentConnection() override;
+    OFString& dumpConnectionParameters(OFString& str) override;
+    const char* errorString(DcmTransportLayerStatus code) override;
+
+protected:
+    DcmTransportConnection* inner;
+};
+
+/// Connection that paces reads and writes to a fixed byte rate, to emulate
+/// a slow link.
+class PacedConnection : public ForwardingConnection {
+public:
+    PacedConnection(DcmTransportConnection* inner, double bytesPerSecond);
+
+    ssize_t read(void* buf, size_t nbyte) override;
+    ssize_t write(void* buf, size_t nbyte) override;
+
+private:
+    void pace(size_t bytes);
+
+    double bytesPerSecond;
+    double linkFreeAt;          // Monotonic time the link has carried everything
+};
+
+/// Transport layer whose connections come from an inner layer (plain TCP
+/// when there is none) and are then wrapped, so layers can be stacked,
+/// e.g. instrumentation over TLS.
+class StackedTransportLayer : public DcmTransportLayer {
+public:
+    /// Takes ownership of inner, which may be nullptr.
+    explicit StackedTransportLayer(DcmTransportLayer* inner = nullptr) : inner(inner) {}
+    ~StackedTransportLayer() override;
+    StackedTransportLayer(const StackedTransportLayer&) = delete;
+    StackedTransportLayer& operator=(const StackedTransportLayer&) = delete;
+
+    DcmTransportConnection* createConnection(DcmNativeSocketType openSocket,
+                                             OFBool useSecureLayer) override;
+
+protected:
+    /// Wrap a connection of the inner layer; takes ownership of it.
+    virtual DcmTransportConnection* wrap(DcmTransportConnection* connection) = 0;
+
+private:
+    DcmTransportLayer* inner;
+};
+
+/// Transport layer whose connections are paced.
+class PacedTransportLayer : public StackedTransportLayer {
+public:
+    explicit PacedTransportLayer(double bytesPerSecond, DcmTransportLayer* inner = nullptr)
+        : StackedTransportLayer(inner), bytesPerSecond(bytesPerSecond) {}
+
+protected:
+    DcmTransportConnection* wrap(DcmTransportConnection* connection) override;
+
+private:
+    double bytesPerSecond;
+};
+
+}  // namespace dicomcore
+
+#endif /* DICOM_TRANSPORT_HPP */
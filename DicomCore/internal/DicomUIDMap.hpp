@@ -0,0 +1,74 @@
+//
+//  DicomUIDMap.hpp
+//  DicomCore
+//
+//  Internal C++ header. NOT exposed to Swift.
+//  Batch-scoped map from original to replacement UIDs, shared by the
+//  anonymization workers and optionally persisted.
+//
+
+#ifndef DICOM_UID_MAP_HPP
+#define DICOM_UID_MAP_HPP
+
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace dicomcore {
+
+/// Thread-safe: the map is split into shards with a lock each, so workers
+/// rarely wait on each other. Each original UID gets exactly one
+/// replacement, however many threads ask for it at once.
+class UIDMap {
+public:
+    UIDMap() = default;
+    ~UIDMap();
+    UIDMap(const UIDMap&) = delete;
+    UIDMap& operator=(const UIDMap&) = delete;
+
+    /// Load the mappings in path (created if missing) and append new ones
+    /// to it. Must be called before the map is shared.
+    bool open(const std::string& path);
+
+    /// Replacement for original, assigned on first use by assign (a
+    /// generated UID if empty).
+    std::string map(const std::string& original,
+                    const std::function<std::string(const std::string&)>& assign = nullptr);
+
+    /// Replacement for original if it has one.
+    bool find(const std::string& original, std::string& replacement);
+
+    size_t size();
+
+    /// Flush and fsync the persisted mappings.
+    void sync();
+
+private:
+    static const size_t kShardCount = 32;
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<std::string, std::string> uids;
+    };
+
+    Shard& shardFor(const std::string& original);
+
+    Shard shards[kShardCount];
+    std::mutex fileMutex;
+    FILE* file = nullptr;
+};
+
+/// True for UIDs under the DICOM root (SOP classes, transfer syntaxes and
+/// the like), which identify no instance and are never remapped.
+bool isStandardUID(const char* uid);
+
+}  // namespace dicomcore
+
+struct DB_UIDMap {
+    dicomcore::UIDMap map;
+};
+
+#endif /* DICOM_UID_MAP_HPP */
@@ -0,0 +1,75 @@
+//
+//  DicomWorkPool.hpp
+//  DicomCore
+//
+//  Internal C++ header. NOT exposed to Swift.
+//  Fan-out of independent per-file work over a fixed set of threads, and
+//  bounded queues between the stages of a pipeline.
+//
+
+#ifndef DICOM_WORK_POOL_HPP
+#define DICOM_WORK_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace dicomcore {
+
+/// Number of threads to use for threadCount (0 or less = one per core).
+int resolveThreadCount(int threadCount);
+
+/// Call body(index) for every index in [0, count) on up to threadCount
+/// threads (0 = one per core), handing out indexes in order. Returns when
+/// every call has returned. body must not throw.
+void parallelFor(size_t count, int threadCount,
+                 const std::function<void(size_t)>& body);
+
+/// Queue between pipeline stages. push blocks while capacity items wait,
+/// so a fast stage cannot run ahead of a slow one and fill memory. Each
+/// producer calls close once; pop returns false when every producer has
+/// closed and the queue is drained.
+template <typename T>
+class BoundedQueue {
+public:
+    BoundedQueue(size_t capacity, int producers)
+        : capacity(capacity > 0 ? capacity : 1), openProducers(producers) {}
+
+    void push(T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [&] { return items.size() < capacity; });
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+    }
+
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [&] { return !items.empty() || openProducers == 0; });
+        if (items.empty()) return false;
+        item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--openProducers == 0) {
+            notEmpty.notify_all();
+        }
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+    std::deque<T> items;
+    size_t capacity;
+    int openProducers;
+};
+
+}  // namespace dicomcore
+
+#endif /* DICOM_WORK_POOL_HPP */
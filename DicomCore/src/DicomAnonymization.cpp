@@ -6,284 +6,379 @@
 //
 
 #include "DicomBridge.h"
-#include "dcmtk/dcmdata/dctk.h"
-#include "dcmtk/dcmdata/dcfilefo.h"
-#include "dcmtk/dcmdata/dcuid.h"
+#include "DicomAnonymizer.hpp"
+#include "DicomFileSync.hpp"
+#include "DicomHash.hpp"
+#include "DicomUIDMap.hpp"
+#include "DicomWorkPool.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
 #include <string>
-#include <sstream>
-#include <iomanip>
-#include <functional>
-
-// Helper: Generate new UID
-static std::string generateNewUID() {
-    char uid[100];
-    dcmGenerateUniqueIdentifier(uid, SITE_INSTANCE_UID_ROOT);
-    return std::string(uid);
-}
+#include <unordered_set>
 
-// Helper: Hash a string using std::hash
-static std::string hashString(const std::string& input) {
-    std::hash<std::string> hasher;
-    size_t hashValue = hasher(input);
+#include <unistd.h>
 
-    std::stringstream ss;
-    ss << std::hex << std::setw(16) << std::setfill('0') << hashValue;
-    return ss.str();
-}
+using namespace dicomcore;
 
-// Helper: Apply tag rule to dataset
-static void applyTagRule(DcmDataset* dataset, const DB_TagRule& rule) {
-    DcmTag tag(rule.group, rule.element);
-
-    switch (rule.action) {
-        case DB_TAG_ACTION_REMOVE:
-            // Remove the tag entirely
-            dataset->findAndDeleteElement(tag);
-            break;
-
-        case DB_TAG_ACTION_REPLACE: {
-            // Replace with specified value
-            std::string replacement(rule.replacementValue);
-            if (!replacement.empty()) {
-                dataset->putAndInsertString(tag, replacement.c_str(), OFTrue);
-            }
-            break;
-        }
+static const char* kInPlaceJournalHeader = "DBANONINPLACE\t1";
 
-        case DB_TAG_ACTION_HASH: {
-            // Replace with hash of original value
-            OFString originalValue;
-            if (dataset->findAndGetOFString(tag, originalValue).good()) {
-                std::string hashed = hashString(originalValue.c_str());
-
-                // Truncate hash to reasonable length for the field
-                if (hashed.length() > 64) {
-                    hashed = hashed.substr(0, 64);
-                }
+// --- Helper: Anonymize a file into its replacement, ready to rename ---
+static DB_Status anonymizeToReplacement(const AnonymizationProgram& program,
+                                        const char* filePath,
+                                        const std::string& tempPath) {
+    // A replacement left by an earlier crash was never journaled
+    remove(tempPath.c_str());
+    DB_Status status = program.anonymizeFile(filePath, tempPath.c_str());
+    if (status != DB_STATUS_OK) {
+        remove(tempPath.c_str());
+    }
+    return status;
+}
 
-                dataset->putAndInsertString(tag, hashed.c_str(), OFTrue);
-            }
-            break;
-        }
+// Main anonymization function
+DB_Status db_anonymize_file(const char* inputPath,
+                             const char* outputPath,
+                             const DB_AnonymizationConfig* config) {
+    if (!inputPath || !outputPath || !config) {
+        return DB_STATUS_ERROR;
+    }
 
-        case DB_TAG_ACTION_EMPTY:
-            // Replace with empty string
-            dataset->putAndInsertString(tag, "", OFTrue);
-            break;
+    AnonymizationProgram program(*config);
+    return program.anonymizeFile(inputPath, outputPath);
+}
 
-        case DB_TAG_ACTION_KEEP:
-            // Do nothing - keep original value
-            break;
+// In-place anonymization
+DB_Status db_anonymize_file_inplace(const char* filePath,
+                                     const DB_AnonymizationConfig* config) {
+    if (!filePath || !config) {
+        return DB_STATUS_ERROR;
+    }
 
-        case DB_TAG_ACTION_GENERATE_UID: {
-            // Generate new UID
-            std::string newUID = generateNewUID();
-            dataset->putAndInsertString(tag, newUID.c_str(), OFTrue);
-            break;
-        }
+    AnonymizationProgram program(*config);
+    std::string tempPath = replacementPath(filePath);
+    DB_Status status = anonymizeToReplacement(program, filePath, tempPath);
+    if (status != DB_STATUS_OK) {
+        return status;
     }
-}
 
-// Helper: Remove private tags
-static void removePrivateTags(DcmDataset* dataset) {
-    DcmStack stack;
-    DcmObject* obj = nullptr;
-
-    // Find all private tags (group number is odd)
-    OFCondition cond = dataset->nextObject(stack, OFTrue);
-    while (cond.good()) {
-        obj = stack.top();
-        if (obj) {
-            DcmTag tag = obj->getTag();
-            unsigned short group = tag.getGroup();
-
-            // Private tags have odd group numbers
-            if (group % 2 == 1) {
-                dataset->findAndDeleteElement(tag);
-            }
-        }
-        cond = dataset->nextObject(stack, OFTrue);
+    // Renamed over the original, never removed first
+    if (!replaceFile(tempPath, filePath)) {
+        remove(tempPath.c_str());
+        return DB_STATUS_ERROR;
     }
+    return DB_STATUS_OK;
 }
 
-// Helper: Shift date by specified days
-static std::string shiftDate(const std::string& dateStr, int dayShift) {
-    if (dateStr.empty() || dateStr.length() != 8) {
-        return "";
+// Batch anonymization: one compiled program, files on a thread pool
+DB_Status db_anonymize_batch(const char* const* inputPaths,
+                             const char* const* outputPaths,
+                             int fileCount,
+                             const DB_AnonymizationConfig* config,
+                             int threadCount,
+                             DB_Status* outStatuses,
+                             DB_AnonymizeProgressCallback onProgress,
+                             void* userData) {
+    if (!inputPaths || !outputPaths || fileCount < 0 || !config) {
+        return DB_STATUS_ERROR;
     }
 
-    // Parse YYYYMMDD format
-    int year = std::stoi(dateStr.substr(0, 4));
-    int month = std::stoi(dateStr.substr(4, 2));
-    int day = std::stoi(dateStr.substr(6, 2));
-
-    // Simple date arithmetic (not handling month/year boundaries properly for brevity)
-    // In production, use a proper date library
-    day += dayShift;
-
-    // Rough normalization
-    while (day > 28) {
-        day -= 28;
-        month++;
-        if (month > 12) {
-            month = 1;
-            year++;
+    AnonymizationProgram program(*config);
+    std::mutex progressMutex;
+    int filesDone = 0;
+    int failures = 0;
+
+    parallelFor((size_t)fileCount, threadCount, [&](size_t index) {
+        DB_Status status = DB_STATUS_ERROR;
+        if (inputPaths[index] && outputPaths[index]) {
+            status = program.anonymizeFile(inputPaths[index], outputPaths[index]);
         }
-    }
-    while (day < 1) {
-        day += 28;
-        month--;
-        if (month < 1) {
-            month = 12;
-            year--;
+        if (outStatuses) {
+            outStatuses[index] = status;
         }
-    }
 
-    std::stringstream ss;
-    ss << std::setfill('0')
-       << std::setw(4) << year
-       << std::setw(2) << month
-       << std::setw(2) << day;
-    return ss.str();
-}
+        // Progress is reported one file at a time, in completion order
+        std::lock_guard<std::mutex> lock(progressMutex);
+        filesDone++;
+        if (status != DB_STATUS_OK) {
+            failures++;
+        }
+        if (onProgress) {
+            onProgress(userData, filesDone, fileCount, (int)index, status);
+        }
+    });
 
-// Helper: Process date tags
-static void processDateTags(DcmDataset* dataset, int dateShiftDays) {
-    if (dateShiftDays == -1) {
-        // Remove all date/time tags
-        DcmTag dateTags[] = {
-            DCM_StudyDate,
-            DCM_SeriesDate,
-            DCM_AcquisitionDate,
-            DCM_ContentDate,
-            DCM_PatientBirthDate,
-            DCM_InstanceCreationDate,
-            DCM_StudyTime,
-            DCM_SeriesTime,
-            DCM_AcquisitionTime,
-            DCM_ContentTime
-        };
+    return failures == 0 ? DB_STATUS_OK : DB_STATUS_ERROR;
+}
 
-        for (const auto& tag : dateTags) {
-            dataset->findAndDeleteElement(tag);
+// --- Helper: Read the files an in-place journal records as replaced ---
+// A torn last line from a crash has no newline and is ignored; its file
+// was not renamed yet.
+static bool readInPlaceJournal(const char* journalPath, std::unordered_set<std::string>& replaced) {
+    FILE* file = fopen(journalPath, "r");
+    if (!file) return true;
+
+    std::string line;
+    bool first = true;
+    bool valid = true;
+    int c;
+    while ((c = fgetc(file)) != EOF) {
+        if (c != '\n') {
+            line += (char)c;
+            continue;
         }
-    } else if (dateShiftDays != 0) {
-        // Shift dates
-        DcmTag dateTags[] = {
-            DCM_StudyDate,
-            DCM_SeriesDate,
-            DCM_AcquisitionDate,
-            DCM_ContentDate,
-            DCM_PatientBirthDate,
-            DCM_InstanceCreationDate
-        };
-
-        for (const auto& tag : dateTags) {
-            DcmElement* elem = nullptr;
-            if (dataset->findAndGetElement(tag, elem).good() && elem) {
-                OFString originalValue;
-                if (elem->getOFString(originalValue, 0).good()) {
-                    std::string shifted = shiftDate(originalValue.c_str(), dateShiftDays);
-                    if (!shifted.empty()) {
-                        elem->putString(shifted.c_str());
-                    }
-                }
-            }
+        if (first) {
+            first = false;
+            valid = line == kInPlaceJournalHeader;
+            if (!valid) break;
+        } else if (line.compare(0, 2, "R\t") == 0) {
+            replaced.insert(line.substr(2));
         }
+        line.clear();
     }
+    fclose(file);
+    return valid || first;
 }
 
-// Main anonymization function
-DB_Status db_anonymize_file(const char* inputPath,
-                             const char* outputPath,
-                             const DB_AnonymizationConfig* config) {
-    if (!inputPath || !outputPath || !config) {
+// In-place batch: replacements journaled before each rename
+DB_Status db_anonymize_batch_inplace(const char* const* filePaths,
+                                     int fileCount,
+                                     const DB_AnonymizationConfig* config,
+                                     const char* journalPath,
+                                     int threadCount,
+                                     DB_Status* outStatuses,
+                                     DB_AnonymizeProgressCallback onProgress,
+                                     void* userData) {
+    if (!filePaths || fileCount < 0 || !config || !journalPath) {
         return DB_STATUS_ERROR;
     }
 
-    // Load DICOM file
-    DcmFileFormat fileFormat;
-    OFCondition status = fileFormat.loadFile(inputPath);
-    if (status.bad()) {
-        return DB_STATUS_NOT_FOUND;
+    // Not a journal of ours: refuse rather than anonymize files twice
+    std::unordered_set<std::string> replaced;
+    if (!readInPlaceJournal(journalPath, replaced)) {
+        return DB_STATUS_ERROR;
     }
-
-    DcmDataset* dataset = fileFormat.getDataset();
-    if (!dataset) {
+    FILE* journal = fopen(journalPath, "a");
+    if (!journal) {
         return DB_STATUS_ERROR;
     }
-
-    // Apply tag rules
-    for (int i = 0; i < config->tagRuleCount; i++) {
-        applyTagRule(dataset, config->tagRules[i]);
+    if (fseek(journal, 0, SEEK_END) == 0 && ftell(journal) == 0) {
+        fprintf(journal, "%s\n", kInPlaceJournalHeader);
     }
-
-    // Remove private tags if requested
-    if (config->removePrivateTags) {
-        removePrivateTags(dataset);
+    if (fflush(journal) != 0 || fsync(fileno(journal)) != 0 || !syncParentDirectory(journalPath)) {
+        fclose(journal);
+        return DB_STATUS_ERROR;
     }
 
-    // Process date shifting
-    processDateTags(dataset, config->dateShiftDays);
+    AnonymizationProgram program(*config);
+    std::mutex journalMutex;
+    std::mutex progressMutex;
+    int filesDone = 0;
+    int failures = 0;
+
+    parallelFor((size_t)fileCount, threadCount, [&](size_t index) {
+        DB_Status status = DB_STATUS_ERROR;
+        const char* filePath = filePaths[index];
+        if (filePath && !strchr(filePath, '\n')) {
+            std::string tempPath = replacementPath(filePath);
+            if (replaced.count(filePath)) {
+                // Journaled, so the replacement is complete; if it is
+                // still there the rename did not happen
+                status = access(tempPath.c_str(), F_OK) != 0 || commitReplacement(tempPath, filePath)
+                             ? DB_STATUS_OK : DB_STATUS_ERROR;
+            } else if ((status = anonymizeToReplacement(program, filePath, tempPath)) == DB_STATUS_OK) {
+                // Synced before it is journaled: a journaled replacement
+                // can always be renamed
+                bool journaled = false;
+                if (prepareReplacement(tempPath, filePath)) {
+                    std::lock_guard<std::mutex> lock(journalMutex);
+                    fprintf(journal, "R\t%s\n", filePath);
+                    journaled = fflush(journal) == 0 && fsync(fileno(journal)) == 0;
+                }
+                if (!journaled || !commitReplacement(tempPath, filePath)) {
+                    // Journaled but not renamed is finished by a rerun
+                    if (!journaled) remove(tempPath.c_str());
+                    status = DB_STATUS_ERROR;
+                }
+            }
+        }
+        if (outStatuses) {
+            outStatuses[index] = status;
+        }
 
-    // Replace UIDs if requested
-    if (config->replaceStudyUID) {
-        std::string newUID = generateNewUID();
-        dataset->putAndInsertString(DCM_StudyInstanceUID, newUID.c_str());
-    }
+        std::lock_guard<std::mutex> lock(progressMutex);
+        filesDone++;
+        if (status != DB_STATUS_OK) {
+            failures++;
+        }
+        if (onProgress) {
+            onProgress(userData, filesDone, fileCount, (int)index, status);
+        }
+    });
 
-    if (config->replaceSeriesUID) {
-        std::string newUID = generateNewUID();
-        dataset->putAndInsertString(DCM_SeriesInstanceUID, newUID.c_str());
+    fclose(journal);
+    if (failures == 0) {
+        remove(journalPath);
+        return DB_STATUS_OK;
     }
+    return DB_STATUS_ERROR;
+}
 
-    if (config->replaceSOPUID) {
-        std::string newUID = generateNewUID();
-        dataset->putAndInsertString(DCM_SOPInstanceUID, newUID.c_str());
-
-        // Also update Media Storage SOP Instance UID in meta header
-        DcmMetaInfo* metaInfo = fileFormat.getMetaInfo();
-        if (metaInfo) {
-            metaInfo->putAndInsertString(DCM_MediaStorageSOPInstanceUID, newUID.c_str());
-        }
+// --- Helper: Fill a file report from what a dry run recorded ---
+static void fillFileReport(const AnonymizationReport& report, DB_Status status,
+                           DB_AnonymizationFileReport& out) {
+    memset(&out, 0, sizeof(out));
+    out.status = status;
+    out.tagsRemoved = report.totals[AnonymizationReport::kRemoved];
+    out.tagsReplaced = report.totals[AnonymizationReport::kReplaced];
+    out.tagsAdded = report.totals[AnonymizationReport::kAdded];
+    out.datesShifted = report.totals[AnonymizationReport::kShifted];
+    out.uidsRemapped = report.totals[AnonymizationReport::kRemapped];
+    out.privateGroupCount = (int)report.privateGroups.size();
+    int count = 0;
+    for (uint16_t group : report.privateGroups) {
+        if (count == 16) break;
+        out.privateGroups[count++] = group;
     }
+}
 
-    // Save anonymized file
-    status = fileFormat.saveFile(outputPath, EXS_LittleEndianExplicit);
-    if (status.bad()) {
+// Dry run: the batch's program applied in memory, changes tallied
+DB_Status db_anonymize_dry_run(const char* const* inputPaths,
+                               int fileCount,
+                               const DB_AnonymizationConfig* config,
+                               int threadCount,
+                               DB_AnonymizationFileReport* outReports,
+                               DB_AnonymizationSummary* outSummary,
+                               DB_AnonymizeProgressCallback onProgress,
+                               void* userData) {
+    if (!inputPaths || fileCount < 0 || !config) {
         return DB_STATUS_ERROR;
     }
 
-    return DB_STATUS_OK;
-}
-
-// In-place anonymization
-DB_Status db_anonymize_file_inplace(const char* filePath,
-                                     const DB_AnonymizationConfig* config) {
-    if (!filePath || !config) {
-        return DB_STATUS_ERROR;
+    // Remapping must not assign UIDs in the real map, which may persist
+    DB_UIDMap scratchMap;
+    DB_AnonymizationConfig dryConfig = *config;
+    if (dryConfig.uidMap) {
+        dryConfig.uidMap = &scratchMap;
     }
+    AnonymizationProgram program(dryConfig);
+
+    std::mutex mergeMutex;
+    int filesDone = 0;
+    int failures = 0;
+    int filesWithPrivateTags = 0;
+    AnonymizationReport totals;
+
+    parallelFor((size_t)fileCount, threadCount, [&](size_t index) {
+        AnonymizationReport report;
+        DB_Status status = inputPaths[index] ? program.dryRun(inputPaths[index], report)
+                                             : DB_STATUS_ERROR;
+        if (outReports) {
+            fillFileReport(report, status, outReports[index]);
+        }
 
-    // Create temporary output path
-    std::string tempPath = std::string(filePath) + ".tmp";
+        std::lock_guard<std::mutex> lock(mergeMutex);
+        filesDone++;
+        if (status != DB_STATUS_OK) {
+            failures++;
+        }
+        if (!report.privateGroups.empty()) {
+            filesWithPrivateTags++;
+        }
+        for (size_t change = 0; change < AnonymizationReport::kChangeCount; change++) {
+            totals.totals[change] += report.totals[change];
+        }
+        for (const auto& entry : report.tags) {
+            auto& counts = totals.tags[entry.first];
+            for (size_t change = 0; change < AnonymizationReport::kChangeCount; change++) {
+                counts[change] += entry.second[change];
+            }
+        }
+        totals.privateGroups.insert(report.privateGroups.begin(), report.privateGroups.end());
+        if (onProgress) {
+            onProgress(userData, filesDone, fileCount, (int)index, status);
+        }
+    });
+
+    if (outSummary) {
+        DB_AnonymizationSummary& summary = *outSummary;
+        memset(&summary, 0, sizeof(summary));
+        summary.filesScanned = fileCount;
+        summary.filesFailed = failures;
+        summary.filesWithPrivateTags = filesWithPrivateTags;
+        summary.tagsRemoved = totals.totals[AnonymizationReport::kRemoved];
+        summary.tagsReplaced = totals.totals[AnonymizationReport::kReplaced];
+        summary.tagsAdded = totals.totals[AnonymizationReport::kAdded];
+        summary.datesShifted = totals.totals[AnonymizationReport::kShifted];
+        summary.uidsRemapped = totals.totals[AnonymizationReport::kRemapped];
+
+        summary.privateGroupCount = (int)totals.privateGroups.size();
+        int groups = 0;
+        for (uint16_t group : totals.privateGroups) {
+            if (groups == 64) break;
+            summary.privateGroups[groups++] = group;
+        }
 
-    // Anonymize to temp file
-    DB_Status status = db_anonymize_file(filePath, tempPath.c_str(), config);
-    if (status != DB_STATUS_OK) {
-        return status;
+        // Most changed tags first, ties in tag order
+        typedef std::pair<uint32_t, std::array<int, AnonymizationReport::kChangeCount>> TagCounts;
+        std::vector<TagCounts> tags(totals.tags.begin(), totals.tags.end());
+        auto changes = [](const TagCounts& entry) {
+            int sum = 0;
+            for (int count : entry.second) sum += count;
+            return sum;
+        };
+        std::stable_sort(tags.begin(), tags.end(), [&](const TagCounts& a, const TagCounts& b) {
+            return changes(a) > changes(b);
+        });
+        summary.tagChangeCount = (int)tags.size();
+        for (size_t i = 0; i < tags.size() && i < 256; i++) {
+            DB_TagChangeCount& out = summary.tagChanges[i];
+            out.group = (uint16_t)(tags[i].first >> 16);
+            out.element = (uint16_t)(tags[i].first & 0xFFFF);
+            out.removed = tags[i].second[AnonymizationReport::kRemoved];
+            out.replaced = tags[i].second[AnonymizationReport::kReplaced];
+            out.added = tags[i].second[AnonymizationReport::kAdded];
+            out.shifted = tags[i].second[AnonymizationReport::kShifted];
+            out.remapped = tags[i].second[AnonymizationReport::kRemapped];
+        }
     }
 
-    // Replace original with anonymized version
-    if (remove(filePath) != 0) {
-        remove(tempPath.c_str());
-        return DB_STATUS_ERROR;
-    }
+    return failures == 0 ? DB_STATUS_OK : DB_STATUS_ERROR;
+}
 
-    if (rename(tempPath.c_str(), filePath) != 0) {
+// PS3.15 Table E.1-1 action codes
+DB_Status db_tag_action_from_profile_code(const char* code,
+                                          DB_TagAction* outAction) {
+    if (!code || !outAction) {
         return DB_STATUS_ERROR;
     }
 
-    return DB_STATUS_OK;
+    // Combined codes leave the choice to the IOD; without it, take the one
+    // a Type 1 attribute allows, which is valid for every type
+    static const struct {
+        const char* code;
+        DB_TagAction action;
+    } kCodes[] = {
+        { "X", DB_TAG_ACTION_REMOVE },
+        { "Z", DB_TAG_ACTION_EMPTY },
+        { "D", DB_TAG_ACTION_DUMMY },
+        { "K", DB_TAG_ACTION_KEEP },
+        { "C", DB_TAG_ACTION_CLEAN },
+        { "U", DB_TAG_ACTION_GENERATE_UID },
+        { "Z/D", DB_TAG_ACTION_DUMMY },
+        { "X/Z", DB_TAG_ACTION_EMPTY },
+        { "X/D", DB_TAG_ACTION_DUMMY },
+        { "X/Z/D", DB_TAG_ACTION_DUMMY },
+        { "X/Z/U*", DB_TAG_ACTION_GENERATE_UID }
+    };
+    for (const auto& entry : kCodes) {
+        if (strcmp(code, entry.code) == 0) {
+            *outAction = entry.action;
+            return DB_STATUS_OK;
+        }
+    }
+    return DB_STATUS_ERROR;
 }
 
 // Generate hash for external use
@@ -298,3 +393,35 @@ void db_generate_hash(const char* input,
     strncpy(output, hashed.c_str(), outputSize - 1);
     output[outputSize - 1] = '\0';
 }
+
+// Keyed hash for external use
+DB_Status db_generate_keyed_hash(const char* key,
+                                 const char* input,
+                                 char* output,
+                                 size_t outputSize) {
+    if (!key || !key[0] || !input || !output || outputSize < 65) {
+        return DB_STATUS_ERROR;
+    }
+
+    std::string hashed = toHex(HmacSha256(key).digest(std::string(input)));
+    strncpy(output, hashed.c_str(), outputSize - 1);
+    output[outputSize - 1] = '\0';
+    return DB_STATUS_OK;
+}
+
+// Derived UID for external use, the same one anonymization assigns
+DB_Status db_generate_derived_uid(const char* key,
+                                  const char* uidRoot,
+                                  const char* originalUID,
+                                  char* outUID,
+                                  size_t outSize) {
+    if (!key || !key[0] || !originalUID || !outUID || outSize < 65) {
+        return DB_STATUS_ERROR;
+    }
+
+    std::string uid = uidFromDigest(derivedUIDRoot(uidRoot),
+                                    HmacSha256(key).digest(std::string(originalUID)));
+    strncpy(outUID, uid.c_str(), outSize - 1);
+    outUID[outSize - 1] = '\0';
+    return DB_STATUS_OK;
+}
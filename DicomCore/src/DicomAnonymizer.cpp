@@ -0,0 +1,711 @@
+//
+//  DicomAnonymizer.cpp
+//  DicomCore
+//
+//  Compiled anonymization program: the rule table is built once per
+//  configuration and each dataset is rewritten in one ordered walk.
+//
+
+#include "DicomAnonymizer.hpp"
+#include "DicomDateShift.hpp"
+#include "DicomHash.hpp"
+#include "DicomPixelStream.hpp"
+#include "DicomRedaction.hpp"
+#include "DicomUIDMap.hpp"
+#include "dcmtk/dcmdata/dctk.h"
+#include "dcmtk/dcmdata/dcostrmb.h"
+#include "dcmtk/dcmdata/dcuid.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+
+namespace dicomcore {
+
+// --- Helper: Generate new UID ---
+static std::string generateNewUID() {
+    char uid[100];
+    dcmGenerateUniqueIdentifier(uid, SITE_INSTANCE_UID_ROOT);
+    return std::string(uid);
+}
+
+std::string hashString(const std::string& input) {
+    Sha256 sha;
+    sha.update(input.data(), input.size());
+    return toHex(sha.finish());
+}
+
+// --- Helper: Longest hash that fits the value representation ---
+static size_t hashLengthFor(DcmEVR vr) {
+    switch (vr) {
+        case EVR_AE:
+        case EVR_CS:
+        case EVR_SH:
+            return 16;
+        default:
+            return 64;
+    }
+}
+
+static inline uint32_t tagKey(unsigned short group, unsigned short element) {
+    return ((uint32_t)group << 16) | element;
+}
+
+// --- Helper: Key of a private creator's blocks in a group ---
+// Empty for an empty creator; padding spaces do not count.
+static std::string privateBlockKey(uint16_t group, const std::string& creator) {
+    size_t first = creator.find_first_not_of(' ');
+    if (first == std::string::npos) return "";
+    size_t last = creator.find_last_not_of(' ');
+    char prefix[6];
+    snprintf(prefix, sizeof(prefix), "%04X:", group);
+    return prefix + creator.substr(first, last - first + 1);
+}
+
+static bool isDateTimeVR(DcmEVR vr) {
+    return vr == EVR_DA || vr == EVR_DT || vr == EVR_TM;
+}
+
+static const size_t kActionCount = 8;    // Entries of kActionHandlers
+
+// UI attributes that refer to another attribute's UID, remapped when that
+// one is replaced so references between objects stay intact. The first
+// entry for the reference whose sequence matches (0 = any) applies.
+static const struct {
+    uint32_t reference;
+    uint32_t sequence;
+    uint32_t target;
+} kUIDReferences[] = {
+    // Referenced Study Sequence items refer to the study by its UID
+    { 0x00081155, 0x00081110, 0x0020000D },    // ReferencedSOPInstanceUID -> StudyInstanceUID
+    { 0x00081155, 0, 0x00080018 },             // ReferencedSOPInstanceUID -> SOPInstanceUID
+    { 0x00041511, 0, 0x00080018 },             // ReferencedSOPInstanceUIDInFile
+    { 0x30060024, 0, 0x00200052 },             // ReferencedFrameOfReferenceUID -> FrameOfReferenceUID
+    { 0x300600C2, 0, 0x00200052 }              // RelatedFrameOfReferenceUID
+};
+
+static inline uint32_t elementTag(DcmObject* obj) {
+    DcmTagKey key = obj->getTag();
+    return tagKey(key.getGroup(), key.getElement());
+}
+
+// ========================================================================
+// Compilation
+// ========================================================================
+
+AnonymizationProgram::AnonymizationProgram(const DB_AnonymizationConfig& config)
+    : removePrivateTags(config.removePrivateTags),
+      dateShiftDays(config.dateShiftDays),
+      preserveTransferSyntax(config.preserveTransferSyntax),
+      uidMap(config.uidMap ? &config.uidMap->map : nullptr),
+      config(config)
+{
+    if (config.hashKey && config.hashKey[0]) {
+        hmac.reset(new HmacSha256(config.hashKey));
+        uidRoot = derivedUIDRoot(config.uidRoot);
+    }
+    redaction.reset(new RedactionPlan(config));
+    if (redaction->empty()) {
+        redaction.reset();
+    }
+
+    // Later rules for the same tag win, as they did when rules were
+    // applied one after another
+    for (int i = 0; i < config.tagRuleCount; i++) {
+        const DB_TagRule& tagRule = config.tagRules[i];
+        CompiledRule rule;
+        rule.tag = tagKey(tagRule.group, tagRule.element);
+        // An action this build does not know removes, the safe reading
+        rule.action = (unsigned)tagRule.action < kActionCount ? tagRule.action
+                                                              : DB_TAG_ACTION_REMOVE;
+        rule.replacement = tagRule.replacementValue;
+        rules.push_back(rule);
+    }
+    std::stable_sort(rules.begin(), rules.end(),
+                     [](const CompiledRule& a, const CompiledRule& b) { return a.tag < b.tag; });
+    auto last = std::unique(rules.rbegin(), rules.rend(),
+                            [](const CompiledRule& a, const CompiledRule& b) { return a.tag == b.tag; });
+    rules.erase(rules.begin(), last.base());
+
+    // Private attributes removePrivateTags keeps, by group and creator
+    for (int i = 0; i < config.privateTagRuleCount; i++) {
+        const DB_PrivateTagRule& privateRule = config.privateTagRules[i];
+        char creator[sizeof(privateRule.privateCreator)];
+        strncpy(creator, privateRule.privateCreator, sizeof(creator) - 1);
+        creator[sizeof(creator) - 1] = '\0';
+        std::string blockKey = privateBlockKey(privateRule.group, creator);
+        if ((privateRule.group & 1) == 0 || blockKey.empty()) continue;
+        privateKeeps[blockKey].set(privateRule.offset);
+    }
+
+    // UID replacement ran after the rules, so it overrides them. Dates
+    // are handled by VR while applying.
+    if (config.replaceStudyUID) overrideRule(tagKey(0x0020, 0x000D), DB_TAG_ACTION_GENERATE_UID);
+    if (config.replaceSeriesUID) overrideRule(tagKey(0x0020, 0x000E), DB_TAG_ACTION_GENERATE_UID);
+    if (config.replaceSOPUID) overrideRule(tagKey(0x0008, 0x0018), DB_TAG_ACTION_GENERATE_UID);
+
+    // Sequence items are walked only when something can change in them
+    walksSequences = !rules.empty() || removePrivateTags || dateShiftDays != 0;
+}
+
+AnonymizationProgram::~AnonymizationProgram() = default;
+
+CompiledRule& AnonymizationProgram::ruleFor(uint32_t tag) {
+    auto it = std::lower_bound(rules.begin(), rules.end(), tag,
+                               [](const CompiledRule& rule, uint32_t t) { return rule.tag < t; });
+    if (it == rules.end() || it->tag != tag) {
+        CompiledRule rule;
+        rule.tag = tag;
+        rule.action = DB_TAG_ACTION_KEEP;
+        it = rules.insert(it, rule);
+    }
+    return *it;
+}
+
+bool AnonymizationProgram::replacesUID(uint32_t tag) const {
+    auto it = std::lower_bound(rules.begin(), rules.end(), tag,
+                               [](const CompiledRule& rule, uint32_t t) { return rule.tag < t; });
+    return it != rules.end() && it->tag == tag && it->action == DB_TAG_ACTION_GENERATE_UID;
+}
+
+void AnonymizationProgram::overrideRule(uint32_t tag, DB_TagAction action) {
+    CompiledRule& rule = ruleFor(tag);
+    rule.action = action;
+    rule.replacement.clear();
+}
+
+// ========================================================================
+// Application
+// ========================================================================
+
+// --- Helper: Dummy value for D, valid for the value representation ---
+static std::string dummyValue(DcmEVR vr) {
+    switch (vr) {
+        case EVR_DA:
+            return "19000101";
+        case EVR_DT:
+            return "19000101000000";
+        case EVR_TM:
+            return "000000";
+        case EVR_AS:
+            return "000D";
+        case EVR_DS:
+        case EVR_IS:
+        case EVR_SS:
+        case EVR_US:
+        case EVR_SL:
+        case EVR_UL:
+        case EVR_FL:
+        case EVR_FD:
+            return "0";
+        case EVR_UI:
+            return generateNewUID();
+        case EVR_AE:
+        case EVR_CS:
+        case EVR_LO:
+        case EVR_LT:
+        case EVR_PN:
+        case EVR_SH:
+        case EVR_ST:
+        case EVR_UC:
+        case EVR_UT:
+            return "ANONYMIZED";
+        default:
+            // Binary values have no meaningful dummy
+            return "";
+    }
+}
+
+// Returns false if the element is to be removed (REMOVE) or left alone
+// (KEEP, CLEAN, HASH of a missing value, REPLACE without replacement).
+bool AnonymizationProgram::ruleValue(const CompiledRule& rule, DcmEVR vr, bool present,
+                                     const OFString& original, std::string& value) const {
+    switch (rule.action) {
+        case DB_TAG_ACTION_REMOVE:
+        case DB_TAG_ACTION_KEEP:
+        case DB_TAG_ACTION_CLEAN:
+            return false;
+
+        case DB_TAG_ACTION_REPLACE:
+            if (rule.replacement.empty()) return false;
+            value = rule.replacement;
+            return true;
+
+        case DB_TAG_ACTION_HASH:
+            if (!present) return false;
+            // Truncate hash to what the field can hold
+            value = hmac ? toHex(hmac->digest(original.c_str(), original.length()))
+                         : hashString(original.c_str());
+            value.resize(std::min(value.size(), hashLengthFor(vr)));
+            return true;
+
+        case DB_TAG_ACTION_EMPTY:
+            value.clear();
+            return true;
+
+        case DB_TAG_ACTION_GENERATE_UID:
+            // A tag the file lacks has no original to map from
+            value = present && !original.empty()
+                ? replacementUID(original.c_str())
+                : generateNewUID();
+            return true;
+
+        case DB_TAG_ACTION_DUMMY:
+            value = dummyValue(vr);
+            return true;
+    }
+    return false;
+}
+
+std::string AnonymizationProgram::replacementUID(const std::string& original) const {
+    if (uidMap) {
+        return uidMap->map(original, [this](const std::string& uid) { return assignUID(uid); });
+    }
+    return assignUID(original);
+}
+
+std::string AnonymizationProgram::assignUID(const std::string& original) const {
+    // Keyed: the same original gives the same UID on every machine
+    if (hmac) {
+        return uidFromDigest(uidRoot, hmac->digest(original));
+    }
+    return generateNewUID();
+}
+
+// Map each value of a UI element
+void AnonymizationProgram::remapUIDElement(DcmElement* elem, AnonymizationReport* report) const {
+    OFString values;
+    if (elem->getOFStringArray(values).bad() || values.empty()) return;
+
+    std::string remapped;
+    bool changed = false;
+    size_t start = 0;
+    for (;;) {
+        size_t separator = values.find('\\', start);
+        std::string uid(values.c_str() + start,
+                        (separator == OFString_npos ? values.length() : separator) - start);
+        if (!uid.empty() && !isStandardUID(uid.c_str())) {
+            uid = replacementUID(uid);
+            changed = true;
+        }
+        remapped += uid;
+        if (separator == OFString_npos) break;
+        remapped += '\\';
+        start = separator + 1;
+    }
+    if (changed) {
+        elem->putOFStringArray(remapped.c_str());
+        if (report) report->record(elementTag(elem), AnonymizationReport::kRemapped);
+    }
+}
+
+// The flags and GENERATE_UID rules reach their own tags at any depth; a
+// reference follows the attribute it refers to
+bool AnonymizationProgram::followsReplacedUID(DcmElement* elem) const {
+    uint32_t tag = elementTag(elem);
+    DcmObject* item = elem->getParent();
+    DcmObject* sequence = item ? item->getParent() : nullptr;
+    uint32_t sequenceTag = sequence ? elementTag(sequence) : 0;
+    for (const auto& entry : kUIDReferences) {
+        if (entry.reference == tag && (entry.sequence == 0 || entry.sequence == sequenceTag)) {
+            return replacesUID(entry.target);
+        }
+    }
+    return false;
+}
+
+// Returns false if a value of this VR is to be removed, else shifts DA and
+// DT values in place; one that does not parse is left as it is.
+bool AnonymizationProgram::dateValue(DcmEVR vr, std::string& value) const {
+    if (dateShiftDays == 0 || !isDateTimeVR(vr)) return true;
+    if (dateShiftDays == -1) return false;
+
+    // Whole days leave TM unchanged
+    std::string shifted;
+    if (vr == EVR_DA ? shiftDA(value, dateShiftDays, shifted)
+                     : vr == EVR_DT && shiftDT(value, dateShiftDays, shifted)) {
+        value = shifted;
+    }
+    return true;
+}
+
+// --- Action handlers, indexed by DB_TagAction ---
+
+const AnonymizationProgram::ActionHandler AnonymizationProgram::kActionHandlers[] = {
+    &AnonymizationProgram::removeElement,    // DB_TAG_ACTION_REMOVE (X)
+    &AnonymizationProgram::replaceElement,   // DB_TAG_ACTION_REPLACE
+    &AnonymizationProgram::replaceElement,   // DB_TAG_ACTION_HASH
+    &AnonymizationProgram::replaceElement,   // DB_TAG_ACTION_EMPTY (Z)
+    &AnonymizationProgram::keepElement,      // DB_TAG_ACTION_KEEP (K)
+    &AnonymizationProgram::replaceElement,   // DB_TAG_ACTION_GENERATE_UID (U)
+    &AnonymizationProgram::replaceElement,   // DB_TAG_ACTION_DUMMY (D)
+    &AnonymizationProgram::cleanElement      // DB_TAG_ACTION_CLEAN (C)
+};
+
+bool AnonymizationProgram::removeElement(DcmElement*, const CompiledRule&,
+                                         AnonymizationReport*) const {
+    return false;
+}
+
+bool AnonymizationProgram::keepElement(DcmElement* elem, const CompiledRule&,
+                                       AnonymizationReport* report) const {
+    return applyDefaults(elem, report);
+}
+
+bool AnonymizationProgram::replaceElement(DcmElement* elem, const CompiledRule& rule,
+                                          AnonymizationReport* report) const {
+    DcmEVR vr = elem->ident();
+    if (vr == EVR_SQ) {
+        // Z empties a sequence; other values have no meaning for one, so
+        // its items are de-identified instead
+        if (rule.action == DB_TAG_ACTION_EMPTY) {
+            OFstatic_cast(DcmSequenceOfItems*, elem)->clear();
+            if (report) report->record(elementTag(elem), AnonymizationReport::kReplaced);
+            return true;
+        }
+        return applyDefaults(elem, report);
+    }
+
+    OFString original;
+    bool present = elem->getOFString(original, 0).good();
+    std::string value;
+    if (ruleValue(rule, vr, present, original, value)) {
+        // A replaced date is shifted like the original would have been
+        if (!dateValue(vr, value)) return false;
+        elem->putString(value.c_str());
+        if (report) {
+            report->record(elementTag(elem), rule.action == DB_TAG_ACTION_GENERATE_UID
+                                                 ? AnonymizationReport::kRemapped
+                                                 : AnonymizationReport::kReplaced);
+        }
+    }
+    return true;
+}
+
+bool AnonymizationProgram::cleanElement(DcmElement* elem, const CompiledRule&,
+                                        AnonymizationReport* report) const {
+    DcmEVR vr = elem->ident();
+    // Sequences are cleaned item by item, dates by the date shift when
+    // there is one, and UIDs remapped like GENERATE_UID
+    if (vr == EVR_SQ || (isDateTimeVR(vr) && dateShiftDays != 0)) {
+        return applyDefaults(elem, report);
+    }
+    if (vr == EVR_UI) {
+        remapUIDElement(elem, report);
+        return true;
+    }
+
+    OFString original;
+    if (elem->getOFString(original, 0).good() && !original.empty()) {
+        elem->putString(dummyValue(vr).c_str());
+        if (report) report->record(elementTag(elem), AnonymizationReport::kReplaced);
+    }
+    return true;
+}
+
+bool AnonymizationProgram::applyDefaults(DcmElement* elem, AnonymizationReport* report) const {
+    DcmEVR vr = elem->ident();
+    if (isDateTimeVR(vr)) {
+        if (dateShiftDays == -1) return false;
+        OFString original;
+        if (dateShiftDays != 0 && vr != EVR_TM &&
+            elem->getOFStringArray(original).good() && !original.empty()) {
+            std::string value = original.c_str();
+            dateValue(vr, value);
+            if (value != original.c_str()) {
+                elem->putString(value.c_str());
+                if (report) report->record(elementTag(elem), AnonymizationReport::kShifted);
+            }
+        }
+    } else if (vr == EVR_UI) {
+        if (followsReplacedUID(elem)) {
+            remapUIDElement(elem, report);
+        }
+    } else if (vr == EVR_SQ && walksSequences) {
+        DcmSequenceOfItems* sequence = OFstatic_cast(DcmSequenceOfItems*, elem);
+        for (unsigned long i = 0; i < sequence->card(); i++) {
+            applyRules(sequence->getItem(i), nullptr, report);
+        }
+    }
+    return true;
+}
+
+bool AnonymizationProgram::keepsPrivate(DcmElement* elem, const DcmTagKey& key,
+                                        PrivateBlocks& blocks) const {
+    if (blocks.group != key.getGroup()) {
+        blocks.group = key.getGroup();
+        std::fill(std::begin(blocks.keptOffsets), std::end(blocks.keptOffsets), nullptr);
+    }
+
+    // (gggg,0010-00FF) reserve block bb, (gggg,bb00-bbFF), for a creator
+    uint16_t element = key.getElement();
+    if (element >= 0x0010 && element <= 0x00FF) {
+        OFString creator;
+        if (elem->getOFString(creator, 0).bad()) return false;
+        auto it = privateKeeps.find(privateBlockKey(key.getGroup(), creator.c_str()));
+        blocks.keptOffsets[element] = it != privateKeeps.end() ? &it->second : nullptr;
+        return blocks.keptOffsets[element] != nullptr;
+    }
+    if (element < 0x1000) return false;
+    const std::bitset<256>* offsets = blocks.keptOffsets[element >> 8];
+    return offsets && offsets->test(element & 0xFF);
+}
+
+void AnonymizationProgram::applyRules(DcmItem* item,
+                                      std::vector<const CompiledRule*>* missing,
+                                      AnonymizationReport* report) const {
+    std::vector<DcmObject*> removals;
+    PrivateBlocks privateBlocks;
+
+    // Elements are kept in tag order, so the walk merges them with the
+    // sorted rules
+    auto next = rules.begin();
+    for (DcmObject* obj = item->nextInContainer(nullptr); obj;
+         obj = item->nextInContainer(obj)) {
+        DcmTagKey key = obj->getTag();
+        uint32_t tag = tagKey(key.getGroup(), key.getElement());
+
+        while (next != rules.end() && next->tag < tag) {
+            if (missing) missing->push_back(&*next);
+            ++next;
+        }
+        const CompiledRule* rule = nullptr;
+        if (next != rules.end() && next->tag == tag) {
+            rule = &*next++;
+        }
+
+        // Private tags have odd group numbers
+        bool isPrivate = key.getGroup() & 1;
+        if (isPrivate && report) {
+            report->privateGroups.insert(key.getGroup());
+        }
+        DcmElement* elem = OFstatic_cast(DcmElement*, obj);
+        bool removesPrivate = removePrivateTags && isPrivate &&
+                              (privateKeeps.empty() || !keepsPrivate(elem, key, privateBlocks));
+        bool keep = !removesPrivate &&
+                    (rule ? (this->*kActionHandlers[rule->action])(elem, *rule, report)
+                          : applyDefaults(elem, report));
+        if (!keep) {
+            removals.push_back(obj);
+            if (report) report->record(tag, AnonymizationReport::kRemoved);
+        }
+    }
+    while (missing && next != rules.end()) {
+        missing->push_back(&*next++);
+    }
+
+    // Removing after the walk keeps the container's iteration valid
+    for (DcmObject* obj : removals) {
+        delete item->remove(obj);
+    }
+}
+
+void AnonymizationProgram::apply(DcmFileFormat& fileFormat, AnonymizationReport* report) const {
+    DcmDataset* dataset = fileFormat.getDataset();
+    std::vector<const CompiledRule*> missing;
+    applyRules(dataset, &missing, report);
+
+    // Rules that create their tag when the dataset lacks it; only the top
+    // level, an item's content depends on its sequence
+    std::string value;
+    for (const CompiledRule* rule : missing) {
+        DcmTag tag(rule->tag >> 16, rule->tag & 0xFFFF);
+        if (!ruleValue(*rule, tag.getEVR(), false, OFString(), value) ||
+            !dateValue(tag.getEVR(), value)) {
+            continue;
+        }
+        dataset->putAndInsertString(tag, value.c_str(), OFTrue);
+        if (report) report->record(rule->tag, AnonymizationReport::kAdded);
+    }
+
+    // Keep the meta header's SOP Instance UID in step with the dataset
+    DcmMetaInfo* metaInfo = fileFormat.getMetaInfo();
+    OFString sopInstanceUID;
+    if (metaInfo && metaInfo->tagExists(DCM_MediaStorageSOPInstanceUID) &&
+        dataset->findAndGetOFString(DCM_SOPInstanceUID, sopInstanceUID).good()) {
+        metaInfo->putAndInsertString(DCM_MediaStorageSOPInstanceUID, sopInstanceUID.c_str());
+    }
+}
+
+const AnonymizationProgram& AnonymizationProgram::programFor(DcmDataset* dataset) const {
+    if (!config.patientOverride) return *this;
+
+    OFString patientID;
+    dataset->findAndGetOFString(DCM_PatientID, patientID);
+    std::lock_guard<std::mutex> lock(patientMutex);
+    auto it = patientPrograms.find(patientID.c_str());
+    if (it == patientPrograms.end()) {
+        std::unique_ptr<AnonymizationProgram> program;
+        DB_PatientOverride values;
+        memset(&values, 0, sizeof(values));
+        values.dateShiftDays = config.dateShiftDays;
+        if (config.patientOverride(config.patientOverrideUserData, patientID.c_str(), &values)) {
+            // The PatientID rule goes last, so it wins over the profile's
+            std::vector<DB_TagRule> tagRules(config.tagRules, config.tagRules + config.tagRuleCount);
+            values.patientID[sizeof(values.patientID) - 1] = '\0';
+            if (values.patientID[0]) {
+                DB_TagRule rule;
+                memset(&rule, 0, sizeof(rule));
+                rule.group = 0x0010;
+                rule.element = 0x0020;
+                rule.action = DB_TAG_ACTION_REPLACE;
+                strncpy(rule.replacementValue, values.patientID, sizeof(rule.replacementValue) - 1);
+                tagRules.push_back(rule);
+            }
+            DB_AnonymizationConfig patientConfig = config;
+            patientConfig.tagRules = tagRules.data();
+            patientConfig.tagRuleCount = (int)tagRules.size();
+            patientConfig.dateShiftDays = values.dateShiftDays;
+            patientConfig.patientOverride = nullptr;
+            program.reset(new AnonymizationProgram(patientConfig));
+        }
+        it = patientPrograms.emplace(patientID.c_str(), std::move(program)).first;
+    }
+    return it->second ? *it->second : *this;
+}
+
+DB_Status AnonymizationProgram::dryRun(const char* inputPath,
+                                       AnonymizationReport& report) const {
+    DcmFileFormat fileFormat;
+    if (fileFormat.loadFile(inputPath).bad()) {
+        return DB_STATUS_NOT_FOUND;
+    }
+    if (!fileFormat.getDataset()) {
+        return DB_STATUS_ERROR;
+    }
+    programFor(fileFormat.getDataset()).apply(fileFormat, &report);
+    return DB_STATUS_OK;
+}
+
+DB_Status AnonymizationProgram::anonymizeFile(const char* inputPath,
+                                              const char* outputPath) const {
+    // Values longer than DCM_MaxReadLength stay in the file until written
+    DcmFileFormat fileFormat;
+    if (fileFormat.loadFile(inputPath).bad()) {
+        return DB_STATUS_NOT_FOUND;
+    }
+    if (!fileFormat.getDataset()) {
+        return DB_STATUS_ERROR;
+    }
+    return programFor(fileFormat.getDataset()).anonymizeLoaded(fileFormat, inputPath, outputPath);
+}
+
+DB_Status AnonymizationProgram::anonymizeLoaded(DcmFileFormat& fileFormat,
+                                                const char* inputPath,
+                                                const char* outputPath) const {
+    // Pixels first: the rules may remove what redaction matches on
+    bool redacted = false;
+    if (redaction) {
+        DB_Status status = redaction->apply(fileFormat.getDataset(), redacted);
+        if (status != DB_STATUS_OK) {
+            return status;
+        }
+    }
+
+    apply(fileFormat);
+
+    if (preserveTransferSyntax) {
+        // Redacted pixels are in memory, the file's bytes are stale
+        if (!redacted) {
+            return saveStreaming(fileFormat, inputPath, outputPath);
+        }
+        if (fileFormat.saveFile(outputPath, fileFormat.getDataset()->getOriginalXfer()).bad()) {
+            return DB_STATUS_ERROR;
+        }
+        return DB_STATUS_OK;
+    }
+    if (fileFormat.saveFile(outputPath, EXS_LittleEndianExplicit).bad()) {
+        return DB_STATUS_ERROR;
+    }
+    return DB_STATUS_OK;
+}
+
+// ========================================================================
+// Streaming save
+// ========================================================================
+
+// --- Helper: Encode elements as they follow PixelData in the dataset ---
+static bool encodeElements(const std::vector<std::unique_ptr<DcmElement>>& elements,
+                           E_TransferSyntax xfer, std::vector<char>& encoded) {
+    size_t total = 0;
+    for (const auto& element : elements) {
+        total += element->calcElementLength(xfer, EET_ExplicitLength);
+    }
+    encoded.resize(total);
+    if (total == 0) return true;
+
+    DcmOutputBufferStream stream(encoded.data(), (offile_off_t)encoded.size());
+    for (const auto& element : elements) {
+        element->transferInit();
+        OFCondition cond = element->write(stream, xfer, EET_ExplicitLength, nullptr);
+        element->transferEnd();
+        if (cond.bad()) return false;
+    }
+    stream.flush();
+
+    void* buffer = nullptr;
+    offile_off_t length = 0;
+    stream.getBuffer(buffer, length);
+    return (size_t)length == total;
+}
+
+DB_Status AnonymizationProgram::saveStreaming(DcmFileFormat& fileFormat,
+                                              const char* inputPath,
+                                              const char* outputPath) const {
+    DcmDataset* dataset = fileFormat.getDataset();
+    E_TransferSyntax xfer = dataset->getOriginalXfer();
+
+    // Without a PixelData element we can locate (deflate, or none left)
+    // the dataset is small enough to save as a whole
+    ElementRange pixelRange;
+    if (!dataset->tagExists(DCM_PixelData) ||
+        !findPixelDataRange(inputPath, xfer, pixelRange)) {
+        return fileFormat.saveFile(outputPath, xfer).good() ? DB_STATUS_OK : DB_STATUS_ERROR;
+    }
+
+    // Write everything before PixelData, then its original bytes, then
+    // whatever followed it (e.g. private groups 7FE1), already anonymized
+    delete dataset->remove(DCM_PixelData);
+    std::vector<std::unique_ptr<DcmElement>> trailing;
+    std::vector<DcmObject*> after;
+    for (DcmObject* obj = dataset->nextInContainer(nullptr); obj;
+         obj = dataset->nextInContainer(obj)) {
+        if (DCM_PixelData < obj->getTag()) {
+            after.push_back(obj);
+        }
+    }
+    for (DcmObject* obj : after) {
+        // Group lengths (retired) are dropped here and when saving: the
+        // dataset no longer holds what the written groups contain
+        if (obj->getTag().getElement() == 0x0000) {
+            delete dataset->remove(obj);
+        } else {
+            trailing.emplace_back(dataset->remove(obj));
+        }
+    }
+
+    std::vector<char> encodedTrailing;
+    if (!encodeElements(trailing, xfer, encodedTrailing) ||
+        fileFormat.saveFile(outputPath, xfer, EET_UndefinedLength, EGL_withoutGL).bad()) {
+        remove(outputPath);
+        return DB_STATUS_ERROR;
+    }
+
+    FILE* source = fopen(inputPath, "rb");
+    FILE* destination = fopen(outputPath, "ab");
+    bool copied = source && destination &&
+                  copyRange(source, pixelRange, destination) &&
+                  fwrite(encodedTrailing.data(), 1, encodedTrailing.size(), destination) ==
+                      encodedTrailing.size();
+    if (source) fclose(source);
+    if (destination && fclose(destination) != 0) copied = false;
+
+    if (!copied) {
+        remove(outputPath);
+        return DB_STATUS_ERROR;
+    }
+    return DB_STATUS_OK;
+}
+
+}  // namespace dicomcore
@@ -0,0 +1,689 @@
+//
+//  DicomCine.cpp
+//  DicomCore
+//
+//  Cine export: the frames of a multi-frame object or an ordered series,
+//  decoded and encoded on worker threads and written in order as an AVI
+//  or animated PNG stream.
+//
+
+#include "DicomBridge.h"
+#include "DicomExport.hpp"
+#include "DicomFileSync.hpp"
+#include "DicomWorkPool.hpp"
+#include <zlib.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace dicomcore;
+
+namespace {
+
+/// What the header of one input says about its frames.
+struct CineSource {
+    FrameLayout layout;
+    double framesPerSecond = 0.0;   // 0 if it does not say
+    std::vector<double> frameSeconds;   // How long each frame shows, from
+                                        // FrameTimeVector; empty if none
+};
+
+/// One frame of the loop: which input, which frame of it.
+struct CineFrame {
+    uint32_t source;
+    uint32_t frame;
+};
+
+struct RenderedFrame {
+    size_t index = 0;
+    RenderedImage image;
+};
+
+/// Hands out frames to decode and gives encoded ones back in order. At
+/// most window frames are claimed and not yet taken, which bounds memory
+/// however far ahead the workers get.
+class FrameReorder {
+public:
+    FrameReorder(size_t count, size_t window) : count(count), window(window) {}
+
+    /// Next frame to decode; blocks while window frames are in flight.
+    /// False once every frame is claimed, or after cancel.
+    bool claim(size_t& index) {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return cancelled || claimed >= count || claimed < taken + window; });
+        if (cancelled || claimed >= count) return false;
+        index = claimed++;
+        return true;
+    }
+
+    void deliver(size_t index, std::vector<uint8_t>&& bytes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready[index] = std::move(bytes);
+        changed.notify_all();
+    }
+
+    /// The next frame in order; blocks until it is delivered. False after
+    /// cancel.
+    bool take(std::vector<uint8_t>& bytes) {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return cancelled || ready.count(taken) > 0; });
+        if (cancelled) return false;
+        auto it = ready.find(taken);
+        bytes = std::move(it->second);
+        ready.erase(it);
+        taken++;
+        changed.notify_all();
+        return true;
+    }
+
+    void cancel() {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelled = true;
+        changed.notify_all();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable changed;
+    size_t count;
+    size_t window;
+    size_t claimed = 0;
+    size_t taken = 0;
+    bool cancelled = false;
+    std::map<size_t, std::vector<uint8_t>> ready;
+};
+
+/// Where encoded frames go, in order.
+class CineWriter {
+public:
+    explicit CineWriter(FILE* file) : file(file) {}
+    virtual ~CineWriter() = default;
+
+    virtual bool begin() = 0;
+    virtual bool write(size_t index, const std::vector<uint8_t>& frame) = 0;
+    virtual bool finish() = 0;
+
+protected:
+    bool put(const void* data, size_t size) {
+        return size == 0 || fwrite(data, 1, size, file) == size;
+    }
+
+    FILE* file;
+};
+
+}  // namespace
+
+// ========================================================================
+// Byte Layout
+// ========================================================================
+
+// --- Helper: Little-endian fields, as RIFF has them ---
+static void put16(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back((uint8_t)value);
+    out.push_back((uint8_t)(value >> 8));
+}
+
+static void put32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back((uint8_t)(value >> shift));
+    }
+}
+
+static void putFourCC(std::vector<uint8_t>& out, const char* code) {
+    out.insert(out.end(), code, code + 4);
+}
+
+// --- Helper: Big-endian fields, as PNG has them ---
+static void putBig16(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back((uint8_t)(value >> 8));
+    out.push_back((uint8_t)value);
+}
+
+static void putBig32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back((uint8_t)(value >> shift));
+    }
+}
+
+// --- Helper: Bottom-up BGR rows padded to 4 bytes, as a DIB stores them ---
+static void toDIB(const RenderedImage& image, std::vector<uint8_t>& out) {
+    size_t stride = ((size_t)image.width * 3 + 3) & ~(size_t)3;
+    out.assign(stride * image.height, 0);
+    for (uint32_t y = 0; y < image.height; y++) {
+        const uint8_t* source = image.pixels.data() + (size_t)y * image.width * image.channels;
+        uint8_t* row = out.data() + (size_t)(image.height - 1 - y) * stride;
+        for (uint32_t x = 0; x < image.width; x++) {
+            if (image.channels == 1) {
+                row[3 * x] = row[3 * x + 1] = row[3 * x + 2] = source[x];
+            } else {
+                row[3 * x] = source[3 * x + 2];
+                row[3 * x + 1] = source[3 * x + 1];
+                row[3 * x + 2] = source[3 * x];
+            }
+        }
+    }
+}
+
+// ========================================================================
+// AVI
+// ========================================================================
+
+namespace {
+
+/// AVI 1.0: headers, a movi list of one chunk per frame and an idx1 index.
+/// The headers are written as placeholders and rewritten with the sizes
+/// once every frame is in.
+class AviWriter : public CineWriter {
+public:
+    AviWriter(FILE* file, uint32_t width, uint32_t height, double framesPerSecond,
+              size_t frameCount, bool mjpeg)
+        : CineWriter(file), width(width), height(height), framesPerSecond(framesPerSecond),
+          frameCount(frameCount), mjpeg(mjpeg) {}
+
+    bool begin() override {
+        std::vector<uint8_t> headers = buildHeaders();
+        return put(headers.data(), headers.size());
+    }
+
+    bool write(size_t, const std::vector<uint8_t>& frame) override {
+        // RIFF sizes are 32-bit
+        uint64_t chunkBytes = 8 + (uint64_t)frame.size() + (frame.size() & 1);
+        uint64_t indexBytes = 8 + 16 * ((uint64_t)index.size() / 16 + 1);
+        if (kHeaderBytes + moviBytes + chunkBytes + indexBytes > UINT32_MAX) {
+            return false;
+        }
+        std::vector<uint8_t> header;
+        putFourCC(header, mjpeg ? "00dc" : "00db");
+        put32(header, (uint32_t)frame.size());
+        static const uint8_t pad = 0;
+        if (!put(header.data(), header.size()) || !put(frame.data(), frame.size()) ||
+            ((frame.size() & 1) && !put(&pad, 1))) {
+            return false;
+        }
+
+        putFourCC(index, mjpeg ? "00dc" : "00db");
+        put32(index, 0x10);                             // AVIIF_KEYFRAME
+        put32(index, (uint32_t)(4 + moviBytes));        // From the movi list type
+        put32(index, (uint32_t)frame.size());
+        moviBytes += chunkBytes;
+        largestFrame = std::max<uint64_t>(largestFrame, frame.size());
+        return true;
+    }
+
+    bool finish() override {
+        std::vector<uint8_t> header;
+        putFourCC(header, "idx1");
+        put32(header, (uint32_t)index.size());
+        if (!put(header.data(), header.size()) || !put(index.data(), index.size())) {
+            return false;
+        }
+        std::vector<uint8_t> headers = buildHeaders();
+        return fseek(file, 0, SEEK_SET) == 0 && put(headers.data(), headers.size());
+    }
+
+private:
+    static constexpr uint64_t kHeaderBytes = 224;   // Through the movi list type
+
+    std::vector<uint8_t> buildHeaders() const {
+        uint32_t frameBytes = mjpeg ? width * height * 3 : (((width * 3 + 3) & ~3u) * height);
+        uint32_t bufferSize = largestFrame > 0 ? (uint32_t)largestFrame : frameBytes;
+        uint32_t scale = 1000;
+        uint32_t rate = (uint32_t)std::lround(framesPerSecond * scale);
+        uint64_t moviSize = 4 + moviBytes;
+        uint64_t riffSize = kHeaderBytes - 8 + moviBytes + 8 + index.size();
+
+        std::vector<uint8_t> out;
+        putFourCC(out, "RIFF");
+        put32(out, (uint32_t)riffSize);
+        putFourCC(out, "AVI ");
+
+        putFourCC(out, "LIST");
+        put32(out, 192);
+        putFourCC(out, "hdrl");
+
+        // MainAVIHeader
+        putFourCC(out, "avih");
+        put32(out, 56);
+        put32(out, (uint32_t)std::lround(1000000.0 / framesPerSecond));
+        put32(out, (uint32_t)std::min<double>(bufferSize * framesPerSecond, UINT32_MAX));
+        put32(out, 0);                  // Padding granularity
+        put32(out, 0x10);               // AVIF_HASINDEX
+        put32(out, (uint32_t)frameCount);
+        put32(out, 0);                  // Initial frames
+        put32(out, 1);                  // Streams
+        put32(out, bufferSize);
+        put32(out, width);
+        put32(out, height);
+        for (int i = 0; i < 4; i++) put32(out, 0);
+
+        putFourCC(out, "LIST");
+        put32(out, 116);
+        putFourCC(out, "strl");
+
+        // AVIStreamHeader
+        putFourCC(out, "strh");
+        put32(out, 56);
+        putFourCC(out, "vids");
+        putFourCC(out, mjpeg ? "MJPG" : "DIB ");
+        put32(out, 0);                  // Flags
+        put16(out, 0);                  // Priority
+        put16(out, 0);                  // Language
+        put32(out, 0);                  // Initial frames
+        put32(out, scale);
+        put32(out, rate);
+        put32(out, 0);                  // Start
+        put32(out, (uint32_t)frameCount);
+        put32(out, bufferSize);
+        put32(out, 0xFFFFFFFF);         // Default quality
+        put32(out, 0);                  // Sample size: varies
+        put16(out, 0);
+        put16(out, 0);
+        put16(out, width);
+        put16(out, height);
+
+        // BITMAPINFOHEADER
+        putFourCC(out, "strf");
+        put32(out, 40);
+        put32(out, 40);
+        put32(out, width);
+        put32(out, height);             // Positive: rows bottom-up
+        put16(out, 1);                  // Planes
+        put16(out, 24);
+        if (mjpeg) {
+            putFourCC(out, "MJPG");
+        } else {
+            put32(out, 0);              // BI_RGB
+        }
+        put32(out, frameBytes);
+        for (int i = 0; i < 4; i++) put32(out, 0);
+
+        putFourCC(out, "LIST");
+        put32(out, (uint32_t)moviSize);
+        putFourCC(out, "movi");
+        return out;
+    }
+
+    uint32_t width;
+    uint32_t height;
+    double framesPerSecond;
+    size_t frameCount;
+    bool mjpeg;
+    uint64_t moviBytes = 0;
+    uint64_t largestFrame = 0;
+    std::vector<uint8_t> index;
+};
+
+}  // namespace
+
+// ========================================================================
+// APNG
+// ========================================================================
+
+// --- Helper: Payload of every chunk of a type in a PNG, concatenated ---
+static bool pngChunkData(const std::vector<uint8_t>& png, const char* type, std::vector<uint8_t>& data) {
+    data.clear();
+    bool found = false;
+    for (size_t offset = 8; offset + 12 <= png.size();) {
+        uint32_t length = ((uint32_t)png[offset] << 24) | ((uint32_t)png[offset + 1] << 16) |
+                          ((uint32_t)png[offset + 2] << 8) | png[offset + 3];
+        if (length > png.size() - offset - 12) return false;
+        if (memcmp(&png[offset + 4], type, 4) == 0) {
+            data.insert(data.end(), &png[offset + 8], &png[offset + 8] + length);
+            found = true;
+        }
+        offset += 12 + (size_t)length;
+    }
+    return found;
+}
+
+namespace {
+
+/// Animated PNG: the frames' own IHDR and IDAT data, each frame behind an
+/// fcTL and all but the first in fdAT chunks, looping forever.
+class ApngWriter : public CineWriter {
+public:
+    ApngWriter(FILE* file, uint32_t width, uint32_t height, const std::vector<double>& frameSeconds)
+        : CineWriter(file), width(width), height(height), frameSeconds(frameSeconds) {}
+
+    bool begin() override {
+        static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        return put(signature, sizeof(signature));
+    }
+
+    bool write(size_t frameIndex, const std::vector<uint8_t>& png) override {
+        std::vector<uint8_t> data;
+        if (frameIndex == 0) {
+            std::vector<uint8_t> control;
+            putBig32(control, (uint32_t)frameSeconds.size());
+            putBig32(control, 0);                       // Plays: forever
+            if (!pngChunkData(png, "IHDR", data) || !chunk("IHDR", nullptr, 0, data) ||
+                !chunk("acTL", nullptr, 0, control)) {
+                return false;
+            }
+        }
+
+        // The delay is a fraction of 16-bit parts
+        double seconds = frameSeconds[frameIndex];
+        uint16_t delayDenominator = seconds <= 1.0 ? 10000 : 100;
+        uint16_t delayNumerator = (uint16_t)std::min<long>(std::max<long>(
+            std::lround(seconds * delayDenominator), 1), 65535);
+
+        std::vector<uint8_t> control;
+        putBig32(control, sequence++);
+        putBig32(control, width);
+        putBig32(control, height);
+        putBig32(control, 0);                           // x offset
+        putBig32(control, 0);                           // y offset
+        putBig16(control, delayNumerator);
+        putBig16(control, delayDenominator);
+        control.push_back(0);                           // APNG_DISPOSE_OP_NONE
+        control.push_back(0);                           // APNG_BLEND_OP_SOURCE
+        if (!chunk("fcTL", nullptr, 0, control) || !pngChunkData(png, "IDAT", data)) {
+            return false;
+        }
+        if (frameIndex == 0) {
+            return chunk("IDAT", nullptr, 0, data);
+        }
+        std::vector<uint8_t> number;
+        putBig32(number, sequence++);
+        return chunk("fdAT", number.data(), number.size(), data);
+    }
+
+    bool finish() override {
+        return chunk("IEND", nullptr, 0, std::vector<uint8_t>());
+    }
+
+private:
+    // --- Helper: A chunk whose data is prefix then data ---
+    bool chunk(const char* type, const uint8_t* prefix, size_t prefixSize, const std::vector<uint8_t>& data) {
+        std::vector<uint8_t> header;
+        putBig32(header, (uint32_t)(prefixSize + data.size()));
+        header.insert(header.end(), type, type + 4);
+        uLong crc = crc32(0L, reinterpret_cast<const Bytef*>(type), 4);
+        if (prefixSize > 0) crc = crc32(crc, prefix, (uInt)prefixSize);
+        if (!data.empty()) crc = crc32(crc, data.data(), (uInt)data.size());
+        std::vector<uint8_t> trailer;
+        putBig32(trailer, (uint32_t)crc);
+        return put(header.data(), header.size()) && put(prefix, prefixSize) &&
+               put(data.data(), data.size()) && put(trailer.data(), trailer.size());
+    }
+
+    uint32_t width;
+    uint32_t height;
+    std::vector<double> frameSeconds;
+    uint32_t sequence = 0;
+};
+
+}  // namespace
+
+// ========================================================================
+// Sources
+// ========================================================================
+
+// --- Helper: Frames per second a dataset asks for, 0 if none ---
+static double frameRate(DcmDataset* dataset) {
+    Sint32 rate = 0;
+    Float64 frameTime = 0.0;
+    if (dataset->findAndGetSint32(DCM_CineRate, rate).good() && rate > 0) {
+        return rate;
+    }
+    if (dataset->findAndGetFloat64(DCM_FrameTime, frameTime).good() && frameTime > 0.0) {
+        return 1000.0 / frameTime;
+    }
+    if (dataset->findAndGetSint32(DCM_RecommendedDisplayFrameRate, rate).good() && rate > 0) {
+        return rate;
+    }
+    return 0.0;
+}
+
+// --- Helper: How long each frame shows, from FrameTimeVector ---
+// Entry i is the time from frame i - 1 to frame i, so frame i shows for
+// entry i + 1; the last frame gets the mean. Empty if absent or unusable.
+static std::vector<double> frameSeconds(DcmDataset* dataset, uint32_t frameCount) {
+    std::vector<double> increments;
+    Float64 value = 0.0;
+    while (dataset->findAndGetFloat64(DCM_FrameTimeVector, value, (unsigned long)increments.size()).good()) {
+        if (value < 0.0) return {};
+        increments.push_back(value / 1000.0);
+    }
+    if (frameCount < 2 || increments.size() != frameCount) {
+        return {};
+    }
+    std::vector<double> seconds(increments.begin() + 1, increments.end());
+    double total = 0.0;
+    for (double s : seconds) total += s;
+    if (total <= 0.0) return {};
+    seconds.push_back(total / seconds.size());
+    return seconds;
+}
+
+static DB_Status readSource(const char* path, CineSource& source) {
+    if (!path) {
+        return DB_STATUS_ERROR;
+    }
+    DcmFileFormat fileFormat;
+    if (fileFormat.loadFile(path).bad()) {
+        return DB_STATUS_NOT_FOUND;
+    }
+    DcmDataset* dataset = fileFormat.getDataset();
+    if (!dataset || !readFrameLayout(dataset, source.layout)) {
+        return DB_STATUS_ERROR;
+    }
+    source.framesPerSecond = frameRate(dataset);
+    source.frameSeconds = frameSeconds(dataset, source.layout.frameCount);
+    return DB_STATUS_OK;
+}
+
+// --- Helper: Window over every stored value ---
+// A loop windowed frame by frame would flicker.
+static void useStoredRange(DecodedFrame& frame) {
+    const FrameLayout& layout = frame.layout;
+    uint32_t bits = std::min<uint32_t>(layout.bitsStored, 16);
+    double low = layout.isSigned ? -std::ldexp(1.0, bits - 1) : 0.0;
+    double high = layout.isSigned ? std::ldexp(1.0, bits - 1) - 1.0 : std::ldexp(1.0, bits) - 1.0;
+    low = low * frame.slope + frame.intercept;
+    high = high * frame.slope + frame.intercept;
+    if (low > high) std::swap(low, high);
+    frame.hasWindow = true;
+    frame.windowCenter = (low + high + 1.0) / 2.0;
+    frame.windowWidth = high - low + 1.0;
+}
+
+// ========================================================================
+// Cine Export API
+// ========================================================================
+
+DB_Status db_export_cine(const char* const* inputPaths,
+                         int inputCount,
+                         const char* outputPath,
+                         const DB_CineOptions* options,
+                         DB_CineProgressCallback onProgress,
+                         void* userData) {
+    if (!inputPaths || inputCount <= 0 || !outputPath || !options ||
+        options->framesPerSecond < 0.0 || options->framesPerSecond > 1000.0 ||
+        (options->format != DB_CINE_FORMAT_AVI_UNCOMPRESSED &&
+         options->format != DB_CINE_FORMAT_AVI_MJPEG && options->format != DB_CINE_FORMAT_APNG)) {
+        return DB_STATUS_ERROR;
+    }
+    registerCodecs();
+
+    // Headers first: the writer needs the size and number of frames
+    std::vector<CineSource> sources((size_t)inputCount);
+    std::vector<DB_Status> sourceStatuses((size_t)inputCount, DB_STATUS_OK);
+    parallelFor((size_t)inputCount, options->threadCount, [&](size_t i) {
+        sourceStatuses[i] = readSource(inputPaths[i], sources[i]);
+    });
+    std::vector<CineFrame> frames;
+    const FrameLayout& first = sources[0].layout;
+    for (size_t i = 0; i < sources.size(); i++) {
+        if (sourceStatuses[i] != DB_STATUS_OK) {
+            return sourceStatuses[i];
+        }
+        const FrameLayout& layout = sources[i].layout;
+        if (layout.rows != first.rows || layout.columns != first.columns ||
+            layout.samplesPerPixel != first.samplesPerPixel) {
+            return DB_STATUS_ERROR;
+        }
+        for (uint32_t frame = 0; frame < layout.frameCount; frame++) {
+            frames.push_back({(uint32_t)i, frame});
+        }
+    }
+    double framesPerSecond = options->framesPerSecond > 0.0 ? options->framesPerSecond
+                           : sources[0].framesPerSecond > 0.0 ? sources[0].framesPerSecond
+                           : 10.0;
+    framesPerSecond = std::min(std::max(framesPerSecond, 0.01), 1000.0);
+
+    // An input's FrameTimeVector paces its own frames unless the caller
+    // sets a rate; AVI has one rate for the whole file, so it gets the mean
+    std::vector<double> seconds(frames.size(), 1.0 / framesPerSecond);
+    double totalSeconds = 0.0;
+    for (size_t i = 0; i < frames.size(); i++) {
+        const CineSource& source = sources[frames[i].source];
+        if (options->framesPerSecond <= 0.0 && !source.frameSeconds.empty()) {
+            seconds[i] = std::min(std::max(source.frameSeconds[frames[i].frame], 0.001), 100.0);
+        }
+        totalSeconds += seconds[i];
+    }
+    framesPerSecond = std::min(std::max(frames.size() / totalSeconds, 0.01), 1000.0);
+
+    DB_ExportOptions renderOptions = {};
+    renderOptions.format = options->format == DB_CINE_FORMAT_APNG ? DB_EXPORT_FORMAT_PNG : DB_EXPORT_FORMAT_JPEG;
+    renderOptions.windowMode = options->windowMode;
+    renderOptions.windowCenter = options->windowCenter;
+    renderOptions.windowWidth = options->windowWidth;
+    renderOptions.bitDepth = 8;
+    int quality = options->quality > 0 ? options->quality : 90;
+
+    // Written beside the output and renamed over it, so a failed export
+    // leaves any earlier file at outputPath as it was
+    std::string tempPath = replacementPath(outputPath);
+    FILE* file = fopen(tempPath.c_str(), "wb");
+    if (!file) {
+        return DB_STATUS_ERROR;
+    }
+    std::unique_ptr<CineWriter> writer;
+    if (options->format == DB_CINE_FORMAT_APNG) {
+        writer.reset(new ApngWriter(file, first.columns, first.rows, seconds));
+    } else {
+        writer.reset(new AviWriter(file, first.columns, first.rows, framesPerSecond, frames.size(),
+                                   options->format == DB_CINE_FORMAT_AVI_MJPEG));
+    }
+
+    // Decoding a compressed frame costs about what encoding one does; this
+    // thread only writes
+    size_t frameCount = frames.size();
+    int threads = resolveThreadCount(options->threadCount);
+    int decoders = (int)std::min<size_t>(std::max(1, threads / 2), frameCount);
+    int encoders = (int)std::min<size_t>(std::max(1, threads - decoders), frameCount);
+    size_t depth = options->queueDepth > 0 ? (size_t)options->queueDepth : (size_t)threads * 2;
+
+    FrameReorder order(frameCount, depth);
+    BoundedQueue<RenderedFrame> renderedFrames(depth, decoders);
+    std::atomic<int> failure{DB_STATUS_OK};
+    auto fail = [&](DB_Status status) {
+        int expected = DB_STATUS_OK;
+        failure.compare_exchange_strong(expected, (int)status);
+        order.cancel();
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < decoders; i++) {
+        workers.emplace_back([&] {
+            // Each decoder keeps its current input open across its frames
+            std::unique_ptr<DcmFileFormat> fileFormat;
+            std::unique_ptr<FrameAccess> access;
+            uint32_t openSource = UINT32_MAX;
+            size_t index;
+            while (order.claim(index)) {
+                const CineFrame& frame = frames[index];
+                if (frame.source != openSource) {
+                    openSource = frame.source;
+                    access.reset(new FrameAccess);
+                    fileFormat.reset(new DcmFileFormat);
+                    if (fileFormat->loadFile(inputPaths[frame.source]).bad()) {
+                        fail(DB_STATUS_NOT_FOUND);
+                        break;
+                    }
+                    if (!fileFormat->getDataset() || !access->open(fileFormat->getDataset(), false)) {
+                        fail(DB_STATUS_ERROR);
+                        break;
+                    }
+                }
+                DecodedFrame decoded;
+                RenderedFrame rendered;
+                decoded.index = rendered.index = index;
+                if (!readFrame(fileFormat->getDataset(), *access, frame.frame, decoded)) {
+                    fail(DB_STATUS_ERROR);
+                    break;
+                }
+                if (!decoded.hasWindow && renderOptions.windowMode == DB_EXPORT_WINDOW_FILE) {
+                    useStoredRange(decoded);
+                }
+                if (!renderFrame(decoded, renderOptions, rendered.image)) {
+                    fail(DB_STATUS_ERROR);
+                    break;
+                }
+                renderedFrames.push(std::move(rendered));
+            }
+            renderedFrames.close();
+        });
+    }
+    for (int i = 0; i < encoders; i++) {
+        workers.emplace_back([&] {
+            RenderedFrame rendered;
+            while (renderedFrames.pop(rendered)) {
+                if (failure != DB_STATUS_OK) continue;
+                std::vector<uint8_t> encoded;
+                bool ok = true;
+                switch (options->format) {
+                    case DB_CINE_FORMAT_AVI_UNCOMPRESSED:
+                        toDIB(rendered.image, encoded);
+                        break;
+                    case DB_CINE_FORMAT_AVI_MJPEG:
+                        ok = encodeJPEG(rendered.image, quality, encoded);
+                        break;
+                    case DB_CINE_FORMAT_APNG:
+                        ok = encodePNG(rendered.image, encoded);
+                        break;
+                }
+                if (ok) {
+                    order.deliver(rendered.index, std::move(encoded));
+                } else {
+                    fail(DB_STATUS_ERROR);
+                }
+            }
+        });
+    }
+
+    // Frames are written in order as they come back
+    bool written = writer->begin();
+    std::vector<uint8_t> encoded;
+    for (size_t index = 0; written && index < frameCount; index++) {
+        written = order.take(encoded) && writer->write(index, encoded);
+        if (written && onProgress) {
+            onProgress(userData, (int)index + 1, (int)frameCount);
+        }
+    }
+    written = written && writer->finish();
+    if (!written) {
+        fail(DB_STATUS_ERROR);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    writer.reset();
+    if (fclose(file) != 0 || !written || !replaceFile(tempPath, outputPath)) {
+        remove(tempPath.c_str());
+        return failure != DB_STATUS_OK ? (DB_Status)failure.load() : DB_STATUS_ERROR;
+    }
+    return DB_STATUS_OK;
+}
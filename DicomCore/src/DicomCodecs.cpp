@@ -0,0 +1,294 @@
+//
+//  DicomCodecs.cpp
+//  DicomCore
+//
+//  Frame access on top of DCMTK's codecs: decode one frame, and re-encode
+//  one frame by compressing it alone and splicing its fragments into the
+//  original pixel sequence.
+//
+
+#include "DicomCodecs.hpp"
+#include "dcmtk/dcmdata/dcpixel.h"
+#include "dcmtk/dcmdata/dcpixseq.h"
+#include "dcmtk/dcmdata/dcpxitem.h"
+#include "dcmtk/dcmdata/dcrledrg.h"
+#include "dcmtk/dcmdata/dcrleerg.h"
+#include "dcmtk/dcmdata/dcxfer.h"
+#include "dcmtk/dcmjpeg/djdecode.h"
+#include "dcmtk/dcmjpeg/djencode.h"
+#include "dcmtk/dcmjpls/djdecode.h"
+#include "dcmtk/dcmjpls/djencode.h"
+#include <algorithm>
+#include <mutex>
+
+namespace dicomcore {
+
+void registerCodecs() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        DJDecoderRegistration::registerCodecs();
+        DJEncoderRegistration::registerCodecs();
+        DJLSDecoderRegistration::registerCodecs();
+        DJLSEncoderRegistration::registerCodecs();
+        DcmRLEDecoderRegistration::registerCodecs();
+        DcmRLEEncoderRegistration::registerCodecs();
+    });
+}
+
+bool readFrameLayout(DcmItem* dataset, FrameLayout& layout) {
+    Uint16 rows = 0, columns = 0, samples = 1, bitsAllocated = 0, bitsStored = 0;
+    Uint16 highBit = 0, pixelRepresentation = 0, planar = 0;
+    Sint32 frames = 1;
+    dataset->findAndGetUint16(DCM_Rows, rows);
+    dataset->findAndGetUint16(DCM_Columns, columns);
+    dataset->findAndGetUint16(DCM_SamplesPerPixel, samples);
+    dataset->findAndGetUint16(DCM_BitsAllocated, bitsAllocated);
+    dataset->findAndGetUint16(DCM_BitsStored, bitsStored);
+    dataset->findAndGetUint16(DCM_HighBit, highBit);
+    dataset->findAndGetUint16(DCM_PixelRepresentation, pixelRepresentation);
+    dataset->findAndGetUint16(DCM_PlanarConfiguration, planar);
+    dataset->findAndGetSint32(DCM_NumberOfFrames, frames);
+
+    OFString photometric;
+    dataset->findAndGetOFString(DCM_PhotometricInterpretation, photometric);
+
+    if (rows == 0 || columns == 0 || samples == 0 ||
+        (bitsAllocated != 8 && bitsAllocated != 16)) {
+        return false;
+    }
+    layout.rows = rows;
+    layout.columns = columns;
+    layout.frameCount = frames > 0 ? (uint32_t)frames : 1;
+    layout.samplesPerPixel = samples;
+    layout.bitsAllocated = bitsAllocated;
+    layout.bitsStored = bitsStored > 0 && bitsStored <= bitsAllocated ? bitsStored : bitsAllocated;
+    layout.highBit = highBit;
+    layout.isSigned = pixelRepresentation == 1;
+    layout.planar = samples > 1 && planar == 1;
+    layout.photometric = photometric.c_str();
+    return true;
+}
+
+// ========================================================================
+// Frame access
+// ========================================================================
+
+static inline uint32_t readLittleEndian32(const Uint8* p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+bool FrameAccess::open(DcmDataset* ds, bool writable) {
+    registerCodecs();
+    dataset = ds;
+    if (!readFrameLayout(dataset, frameLayout)) return false;
+
+    DcmElement* element = nullptr;
+    if (dataset->findAndGetElement(DCM_PixelData, element).bad() || !element) return false;
+    pixelData = OFstatic_cast(DcmPixelData*, element);
+    xfer = dataset->getOriginalXfer();
+    encapsulated = DcmXfer(xfer).isEncapsulated();
+    size_t frameBytes = frameLayout.frameBytes();
+
+    if (!encapsulated) {
+        // Subsampled color is not addressable per pixel
+        if (frameLayout.photometric.compare(0, 12, "YBR_FULL_422") == 0 ||
+            frameLayout.photometric.compare(0, 11, "YBR_PARTIAL") == 0 ||
+            (uint64_t)element->getLength() < (uint64_t)frameBytes * frameLayout.frameCount) {
+            return false;
+        }
+        if (!writable) {
+            decoded.resize(frameBytes);
+            return true;
+        }
+        if (frameLayout.bitsAllocated == 8) {
+            Uint8* pixels = nullptr;
+            element->getUint8Array(pixels);
+            nativePixels = pixels;
+        } else {
+            Uint16* pixels = nullptr;
+            element->getUint16Array(pixels);
+            nativePixels = reinterpret_cast<uint8_t*>(pixels);
+        }
+        return nativePixels != nullptr;
+    }
+
+    if (pixelData->getEncapsulatedRepresentation(xfer, nullptr, sequence).bad() || !sequence) {
+        return false;
+    }
+    Uint32 uncompressedSize = 0;
+    if (pixelData->getUncompressedFrameSize(dataset, uncompressedSize).bad()) return false;
+    decoded.resize(std::max((size_t)uncompressedSize, frameBytes));
+    return mapFragments();
+}
+
+bool FrameAccess::mapFragments() {
+    unsigned long items = sequence->card();
+    if (items < 2) return false;
+    unsigned long fragmentCount = items - 1;
+    uint32_t frames = frameLayout.frameCount;
+
+    if (frames == 1) {
+        fragments.assign(1, std::make_pair(1UL, fragmentCount));
+        return true;
+    }
+    if (fragmentCount == frames) {
+        for (uint32_t i = 0; i < frames; i++) {
+            fragments.push_back(std::make_pair((unsigned long)i + 1, 1UL));
+        }
+        return true;
+    }
+
+    // Several fragments per frame: the Basic Offset Table tells where each
+    // frame starts, as a byte offset from the first fragment's item tag
+    DcmPixelItem* table = nullptr;
+    Uint8* offsets = nullptr;
+    if (sequence->getItem(table, 0).bad() || table->getLength() != frames * 4 ||
+        table->getUint8Array(offsets).bad() || !offsets) {
+        return false;
+    }
+    uint64_t position = 0;
+    uint32_t frame = 0;
+    for (unsigned long item = 1; item < items; item++) {
+        if (frame < frames && position == readLittleEndian32(offsets + 4 * frame)) {
+            fragments.push_back(std::make_pair(item, 0UL));
+            frame++;
+        }
+        if (fragments.empty()) return false;
+        fragments.back().second++;
+
+        DcmPixelItem* fragment = nullptr;
+        if (sequence->getItem(fragment, item).bad()) return false;
+        position += 8 + fragment->getLength();
+    }
+    return frame == frames;
+}
+
+uint8_t* FrameAccess::frame(uint32_t index) {
+    if (index >= frameLayout.frameCount) return nullptr;
+    if (nativePixels) {
+        return nativePixels + (size_t)index * frameLayout.frameBytes();
+    }
+    if (decodedIndex == index) return decoded.data();
+    decodedIndex = UINT32_MAX;
+
+    if (!encapsulated) {
+        size_t frameBytes = frameLayout.frameBytes();
+        if (pixelData->getPartialValue(decoded.data(), (Uint32)(index * frameBytes), (Uint32)frameBytes,
+                                       &fileCache, gLocalByteOrder).bad()) {
+            return nullptr;
+        }
+        decodedIndex = index;
+        return decoded.data();
+    }
+
+    // Codecs may rewrite PlanarConfiguration to describe what they
+    // produce; the file keeps its own
+    Uint16 planarBefore = 0;
+    bool hadPlanar = dataset->findAndGetUint16(DCM_PlanarConfiguration, planarBefore).good();
+
+    Uint32 startFragment = (Uint32)fragments[index].first;
+    OFString colorModel;
+    if (pixelData->getUncompressedFrame(dataset, index, startFragment, decoded.data(),
+                                        (Uint32)decoded.size(), colorModel, &fileCache).bad()) {
+        return nullptr;
+    }
+
+    Uint16 planarAfter = planarBefore;
+    dataset->findAndGetUint16(DCM_PlanarConfiguration, planarAfter);
+    if (hadPlanar && planarAfter != planarBefore) {
+        dataset->putAndInsertUint16(DCM_PlanarConfiguration, planarBefore);
+    }
+    // RLE decodes color by plane whatever the attribute says
+    frameLayout.planar = frameLayout.samplesPerPixel > 1 &&
+                         (xfer == EXS_RLELossless || planarAfter == 1);
+    if (!colorModel.empty()) {
+        frameLayout.photometric = colorModel.c_str();
+    }
+    decodedIndex = index;
+    return decoded.data();
+}
+
+bool encodeFrame(const FrameLayout& layout, const uint8_t* pixels, E_TransferSyntax xfer,
+                 const DcmRepresentationParameter* parameter, DcmDataset& frameSet,
+                 DcmPixelSequence*& encoded) {
+    // The frame alone, as an uncompressed single-frame image
+    frameSet.putAndInsertUint16(DCM_SamplesPerPixel, layout.samplesPerPixel);
+    frameSet.putAndInsertString(DCM_PhotometricInterpretation, layout.photometric.c_str());
+    if (layout.samplesPerPixel > 1) {
+        frameSet.putAndInsertUint16(DCM_PlanarConfiguration, layout.planar ? 1 : 0);
+    }
+    frameSet.putAndInsertUint16(DCM_Rows, (Uint16)layout.rows);
+    frameSet.putAndInsertUint16(DCM_Columns, (Uint16)layout.columns);
+    frameSet.putAndInsertUint16(DCM_BitsAllocated, layout.bitsAllocated);
+    frameSet.putAndInsertUint16(DCM_BitsStored, layout.bitsStored);
+    frameSet.putAndInsertUint16(DCM_HighBit, layout.highBit);
+    frameSet.putAndInsertUint16(DCM_PixelRepresentation, layout.isSigned ? 1 : 0);
+    size_t frameBytes = layout.frameBytes();
+    if (layout.bitsAllocated == 8) {
+        frameSet.putAndInsertUint8Array(DCM_PixelData, pixels, (unsigned long)frameBytes);
+    } else {
+        frameSet.putAndInsertUint16Array(DCM_PixelData, reinterpret_cast<const Uint16*>(pixels),
+                                         (unsigned long)(frameBytes / 2));
+    }
+
+    DcmElement* element = nullptr;
+    encoded = nullptr;
+    return frameSet.chooseRepresentation(xfer, parameter).good() &&
+           frameSet.findAndGetElement(DCM_PixelData, element).good() &&
+           OFstatic_cast(DcmPixelData*, element)->getEncapsulatedRepresentation(xfer, parameter, encoded).good() &&
+           encoded && encoded->card() >= 2;
+}
+
+bool FrameAccess::replaceFrame(uint32_t index) {
+    if (!encapsulated) return true;
+    if (index != decodedIndex) return false;
+
+    DcmDataset frameSet;
+    DcmPixelSequence* encoded = nullptr;
+    if (!encodeFrame(frameLayout, decoded.data(), xfer, nullptr, frameSet, encoded)) {
+        return false;
+    }
+
+    // A lossy encoder may pick its own color space; the dataset describes
+    // every frame, so this frame must come out in the same one
+    OFString encodedPhotometric;
+    OFString datasetPhotometric;
+    frameSet.findAndGetOFString(DCM_PhotometricInterpretation, encodedPhotometric);
+    dataset->findAndGetOFString(DCM_PhotometricInterpretation, datasetPhotometric);
+    if (encodedPhotometric != datasetPhotometric) return false;
+
+    std::pair<unsigned long, unsigned long>& range = fragments[index];
+    for (unsigned long i = 0; i < range.second; i++) {
+        DcmPixelItem* old = nullptr;
+        if (sequence->remove(old, range.first).good()) {
+            delete old;
+        }
+    }
+    unsigned long inserted = 0;
+    while (encoded->card() > 1) {
+        DcmPixelItem* item = nullptr;
+        if (encoded->remove(item, 1).bad()) break;
+        sequence->insert(item, range.first + inserted);
+        inserted++;
+    }
+
+    long delta = (long)inserted - (long)range.second;
+    range.second = inserted;
+    for (size_t i = index + 1; i < fragments.size(); i++) {
+        fragments[i].first = (unsigned long)((long)fragments[i].first + delta);
+    }
+    replaced = true;
+    return true;
+}
+
+void FrameAccess::finish() {
+    if (!replaced) return;
+    DcmPixelItem* table = nullptr;
+    if (sequence->getItem(table, 0).good()) {
+        table->putUint8Array(nullptr, 0);
+    }
+    dataset->findAndDeleteElement(DcmTagKey(0x7FE0, 0x0001));   // Extended Offset Table
+    dataset->findAndDeleteElement(DcmTagKey(0x7FE0, 0x0002));   // Extended Offset Table Lengths
+}
+
+}  // namespace dicomcore
@@ -0,0 +1,202 @@
+//
+//  DicomDateShift.cpp
+//  DicomCore
+//
+//  Whole-day shifting of DA and DT values. Dates go through a day count
+//  (Howard Hinnant's days_from_civil / civil_from_days), so month lengths
+//  and leap years come out right for any shift.
+//
+
+#include "DicomDateShift.hpp"
+#include <cstdio>
+
+namespace dicomcore {
+
+int64_t daysFromCivil(int64_t year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned yearOfEra = (unsigned)(year - era * 400);
+    const unsigned dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + (int64_t)dayOfEra - 719468;
+}
+
+void civilFromDays(int64_t days, int64_t& year, unsigned& month, unsigned& day) {
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned dayOfEra = (unsigned)(days - era * 146097);
+    const unsigned yearOfEra =
+        (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const unsigned monthIndex = (5 * dayOfYear + 2) / 153;    // March = 0
+    day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    year = (int64_t)yearOfEra + era * 400 + (month <= 2);
+}
+
+namespace {
+
+bool isDigits(const std::string& text, size_t start, size_t count) {
+    if (start + count > text.size()) return false;
+    for (size_t i = start; i < start + count; i++) {
+        if (text[i] < '0' || text[i] > '9') return false;
+    }
+    return true;
+}
+
+unsigned parseNumber(const std::string& text, size_t start, size_t count) {
+    unsigned value = 0;
+    for (size_t i = start; i < start + count; i++) {
+        value = value * 10 + (unsigned)(text[i] - '0');
+    }
+    return value;
+}
+
+bool isLeapYear(int64_t year) {
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+unsigned daysInMonth(int64_t year, unsigned month) {
+    static const unsigned lengths[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    return month == 2 && isLeapYear(year) ? 29 : lengths[month - 1];
+}
+
+// --- Helper: Shift YYYYMMDD, the result stays within years 0000-9999 ---
+bool shiftDate8(const std::string& date, int days, std::string& shifted) {
+    if (date.size() != 8 || !isDigits(date, 0, 8)) return false;
+    int64_t year = parseNumber(date, 0, 4);
+    unsigned month = parseNumber(date, 4, 2);
+    unsigned day = parseNumber(date, 6, 2);
+    if (month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month)) return false;
+
+    civilFromDays(daysFromCivil(year, month, day) + days, year, month, day);
+    if (year < 0 || year > 9999) return false;
+
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%04d%02u%02u", (int)year, month, day);
+    shifted = buffer;
+    return true;
+}
+
+bool shiftSingleDA(const std::string& value, int days, std::string& shifted) {
+    // ACR-NEMA style YYYY.MM.DD
+    if (value.size() == 10 && value[4] == '.' && value[7] == '.') {
+        return shiftDate8(value.substr(0, 4) + value.substr(5, 2) + value.substr(8, 2),
+                          days, shifted);
+    }
+    return shiftDate8(value, days, shifted);
+}
+
+bool shiftSingleDT(const std::string& value, int days, std::string& shifted) {
+    // YYYY[MM[DD[HH[MM[SS[.F{1-6}]]]]]][&ZZXX]
+    size_t digits = 0;
+    while (digits < value.size() && value[digits] >= '0' && value[digits] <= '9') {
+        digits++;
+    }
+    size_t end = value.size();
+    size_t offset = value.find_first_of("+-", digits);
+    if (offset != std::string::npos) {
+        if (offset + 5 != end || !isDigits(value, offset + 1, 4)) return false;
+        end = offset;
+    }
+
+    std::string date;
+    size_t precision;
+    if (digits >= 8) {
+        date = value.substr(0, 8);
+        precision = 8;
+    } else if (digits == 6 && end == 6) {
+        date = value.substr(0, 6) + "01";
+        precision = 6;
+    } else if (digits == 4 && end == 4) {
+        date = value.substr(0, 4) + "0101";
+        precision = 4;
+    } else {
+        return false;
+    }
+
+    std::string shiftedDate;
+    if (!shiftDate8(date, days, shiftedDate)) return false;
+    shifted = shiftedDate.substr(0, precision) + value.substr(precision);
+    return true;
+}
+
+// --- Helper: Position of the hyphen separating a DT range, npos if none ---
+// A hyphen after a time of day (YYYYMMDDHH at least) followed by a valid
+// HHMM offset that ends the value or the range's first part is a UTC
+// offset instead; "1990-1000" is a range of years.
+size_t dtRangeSeparator(const std::string& value) {
+    for (size_t i = 0; i < value.size(); i++) {
+        if (value[i] != '-') continue;
+        bool isOffset = i >= 10 && isDigits(value, 0, 10) && isDigits(value, i + 1, 4) &&
+                        parseNumber(value, i + 1, 2) <= 14 &&
+                        parseNumber(value, i + 3, 2) < 60 &&
+                        (i + 5 == value.size() || value[i + 5] == '-');
+        if (!isOffset) return i;
+    }
+    return std::string::npos;
+}
+
+typedef bool (*SingleShift)(const std::string&, int, std::string&);
+
+// --- Helper: Shift one value, which may be a range with an open end ---
+bool shiftRange(const std::string& value, size_t separator, int days, SingleShift shiftOne,
+                std::string& shifted) {
+    if (separator == std::string::npos) {
+        return shiftOne(value, days, shifted);
+    }
+    std::string low = value.substr(0, separator);
+    std::string high = value.substr(separator + 1);
+    if (low.empty() && high.empty()) return false;
+
+    std::string shiftedLow;
+    std::string shiftedHigh;
+    if ((!low.empty() && !shiftOne(low, days, shiftedLow)) ||
+        (!high.empty() && !shiftOne(high, days, shiftedHigh))) {
+        return false;
+    }
+    shifted = shiftedLow + "-" + shiftedHigh;
+    return true;
+}
+
+// --- Helper: Shift each backslash separated value ---
+bool shiftValues(const std::string& value, int days, bool dateTime, std::string& shifted) {
+    std::string result;
+    size_t start = 0;
+    for (;;) {
+        size_t separator = value.find('\\', start);
+        std::string single = value.substr(start, separator == std::string::npos
+                                                     ? std::string::npos : separator - start);
+        // Values are padded with a trailing space to even length
+        while (!single.empty() && single.back() == ' ') {
+            single.pop_back();
+        }
+
+        std::string shiftedSingle;
+        if (!single.empty()) {
+            bool ok = dateTime
+                ? shiftRange(single, dtRangeSeparator(single), days, shiftSingleDT, shiftedSingle)
+                : shiftRange(single, single.find('-'), days, shiftSingleDA, shiftedSingle);
+            if (!ok) return false;
+        }
+        result += shiftedSingle;
+
+        if (separator == std::string::npos) break;
+        result += '\\';
+        start = separator + 1;
+    }
+    shifted = result;
+    return true;
+}
+
+}  // namespace
+
+bool shiftDA(const std::string& value, int days, std::string& shifted) {
+    return shiftValues(value, days, false, shifted);
+}
+
+bool shiftDT(const std::string& value, int days, std::string& shifted) {
+    return shiftValues(value, days, true, shifted);
+}
+
+}  // namespace dicomcore
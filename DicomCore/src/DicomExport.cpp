@@ -0,0 +1,336 @@
+//
+//  DicomExport.cpp
+//  DicomCore
+//
+//  Image export as a three-stage pipeline: frames are decoded, windowed
+//  into display values and encoded to files by separate sets of threads
+//  joined by bounded queues.
+//
+
+#include "DicomExport.hpp"
+#include "DicomWorkPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace dicomcore;
+
+namespace {
+
+struct RenderedFrame {
+    size_t index = 0;
+    RenderedImage image;
+};
+
+}  // namespace
+
+// ========================================================================
+// Decode
+// ========================================================================
+
+namespace dicomcore {
+
+bool readFrame(DcmDataset* dataset, FrameAccess& access, uint32_t index, DecodedFrame& decoded) {
+    const uint8_t* frame = access.frame(index);
+    if (!frame) {
+        return false;
+    }
+    decoded.layout = access.layout();
+    decoded.samples.assign(frame, frame + decoded.layout.frameBytes());
+
+    Float64 slope = 1.0, intercept = 0.0, center = 0.0, width = 0.0;
+    dataset->findAndGetFloat64(DCM_RescaleSlope, slope);
+    dataset->findAndGetFloat64(DCM_RescaleIntercept, intercept);
+    decoded.slope = slope != 0.0 ? slope : 1.0;
+    decoded.intercept = intercept;
+    decoded.hasWindow = dataset->findAndGetFloat64(DCM_WindowCenter, center).good() &&
+                        dataset->findAndGetFloat64(DCM_WindowWidth, width).good() && width > 0.0;
+    decoded.windowCenter = center;
+    decoded.windowWidth = width;
+    return true;
+}
+
+}  // namespace dicomcore
+
+static DB_Status decodeFrame(const DB_ExportItem& item, DecodedFrame& decoded) {
+    if (!item.inputPath || !item.outputPath || item.frameIndex < 0) {
+        return DB_STATUS_ERROR;
+    }
+    DcmFileFormat fileFormat;
+    if (fileFormat.loadFile(item.inputPath).bad()) {
+        return DB_STATUS_NOT_FOUND;
+    }
+    DcmDataset* dataset = fileFormat.getDataset();
+    // Only the requested frame is read
+    FrameAccess access;
+    if (!dataset || !access.open(dataset, false) ||
+        !readFrame(dataset, access, (uint32_t)item.frameIndex, decoded)) {
+        return DB_STATUS_ERROR;
+    }
+    return DB_STATUS_OK;
+}
+
+// ========================================================================
+// Window
+// ========================================================================
+
+namespace dicomcore {
+
+// --- Helper: Display value of a modality value, PS3.3 C.11.2.1.2.1 ---
+static uint16_t windowValue(double x, double center, double width, double maximum) {
+    double low = center - 0.5 - (width - 1.0) / 2.0;
+    double high = center - 0.5 + (width - 1.0) / 2.0;
+    if (x <= low) return 0;
+    if (x > high) return (uint16_t)maximum;
+    return (uint16_t)(((x - (center - 0.5)) / (width - 1.0) + 0.5) * maximum + 0.5);
+}
+
+// --- Helper: Grayscale through a table of every stored value ---
+// At most 2^16 entries, far fewer than the pixels of a frame.
+static bool renderGray(const DecodedFrame& frame, const DB_ExportOptions& options,
+                       RenderedImage& image) {
+    const FrameLayout& layout = frame.layout;
+    size_t pixelCount = (size_t)layout.rows * layout.columns;
+    uint32_t bits = std::min<uint32_t>(layout.bitsStored, 16);
+    uint32_t size = 1u << bits;
+    uint32_t mask = size - 1;
+    auto storedValue = [&](uint32_t raw) {
+        return layout.isSigned && raw >= size / 2 ? (int32_t)raw - (int32_t)size : (int32_t)raw;
+    };
+    auto rawAt = [&](size_t i) -> uint32_t {
+        return layout.bitsAllocated == 8
+            ? frame.samples[i] & mask
+            : reinterpret_cast<const uint16_t*>(frame.samples.data())[i] & mask;
+    };
+
+    double center = options.windowCenter;
+    double width = options.windowWidth;
+    if (options.windowMode == DB_EXPORT_WINDOW_FILE && frame.hasWindow) {
+        center = frame.windowCenter;
+        width = frame.windowWidth;
+    } else if (options.windowMode != DB_EXPORT_WINDOW_CUSTOM) {
+        int32_t minimum = INT32_MAX, maximum = INT32_MIN;
+        for (size_t i = 0; i < pixelCount; i++) {
+            int32_t value = storedValue(rawAt(i));
+            minimum = std::min(minimum, value);
+            maximum = std::max(maximum, value);
+        }
+        double low = minimum * frame.slope + frame.intercept;
+        double high = maximum * frame.slope + frame.intercept;
+        if (low > high) std::swap(low, high);
+        center = (low + high + 1.0) / 2.0;
+        width = high - low + 1.0;
+    }
+    width = std::max(width, 1.0);
+
+    bool deep = options.bitDepth == 16 && options.format != DB_EXPORT_FORMAT_JPEG;
+    double maximum = deep ? 65535.0 : 255.0;
+    bool invert = layout.photometric == "MONOCHROME1";
+    std::vector<uint16_t> table(size);
+    for (uint32_t raw = 0; raw < size; raw++) {
+        uint16_t value = windowValue(storedValue(raw) * frame.slope + frame.intercept,
+                                     center, width, maximum);
+        table[raw] = invert ? (uint16_t)maximum - value : value;
+    }
+
+    image.channels = 1;
+    image.bitDepth = deep ? 16 : 8;
+    if (deep) {
+        image.pixels.resize(pixelCount * 2);
+        uint16_t* pixels = reinterpret_cast<uint16_t*>(image.pixels.data());
+        for (size_t i = 0; i < pixelCount; i++) {
+            pixels[i] = table[rawAt(i)];
+        }
+    } else {
+        image.pixels.resize(pixelCount);
+        for (size_t i = 0; i < pixelCount; i++) {
+            image.pixels[i] = (uint8_t)table[rawAt(i)];
+        }
+    }
+    return true;
+}
+
+// --- Helper: 8-bit color, interleaved RGB ---
+static bool renderColor(const DecodedFrame& frame, RenderedImage& image) {
+    const FrameLayout& layout = frame.layout;
+    bool ycc = layout.photometric == "YBR_FULL";
+    if (layout.bitsAllocated != 8 || (layout.photometric != "RGB" && !ycc)) {
+        return false;
+    }
+    size_t pixelCount = (size_t)layout.rows * layout.columns;
+    const uint8_t* samples = frame.samples.data();
+
+    image.channels = 3;
+    image.pixels.resize(pixelCount * 3);
+    for (size_t i = 0; i < pixelCount; i++) {
+        int c0, c1, c2;
+        if (layout.planar) {
+            c0 = samples[i];
+            c1 = samples[pixelCount + i];
+            c2 = samples[2 * pixelCount + i];
+        } else {
+            c0 = samples[3 * i];
+            c1 = samples[3 * i + 1];
+            c2 = samples[3 * i + 2];
+        }
+        if (ycc) {
+            // PS3.3 C.7.6.3.1.2, full range
+            double y = c0, cb = c1 - 128.0, cr = c2 - 128.0;
+            c0 = (int)(y + 1.402 * cr + 0.5);
+            c1 = (int)(y - 0.344136 * cb - 0.714136 * cr + 0.5);
+            c2 = (int)(y + 1.772 * cb + 0.5);
+        }
+        image.pixels[3 * i] = (uint8_t)std::min(std::max(c0, 0), 255);
+        image.pixels[3 * i + 1] = (uint8_t)std::min(std::max(c1, 0), 255);
+        image.pixels[3 * i + 2] = (uint8_t)std::min(std::max(c2, 0), 255);
+    }
+    return true;
+}
+
+bool renderFrame(const DecodedFrame& frame, const DB_ExportOptions& options,
+                 RenderedImage& image) {
+    const FrameLayout& layout = frame.layout;
+    image.width = layout.columns;
+    image.height = layout.rows;
+    if (layout.samplesPerPixel == 1 && layout.photometric.compare(0, 10, "MONOCHROME") == 0) {
+        return renderGray(frame, options, image);
+    }
+    if (layout.samplesPerPixel == 3) {
+        return renderColor(frame, image);
+    }
+    return false;
+}
+
+}  // namespace dicomcore
+
+// ========================================================================
+// Encode
+// ========================================================================
+
+static DB_Status writeImage(const RenderedImage& image, const DB_ExportOptions& options,
+                            const char* outputPath) {
+    std::vector<uint8_t> encoded;
+    bool ok = false;
+    switch (options.format) {
+        case DB_EXPORT_FORMAT_PNG:
+            ok = encodePNG(image, encoded);
+            break;
+        case DB_EXPORT_FORMAT_JPEG:
+            ok = encodeJPEG(image, options.quality > 0 ? options.quality : 90, encoded);
+            break;
+        case DB_EXPORT_FORMAT_TIFF:
+            ok = encodeTIFF(image, encoded);
+            break;
+    }
+    if (!ok) {
+        return DB_STATUS_ERROR;
+    }
+
+    FILE* file = fopen(outputPath, "wb");
+    if (!file) {
+        return DB_STATUS_ERROR;
+    }
+    bool written = fwrite(encoded.data(), 1, encoded.size(), file) == encoded.size();
+    if (fclose(file) != 0 || !written) {
+        remove(outputPath);
+        return DB_STATUS_ERROR;
+    }
+    return DB_STATUS_OK;
+}
+
+// ========================================================================
+// Export API
+// ========================================================================
+
+DB_Status db_export_images(const DB_ExportItem* items,
+                           int itemCount,
+                           const DB_ExportOptions* options,
+                           DB_Status* outStatuses,
+                           DB_ExportProgressCallback onProgress,
+                           void* userData) {
+    if (!items || itemCount < 0 || !options) {
+        return DB_STATUS_ERROR;
+    }
+    if (itemCount == 0) {
+        return DB_STATUS_OK;
+    }
+    registerCodecs();
+
+    // Decoding and encoding cost about the same; windowing is a table
+    // lookup per pixel
+    int threads = resolveThreadCount(options->threadCount);
+    int decoders = std::min(std::max(1, threads / 2), itemCount);
+    int renderers = std::max(1, threads / 8);
+    int encoders = std::min(std::max(1, threads - decoders - renderers), itemCount);
+    size_t depth = options->queueDepth > 0 ? (size_t)options->queueDepth : (size_t)threads * 2;
+
+    BoundedQueue<DecodedFrame> decodedFrames(depth, decoders);
+    BoundedQueue<RenderedFrame> renderedFrames(depth, renderers);
+
+    std::mutex progressMutex;
+    int itemsDone = 0;
+    int failures = 0;
+    auto finish = [&](size_t index, DB_Status status) {
+        if (outStatuses) {
+            outStatuses[index] = status;
+        }
+        std::lock_guard<std::mutex> lock(progressMutex);
+        itemsDone++;
+        if (status != DB_STATUS_OK) {
+            failures++;
+        }
+        if (onProgress) {
+            onProgress(userData, itemsDone, itemCount, (int)index, status);
+        }
+    };
+
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> workers;
+    for (int i = 0; i < decoders; i++) {
+        workers.emplace_back([&] {
+            for (size_t index = next++; index < (size_t)itemCount; index = next++) {
+                DecodedFrame frame;
+                frame.index = index;
+                DB_Status status = decodeFrame(items[index], frame);
+                if (status == DB_STATUS_OK) {
+                    decodedFrames.push(std::move(frame));
+                } else {
+                    finish(index, status);
+                }
+            }
+            decodedFrames.close();
+        });
+    }
+    for (int i = 0; i < renderers; i++) {
+        workers.emplace_back([&] {
+            DecodedFrame frame;
+            while (decodedFrames.pop(frame)) {
+                RenderedFrame rendered;
+                rendered.index = frame.index;
+                if (renderFrame(frame, *options, rendered.image)) {
+                    renderedFrames.push(std::move(rendered));
+                } else {
+                    finish(frame.index, DB_STATUS_ERROR);
+                }
+            }
+            renderedFrames.close();
+        });
+    }
+    for (int i = 0; i < encoders; i++) {
+        workers.emplace_back([&] {
+            RenderedFrame rendered;
+            while (renderedFrames.pop(rendered)) {
+                finish(rendered.index, writeImage(rendered.image, *options,
+                                                  items[rendered.index].outputPath));
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    return failures == 0 ? DB_STATUS_OK : DB_STATUS_ERROR;
+}
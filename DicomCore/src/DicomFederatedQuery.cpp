@@ -0,0 +1,326 @@
+//
+//  DicomFederatedQuery.cpp
+//  DicomCore
+//
+//  Concurrent C-FIND fan-out across several PACS nodes.
+//  Responses are merged by StudyInstanceUID as they stream in.
+//
+
+#include "DicomBridge.h"
+#include "DicomNetworkUtils.hpp"
+#include "DicomNetworkStats.hpp"
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/dcmnet/dimse.h"
+#include "dcmtk/dcmnet/diutil.h"
+#include "dcmtk/dcmdata/dcdeftag.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+using namespace dicomcore;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// How long a cancelled node may take to send its final response
+// before the association is aborted
+constexpr auto kCancelGrace = std::chrono::seconds(1);
+
+// State shared between the caller and the per-node workers.
+// Held by shared_ptr so a worker that outlives its deadline stays valid.
+struct FederatedState {
+    std::mutex mutex;
+    std::condition_variable allDone;
+    std::unordered_set<std::string> seenStudies;
+    std::vector<DB_FederatedNodeResult> nodeResults;
+    std::vector<bool> finished;
+    DB_FederatedQueryCallback onResult = nullptr;
+    void* userData = nullptr;
+    int pending = 0;
+    bool closed = false;    // Caller has returned; drop late results
+};
+
+// Context for a single node's C-FIND exchange
+struct NodeFindContext {
+    FederatedState* state;
+    int nodeIndex;
+    T_ASC_Association* assoc;
+    T_ASC_PresentationContextID presID;
+    Clock::time_point deadline;
+    bool cancelled;
+    int matchCount;
+    int uniqueCount;
+};
+
+// --- Helper: Whole seconds left until a deadline, rounded up ---
+int secondsUntil(Clock::time_point deadline) {
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now());
+    return left.count() > 0 ? (int)((left.count() + 999) / 1000) : 0;
+}
+
+void handleMatch(NodeFindContext* ctx, DcmDataset* responseIdentifiers) {
+    DB_DicomTags tags;
+    extractStudyTags(responseIdentifiers, tags);
+    ctx->matchCount++;
+
+    FederatedState* state = ctx->state;
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (state->closed) return;
+
+    // Studies without a UID cannot be de-duplicated; pass them through
+    if (tags.studyInstanceUID[0] &&
+        !state->seenStudies.insert(tags.studyInstanceUID).second) {
+        return;
+    }
+
+    ctx->uniqueCount++;
+    if (state->onResult) {
+        state->onResult(state->userData, &tags, ctx->nodeIndex);
+    }
+}
+
+// Send the C-FIND and read responses, never waiting past the node deadline.
+// At the deadline a C-CANCEL is sent and the node gets kCancelGrace to
+// close the exchange; DIMSE_NODATAAVAILABLE is returned if it does not.
+OFCondition runFind(NodeFindContext* ctx, DcmDataset* findRequest, DIC_US& finalStatus) {
+    T_DIMSE_Message msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.CommandField = DIMSE_C_FIND_RQ;
+    T_DIMSE_C_FindRQ& findRQ = msg.msg.CFindRQ;
+    findRQ.MessageID = ctx->assoc->nextMsgID++;
+    strcpy(findRQ.AffectedSOPClassUID, UID_FINDStudyRootQueryRetrieveInformationModel);
+    findRQ.Priority = DIMSE_PRIORITY_MEDIUM;
+    findRQ.DataSetType = DIMSE_DATASET_PRESENT;
+
+    OFCondition cond = DIMSE_sendMessageUsingMemoryData(
+        ctx->assoc, ctx->presID, &msg, nullptr, findRequest, nullptr, nullptr);
+    if (cond.bad()) return cond;
+
+    Clock::time_point cancelDeadline;
+    while (true) {
+        int wait = secondsUntil(ctx->cancelled ? cancelDeadline : ctx->deadline);
+        if (wait == 0) {
+            if (ctx->cancelled) return DIMSE_NODATAAVAILABLE;
+
+            // Past the node deadline: ask the archive to stop and ignore the rest
+            cond = DIMSE_sendCancelRequest(ctx->assoc, ctx->presID, findRQ.MessageID);
+            if (cond.bad()) return cond;
+            ctx->cancelled = true;
+            cancelDeadline = Clock::now() + kCancelGrace;
+            continue;
+        }
+
+        T_DIMSE_Message incoming;
+        memset(&incoming, 0, sizeof(incoming));
+        T_ASC_PresentationContextID incomingPresID = 0;
+        DcmDataset* statusDetail = nullptr;
+
+        cond = DIMSE_receiveCommand(ctx->assoc, DIMSE_NONBLOCKING, wait,
+                                    &incomingPresID, &incoming, &statusDetail);
+        if (statusDetail) {
+            delete statusDetail;
+        }
+        if (cond == DIMSE_NODATAAVAILABLE) continue;
+        if (cond.bad()) return cond;
+
+        if (incoming.CommandField != DIMSE_C_FIND_RSP) {
+            return makeOFCondition(0, 0, OF_error, "Unexpected DIMSE command during C-FIND");
+        }
+        T_DIMSE_C_FindRSP& findRSP = incoming.msg.CFindRSP;
+
+        DcmDataset* responseIdentifiers = nullptr;
+        if (findRSP.DataSetType != DIMSE_DATASET_NULL) {
+            cond = DIMSE_receiveDataSetInMemory(ctx->assoc, DIMSE_NONBLOCKING, wait,
+                                                &incomingPresID, &responseIdentifiers,
+                                                nullptr, nullptr);
+            if (cond.bad()) {
+                delete responseIdentifiers;
+                return cond;
+            }
+        }
+
+        if (responseIdentifiers && findRSP.DimseStatus == STATUS_Pending && !ctx->cancelled) {
+            handleMatch(ctx, responseIdentifiers);
+        }
+        delete responseIdentifiers;
+
+        if (!DICOM_PENDING_STATUS(findRSP.DimseStatus)) {
+            finalStatus = findRSP.DimseStatus;
+            return EC_Normal;
+        }
+    }
+}
+
+void queryNode(std::shared_ptr<FederatedState> state,
+               int nodeIndex,
+               std::string localAE,
+               DB_DicomNode node,
+               DB_DicomTags criteria,
+               int timeoutSeconds,
+               Clock::time_point started)
+{
+    NodeFindContext ctx;
+    ctx.state = state.get();
+    ctx.nodeIndex = nodeIndex;
+    ctx.assoc = nullptr;
+    ctx.presID = 0;
+    ctx.deadline = started + std::chrono::seconds(timeoutSeconds);
+    ctx.cancelled = false;
+    ctx.matchCount = 0;
+    ctx.uniqueCount = 0;
+
+    NetworkOperation operation(DB_NET_OP_FIND, &node);
+    T_ASC_Network* net = nullptr;
+    DB_NetworkResult result;
+
+    // Connect and negotiate within what is left of the node deadline
+    OFCondition cond = createAssociation(
+        localAE.c_str(), &node,
+        UID_FINDStudyRootQueryRetrieveInformationModel,
+        net, ctx.assoc, std::max(1, secondsUntil(ctx.deadline)));
+
+    if (cond.bad()) {
+        bool late = Clock::now() >= ctx.deadline;
+        result = late ? makeResult(DB_STATUS_TIMEOUT, "Association not established before deadline")
+                      : conditionToResult(cond, "Association");
+        ctx.cancelled = late;
+    } else {
+        DcmDataset findRequest;
+        buildStudyFindRequest(criteria, findRequest);
+
+        ctx.presID = ASC_findAcceptedPresentationContextID(
+            ctx.assoc, UID_FINDStudyRootQueryRetrieveInformationModel);
+
+        DIC_US finalStatus = 0;
+        cond = runFind(&ctx, &findRequest, finalStatus);
+
+        if (ctx.cancelled) {
+            result = makeResult(DB_STATUS_TIMEOUT, "C-FIND cancelled at node deadline",
+                                finalStatus);
+        } else if (cond.bad()) {
+            result = conditionToResult(cond, "C-FIND");
+        } else {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "C-FIND completed, %d matches found", ctx.matchCount);
+            result = makeResult(DB_STATUS_OK, msg, finalStatus);
+        }
+
+        // A node that ignored the cancel or broke the exchange is aborted
+        // rather than waited on for an A-RELEASE response
+        if (cond.bad()) {
+            ASC_abortAssociation(ctx.assoc);
+            ASC_dropAssociation(ctx.assoc);
+            ASC_dropNetwork(&net);
+        } else {
+            releaseAssociation(ctx.assoc, net);
+        }
+    }
+
+    operation.addInstances(ctx.matchCount);
+    operation.finish(result);
+
+    double elapsed = std::chrono::duration<double>(Clock::now() - started).count();
+
+    std::lock_guard<std::mutex> lock(state->mutex);
+    DB_FederatedNodeResult& nodeResult = state->nodeResults[nodeIndex];
+    nodeResult.result = result;
+    nodeResult.matchCount = ctx.matchCount;
+    nodeResult.uniqueCount = ctx.uniqueCount;
+    nodeResult.timedOut = ctx.cancelled ? 1 : 0;
+    nodeResult.elapsedSeconds = elapsed;
+    state->finished[nodeIndex] = true;
+    state->pending--;
+    state->allDone.notify_all();
+}
+
+}  // namespace
+
+// ========================================================================
+// Federated C-FIND
+// ========================================================================
+
+DB_NetworkResult db_find_studies_federated(
+    const char* localAE,
+    const DB_DicomNode* remoteNodes,
+    int nodeCount,
+    const DB_DicomTags* searchCriteria,
+    DB_FederatedQueryCallback onResult,
+    void* userData,
+    int perNodeTimeoutSeconds,
+    DB_FederatedNodeResult* outNodeResults)
+{
+    if (!localAE || !remoteNodes || nodeCount <= 0 || !searchCriteria ||
+        perNodeTimeoutSeconds <= 0) {
+        return makeResult(DB_STATUS_ERROR, "Invalid parameters");
+    }
+
+    auto state = std::make_shared<FederatedState>();
+    state->onResult = onResult;
+    state->userData = userData;
+    state->pending = nodeCount;
+    state->finished.assign(nodeCount, false);
+    state->nodeResults.resize(nodeCount);
+    for (auto& nodeResult : state->nodeResults) {
+        memset(&nodeResult, 0, sizeof(nodeResult));
+    }
+
+    Clock::time_point started = Clock::now();
+
+    // Workers are detached so the caller returns at the deadline. Every wait
+    // in a worker is bounded by the node deadline plus kCancelGrace, so a
+    // silent node cannot keep its thread alive. They only touch the shared
+    // state under its lock.
+    for (int i = 0; i < nodeCount; i++) {
+        std::thread(queryNode, state, i, std::string(localAE), remoteNodes[i],
+                    *searchCriteria, perNodeTimeoutSeconds, started).detach();
+    }
+
+    // Give stragglers a short grace period to deliver their cancel response
+    Clock::time_point deadline = started + std::chrono::seconds(perNodeTimeoutSeconds) +
+                                 std::chrono::milliseconds(500);
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->allDone.wait_until(lock, deadline, [&] { return state->pending == 0; });
+
+    int succeeded = 0;
+    int timedOut = 0;
+    for (int i = 0; i < nodeCount; i++) {
+        DB_FederatedNodeResult& nodeResult = state->nodeResults[i];
+        if (!state->finished[i]) {
+            nodeResult.result = makeResult(DB_STATUS_TIMEOUT, "Node did not respond before deadline");
+            nodeResult.timedOut = 1;
+            nodeResult.elapsedSeconds =
+                std::chrono::duration<double>(Clock::now() - started).count();
+        }
+        if (nodeResult.timedOut) {
+            timedOut++;
+        } else if (nodeResult.result.status == DB_STATUS_OK) {
+            succeeded++;
+        }
+        if (outNodeResults) {
+            outNodeResults[i] = nodeResult;
+        }
+    }
+
+    int uniqueStudies = (int)state->seenStudies.size();
+    state->closed = true;
+    lock.unlock();
+
+    char msg[256];
+    snprintf(msg, sizeof(msg),
+             "Federated C-FIND: %d studies from %d of %d nodes (%d timed out)",
+             uniqueStudies, succeeded, nodeCount, timedOut);
+
+    if (succeeded == 0 && timedOut == nodeCount) {
+        return makeResult(DB_STATUS_TIMEOUT, msg);
+    }
+    return makeResult(succeeded > 0 ? DB_STATUS_OK : DB_STATUS_ERROR, msg);
+}
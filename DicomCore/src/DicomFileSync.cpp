@@ -0,0 +1,66 @@
+//
+//  DicomFileSync.cpp
+//  DicomCore
+//
+//  Durable writes with POSIX file and directory sync.
+//
+
+#include "DicomFileSync.hpp"
+#include <cstdio>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace dicomcore {
+
+// --- Helper: Sync an open descriptor ---
+// fsync on Darwin only reaches the drive; F_FULLFSYNC reaches the platter.
+// Network file systems may not support it, so fsync is the fallback.
+static bool syncDescriptor(int fd) {
+#ifdef F_FULLFSYNC
+    if (fcntl(fd, F_FULLFSYNC) == 0) return true;
+#endif
+    return fsync(fd) == 0;
+}
+
+bool syncFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = syncDescriptor(fd);
+    return close(fd) == 0 && ok;
+}
+
+bool syncParentDirectory(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." :
+                            slash == 0 ? "/" : path.substr(0, slash);
+    int fd = open(directory.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = syncDescriptor(fd);
+    close(fd);
+    return ok;
+}
+
+std::string replacementPath(const std::string& path) {
+    return path + ".replace.tmp";
+}
+
+bool prepareReplacement(const std::string& tempPath, const std::string& targetPath) {
+    // The new file keeps the permissions of the one it replaces
+    struct stat target;
+    if (stat(targetPath.c_str(), &target) == 0) {
+        chmod(tempPath.c_str(), target.st_mode & 07777);
+    }
+    return syncFile(tempPath);
+}
+
+bool commitReplacement(const std::string& tempPath, const std::string& targetPath) {
+    return rename(tempPath.c_str(), targetPath.c_str()) == 0 && syncParentDirectory(targetPath);
+}
+
+bool replaceFile(const std::string& tempPath, const std::string& targetPath) {
+    return prepareReplacement(tempPath, targetPath) && commitReplacement(tempPath, targetPath);
+}
+
+}  // namespace dicomcore
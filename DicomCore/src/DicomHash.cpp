@@ -0,0 +1,216 @@
+//
+//  DicomHash.cpp
+//  DicomCore
+//
+//  SHA-256 (FIPS 180-4) and HMAC-SHA256 (RFC 2104). Self-contained so the
+//  result never depends on which crypto library a build links.
+//
+
+#include "DicomHash.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace dicomcore {
+
+namespace {
+
+const uint32_t kRoundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+inline uint32_t rotr(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+inline uint32_t loadBigEndian(const uint8_t* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+// --- Helper: Compress consecutive 64-byte blocks into state ---
+void compress(uint32_t state[8], const uint8_t* data, size_t blocks) {
+    uint32_t w[64];
+    while (blocks--) {
+        for (int t = 0; t < 16; t++) {
+            w[t] = loadBigEndian(data + 4 * t);
+        }
+        for (int t = 16; t < 64; t++) {
+            uint32_t s0 = rotr(w[t - 15], 7) ^ rotr(w[t - 15], 18) ^ (w[t - 15] >> 3);
+            uint32_t s1 = rotr(w[t - 2], 17) ^ rotr(w[t - 2], 19) ^ (w[t - 2] >> 10);
+            w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int t = 0; t < 64; t++) {
+            uint32_t s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+            uint32_t choose = (e & f) ^ (~e & g);
+            uint32_t t1 = h + s1 + choose + kRoundConstants[t] + w[t];
+            uint32_t s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+            uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+            uint32_t t2 = s0 + majority;
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+        data += 64;
+    }
+}
+
+}  // namespace
+
+// ========================================================================
+// SHA-256
+// ========================================================================
+
+Sha256::Sha256() {
+    static const uint32_t initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(state, initial, sizeof(state));
+}
+
+void Sha256::update(const void* data, size_t length) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    totalLength += length;
+
+    if (buffered > 0) {
+        size_t take = std::min(length, sizeof(buffer) - buffered);
+        memcpy(buffer + buffered, bytes, take);
+        buffered += take;
+        bytes += take;
+        length -= take;
+        if (buffered < sizeof(buffer)) return;
+        compress(state, buffer, 1);
+        buffered = 0;
+    }
+
+    // Whole blocks straight from the input
+    size_t blocks = length / 64;
+    compress(state, bytes, blocks);
+    bytes += blocks * 64;
+    length -= blocks * 64;
+
+    memcpy(buffer, bytes, length);
+    buffered = length;
+}
+
+Digest Sha256::finish() {
+    uint64_t bitLength = totalLength * 8;
+
+    // 0x80, zeros up to 56 mod 64, then the 64-bit big endian bit length
+    uint8_t padding[72] = { 0x80 };
+    size_t padLength = (buffered < 56 ? 56 : 120) - buffered;
+    for (int i = 0; i < 8; i++) {
+        padding[padLength + i] = (uint8_t)(bitLength >> (56 - 8 * i));
+    }
+    update(padding, padLength + 8);
+
+    Digest digest;
+    for (int i = 0; i < 8; i++) {
+        digest[4 * i] = (uint8_t)(state[i] >> 24);
+        digest[4 * i + 1] = (uint8_t)(state[i] >> 16);
+        digest[4 * i + 2] = (uint8_t)(state[i] >> 8);
+        digest[4 * i + 3] = (uint8_t)state[i];
+    }
+    return digest;
+}
+
+// ========================================================================
+// HMAC-SHA256
+// ========================================================================
+
+HmacSha256::HmacSha256(const std::string& key) {
+    uint8_t block[64] = {};
+    if (key.size() > sizeof(block)) {
+        Sha256 keyHash;
+        keyHash.update(key.data(), key.size());
+        Digest hashed = keyHash.finish();
+        memcpy(block, hashed.data(), hashed.size());
+    } else {
+        memcpy(block, key.data(), key.size());
+    }
+
+    uint8_t pad[64];
+    for (int i = 0; i < 64; i++) pad[i] = block[i] ^ 0x36;
+    inner.update(pad, sizeof(pad));
+    for (int i = 0; i < 64; i++) pad[i] = block[i] ^ 0x5c;
+    outer.update(pad, sizeof(pad));
+}
+
+Digest HmacSha256::digest(const void* data, size_t length) const {
+    Sha256 innerHash = inner;
+    innerHash.update(data, length);
+    Digest innerDigest = innerHash.finish();
+
+    Sha256 outerHash = outer;
+    outerHash.update(innerDigest.data(), innerDigest.size());
+    return outerHash.finish();
+}
+
+// ========================================================================
+// Formatting
+// ========================================================================
+
+std::string toHex(const Digest& digest) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex(digest.size() * 2, '0');
+    for (size_t i = 0; i < digest.size(); i++) {
+        hex[2 * i] = digits[digest[i] >> 4];
+        hex[2 * i + 1] = digits[digest[i] & 0x0F];
+    }
+    return hex;
+}
+
+std::string derivedUIDRoot(const char* root) {
+    static const size_t kMaxRootLength = 32;    // Leaves 31 digits of hash
+    size_t length = root ? strlen(root) : 0;
+    if (length == 0 || length > kMaxRootLength ||
+        root[0] == '.' || root[length - 1] == '.' ||
+        strspn(root, "0123456789.") != length || strstr(root, "..")) {
+        return "2.25";
+    }
+    return root;
+}
+
+std::string uidFromDigest(const std::string& root, const Digest& digest) {
+    // Decimal digits of the leading 128 bits, by repeated division by 10
+    uint8_t number[16];
+    memcpy(number, digest.data(), sizeof(number));
+    std::string decimal;
+    bool nonZero = true;
+    while (nonZero) {
+        unsigned int remainder = 0;
+        nonZero = false;
+        for (uint8_t& byte : number) {
+            unsigned int value = remainder << 8 | byte;
+            byte = (uint8_t)(value / 10);
+            remainder = value % 10;
+            nonZero = nonZero || byte != 0;
+        }
+        decimal += (char)('0' + remainder);
+    }
+    std::reverse(decimal.begin(), decimal.end());
+
+    // Keep the most significant digits that fit; a component has no
+    // leading zero, which the most significant digit never is
+    size_t room = root.size() + 1 < 64 ? 64 - root.size() - 1 : 0;
+    if (room == 0) return root.substr(0, 64);
+    return root + "." + decimal.substr(0, room);
+}
+
+}  // namespace dicomcore
@@ -0,0 +1,507 @@
+//
+//  DicomImageEncode.cpp
+//  DicomCore
+//
+//  PNG with per-row filter selection in SSE2 or NEON and fast deflate,
+//  baseline JPEG through DCMTK's 8-bit IJG encoder, and TIFF written
+//  directly. Each takes the rendered buffer as it is.
+//
+
+#include "DicomBridge.h"
+#include "DicomImageEncode.hpp"
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/dcmjpeg/djcparam.h"
+#include "dcmtk/dcmjpeg/djeijg8.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <zlib.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace dicomcore {
+
+// --- Helper: Append big- and little-endian integers ---
+static void putBigEndian32(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back((uint8_t)(value >> 24));
+    out.push_back((uint8_t)(value >> 16));
+    out.push_back((uint8_t)(value >> 8));
+    out.push_back((uint8_t)value);
+}
+
+static void putLittleEndian16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back((uint8_t)value);
+    out.push_back((uint8_t)(value >> 8));
+}
+
+static void putLittleEndian32(std::vector<uint8_t>& out, uint32_t value) {
+    putLittleEndian16(out, (uint16_t)value);
+    putLittleEndian16(out, (uint16_t)(value >> 16));
+}
+
+// ========================================================================
+// PNG
+// ========================================================================
+
+// --- Helper: Append a chunk: length, type, data, CRC of type and data ---
+static void putChunk(std::vector<uint8_t>& out, const char* type,
+                     const uint8_t* data, size_t length) {
+    putBigEndian32(out, (uint32_t)length);
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    if (length > 0) {
+        out.insert(out.end(), data, data + length);
+    }
+    putBigEndian32(out, (uint32_t)crc32(0, out.data() + start, (uInt)(length + 4)));
+}
+
+// --- Helper: Residuals of the PNG filter types (PNG 9.2) ---
+// Each reads the unfiltered row and the one above it, so every byte is
+// independent and 16 are filtered at a time. The first bpp bytes have no
+// left neighbour and are done one at a time.
+static void filterSub(const uint8_t* row, const uint8_t*, size_t length, size_t bpp, uint8_t* out) {
+    size_t i = 0;
+    for (; i < bpp && i < length; i++) {
+        out[i] = row[i];
+    }
+#if defined(__SSE2__)
+    for (; i + 16 <= length; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(row + i));
+        __m128i a = _mm_loadu_si128((const __m128i*)(row + i - bpp));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_sub_epi8(x, a));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 16 <= length; i += 16) {
+        vst1q_u8(out + i, vsubq_u8(vld1q_u8(row + i), vld1q_u8(row + i - bpp)));
+    }
+#endif
+    for (; i < length; i++) {
+        out[i] = (uint8_t)(row[i] - row[i - bpp]);
+    }
+}
+
+static void filterUp(const uint8_t* row, const uint8_t* prior, size_t length, size_t, uint8_t* out) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= length; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(row + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(prior + i));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_sub_epi8(x, b));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 16 <= length; i += 16) {
+        vst1q_u8(out + i, vsubq_u8(vld1q_u8(row + i), vld1q_u8(prior + i)));
+    }
+#endif
+    for (; i < length; i++) {
+        out[i] = (uint8_t)(row[i] - prior[i]);
+    }
+}
+
+static void filterAverage(const uint8_t* row, const uint8_t* prior, size_t length, size_t bpp,
+                          uint8_t* out) {
+    size_t i = 0;
+    for (; i < bpp && i < length; i++) {
+        out[i] = (uint8_t)(row[i] - (prior[i] >> 1));
+    }
+#if defined(__SSE2__)
+    // pavgb rounds up; the filter rounds down
+    const __m128i one = _mm_set1_epi8(1);
+    for (; i + 16 <= length; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(row + i));
+        __m128i a = _mm_loadu_si128((const __m128i*)(row + i - bpp));
+        __m128i b = _mm_loadu_si128((const __m128i*)(prior + i));
+        __m128i average = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_sub_epi8(x, average));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 16 <= length; i += 16) {
+        uint8x16_t average = vhaddq_u8(vld1q_u8(row + i - bpp), vld1q_u8(prior + i));
+        vst1q_u8(out + i, vsubq_u8(vld1q_u8(row + i), average));
+    }
+#endif
+    for (; i < length; i++) {
+        out[i] = (uint8_t)(row[i] - ((row[i - bpp] + prior[i]) >> 1));
+    }
+}
+
+static inline uint8_t paethPredictor(int a, int b, int c) {
+    int pa = std::abs(b - c);
+    int pb = std::abs(a - c);
+    int pc = std::abs(a + b - 2 * c);
+    if (pa <= pb && pa <= pc) return (uint8_t)a;
+    return (uint8_t)(pb <= pc ? b : c);
+}
+
+static void filterPaeth(const uint8_t* row, const uint8_t* prior, size_t length, size_t bpp,
+                        uint8_t* out) {
+    size_t i = 0;
+    for (; i < bpp && i < length; i++) {
+        out[i] = (uint8_t)(row[i] - prior[i]);      // Predicts the byte above
+    }
+    // pa and pb fit a byte; pc, which can reach 510, is saturated to 255,
+    // which leaves every comparison with pa and pb as it was
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    auto absDiff = [](__m128i x, __m128i y) {
+        return _mm_or_si128(_mm_subs_epu8(x, y), _mm_subs_epu8(y, x));
+    };
+    auto lessOrEqual = [](__m128i x, __m128i y) { return _mm_cmpeq_epi8(_mm_min_epu8(x, y), x); };
+    auto widePc = [&](__m128i a, __m128i b, __m128i c) {
+        __m128i difference = _mm_sub_epi16(_mm_add_epi16(a, b), _mm_slli_epi16(c, 1));
+        return _mm_max_epi16(difference, _mm_sub_epi16(zero, difference));
+    };
+    for (; i + 16 <= length; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(row + i));
+        __m128i a = _mm_loadu_si128((const __m128i*)(row + i - bpp));
+        __m128i b = _mm_loadu_si128((const __m128i*)(prior + i));
+        __m128i c = _mm_loadu_si128((const __m128i*)(prior + i - bpp));
+        __m128i pa = absDiff(b, c);
+        __m128i pb = absDiff(a, c);
+        __m128i pc = _mm_packus_epi16(
+            widePc(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(c, zero)),
+            widePc(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(c, zero)));
+        __m128i useA = _mm_and_si128(lessOrEqual(pa, pb), lessOrEqual(pa, pc));
+        __m128i useB = lessOrEqual(pb, pc);
+        __m128i bOrC = _mm_or_si128(_mm_and_si128(useB, b), _mm_andnot_si128(useB, c));
+        __m128i predicted = _mm_or_si128(_mm_and_si128(useA, a), _mm_andnot_si128(useA, bOrC));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_sub_epi8(x, predicted));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 16 <= length; i += 16) {
+        uint8x16_t x = vld1q_u8(row + i);
+        uint8x16_t a = vld1q_u8(row + i - bpp);
+        uint8x16_t b = vld1q_u8(prior + i);
+        uint8x16_t c = vld1q_u8(prior + i - bpp);
+        uint8x16_t pa = vabdq_u8(b, c);
+        uint8x16_t pb = vabdq_u8(a, c);
+        uint16x8_t pcLow = vabdq_u16(vaddl_u8(vget_low_u8(a), vget_low_u8(b)), vshll_n_u8(vget_low_u8(c), 1));
+        uint16x8_t pcHigh = vabdq_u16(vaddl_high_u8(a, b), vshll_high_n_u8(c, 1));
+        uint8x16_t pc = vcombine_u8(vqmovn_u16(pcLow), vqmovn_u16(pcHigh));
+        uint8x16_t useA = vandq_u8(vcleq_u8(pa, pb), vcleq_u8(pa, pc));
+        uint8x16_t predicted = vbslq_u8(useA, a, vbslq_u8(vcleq_u8(pb, pc), b, c));
+        vst1q_u8(out + i, vsubq_u8(x, predicted));
+    }
+#endif
+    for (; i < length; i++) {
+        out[i] = (uint8_t)(row[i] - paethPredictor(row[i - bpp], prior[i], prior[i - bpp]));
+    }
+}
+
+// --- Helper: Sum of residuals as signed bytes, smaller compresses better ---
+static uint64_t residualCost(const uint8_t* residuals, size_t length) {
+    uint64_t cost = 0;
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = zero;
+    for (; i + 16 <= length; i += 16) {
+        __m128i r = _mm_loadu_si128((const __m128i*)(residuals + i));
+        __m128i magnitude = _mm_min_epu8(r, _mm_sub_epi8(zero, r));
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(magnitude, zero));
+    }
+    alignas(16) uint64_t lanes[2];
+    _mm_store_si128((__m128i*)lanes, sum);
+    cost = lanes[0] + lanes[1];
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 16 <= length; i += 16) {
+        int8x16_t r = vreinterpretq_s8_u8(vld1q_u8(residuals + i));
+        cost += vaddlvq_u8(vreinterpretq_u8_s8(vabsq_s8(r)));
+    }
+#endif
+    for (; i < length; i++) {
+        cost += residuals[i] < 128 ? residuals[i] : 256 - residuals[i];
+    }
+    return cost;
+}
+
+typedef void (*RowFilter)(const uint8_t*, const uint8_t*, size_t, size_t, uint8_t*);
+static const RowFilter kRowFilters[] = { filterSub, filterUp, filterAverage, filterPaeth };
+
+// --- Helper: Filter a row with the type whose residuals are smallest ---
+// The minimum sum of absolute differences heuristic (PNG 12.8). best and
+// trial hold the type byte and the residuals; best ends up the winner.
+static void filterRow(const uint8_t* row, const uint8_t* prior, size_t length, size_t bpp,
+                      uint8_t*& best, uint8_t*& trial) {
+    best[0] = 0;
+    memcpy(best + 1, row, length);
+    uint64_t bestCost = residualCost(best + 1, length);
+    for (uint8_t type = 1; type <= 4 && bestCost > 0; type++) {
+        trial[0] = type;
+        kRowFilters[type - 1](row, prior, length, bpp, trial + 1);
+        uint64_t cost = residualCost(trial + 1, length);
+        if (cost < bestCost) {
+            std::swap(best, trial);
+            bestCost = cost;
+        }
+    }
+}
+
+// --- Helper: Residuals of filter type 1-4 exactly as PNG 9.2 defines them ---
+static void referenceFilter(uint8_t type, const uint8_t* row, const uint8_t* prior,
+                            size_t length, size_t bpp, uint8_t* out) {
+    for (size_t i = 0; i < length; i++) {
+        int a = i >= bpp ? row[i - bpp] : 0;
+        int b = prior[i];
+        int c = i >= bpp ? prior[i - bpp] : 0;
+        int predicted = type == 1 ? a
+                      : type == 2 ? b
+                      : type == 3 ? (a + b) >> 1
+                      : paethPredictor(a, b, c);
+        out[i] = (uint8_t)(row[i] - predicted);
+    }
+}
+
+bool pngFiltersMatchReference(unsigned bitDepth) {
+    size_t bytesPerSample = bitDepth == 16 ? 2 : 1;
+    uint32_t state = 0x2545F491;
+    auto random = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    };
+
+    // Noise, runs of 0 and 255 (Paeth's pc saturates), and smooth ramps
+    // stored big-endian as PNG does
+    auto fill = [&](std::vector<uint8_t>& bytes, int pattern) {
+        uint32_t sample = random() & 0xFFFF;
+        for (size_t i = 0; i < bytes.size(); i += bytesPerSample) {
+            if (pattern == 0) {
+                sample = random();
+            } else if (pattern == 1) {
+                sample = random() & 1 ? 0xFFFF : 0;
+            } else {
+                sample += random() % 7 - 3;
+            }
+            for (size_t b = 0; b < bytesPerSample && i + b < bytes.size(); b++) {
+                bytes[i + b] = (uint8_t)(sample >> (8 * (bytesPerSample - 1 - b)));
+            }
+        }
+    };
+
+    std::vector<uint8_t> row, prior, vectorized, reference;
+    for (unsigned channels : { 1u, 3u, 4u }) {
+        size_t bpp = channels * bytesPerSample;
+        for (size_t pixels = 0; pixels <= 40; pixels++) {
+            size_t length = pixels * bpp;
+            row.resize(length);
+            prior.resize(length);
+            vectorized.resize(length);
+            reference.resize(length);
+            for (int pattern = 0; pattern < 3; pattern++) {
+                fill(row, pattern);
+                fill(prior, pattern);
+                for (uint8_t type = 1; type <= 4; type++) {
+                    kRowFilters[type - 1](row.data(), prior.data(), length, bpp, vectorized.data());
+                    referenceFilter(type, row.data(), prior.data(), length, bpp, reference.data());
+                    if (vectorized != reference) return false;
+
+                    uint64_t cost = 0;
+                    for (uint8_t residual : reference) {
+                        cost += residual < 128 ? residual : 256 - residual;
+                    }
+                    if (residualCost(vectorized.data(), length) != cost) return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool encodePNG(const RenderedImage& image, std::vector<uint8_t>& out) {
+    size_t bytesPerSample = image.bitDepth == 16 ? 2 : 1;
+    size_t bpp = image.channels * bytesPerSample;
+    size_t stride = (size_t)image.width * bpp;
+    if (image.width == 0 || image.height == 0 || image.pixels.size() < stride * image.height) {
+        return false;
+    }
+
+    // Filtered image data is mostly short runs; RLE matching at the
+    // fastest level costs a fraction of the default and compresses
+    // nearly as well
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, 1, Z_DEFLATED, 15, 8, Z_RLE) != Z_OK) {
+        return false;
+    }
+    std::vector<uint8_t> compressed(deflateBound(&stream, (uLong)((stride + 1) * image.height)));
+    stream.next_out = compressed.data();
+    stream.avail_out = (uInt)compressed.size();
+
+    // 16-bit samples are stored big-endian, so those rows are converted
+    // first; 8-bit rows are filtered in place
+    std::vector<uint8_t> converted(bytesPerSample == 2 ? stride * 2 : 0);
+    std::vector<uint8_t> zeroRow(stride, 0);
+    std::vector<uint8_t> filtered(2 * (stride + 1));
+    uint8_t* best = filtered.data();
+    uint8_t* trial = filtered.data() + stride + 1;
+    const uint8_t* prior = zeroRow.data();
+    bool ok = true;
+
+    for (uint32_t y = 0; y < image.height && ok; y++) {
+        const uint8_t* row = &image.pixels[y * stride];
+        if (bytesPerSample == 2) {
+            uint8_t* bigEndian = &converted[(y & 1) * stride];
+            const uint16_t* samples = reinterpret_cast<const uint16_t*>(row);
+            for (size_t i = 0; i < stride / 2; i++) {
+                bigEndian[2 * i] = (uint8_t)(samples[i] >> 8);
+                bigEndian[2 * i + 1] = (uint8_t)samples[i];
+            }
+            row = bigEndian;
+        }
+        filterRow(row, prior, stride, bpp, best, trial);
+        prior = row;
+
+        stream.next_in = best;
+        stream.avail_in = (uInt)(stride + 1);
+        ok = deflate(&stream, Z_NO_FLUSH) == Z_OK && stream.avail_in == 0;
+    }
+    ok = ok && deflate(&stream, Z_FINISH) == Z_STREAM_END;
+    size_t compressedLength = stream.total_out;
+    deflateEnd(&stream);
+    if (!ok) {
+        return false;
+    }
+
+    static const uint8_t kSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    out.clear();
+    out.reserve(compressedLength + 64);
+    out.assign(kSignature, kSignature + 8);
+
+    std::vector<uint8_t> header;
+    putBigEndian32(header, image.width);
+    putBigEndian32(header, image.height);
+    header.push_back((uint8_t)(8 * bytesPerSample));    // Bit depth
+    header.push_back(image.channels == 3 ? 2 : 0);      // Color type: RGB or gray
+    header.push_back(0);                                // Deflate
+    header.push_back(0);                                // Adaptive filtering
+    header.push_back(0);                                // Not interlaced
+    putChunk(out, "IHDR", header.data(), header.size());
+    putChunk(out, "IDAT", compressed.data(), compressedLength);
+    putChunk(out, "IEND", nullptr, 0);
+    return true;
+}
+
+// ========================================================================
+// JPEG
+// ========================================================================
+
+bool encodeJPEG(const RenderedImage& image, int quality, std::vector<uint8_t>& out) {
+    if (image.bitDepth != 8 || image.width == 0 || image.height == 0 ||
+        image.width > 0xFFFF || image.height > 0xFFFF ||
+        image.pixels.size() < (size_t)image.width * image.height * image.channels) {
+        return false;
+    }
+
+    DJCodecParameter parameters(ECC_lossyYCbCr, EDC_photometricInterpretation, EUC_never, EPC_default);
+    DJCompressIJG8Bit compressor(parameters, EJM_baseline, quality < 1 ? 1 : quality > 100 ? 100 : quality);
+    Uint8* encoded = nullptr;
+    Uint32 length = 0;
+    OFCondition cond = compressor.encode((Uint16)image.width, (Uint16)image.height,
+                                         image.channels == 3 ? EPI_RGB : EPI_Monochrome2,
+                                         (Uint16)image.channels,
+                                         const_cast<Uint8*>(image.pixels.data()), encoded, length);
+    if (cond.bad() || !encoded || length < 4) {
+        delete[] encoded;
+        return false;
+    }
+
+    // The DICOM encoder leaves out the JFIF marker image files carry
+    out.assign(encoded, encoded + 2);
+    if (encoded[2] != 0xFF || encoded[3] != 0xE0) {
+        static const uint8_t kJFIF[18] = {
+            0xFF, 0xE0, 0x00, 0x10, 'J', 'F', 'I', 'F', 0x00,
+            0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00
+        };
+        out.insert(out.end(), kJFIF, kJFIF + sizeof(kJFIF));
+    }
+    out.insert(out.end(), encoded + 2, encoded + length);
+    delete[] encoded;
+    return true;
+}
+
+// ========================================================================
+// TIFF
+// ========================================================================
+
+bool encodeTIFF(const RenderedImage& image, std::vector<uint8_t>& out) {
+    uint32_t bytesPerSample = image.bitDepth == 16 ? 2 : 1;
+    uint32_t dataLength = image.width * image.height * image.channels * bytesPerSample;
+    if (image.width == 0 || image.height == 0 || image.pixels.size() < dataLength) {
+        return false;
+    }
+
+    // Header, pixels, then the values too long for their entries, then
+    // the directory, each on a word boundary
+    const uint16_t kEntryCount = 11;
+    uint32_t padding = dataLength & 1;
+    uint32_t bitsOffset = 8 + dataLength + padding;
+    uint32_t resolutionOffset = bitsOffset + 6;
+    uint32_t directoryOffset = resolutionOffset + 8;
+
+    out.clear();
+    out.reserve(directoryOffset + 2 + kEntryCount * 12 + 4);
+    // Little-endian, the host order of 16-bit samples on both Mac
+    // architectures, so they are copied as they are
+    out.push_back('I');
+    out.push_back('I');
+    putLittleEndian16(out, 42);
+    putLittleEndian32(out, directoryOffset);
+    out.insert(out.end(), image.pixels.begin(), image.pixels.begin() + dataLength);
+    if (padding) {
+        out.push_back(0);
+    }
+    for (int i = 0; i < 3; i++) {
+        putLittleEndian16(out, (uint16_t)(8 * bytesPerSample));    // Of each RGB sample
+    }
+    putLittleEndian32(out, 72);                     // 72 dots per inch
+    putLittleEndian32(out, 1);
+
+    enum { kShort = 3, kLong = 4, kRational = 5 };
+    auto entry = [&](uint16_t tag, uint16_t type, uint32_t count, uint32_t value) {
+        putLittleEndian16(out, tag);
+        putLittleEndian16(out, type);
+        putLittleEndian32(out, count);
+        if (type == kShort && count == 1) {
+            putLittleEndian16(out, (uint16_t)value);
+            putLittleEndian16(out, 0);
+        } else {
+            putLittleEndian32(out, value);
+        }
+    };
+    bool rgb = image.channels == 3;
+    putLittleEndian16(out, kEntryCount);
+    entry(256, kLong, 1, image.width);                          // ImageWidth
+    entry(257, kLong, 1, image.height);                         // ImageLength
+    entry(258, kShort, rgb ? 3 : 1, rgb ? bitsOffset : 8 * bytesPerSample);  // BitsPerSample
+    entry(259, kShort, 1, 1);                                   // Compression: none
+    entry(262, kShort, 1, rgb ? 2 : 1);                         // RGB or BlackIsZero
+    entry(273, kLong, 1, 8);                                    // StripOffsets
+    entry(277, kShort, 1, image.channels);                      // SamplesPerPixel
+    entry(278, kLong, 1, image.height);                         // RowsPerStrip
+    entry(279, kLong, 1, dataLength);                           // StripByteCounts
+    entry(282, kRational, 1, resolutionOffset);                 // XResolution
+    entry(283, kRational, 1, resolutionOffset);                 // YResolution
+    putLittleEndian32(out, 0);                                  // No next directory
+    return true;
+}
+
+}  // namespace dicomcore
+
+// ========================================================================
+// Public API
+// ========================================================================
+
+using namespace dicomcore;
+
+DB_Status db_png_filters_self_check(int bitDepth) {
+    if (bitDepth != 8 && bitDepth != 16) {
+        return DB_STATUS_ERROR;
+    }
+    return pngFiltersMatchReference((unsigned)bitDepth) ? DB_STATUS_OK : DB_STATUS_ERROR;
+}
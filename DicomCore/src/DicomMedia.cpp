@@ -0,0 +1,510 @@
+//
+//  DicomMedia.cpp
+//  DicomCore
+//
+//  Media export: a PS3.10 file set of the given instances, copied or
+//  transcoded several at a time, with a DICOMDIR built from the tags the
+//  caller already extracted.
+//
+
+#include "DicomBridge.h"
+#include "DicomCodecs.hpp"
+#include "DicomFileSync.hpp"
+#include "DicomTranscode.hpp"
+#include "DicomWorkPool.hpp"
+#include "dcmtk/dcmdata/dctk.h"
+#include "dcmtk/dcmdata/dcdicdir.h"
+#include "dcmtk/dcmdata/dcdirrec.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace dicomcore;
+
+namespace {
+
+/// Where one item goes on the media.
+struct MediaFile {
+    size_t item;
+    std::string fileID;         // Path components joined by backslashes
+    fs::path path;
+};
+
+struct MediaSeries {
+    size_t firstItem;
+    std::string id;             // SERnnnnn
+    std::vector<size_t> files;  // Indexes into the plan's files
+};
+
+struct MediaStudy {
+    size_t firstItem;
+    std::string id;             // STUnnnnn
+    std::vector<MediaSeries> series;
+    std::unordered_map<std::string, size_t> seriesIndex;
+};
+
+struct MediaPatient {
+    size_t firstItem;
+    std::string id;             // PATnnnnn
+    std::vector<MediaStudy> studies;
+    std::unordered_map<std::string, size_t> studyIndex;
+};
+
+/// The file set: directory records to write, and where every item goes.
+struct MediaPlan {
+    std::vector<MediaPatient> patients;
+    std::vector<MediaFile> files;
+    std::vector<size_t> originals;  // Per item: the earlier item with its SOP
+                                    // Instance UID, or SIZE_MAX
+};
+
+/// What the DICOMDIR needs from a written file's meta header.
+struct FileReference {
+    OFString sopClassUID;
+    OFString sopInstanceUID;
+    OFString transferSyntaxUID;
+};
+
+}  // namespace
+
+// --- Helper: A fixed-size DB_DicomTags field as a string ---
+template <size_t N>
+static std::string field(const char (&value)[N]) {
+    return std::string(value, strnlen(value, N));
+}
+
+// --- Helper: A file or directory ID of the file set, PS3.10 8.5 ---
+// At most eight characters of upper-case letters, digits and underscore.
+static bool mediaID(const char* prefix, size_t number, std::string& id) {
+    if (number > 99999) return false;
+    char value[16];
+    snprintf(value, sizeof(value), "%s%05zu", prefix, number);
+    id = value;
+    return true;
+}
+
+static bool validFileSetID(const char* fileSetID) {
+    size_t length = strlen(fileSetID);
+    if (length > 16) return false;
+    for (size_t i = 0; i < length; i++) {
+        char c = fileSetID[i];
+        if (!((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == ' ' || c == '_')) return false;
+    }
+    return true;
+}
+
+// ========================================================================
+// Layout
+// ========================================================================
+
+/// Group items by patient, study and series in the order they first
+/// appear and give each a path: DICOM/PATnnnnn/STUnnnnn/SERnnnnn/IMGnnnnn.
+static bool planFileSet(const DB_MediaItem* items, size_t itemCount, const fs::path& root,
+                        MediaPlan& plan) {
+    std::unordered_map<std::string, size_t> patientIndex;
+    std::unordered_map<std::string, size_t> instances;
+    plan.originals.assign(itemCount, SIZE_MAX);
+
+    for (size_t i = 0; i < itemCount; i++) {
+        const DB_DicomTags& tags = items[i].tags;
+        std::string sopInstanceUID = field(tags.sopInstanceUID);
+        if (!sopInstanceUID.empty()) {
+            auto instance = instances.emplace(sopInstanceUID, i);
+            if (!instance.second) {
+                plan.originals[i] = instance.first->second;
+                continue;
+            }
+        }
+
+        auto patient = patientIndex.find(field(tags.patientID));
+        if (patient == patientIndex.end()) {
+            MediaPatient added;
+            added.firstItem = i;
+            if (!mediaID("PAT", plan.patients.size() + 1, added.id)) return false;
+            patient = patientIndex.emplace(field(tags.patientID), plan.patients.size()).first;
+            plan.patients.push_back(std::move(added));
+        }
+        MediaPatient& patientNode = plan.patients[patient->second];
+
+        auto study = patientNode.studyIndex.find(field(tags.studyInstanceUID));
+        if (study == patientNode.studyIndex.end()) {
+            MediaStudy added;
+            added.firstItem = i;
+            if (!mediaID("STU", patientNode.studies.size() + 1, added.id)) return false;
+            study = patientNode.studyIndex.emplace(field(tags.studyInstanceUID), patientNode.studies.size()).first;
+            patientNode.studies.push_back(std::move(added));
+        }
+        MediaStudy& studyNode = patientNode.studies[study->second];
+
+        auto series = studyNode.seriesIndex.find(field(tags.seriesInstanceUID));
+        if (series == studyNode.seriesIndex.end()) {
+            MediaSeries added;
+            added.firstItem = i;
+            if (!mediaID("SER", studyNode.series.size() + 1, added.id)) return false;
+            series = studyNode.seriesIndex.emplace(field(tags.seriesInstanceUID), studyNode.series.size()).first;
+            studyNode.series.push_back(std::move(added));
+        }
+        MediaSeries& seriesNode = studyNode.series[series->second];
+
+        MediaFile file;
+        file.item = i;
+        std::string imageID;
+        if (!mediaID("IMG", seriesNode.files.size() + 1, imageID)) return false;
+        file.fileID = "DICOM\\" + patientNode.id + "\\" + studyNode.id + "\\" + seriesNode.id + "\\" + imageID;
+        file.path = root / "DICOM" / patientNode.id / studyNode.id / seriesNode.id / imageID;
+        seriesNode.files.push_back(plan.files.size());
+        plan.files.push_back(std::move(file));
+    }
+    return true;
+}
+
+// ========================================================================
+// Files
+// ========================================================================
+
+// --- Helper: The references of a file, from its meta header alone ---
+static bool readReference(const std::string& path, FileReference& reference) {
+    DcmFileFormat fileFormat;
+    if (fileFormat.loadFile(path.c_str(), EXS_Unknown, EGL_noChange, DCM_MaxReadLength,
+                            ERM_metaOnly).bad()) {
+        return false;
+    }
+    DcmMetaInfo* metaInfo = fileFormat.getMetaInfo();
+    return metaInfo &&
+           metaInfo->findAndGetOFString(DCM_MediaStorageSOPClassUID, reference.sopClassUID).good() &&
+           metaInfo->findAndGetOFString(DCM_MediaStorageSOPInstanceUID, reference.sopInstanceUID).good() &&
+           metaInfo->findAndGetOFString(DCM_TransferSyntaxUID, reference.transferSyntaxUID).good() &&
+           !reference.sopClassUID.empty() && !reference.sopInstanceUID.empty() &&
+           !reference.transferSyntaxUID.empty();
+}
+
+/// Copy or transcode an item to its place in the file set. A file without
+/// a meta header is written again with one, as PS3.10 7.1 requires.
+static DB_Status writeMediaFile(const char* inputPath, const fs::path& outputPath,
+                                const TargetSyntax* target, FileReference& reference) {
+    if (!inputPath) {
+        return DB_STATUS_ERROR;
+    }
+    std::error_code ec;
+    if (!fs::is_regular_file(inputPath, ec)) {
+        return DB_STATUS_NOT_FOUND;
+    }
+    std::string output = outputPath.string();
+    if (target) {
+        DB_Status status = transcodeFile(inputPath, output.c_str(), *target);
+        if (status != DB_STATUS_OK) {
+            return status;
+        }
+    } else if (!fs::copy_file(inputPath, outputPath, fs::copy_options::overwrite_existing, ec)) {
+        return DB_STATUS_ERROR;
+    }
+    if (readReference(output, reference)) {
+        return DB_STATUS_OK;
+    }
+
+    DcmFileFormat fileFormat;
+    std::string tempPath = replacementPath(output);
+    if (fileFormat.loadFile(output.c_str()).bad() || !fileFormat.getDataset() ||
+        fileFormat.saveFile(tempPath.c_str(), fileFormat.getDataset()->getOriginalXfer()).bad() ||
+        !replaceFile(tempPath, output) || !readReference(output, reference)) {
+        remove(tempPath.c_str());
+        remove(output.c_str());
+        return DB_STATUS_ERROR;
+    }
+    return DB_STATUS_OK;
+}
+
+// ========================================================================
+// DICOMDIR
+// ========================================================================
+
+// --- Helper: A new directory record, marked UTF-8 if its text needs it ---
+static DcmDirectoryRecord* newRecord(E_DirRecType type, std::initializer_list<std::string> texts) {
+    DcmDirectoryRecord* record = new DcmDirectoryRecord(type, nullptr, OFFilename());
+    for (const std::string& text : texts) {
+        for (unsigned char c : text) {
+            if (c >= 0x80) {
+                record->putAndInsertString(DCM_SpecificCharacterSet, "ISO_IR 192");
+                return record;
+            }
+        }
+    }
+    return record;
+}
+
+/// The directory record each non-image SOP class is listed under, PS3.3
+/// F.4; any other class is listed as IMAGE.
+static const struct {
+    const char* sopClassUID;
+    E_DirRecType type;
+} kRecordTypes[] = {
+    {UID_BasicTextSRStorage, ERT_SRDocument},
+    {UID_EnhancedSRStorage, ERT_SRDocument},
+    {UID_ComprehensiveSRStorage, ERT_SRDocument},
+    {UID_Comprehensive3DSRStorage, ERT_SRDocument},
+    {UID_MammographyCADSRStorage, ERT_SRDocument},
+    {UID_ChestCADSRStorage, ERT_SRDocument},
+    {UID_XRayRadiationDoseSRStorage, ERT_SRDocument},
+    {UID_KeyObjectSelectionDocumentStorage, ERT_KeyObjectDoc},
+    {UID_GrayscaleSoftcopyPresentationStateStorage, ERT_Presentation},
+    {UID_ColorSoftcopyPresentationStateStorage, ERT_Presentation},
+    {UID_PseudoColorSoftcopyPresentationStateStorage, ERT_Presentation},
+    {UID_BlendingSoftcopyPresentationStateStorage, ERT_Presentation},
+    {UID_EncapsulatedPDFStorage, ERT_EncapDoc},
+    {UID_EncapsulatedCDAStorage, ERT_EncapDoc},
+    {UID_RTDoseStorage, ERT_RTDose},
+    {UID_RTStructureSetStorage, ERT_RTStructureSet},
+    {UID_RTPlanStorage, ERT_RTPlan},
+    {UID_RTIonPlanStorage, ERT_RTPlan},
+    {UID_RTBeamsTreatmentRecordStorage, ERT_RTTreatRecord},
+    {UID_RTBrachyTreatmentRecordStorage, ERT_RTTreatRecord},
+    {UID_RTTreatmentSummaryRecordStorage, ERT_RTTreatRecord},
+    {UID_RTIonBeamsTreatmentRecordStorage, ERT_RTTreatRecord},
+    {UID_TwelveLeadECGWaveformStorage, ERT_Waveform},
+    {UID_GeneralECGWaveformStorage, ERT_Waveform},
+    {UID_AmbulatoryECGWaveformStorage, ERT_Waveform},
+    {UID_HemodynamicWaveformStorage, ERT_Waveform},
+    {UID_CardiacElectrophysiologyWaveformStorage, ERT_Waveform},
+    {UID_BasicVoiceAudioWaveformStorage, ERT_Waveform},
+    {UID_SpatialRegistrationStorage, ERT_Registration},
+    {UID_DeformableSpatialRegistrationStorage, ERT_Registration},
+    {UID_SpatialFiducialsStorage, ERT_Fiducial},
+    {UID_RawDataStorage, ERT_RawData},
+};
+
+static E_DirRecType recordType(const OFString& sopClassUID) {
+    for (const auto& entry : kRecordTypes) {
+        if (sopClassUID == entry.sopClassUID) return entry.type;
+    }
+    return ERT_Image;
+}
+
+// --- Helper: The keys of a record type beyond Instance Number, PS3.3 F.5 ---
+// Items' tags do not hold them, so they come from the written file.
+static std::vector<DcmTagKey> recordKeys(E_DirRecType type) {
+    switch (type) {
+        case ERT_SRDocument:
+            return {DCM_CompletionFlag, DCM_VerificationFlag, DCM_ContentDate, DCM_ContentTime,
+                    DCM_VerificationDateTime, DCM_ConceptNameCodeSequence};
+        case ERT_KeyObjectDoc:
+            return {DCM_ContentDate, DCM_ContentTime, DCM_ConceptNameCodeSequence};
+        case ERT_Presentation:
+            return {DCM_ContentLabel, DCM_ContentDescription, DCM_PresentationCreationDate,
+                    DCM_PresentationCreationTime, DCM_ContentCreatorName, DCM_ReferencedSeriesSequence};
+        case ERT_EncapDoc:
+            return {DCM_ContentDate, DCM_ContentTime, DCM_DocumentTitle,
+                    DCM_MIMETypeOfEncapsulatedDocument, DCM_ConceptNameCodeSequence};
+        case ERT_RTDose:
+            return {DCM_DoseSummationType, DCM_DoseComment};
+        case ERT_RTStructureSet:
+            return {DCM_StructureSetLabel, DCM_StructureSetDate, DCM_StructureSetTime};
+        case ERT_RTPlan:
+            return {DCM_RTPlanLabel, DCM_RTPlanDate, DCM_RTPlanTime};
+        case ERT_RTTreatRecord:
+            return {DCM_TreatmentDate, DCM_TreatmentTime};
+        case ERT_Waveform:
+        case ERT_RawData:
+            return {DCM_ContentDate, DCM_ContentTime};
+        case ERT_Registration:
+        case ERT_Fiducial:
+            return {DCM_ContentDate, DCM_ContentTime, DCM_ContentLabel, DCM_ContentDescription,
+                    DCM_ContentCreatorName};
+        default:
+            return {};
+    }
+}
+
+// --- Helper: Copy the keys a record needs from the file it references ---
+static void copyRecordKeys(DcmDirectoryRecord* record, const fs::path& path) {
+    std::vector<DcmTagKey> keys = recordKeys(record->getRecordType());
+    DcmFileFormat fileFormat;
+    if (keys.empty() || fileFormat.loadFile(path.string().c_str()).bad() || !fileFormat.getDataset()) {
+        return;
+    }
+    // The copied text is in the file's character set
+    keys.insert(keys.begin(), DCM_SpecificCharacterSet);
+    for (const DcmTagKey& key : keys) {
+        DcmElement* element = nullptr;
+        if (fileFormat.getDataset()->findAndGetElement(key, element, OFFalse, OFTrue).good() &&
+            record->insert(element, OFTrue).bad()) {
+            delete element;
+        }
+    }
+}
+
+// --- Helper: A value, or a stand-in for a type 1 key that has none ---
+static void putKey(DcmDirectoryRecord* record, const DcmTagKey& key, const std::string& value,
+                   const char* standIn = nullptr) {
+    record->putAndInsertString(key, value.empty() && standIn ? standIn : value.c_str());
+}
+
+// --- Helper: A stand-in UID for a type 1 UID key that has none ---
+static std::string standInUID() {
+    char uid[100];
+    dcmGenerateUniqueIdentifier(uid, SITE_INSTANCE_UID_ROOT);
+    return uid;
+}
+
+/// The records of every file, PS3.3 F.5: patient, study, series and one
+/// per instance, of the type its SOP class calls for, keyed from the
+/// items' tags. Study Time and Study ID are not among those tags and get
+/// stand-ins, as do missing type 1 keys.
+static bool writeDicomdir(const fs::path& path, const char* fileSetID, const DB_MediaItem* items,
+                          const MediaPlan& plan, const std::vector<FileReference>& references) {
+    DcmDicomDir dicomdir(path.string().c_str(), fileSetID);
+    if (dicomdir.error().bad()) {
+        return false;
+    }
+    DcmDirectoryRecord& root = dicomdir.getRootRecord();
+
+    for (const MediaPatient& patient : plan.patients) {
+        const DB_DicomTags& patientTags = items[patient.firstItem].tags;
+        std::unique_ptr<DcmDirectoryRecord> patientRecord(
+            newRecord(ERT_Patient, {field(patientTags.patientName)}));
+        putKey(patientRecord.get(), DCM_PatientName, field(patientTags.patientName));
+        putKey(patientRecord.get(), DCM_PatientID, field(patientTags.patientID), patient.id.c_str());
+        putKey(patientRecord.get(), DCM_PatientBirthDate, field(patientTags.birthDate));
+
+        for (const MediaStudy& study : patient.studies) {
+            const DB_DicomTags& studyTags = items[study.firstItem].tags;
+            std::unique_ptr<DcmDirectoryRecord> studyRecord(
+                newRecord(ERT_Study, {field(studyTags.studyDescription), field(studyTags.accessionNumber)}));
+            putKey(studyRecord.get(), DCM_StudyDate, field(studyTags.studyDate), "19000101");
+            putKey(studyRecord.get(), DCM_StudyTime, std::string(), "000000");
+            putKey(studyRecord.get(), DCM_StudyDescription, field(studyTags.studyDescription));
+            putKey(studyRecord.get(), DCM_StudyInstanceUID, field(studyTags.studyInstanceUID),
+                   standInUID().c_str());
+            putKey(studyRecord.get(), DCM_StudyID, std::string(), study.id.c_str());
+            putKey(studyRecord.get(), DCM_AccessionNumber, field(studyTags.accessionNumber));
+
+            for (const MediaSeries& series : study.series) {
+                const DB_DicomTags& seriesTags = items[series.firstItem].tags;
+                std::unique_ptr<DcmDirectoryRecord> seriesRecord(
+                    newRecord(ERT_Series, {field(seriesTags.seriesDescription)}));
+                putKey(seriesRecord.get(), DCM_Modality, field(seriesTags.seriesModality), "OT");
+                putKey(seriesRecord.get(), DCM_SeriesInstanceUID, field(seriesTags.seriesInstanceUID),
+                       standInUID().c_str());
+                seriesRecord->putAndInsertString(DCM_SeriesNumber,
+                                                 std::to_string(seriesTags.seriesNumber).c_str());
+                putKey(seriesRecord.get(), DCM_SeriesDescription, field(seriesTags.seriesDescription));
+
+                for (size_t fileIndex : series.files) {
+                    const MediaFile& file = plan.files[fileIndex];
+                    const FileReference& reference = references[file.item];
+                    DcmDirectoryRecord* instanceRecord = newRecord(recordType(reference.sopClassUID), {});
+                    instanceRecord->putAndInsertString(DCM_ReferencedFileID, file.fileID.c_str());
+                    instanceRecord->putAndInsertString(DCM_ReferencedSOPClassUIDInFile,
+                                                       reference.sopClassUID.c_str());
+                    instanceRecord->putAndInsertString(DCM_ReferencedSOPInstanceUIDInFile,
+                                                       reference.sopInstanceUID.c_str());
+                    instanceRecord->putAndInsertString(DCM_ReferencedTransferSyntaxUIDInFile,
+                                                       reference.transferSyntaxUID.c_str());
+                    instanceRecord->putAndInsertString(DCM_InstanceNumber,
+                                                       std::to_string(items[file.item].tags.instanceNumber).c_str());
+                    copyRecordKeys(instanceRecord, file.path);
+                    if (seriesRecord->insertSub(instanceRecord).bad()) {
+                        delete instanceRecord;
+                        return false;
+                    }
+                }
+                if (studyRecord->insertSub(seriesRecord.get()).bad()) return false;
+                seriesRecord.release();
+            }
+            if (patientRecord->insertSub(studyRecord.get()).bad()) return false;
+            studyRecord.release();
+        }
+        if (root.insertSub(patientRecord.get()).bad()) return false;
+        patientRecord.release();
+    }
+    return dicomdir.write(DICOMDIR_DEFAULT_TRANSFERSYNTAX, EET_UndefinedLength, EGL_withoutGL).good();
+}
+
+// ========================================================================
+// Media Export API
+// ========================================================================
+
+DB_Status db_export_media(const DB_MediaItem* items,
+                          int itemCount,
+                          const char* outputDirectory,
+                          const DB_MediaOptions* options,
+                          DB_Status* outStatuses,
+                          DB_MediaProgressCallback onProgress,
+                          void* userData) {
+    if (!items || itemCount < 0 || !outputDirectory || !options ||
+        (options->fileSetID && !validFileSetID(options->fileSetID))) {
+        return DB_STATUS_ERROR;
+    }
+    TargetSyntax target;
+    if (options->transcode) {
+        DB_TranscodeOptions transcodeOptions = {};
+        transcodeOptions.transferSyntax = options->transferSyntax;
+        transcodeOptions.nearLosslessError = options->nearLosslessError;
+        if (!resolveTarget(transcodeOptions, target)) {
+            return DB_STATUS_ERROR;
+        }
+        registerCodecs();
+    }
+
+    // A file set is written whole; adding to an existing one is not supported
+    std::error_code ec;
+    fs::path root(outputDirectory);
+    fs::path dicomdirPath = root / "DICOMDIR";
+    fs::create_directories(root, ec);
+    if (!fs::is_directory(root, ec) || fs::exists(dicomdirPath, ec)) {
+        return DB_STATUS_ERROR;
+    }
+
+    MediaPlan plan;
+    if (!planFileSet(items, (size_t)itemCount, root, plan)) {
+        return DB_STATUS_ERROR;
+    }
+    for (const MediaFile& file : plan.files) {
+        fs::create_directories(file.path.parent_path(), ec);
+    }
+
+    std::vector<DB_Status> statuses((size_t)itemCount, DB_STATUS_OK);
+    std::vector<FileReference> references((size_t)itemCount);
+    std::mutex progressMutex;
+    int filesDone = 0;
+    int failures = 0;
+    auto finish = [&](size_t item, DB_Status status) {
+        statuses[item] = status;
+        if (outStatuses) {
+            outStatuses[item] = status;
+        }
+        std::lock_guard<std::mutex> lock(progressMutex);
+        filesDone++;
+        if (status != DB_STATUS_OK) {
+            failures++;
+        }
+        if (onProgress) {
+            onProgress(userData, filesDone, itemCount, (int)item, status);
+        }
+    };
+
+    parallelFor(plan.files.size(), options->threadCount, [&](size_t index) {
+        const MediaFile& file = plan.files[index];
+        finish(file.item, writeMediaFile(items[file.item].inputPath, file.path,
+                                         options->transcode ? &target : nullptr, references[file.item]));
+    });
+    // Duplicates are on the media only if the item that came first is
+    for (size_t i = 0; i < plan.originals.size(); i++) {
+        if (plan.originals[i] != SIZE_MAX) finish(i, statuses[plan.originals[i]]);
+    }
+
+    // Without a DICOMDIR the directory is not a file set yet, so the same
+    // export can be run into it again once the failures are dealt with
+    if (failures > 0 ||
+        !writeDicomdir(dicomdirPath, options->fileSetID, items, plan, references)) {
+        return DB_STATUS_ERROR;
+    }
+    return DB_STATUS_OK;
+}
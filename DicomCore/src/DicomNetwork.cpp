@@ -7,19 +7,72 @@
 //
 
 #include "DicomBridge.h"
+#include "DicomNetworkUtils.hpp"
+#include "DicomNetworkStats.hpp"
+#include "DicomTLS.hpp"
+#include "DicomThrottle.hpp"
+#include "DicomStore.hpp"
 #include "dcmtk/config/osconfig.h"
 #include "dcmtk/dcmnet/dimse.h"
 #include "dcmtk/dcmnet/assoc.h"
 #include "dcmtk/dcmnet/diutil.h"
+#include "dcmtk/dcmnet/dul.h"
 #include "dcmtk/dcmdata/dcdeftag.h"
 #include "dcmtk/dcmdata/dcfilefo.h"
 #include "dcmtk/dcmdata/dcistrmb.h"
 #include "dcmtk/ofstd/ofstd.h"
 #include <cstring>
 #include <cstdio>
+#include <mutex>
+#include <set>
+
+namespace dicomcore {
+
+namespace {
+
+/// Holds DCMTK's connection timeout for one association's connect.
+/// dcmConnectionTimeout is process-global and DUL reads it during the TCP
+/// connect, so concurrent associations with different timeouts (the
+/// federated query's per-node workers) would overwrite each other's. It is
+/// kept at the longest timeout of the connects in progress: none is cut
+/// short, though a connect may wait up to the longest of them.
+class ConnectTimeoutScope {
+public:
+    explicit ConnectTimeoutScope(int seconds) : seconds(seconds) {
+        std::lock_guard<std::mutex> lock(mutex());
+        pending().insert(seconds);
+        dcmConnectionTimeout.set(*pending().rbegin());
+    }
+
+    ~ConnectTimeoutScope() {
+        std::lock_guard<std::mutex> lock(mutex());
+        pending().erase(pending().find(seconds));
+        if (!pending().empty()) {
+            dcmConnectionTimeout.set(*pending().rbegin());
+        }
+    }
+
+    ConnectTimeoutScope(const ConnectTimeoutScope&) = delete;
+    ConnectTimeoutScope& operator=(const ConnectTimeoutScope&) = delete;
+
+private:
+    static std::mutex& mutex() {
+        static std::mutex instance;
+        return instance;
+    }
+
+    static std::multiset<int>& pending() {
+        static std::multiset<int> instance;
+        return instance;
+    }
+
+    int seconds;
+};
+
+}  // namespace
 
 // --- Helper: Initialize result ---
-static DB_NetworkResult makeResult(DB_Status status, const char* message = "", int dimseStatus = 0) {
+DB_NetworkResult makeResult(DB_Status status, const char* message, int dimseStatus) {
     DB_NetworkResult result;
     result.status = status;
     result.dimseStatus = dimseStatus;
@@ -29,7 +82,7 @@ static DB_NetworkResult makeResult(DB_Status status, const char* message = "", i
 }
 
 // --- Helper: Convert OFCondition to DB_NetworkResult ---
-static DB_NetworkResult conditionToResult(const OFCondition& cond, const char* operation) {
+DB_NetworkResult conditionToResult(const OFCondition& cond, const char* operation) {
     if (cond.good()) {
         return makeResult(DB_STATUS_OK);
     }
@@ -40,17 +93,35 @@ static DB_NetworkResult conditionToResult(const OFCondition& cond, const char* o
 }
 
 // --- Helper: Create association ---
-static OFCondition createAssociation(
+OFCondition createAssociation(
     const char* localAE,
     const DB_DicomNode* remoteNode,
     const char* abstractSyntax,
     T_ASC_Network*& net,
     T_ASC_Association*& assoc,
     int timeoutSeconds)
+{
+    PresentationContextSpec context = { abstractSyntax, ASC_SC_ROLE_DEFAULT, true };
+    return createAssociation(localAE, remoteNode, &context, 1, net, assoc, timeoutSeconds);
+}
+
+// --- Helper: Create association with several presentation contexts ---
+OFCondition createAssociation(
+    const char* localAE,
+    const DB_DicomNode* remoteNode,
+    const PresentationContextSpec* contexts,
+    size_t contextCount,
+    T_ASC_Network*& net,
+    T_ASC_Association*& assoc,
+    int timeoutSeconds)
 {
     OFCondition cond;
 
-    // Initialize network
+    // Presentation context IDs are odd and fit in one byte
+    if (contextCount == 0 || contextCount > 128) {
+        return makeOFCondition(0, 0, OF_error, "Invalid presentation context count");
+    }
+
     cond = ASC_initializeNetwork(NET_REQUESTOR, 0, timeoutSeconds, &net);
     if (cond.bad()) return cond;
 
@@ -70,17 +141,43 @@ static OFCondition createAssociation(
     snprintf(peerHost, sizeof(peerHost), "%s:%d", remoteNode->hostname, remoteNode->port);
     ASC_setPresentationAddresses(params, "localhost", peerHost);
 
-    // Add presentation context
+    // Add presentation contexts
     const char* transferSyntaxes[] = {
         UID_LittleEndianImplicitTransferSyntax,
         UID_LittleEndianExplicitTransferSyntax,
         UID_BigEndianExplicitTransferSyntax
     };
 
-    cond = ASC_addPresentationContext(
-        params, 1, abstractSyntax,
-        transferSyntaxes, 3,
-        ASC_SC_ROLE_DEFAULT);
+    for (size_t i = 0; i < contextCount && cond.good(); i++) {
+        const char* proposed[] = { contexts[i].transferSyntax };
+        bool single = contexts[i].transferSyntax != nullptr;
+        cond = ASC_addPresentationContext(
+            params, (T_ASC_PresentationContextID)(2 * i + 1),
+            contexts[i].abstractSyntax,
+            single ? proposed : transferSyntaxes, single ? 1 : 3,
+            contexts[i].role);
+    }
+
+    // TLS where configured for the node, bandwidth limits, and timing and
+    // counting of the connection for the operation in progress
+    DcmTransportLayer* transport = nullptr;
+    NetworkOperation* operation = NetworkOperation::current();
+    if (cond.good()) {
+        transport = createTLSTransportLayer(remoteNode);
+        transport = createThrottledTransportLayer(remoteNode, transport);
+        if (operation) {
+            transport = operation->instrument(transport);
+        }
+    }
+    if (transport) {
+        cond = ASC_setTransportLayer(net, transport, OFTrue);
+        if (cond.bad()) {
+            delete transport;
+        } else {
+            // Make DUL obtain every connection from the layer
+            cond = ASC_setTransportLayerType(params, OFTrue);
+        }
+    }
 
     if (cond.bad()) {
         ASC_destroyAssociationParameters(&params);
@@ -88,27 +185,35 @@ static OFCondition createAssociation(
         return cond;
     }
 
-    // Request association
-    cond = ASC_requestAssociation(net, params, &assoc);
+    // Request association. DUL leaves the TCP connect to the operating
+    // system unless a connection timeout is set, so an unreachable host
+    // would outlast the caller's timeout by a minute or more.
+    {
+        ConnectTimeoutScope connectTimeout(timeoutSeconds);
+        cond = ASC_requestAssociation(net, params, &assoc);
+    }
     if (cond.bad()) {
         ASC_destroyAssociationParameters(&params);
         ASC_dropNetwork(&net);
         return cond;
     }
 
-    // Check if presentation context was accepted
-    if (ASC_findAcceptedPresentationContextID(assoc, abstractSyntax) == 0) {
-        ASC_abortAssociation(assoc);
-        ASC_dropAssociation(assoc);
-        ASC_dropNetwork(&net);
-        return makeOFCondition(0, 0, OF_error, "Presentation context rejected");
+    // Check that the required presentation contexts were accepted
+    for (size_t i = 0; i < contextCount; i++) {
+        if (contexts[i].required &&
+            ASC_findAcceptedPresentationContextID(assoc, contexts[i].abstractSyntax) == 0) {
+            ASC_abortAssociation(assoc);
+            ASC_dropAssociation(assoc);
+            ASC_dropNetwork(&net);
+            return makeOFCondition(0, 0, OF_error, "Presentation context rejected");
+        }
     }
 
     return EC_Normal;
 }
 
 // --- Helper: Release association ---
-static void releaseAssociation(T_ASC_Association* assoc, T_ASC_Network* net) {
+void releaseAssociation(T_ASC_Association* assoc, T_ASC_Network* net) {
     if (assoc) {
         ASC_releaseAssociation(assoc);
         ASC_dropAssociation(assoc);
@@ -118,6 +223,63 @@ static void releaseAssociation(T_ASC_Association* assoc, T_ASC_Network* net) {
     }
 }
 
+// --- Helper: Build STUDY level C-FIND identifier ---
+void buildStudyFindRequest(const DB_DicomTags& criteria, DcmDataset& request) {
+    // Query/Retrieve Level
+    request.putAndInsertString(DCM_QueryRetrieveLevel, "STUDY");
+
+    // Search criteria (empty string = wildcard)
+    request.putAndInsertString(DCM_PatientID, criteria.patientID);
+    request.putAndInsertString(DCM_PatientName, criteria.patientName);
+    request.putAndInsertString(DCM_StudyDate, criteria.studyDate);
+    request.putAndInsertString(DCM_AccessionNumber, criteria.accessionNumber);
+    request.putAndInsertString(DCM_ModalitiesInStudy, criteria.studyModality);
+
+    // Return keys (what we want back)
+    request.putAndInsertString(DCM_StudyInstanceUID, "");
+    request.putAndInsertString(DCM_StudyDescription, "");
+    request.putAndInsertString(DCM_PatientBirthDate, "");
+}
+
+// --- Helper: Extract study level tags from a C-FIND response ---
+void extractStudyTags(DcmDataset* identifiers, DB_DicomTags& tags) {
+    memset(&tags, 0, sizeof(tags));
+
+    OFString str;
+
+    // Patient level
+    if (identifiers->findAndGetOFString(DCM_PatientID, str).good()) {
+        strncpy(tags.patientID, str.c_str(), sizeof(tags.patientID) - 1);
+    }
+    if (identifiers->findAndGetOFString(DCM_PatientName, str).good()) {
+        strncpy(tags.patientName, str.c_str(), sizeof(tags.patientName) - 1);
+    }
+    if (identifiers->findAndGetOFString(DCM_PatientBirthDate, str).good()) {
+        strncpy(tags.birthDate, str.c_str(), sizeof(tags.birthDate) - 1);
+    }
+
+    // Study level
+    if (identifiers->findAndGetOFString(DCM_StudyInstanceUID, str).good()) {
+        strncpy(tags.studyInstanceUID, str.c_str(), sizeof(tags.studyInstanceUID) - 1);
+    }
+    if (identifiers->findAndGetOFString(DCM_StudyDate, str).good()) {
+        strncpy(tags.studyDate, str.c_str(), sizeof(tags.studyDate) - 1);
+    }
+    if (identifiers->findAndGetOFString(DCM_StudyDescription, str).good()) {
+        strncpy(tags.studyDescription, str.c_str(), sizeof(tags.studyDescription) - 1);
+    }
+    if (identifiers->findAndGetOFString(DCM_AccessionNumber, str).good()) {
+        strncpy(tags.accessionNumber, str.c_str(), sizeof(tags.accessionNumber) - 1);
+    }
+    if (identifiers->findAndGetOFString(DCM_ModalitiesInStudy, str).good()) {
+        strncpy(tags.studyModality, str.c_str(), sizeof(tags.studyModality) - 1);
+    }
+}
+
+}  // namespace dicomcore
+
+using namespace dicomcore;
+
 // ========================================================================
 // C-ECHO: Test connectivity
 // ========================================================================
@@ -131,6 +293,7 @@ DB_NetworkResult db_echo(
         return makeResult(DB_STATUS_ERROR, "Invalid parameters");
     }
 
+    NetworkOperation operation(DB_NET_OP_ECHO, remoteNode);
     T_ASC_Network* net = nullptr;
     T_ASC_Association* assoc = nullptr;
 
@@ -141,7 +304,7 @@ DB_NetworkResult db_echo(
         net, assoc, timeoutSeconds);
 
     if (cond.bad()) {
-        return conditionToResult(cond, "Association");
+        return operation.finish(conditionToResult(cond, "Association"));
     }
 
     // Send C-ECHO
@@ -167,7 +330,7 @@ DB_NetworkResult db_echo(
     // Release association
     releaseAssociation(assoc, net);
 
-    return result;
+    return operation.finish(result);
 }
 
 // ========================================================================
@@ -199,37 +362,7 @@ static void findCallback(
 
     // Extract tags from response dataset
     DB_DicomTags tags;
-    memset(&tags, 0, sizeof(tags));
-
-    OFString str;
-
-    // Patient level
-    if (responseIdentifiers->findAndGetOFString(DCM_PatientID, str).good()) {
-        strncpy(tags.patientID, str.c_str(), sizeof(tags.patientID) - 1);
-    }
-    if (responseIdentifiers->findAndGetOFString(DCM_PatientName, str).good()) {
-        strncpy(tags.patientName, str.c_str(), sizeof(tags.patientName) - 1);
-    }
-    if (responseIdentifiers->findAndGetOFString(DCM_PatientBirthDate, str).good()) {
-        strncpy(tags.birthDate, str.c_str(), sizeof(tags.birthDate) - 1);
-    }
-
-    // Study level
-    if (responseIdentifiers->findAndGetOFString(DCM_StudyInstanceUID, str).good()) {
-        strncpy(tags.studyInstanceUID, str.c_str(), sizeof(tags.studyInstanceUID) - 1);
-    }
-    if (responseIdentifiers->findAndGetOFString(DCM_StudyDate, str).good()) {
-        strncpy(tags.studyDate, str.c_str(), sizeof(tags.studyDate) - 1);
-    }
-    if (responseIdentifiers->findAndGetOFString(DCM_StudyDescription, str).good()) {
-        strncpy(tags.studyDescription, str.c_str(), sizeof(tags.studyDescription) - 1);
-    }
-    if (responseIdentifiers->findAndGetOFString(DCM_AccessionNumber, str).good()) {
-        strncpy(tags.accessionNumber, str.c_str(), sizeof(tags.accessionNumber) - 1);
-    }
-    if (responseIdentifiers->findAndGetOFString(DCM_ModalitiesInStudy, str).good()) {
-        strncpy(tags.studyModality, str.c_str(), sizeof(tags.studyModality) - 1);
-    }
+    extractStudyTags(responseIdentifiers, tags);
 
     // Invoke user callback
     if (ctx->userCallback) {
@@ -249,6 +382,7 @@ DB_NetworkResult db_find_studies(
         return makeResult(DB_STATUS_ERROR, "Invalid parameters");
     }
 
+    NetworkOperation operation(DB_NET_OP_FIND, remoteNode);
     T_ASC_Network* net = nullptr;
     T_ASC_Association* assoc = nullptr;
 
@@ -259,50 +393,12 @@ DB_NetworkResult db_find_studies(
         net, assoc, timeoutSeconds);
 
     if (cond.bad()) {
-        return conditionToResult(cond, "Association");
+        return operation.finish(conditionToResult(cond, "Association"));
     }
 
     // Build C-FIND request dataset
     DcmDataset findRequest;
-
-    // Query/Retrieve Level
-    findRequest.putAndInsertString(DCM_QueryRetrieveLevel, "STUDY");
-
-    // Search criteria (empty string = wildcard)
-    if (searchCriteria->patientID[0]) {
-        findRequest.putAndInsertString(DCM_PatientID, searchCriteria->patientID);
-    } else {
-        findRequest.putAndInsertString(DCM_PatientID, "");
-    }
-
-    if (searchCriteria->patientName[0]) {
-        findRequest.putAndInsertString(DCM_PatientName, searchCriteria->patientName);
-    } else {
-        findRequest.putAndInsertString(DCM_PatientName, "");
-    }
-
-    if (searchCriteria->studyDate[0]) {
-        findRequest.putAndInsertString(DCM_StudyDate, searchCriteria->studyDate);
-    } else {
-        findRequest.putAndInsertString(DCM_StudyDate, "");
-    }
-
-    if (searchCriteria->accessionNumber[0]) {
-        findRequest.putAndInsertString(DCM_AccessionNumber, searchCriteria->accessionNumber);
-    } else {
-        findRequest.putAndInsertString(DCM_AccessionNumber, "");
-    }
-
-    if (searchCriteria->studyModality[0]) {
-        findRequest.putAndInsertString(DCM_ModalitiesInStudy, searchCriteria->studyModality);
-    } else {
-        findRequest.putAndInsertString(DCM_ModalitiesInStudy, "");
-    }
-
-    // Return keys (what we want back)
-    findRequest.putAndInsertString(DCM_StudyInstanceUID, "");
-    findRequest.putAndInsertString(DCM_StudyDescription, "");
-    findRequest.putAndInsertString(DCM_PatientBirthDate, "");
+    buildStudyFindRequest(*searchCriteria, findRequest);
 
     // Setup callback context
     FindContext ctx;
@@ -337,6 +433,8 @@ DB_NetworkResult db_find_studies(
         delete statusDetail;
     }
 
+    operation.addInstances(ctx.matchCount);
+
     DB_NetworkResult result;
     if (cond.bad()) {
         result = conditionToResult(cond, "C-FIND");
@@ -349,7 +447,7 @@ DB_NetworkResult db_find_studies(
     // Release association
     releaseAssociation(assoc, net);
 
-    return result;
+    return operation.finish(result);
 }
 
 // ========================================================================
@@ -397,6 +495,7 @@ DB_NetworkResult db_move_study(
         return makeResult(DB_STATUS_ERROR, "Invalid parameters");
     }
 
+    NetworkOperation operation(DB_NET_OP_MOVE, remoteNode);
     T_ASC_Network* net = nullptr;
     T_ASC_Association* assoc = nullptr;
 
@@ -407,7 +506,7 @@ DB_NetworkResult db_move_study(
         net, assoc, timeoutSeconds);
 
     if (cond.bad()) {
-        return conditionToResult(cond, "Association");
+        return operation.finish(conditionToResult(cond, "Association"));
     }
 
     // Build C-MOVE request dataset
@@ -451,6 +550,8 @@ DB_NetworkResult db_move_study(
         delete statusDetail;
     }
 
+    operation.addInstances(ctx.completed);
+
     DB_NetworkResult result;
     if (cond.bad()) {
         result = conditionToResult(cond, "C-MOVE");
@@ -465,7 +566,7 @@ DB_NetworkResult db_move_study(
     // Release association
     releaseAssociation(assoc, net);
 
-    return result;
+    return operation.finish(result);
 }
 
 // ========================================================================
@@ -485,82 +586,51 @@ DB_NetworkResult db_store_study(
         return makeResult(DB_STATUS_ERROR, "Invalid parameters");
     }
 
+    NetworkOperation operation(DB_NET_OP_STORE, remoteNode);
     T_ASC_Network* net = nullptr;
     T_ASC_Association* assoc = nullptr;
 
-    // Note: For C-STORE we need to add multiple presentation contexts
-    // (one for each SOP class we might send). This is a simplified version
-    // that assumes all files are of compatible transfer syntaxes.
-
-    OFCondition cond = createAssociation(
-        localAE, remoteNode,
-        UID_SecondaryCaptureImageStorage,  // Generic storage SOP class
-        net, assoc, timeoutSeconds);
-
-    if (cond.bad()) {
-        return conditionToResult(cond, "Association");
-    }
-
     int completed = 0;
     int failed = 0;
 
-    // Send each file
+    // Identify the files first so the association proposes the SOP classes
+    // and compressed transfer syntaxes they need
+    std::vector<StoreItem> items;
+    StoreContexts contexts;
     for (int i = 0; i < fileCount; i++) {
-        DcmFileFormat fileFormat;
-        cond = fileFormat.loadFile(filePaths[i]);
-
-        if (cond.bad()) {
-            failed++;
-            continue;
-        }
-
-        DcmDataset* dataset = fileFormat.getDataset();
-
-        // Get SOP Class UID and SOP Instance UID
-        OFString sopClassUID;
-        OFString sopInstanceUID;
-
-        if (!dataset->findAndGetOFString(DCM_SOPClassUID, sopClassUID).good() ||
-            !dataset->findAndGetOFString(DCM_SOPInstanceUID, sopInstanceUID).good()) {
+        StoreItem item;
+        if (!filePaths[i] || !readStoreItem(filePaths[i], item) || !contexts.add(item)) {
             failed++;
             continue;
         }
+        items.push_back(item);
+    }
 
-        // Find presentation context for this SOP class
-        T_ASC_PresentationContextID presID =
-            ASC_findAcceptedPresentationContextID(assoc, sopClassUID.c_str());
+    if (!items.empty()) {
+        std::vector<PresentationContextSpec> specs = contexts.specs();
+        OFCondition cond = createAssociation(
+            localAE, remoteNode, specs.data(), specs.size(),
+            net, assoc, timeoutSeconds);
 
-        if (presID == 0) {
-            failed++;
-            continue;
-        }
-
-        // Send C-STORE
-        T_DIMSE_C_StoreRQ request;
-        memset(&request, 0, sizeof(request));
-        request.MessageID = assoc->nextMsgID++;
-        strcpy(request.AffectedSOPClassUID, sopClassUID.c_str());
-        strcpy(request.AffectedSOPInstanceUID, sopInstanceUID.c_str());
-        request.Priority = DIMSE_PRIORITY_LOW;
-        request.DataSetType = DIMSE_DATASET_PRESENT;
-
-        T_DIMSE_C_StoreRSP response;
-        DcmDataset* statusDetail = nullptr;
-
-        cond = DIMSE_storeUser(
-            assoc, presID, &request, nullptr,
-            dataset, nullptr, nullptr,
-            DIMSE_BLOCKING, timeoutSeconds,
-            &response, &statusDetail, nullptr);
-
-        if (statusDetail) {
-            delete statusDetail;
+        if (cond.bad()) {
+            return operation.finish(conditionToResult(cond, "Association"));
         }
+    }
 
-        if (cond.good() && response.DimseStatus == STATUS_Success) {
+    // Send each file
+    bool connectionLost = false;
+    for (const StoreItem& item : items) {
+        std::string error;
+        int dimseStatus = 0;
+        StoreOutcome outcome = connectionLost
+            ? StoreOutcome::ConnectionLost
+            : storeInstance(assoc, item, timeoutSeconds, error, dimseStatus);
+
+        if (outcome == StoreOutcome::Stored) {
             completed++;
         } else {
             failed++;
+            connectionLost = outcome == StoreOutcome::ConnectionLost;
         }
 
         // Progress callback
@@ -576,9 +646,16 @@ DB_NetworkResult db_store_study(
              "C-STORE completed: %d succeeded, %d failed",
              completed, failed);
     result = makeResult(DB_STATUS_OK, msg);
+    operation.addInstances(completed);
 
     // Release association
-    releaseAssociation(assoc, net);
+    if (connectionLost) {
+        ASC_abortAssociation(assoc);
+        ASC_dropAssociation(assoc);
+        ASC_dropNetwork(&net);
+    } else {
+        releaseAssociation(assoc, net);
+    }
 
-    return result;
+    return operation.finish(result);
 }
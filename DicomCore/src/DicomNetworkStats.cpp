@@ -0,0 +1,365 @@
+//
+//  DicomNetworkStats.cpp
+//  DicomCore
+//
+//  Per-operation network instrumentation. A counting transport layer sits
+//  between DCMTK's upper layer and the TCP (or TLS) connection, so every byte and
+//  PDU of an association is seen without touching the DIMSE code paths.
+//
+
+#include "DicomBridge.h"
+#include "DicomNetworkStats.hpp"
+#include "DicomTransport.hpp"
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/dcmnet/assoc.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+
+using Clock = std::chrono::steady_clock;
+
+namespace dicomcore {
+
+// ========================================================================
+// Transport counters
+// ========================================================================
+
+// PDU types (PS3.8 9.3)
+static const uint8_t kPduAssociateAC = 0x02;
+static const uint8_t kPduAssociateRJ = 0x03;
+static const uint8_t kPduDataTF = 0x04;
+
+/// Byte stream of one direction, split into PDUs by their 6-byte headers.
+struct PduStream {
+    uint64_t bytes = 0;
+    uint32_t pdus = 0;
+    uint8_t header[6] = {};
+    size_t headerFill = 0;
+    uint64_t bodyRemaining = 0;
+
+    /// Account for data and return the type of the last PDU whose header
+    /// completed in it, or 0.
+    uint8_t feed(const uint8_t* data, size_t length) {
+        bytes += length;
+        uint8_t lastType = 0;
+        while (length > 0) {
+            if (bodyRemaining > 0) {
+                size_t skip = (size_t)std::min<uint64_t>(bodyRemaining, length);
+                bodyRemaining -= skip;
+                data += skip;
+                length -= skip;
+                continue;
+            }
+            header[headerFill++] = *data++;
+            length--;
+            if (headerFill == sizeof(header)) {
+                pdus++;
+                lastType = header[0];
+                bodyRemaining = ((uint64_t)header[2] << 24) | ((uint64_t)header[3] << 16) |
+                                ((uint64_t)header[4] << 8) | (uint64_t)header[5];
+                headerFill = 0;
+            }
+        }
+        return lastType;
+    }
+};
+
+struct TransportCounters {
+    Clock::time_point connectStarted;
+    Clock::time_point connected;
+    Clock::time_point negotiated;
+    Clock::time_point firstResponse;
+    bool hasConnected = false;
+    bool hasNegotiated = false;
+    bool hasFirstResponse = false;
+    PduStream sent;
+    PduStream received;
+
+    void onReceived(const void* data, size_t length) {
+        uint8_t type = received.feed(static_cast<const uint8_t*>(data), length);
+        if (!hasNegotiated && (type == kPduAssociateAC || type == kPduAssociateRJ)) {
+            negotiated = Clock::now();
+            hasNegotiated = true;
+        } else if (hasNegotiated && !hasFirstResponse && type == kPduDataTF) {
+            firstResponse = Clock::now();
+            hasFirstResponse = true;
+        }
+    }
+};
+
+namespace {
+
+/// Counts what goes through the real connection.
+class CountingConnection : public ForwardingConnection {
+public:
+    CountingConnection(DcmTransportConnection* inner, std::shared_ptr<TransportCounters> counters)
+        : ForwardingConnection(inner),
+          counters(std::move(counters)) {}
+
+    ssize_t read(void* buf, size_t nbyte) override {
+        ssize_t count = ForwardingConnection::read(buf, nbyte);
+        if (count > 0) counters->onReceived(buf, (size_t)count);
+        return count;
+    }
+
+    ssize_t write(void* buf, size_t nbyte) override {
+        ssize_t count = ForwardingConnection::write(buf, nbyte);
+        if (count > 0) counters->sent.feed(static_cast<const uint8_t*>(buf), (size_t)count);
+        return count;
+    }
+
+private:
+    std::shared_ptr<TransportCounters> counters;
+};
+
+/// Wraps the connections of the layer below in a CountingConnection.
+class CountingTransportLayer : public StackedTransportLayer {
+public:
+    CountingTransportLayer(std::shared_ptr<TransportCounters> counters, DcmTransportLayer* inner)
+        : StackedTransportLayer(inner),
+          counters(std::move(counters)) {}
+
+protected:
+    DcmTransportConnection* wrap(DcmTransportConnection* connection) override {
+        // Called once the TCP connection is up, before any TLS handshake
+        // and A-ASSOCIATE-RQ
+        if (!counters->hasConnected) {
+            counters->connected = Clock::now();
+            counters->hasConnected = true;
+        }
+        return new CountingConnection(connection, counters);
+    }
+
+private:
+    std::shared_ptr<TransportCounters> counters;
+};
+
+// ========================================================================
+// Stats registry
+// ========================================================================
+
+const size_t kRecentCapacity = 256;
+
+struct StatsRegistry {
+    std::mutex mutex;
+    std::deque<DB_NetworkStats> recent;     // Newest first
+    FILE* log = nullptr;
+};
+
+StatsRegistry& registry() {
+    static StatsRegistry instance;
+    return instance;
+}
+
+thread_local NetworkOperation* currentOperation = nullptr;
+thread_local DB_NetworkStats lastStats;
+thread_local bool hasLastStats = false;
+
+const char* operationName(DB_NetworkOperation operation) {
+    switch (operation) {
+        case DB_NET_OP_ECHO:  return "C-ECHO";
+        case DB_NET_OP_FIND:  return "C-FIND";
+        case DB_NET_OP_MOVE:  return "C-MOVE";
+        case DB_NET_OP_GET:   return "C-GET";
+        case DB_NET_OP_STORE: return "C-STORE";
+    }
+    return "UNKNOWN";
+}
+
+double secondsBetween(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double>(to - from).count();
+}
+
+// --- Helper: Append a JSON string literal ---
+void appendJSONString(std::string& out, const char* value) {
+    out += '"';
+    for (const char* p = value; *p; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += (char)c;
+        } else if (c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += (char)c;
+        }
+    }
+    out += '"';
+}
+
+// --- Helper: One JSON line per operation ---
+std::string formatLogLine(const DB_NetworkStats& stats) {
+    std::string line = "{\"time\":";
+    char number[64];
+    snprintf(number, sizeof(number), "%.3f", stats.startTime);
+    line += number;
+    line += ",\"operation\":";
+    appendJSONString(line, operationName(stats.operation));
+    line += ",\"ae\":";
+    appendJSONString(line, stats.remoteAE);
+    line += ",\"host\":";
+    appendJSONString(line, stats.hostname);
+
+    char fields[512];
+    snprintf(fields, sizeof(fields),
+             ",\"port\":%d,\"status\":%d,\"dimseStatus\":%d"
+             ",\"connectMs\":%.1f,\"negotiateMs\":%.1f,\"firstResponseMs\":%.1f"
+             ",\"totalMs\":%.1f,\"bytesSent\":%llu,\"bytesReceived\":%llu"
+             ",\"pdusSent\":%u,\"pdusReceived\":%u,\"instances\":%d"
+             ",\"instancesPerSecond\":%.2f}\n",
+             stats.port, (int)stats.status, stats.dimseStatus,
+             stats.connectSeconds < 0 ? -1.0 : stats.connectSeconds * 1000.0,
+             stats.negotiateSeconds < 0 ? -1.0 : stats.negotiateSeconds * 1000.0,
+             stats.firstResponseSeconds < 0 ? -1.0 : stats.firstResponseSeconds * 1000.0,
+             stats.totalSeconds * 1000.0,
+             (unsigned long long)stats.bytesSent, (unsigned long long)stats.bytesReceived,
+             stats.pdusSent, stats.pdusReceived, stats.instances,
+             stats.instancesPerSecond);
+    line += fields;
+    return line;
+}
+
+void publish(const DB_NetworkStats& stats) {
+    lastStats = stats;
+    hasLastStats = true;
+
+    StatsRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.recent.push_front(stats);
+    if (reg.recent.size() > kRecentCapacity) {
+        reg.recent.pop_back();
+    }
+    if (reg.log) {
+        std::string line = formatLogLine(stats);
+        fwrite(line.data(), 1, line.size(), reg.log);
+        fflush(reg.log);
+    }
+}
+
+}  // namespace
+
+// ========================================================================
+// NetworkOperation
+// ========================================================================
+
+NetworkOperation::NetworkOperation(DB_NetworkOperation operation, const DB_DicomNode* remoteNode)
+    : started(Clock::now()),
+      previous(currentOperation),
+      finished(false)
+{
+    memset(&stats, 0, sizeof(stats));
+    stats.operation = operation;
+    if (remoteNode) {
+        strncpy(stats.remoteAE, remoteNode->aeTitle, sizeof(stats.remoteAE) - 1);
+        strncpy(stats.hostname, remoteNode->hostname, sizeof(stats.hostname) - 1);
+        stats.port = remoteNode->port;
+    }
+    stats.startTime = std::chrono::duration<double>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    currentOperation = this;
+}
+
+NetworkOperation::~NetworkOperation() {
+    currentOperation = previous;
+}
+
+NetworkOperation* NetworkOperation::current() {
+    return currentOperation;
+}
+
+DcmTransportLayer* NetworkOperation::instrument(DcmTransportLayer* inner) {
+    if (!counters) {
+        counters = std::make_shared<TransportCounters>();
+        counters->connectStarted = Clock::now();
+    }
+    return new CountingTransportLayer(counters, inner);
+}
+
+DB_NetworkResult NetworkOperation::finish(const DB_NetworkResult& result) {
+    if (finished) return result;
+    finished = true;
+
+    Clock::time_point now = Clock::now();
+    stats.status = result.status;
+    stats.dimseStatus = result.dimseStatus;
+    stats.totalSeconds = secondsBetween(started, now);
+    stats.connectSeconds = -1.0;
+    stats.negotiateSeconds = -1.0;
+    stats.firstResponseSeconds = -1.0;
+
+    if (counters) {
+        const TransportCounters& c = *counters;
+        if (c.hasConnected) {
+            stats.connectSeconds = secondsBetween(c.connectStarted, c.connected);
+            if (c.hasNegotiated) {
+                stats.negotiateSeconds = secondsBetween(c.connected, c.negotiated);
+            }
+        }
+        if (c.hasFirstResponse) {
+            stats.firstResponseSeconds = secondsBetween(c.negotiated, c.firstResponse);
+        }
+        stats.bytesSent = c.sent.bytes;
+        stats.bytesReceived = c.received.bytes;
+        stats.pdusSent = c.sent.pdus;
+        stats.pdusReceived = c.received.pdus;
+    }
+
+    stats.instancesPerSecond = stats.totalSeconds > 0.0
+        ? stats.instances / stats.totalSeconds : 0.0;
+
+    publish(stats);
+    return result;
+}
+
+}  // namespace dicomcore
+
+using namespace dicomcore;
+
+// ========================================================================
+// Stats API
+// ========================================================================
+
+DB_Status db_network_stats_last(DB_NetworkStats* outStats) {
+    if (!outStats) return DB_STATUS_ERROR;
+    if (!hasLastStats) return DB_STATUS_NOT_FOUND;
+    *outStats = lastStats;
+    return DB_STATUS_OK;
+}
+
+int db_network_stats_recent(DB_NetworkStats* outStats, int maxCount) {
+    if (!outStats || maxCount <= 0) return 0;
+
+    StatsRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    int count = std::min(maxCount, (int)reg.recent.size());
+    std::copy(reg.recent.begin(), reg.recent.begin() + count, outStats);
+    return count;
+}
+
+void db_network_stats_clear(void) {
+    StatsRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.recent.clear();
+}
+
+DB_Status db_network_stats_set_log(const char* path) {
+    FILE* file = nullptr;
+    if (path && path[0]) {
+        file = fopen(path, "a");
+        if (!file) return DB_STATUS_ERROR;
+    }
+
+    StatsRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    if (reg.log) {
+        fclose(reg.log);
+    }
+    reg.log = file;
+    return DB_STATUS_OK;
+}
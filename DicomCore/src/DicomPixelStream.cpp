@@ -0,0 +1,224 @@
+//
+//  DicomPixelStream.cpp
+//  DicomCore
+//
+//  Walks the element headers of a file to find the encoded PixelData and
+//  copies those bytes verbatim, so compressed pixel data is never decoded.
+//
+
+#include "DicomPixelStream.hpp"
+#include <cstring>
+#include <sys/types.h>
+#include <vector>
+
+namespace dicomcore {
+
+namespace {
+
+const uint32_t kUndefinedLength = 0xFFFFFFFF;
+const uint32_t kPixelDataTag = 0x7FE00010;
+const uint32_t kItemTag = 0xFFFEE000;
+const uint32_t kItemDelimitationTag = 0xFFFEE00D;
+const uint32_t kSequenceDelimitationTag = 0xFFFEE0DD;
+const int kMaxNestingDepth = 64;
+const size_t kCopyChunkSize = 1 << 20;
+
+// Explicit VRs encoded with two reserved bytes and a 32-bit length
+bool hasLongLength(const char vr[2]) {
+    static const char* const longVRs[] = {
+        "OB", "OD", "OF", "OL", "OV", "OW", "SQ", "SV", "UC", "UN", "UR", "UT", "UV"
+    };
+    for (const char* longVR : longVRs) {
+        if (vr[0] == longVR[0] && vr[1] == longVR[1]) return true;
+    }
+    return false;
+}
+
+class ElementReader {
+public:
+    ElementReader(FILE* file, bool bigEndian) : file(file), bigEndian(bigEndian) {}
+
+    bool readUint16(uint16_t& value) {
+        unsigned char bytes[2];
+        if (fread(bytes, 1, 2, file) != 2) return false;
+        value = bigEndian ? (uint16_t)(bytes[0] << 8 | bytes[1])
+                          : (uint16_t)(bytes[1] << 8 | bytes[0]);
+        return true;
+    }
+
+    bool readUint32(uint32_t& value) {
+        uint16_t first;
+        uint16_t second;
+        if (!readUint16(first) || !readUint16(second)) return false;
+        value = bigEndian ? ((uint32_t)first << 16 | second) : ((uint32_t)second << 16 | first);
+        return true;
+    }
+
+    bool readTag(uint32_t& tag) {
+        uint16_t group;
+        uint16_t element;
+        if (!readUint16(group) || !readUint16(element)) return false;
+        tag = (uint32_t)group << 16 | element;
+        return true;
+    }
+
+    /// Rest of an element header after its tag. implicitContent is set for
+    /// UN of undefined length, whose items are implicit VR little endian.
+    bool readLength(bool explicitVR, uint32_t& length, bool& implicitContent) {
+        implicitContent = false;
+        if (!explicitVR) return readUint32(length);
+
+        char vr[2];
+        if (fread(vr, 1, 2, file) != 2) return false;
+        if (hasLongLength(vr)) {
+            uint16_t reserved;
+            if (!readUint16(reserved) || !readUint32(length)) return false;
+            implicitContent = length == kUndefinedLength && vr[0] == 'U' && vr[1] == 'N';
+            return true;
+        }
+        uint16_t shortLength;
+        if (!readUint16(shortLength)) return false;
+        length = shortLength;
+        return true;
+    }
+
+    bool skip(uint32_t bytes) {
+        return fseeko(file, (off_t)bytes, SEEK_CUR) == 0;
+    }
+
+    uint64_t position() {
+        return (uint64_t)ftello(file);
+    }
+
+    bool skipValue(bool explicitVR, uint32_t length, bool implicitContent, int depth) {
+        if (length != kUndefinedLength) return skip(length);
+        return skipSequence(explicitVR && !implicitContent, depth + 1);
+    }
+
+    /// Items up to and including the sequence delimiter. Item headers are
+    /// a tag and 32-bit length in every encoding.
+    bool skipSequence(bool explicitVR, int depth) {
+        if (depth > kMaxNestingDepth) return false;
+        for (;;) {
+            uint32_t tag;
+            uint32_t length;
+            if (!readTag(tag) || !readUint32(length)) return false;
+            if (tag == kSequenceDelimitationTag) return true;
+            if (tag != kItemTag) return false;
+            if (length == kUndefinedLength) {
+                if (!skipItem(explicitVR, depth)) return false;
+            } else if (!skip(length)) {
+                return false;
+            }
+        }
+    }
+
+    /// Elements of an undefined-length item up to its delimiter.
+    bool skipItem(bool explicitVR, int depth) {
+        for (;;) {
+            uint32_t tag;
+            if (!readTag(tag)) return false;
+            if (tag == kItemDelimitationTag) {
+                uint32_t length;
+                return readUint32(length);
+            }
+            uint32_t length;
+            bool implicitContent;
+            if (!readLength(explicitVR, length, implicitContent) ||
+                !skipValue(explicitVR, length, implicitContent, depth)) {
+                return false;
+            }
+        }
+    }
+
+    FILE* file;
+    bool bigEndian;
+};
+
+// --- Helper: Position file at the start of the dataset ---
+bool skipMetaHeader(FILE* file) {
+    char preamble[132];
+    if (fread(preamble, 1, sizeof(preamble), file) != sizeof(preamble) ||
+        memcmp(preamble + 128, "DICM", 4) != 0) {
+        // No preamble: a bare dataset
+        return fseeko(file, 0, SEEK_SET) == 0;
+    }
+
+    // Meta elements are always explicit VR little endian, group 0002
+    ElementReader reader(file, false);
+    for (;;) {
+        off_t start = ftello(file);
+        uint32_t tag;
+        if (!reader.readTag(tag)) return false;
+        if ((tag >> 16) != 0x0002) {
+            return fseeko(file, start, SEEK_SET) == 0;
+        }
+        uint32_t length;
+        bool implicitContent;
+        if (!reader.readLength(true, length, implicitContent) ||
+            length == kUndefinedLength || !reader.skip(length)) {
+            return false;
+        }
+    }
+}
+
+}  // namespace
+
+bool findPixelDataRange(const char* path, E_TransferSyntax xfer, ElementRange& range) {
+    if (xfer == EXS_DeflatedLittleEndianExplicit || xfer == EXS_Unknown) {
+        return false;
+    }
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+
+    DcmXfer xferInfo(xfer);
+    bool explicitVR = xferInfo.isExplicitVR();
+    ElementReader reader(file, xferInfo.getByteOrder() == EBO_BigEndian);
+
+    bool found = false;
+    if (fseeko(file, 0, SEEK_END) == 0) {
+        uint64_t fileSize = reader.position();
+        fseeko(file, 0, SEEK_SET);
+
+        if (skipMetaHeader(file)) {
+            for (;;) {
+                uint64_t offset = reader.position();
+                uint32_t tag;
+                uint32_t length;
+                bool implicitContent;
+                if (!reader.readTag(tag) || tag > kPixelDataTag ||
+                    !reader.readLength(explicitVR, length, implicitContent) ||
+                    !reader.skipValue(explicitVR, length, implicitContent, 0)) {
+                    break;
+                }
+                if (tag == kPixelDataTag) {
+                    range.offset = offset;
+                    range.length = reader.position() - offset;
+                    found = offset + range.length <= fileSize;
+                    break;
+                }
+            }
+        }
+    }
+
+    fclose(file);
+    return found;
+}
+
+bool copyRange(FILE* source, const ElementRange& range, FILE* destination) {
+    if (fseeko(source, (off_t)range.offset, SEEK_SET) != 0) return false;
+
+    std::vector<char> buffer(kCopyChunkSize);
+    uint64_t remaining = range.length;
+    while (remaining > 0) {
+        size_t chunk = remaining < buffer.size() ? (size_t)remaining : buffer.size();
+        if (fread(buffer.data(), 1, chunk, source) != chunk ||
+            fwrite(buffer.data(), 1, chunk, destination) != chunk) {
+            return false;
+        }
+        remaining -= chunk;
+    }
+    return true;
+}
+
+}  // namespace dicomcore
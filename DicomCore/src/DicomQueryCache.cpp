@@ -0,0 +1,318 @@
+//
+//  DicomQueryCache.cpp
+//  DicomCore
+//
+//  C-FIND result cache keyed by node and normalized criteria.
+//  Entries expire after a TTL and can be refreshed over a trailing
+//  StudyDate window instead of re-running the full query.
+//
+
+#include "DicomBridge.h"
+#include "DicomNetworkUtils.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace dicomcore;
+using Clock = std::chrono::steady_clock;
+
+struct DB_QueryCache {
+    struct Entry {
+        std::string key;
+        std::vector<DB_DicomTags> results;
+        Clock::time_point fetchedAt;
+    };
+
+    std::mutex mutex;
+    std::list<Entry> lru;   // Most recently used at the front
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    int maxEntries;
+    int maxTotalResults;
+    int ttlSeconds;
+    size_t totalResults = 0;
+    DB_QueryCacheStats stats;
+};
+
+namespace {
+
+// Trim surrounding spaces; a lone "*" is the same as universal matching.
+std::string normalizeValue(const char* value, bool upperCase) {
+    std::string s(value);
+    size_t first = s.find_first_not_of(" \t");
+    if (first == std::string::npos) return "";
+    size_t last = s.find_last_not_of(" \t");
+    s = s.substr(first, last - first + 1);
+    if (s == "*") return "";
+    if (upperCase) {
+        std::transform(s.begin(), s.end(), s.begin(),
+                       [](unsigned char c) { return (char)std::toupper(c); });
+    }
+    return s;
+}
+
+std::string makeKey(const DB_DicomNode& node, const DB_DicomTags& criteria) {
+    std::string key;
+    key.reserve(256);
+    key += normalizeValue(node.aeTitle, false);
+    key += '@';
+    key += normalizeValue(node.hostname, true);
+    key += ':';
+    key += std::to_string(node.port);
+    key += "|STUDY|";
+    key += normalizeValue(criteria.patientID, false);
+    key += '|';
+    key += normalizeValue(criteria.patientName, false);
+    key += '|';
+    key += normalizeValue(criteria.studyDate, false);
+    key += '|';
+    key += normalizeValue(criteria.accessionNumber, false);
+    key += '|';
+    key += normalizeValue(criteria.studyModality, true);
+    return key;
+}
+
+// Local calendar date `daysAgo` days before today, as YYYYMMDD.
+std::string dateDaysAgo(int daysAgo) {
+    time_t now = time(nullptr);
+    struct tm local;
+    localtime_r(&now, &local);
+    local.tm_mday -= daysAgo;
+    local.tm_hour = 12;     // Stay clear of DST transitions
+    mktime(&local);
+
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%04d%02d%02d",
+             local.tm_year + 1900, local.tm_mon + 1, local.tm_mday);
+    return buf;
+}
+
+// Narrow a DA range criterion ("", "A", "A-", "-B", "A-B") to dates on or
+// after windowStart. Returns false if the criterion excludes the window.
+bool narrowDateRange(const std::string& criterion, const std::string& windowStart,
+                     std::string& narrowed) {
+    std::string from, to;
+    size_t dash = criterion.find('-');
+    if (criterion.empty()) {
+        // Universal match
+    } else if (dash == std::string::npos) {
+        from = to = criterion;
+    } else {
+        from = criterion.substr(0, dash);
+        to = criterion.substr(dash + 1);
+    }
+
+    // YYYYMMDD strings compare chronologically
+    if (from.empty() || from < windowStart) from = windowStart;
+    if (!to.empty() && to < from) return false;
+
+    narrowed = from + "-" + to;
+    return true;
+}
+
+struct CollectContext {
+    std::vector<DB_DicomTags>* results;
+};
+
+void collectResult(void* userData, const DB_DicomTags* tags) {
+    auto* ctx = static_cast<CollectContext*>(userData);
+    ctx->results->push_back(*tags);
+}
+
+void deliverResults(const std::vector<DB_DicomTags>& results,
+                    DB_QueryCallback onResult, void* userData) {
+    if (!onResult) return;
+    for (const auto& tags : results) {
+        onResult(userData, &tags);
+    }
+}
+
+// Caller must hold cache->mutex
+void evictToBounds(DB_QueryCache* cache) {
+    while (!cache->lru.empty() &&
+           ((int)cache->lru.size() > cache->maxEntries ||
+            (cache->maxTotalResults > 0 && (int)cache->totalResults > cache->maxTotalResults))) {
+        DB_QueryCache::Entry& victim = cache->lru.back();
+        cache->totalResults -= victim.results.size();
+        cache->index.erase(victim.key);
+        cache->lru.pop_back();
+        cache->stats.evictions++;
+    }
+}
+
+// Caller must hold cache->mutex
+void storeEntry(DB_QueryCache* cache, const std::string& key,
+                std::vector<DB_DicomTags> results) {
+    auto found = cache->index.find(key);
+    if (found != cache->index.end()) {
+        cache->totalResults -= found->second->results.size();
+        cache->lru.erase(found->second);
+        cache->index.erase(found);
+    }
+
+    // A single result set larger than the whole budget is not cached
+    if (cache->maxTotalResults > 0 && (int)results.size() > cache->maxTotalResults) {
+        return;
+    }
+
+    cache->totalResults += results.size();
+    cache->lru.push_front(DB_QueryCache::Entry{key, std::move(results), Clock::now()});
+    cache->index[key] = cache->lru.begin();
+    evictToBounds(cache);
+}
+
+}  // namespace
+
+// ========================================================================
+// Cache lifecycle
+// ========================================================================
+
+DB_QueryCache* db_query_cache_create(int maxEntries, int maxTotalResults, int ttlSeconds) {
+    if (maxEntries <= 0 || ttlSeconds < 0) return nullptr;
+
+    auto* cache = new DB_QueryCache();
+    cache->maxEntries = maxEntries;
+    cache->maxTotalResults = maxTotalResults;
+    cache->ttlSeconds = ttlSeconds;
+    memset(&cache->stats, 0, sizeof(cache->stats));
+    return cache;
+}
+
+void db_query_cache_destroy(DB_QueryCache* cache) {
+    delete cache;
+}
+
+void db_query_cache_clear(DB_QueryCache* cache) {
+    if (!cache) return;
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    cache->lru.clear();
+    cache->index.clear();
+    cache->totalResults = 0;
+}
+
+void db_query_cache_get_stats(DB_QueryCache* cache, DB_QueryCacheStats* outStats) {
+    if (!cache || !outStats) return;
+    std::lock_guard<std::mutex> lock(cache->mutex);
+    *outStats = cache->stats;
+    outStats->entryCount = (int)cache->lru.size();
+    outStats->resultCount = (int)cache->totalResults;
+}
+
+// ========================================================================
+// Cached C-FIND
+// ========================================================================
+
+DB_NetworkResult db_find_studies_cached(
+    DB_QueryCache* cache,
+    const char* localAE,
+    const DB_DicomNode* remoteNode,
+    const DB_DicomTags* searchCriteria,
+    int refreshTrailingDays,
+    DB_QueryCallback onResult,
+    void* userData,
+    int timeoutSeconds)
+{
+    if (!cache || !localAE || !remoteNode || !searchCriteria) {
+        return makeResult(DB_STATUS_ERROR, "Invalid parameters");
+    }
+
+    const std::string key = makeKey(*remoteNode, *searchCriteria);
+
+    // Look up, copying the results so callbacks run without the lock
+    std::vector<DB_DicomTags> cached;
+    bool found = false;
+    bool fresh = false;
+    {
+        std::lock_guard<std::mutex> lock(cache->mutex);
+        auto it = cache->index.find(key);
+        if (it != cache->index.end()) {
+            found = true;
+            cache->lru.splice(cache->lru.begin(), cache->lru, it->second);
+            const DB_QueryCache::Entry& entry = *it->second;
+            fresh = Clock::now() - entry.fetchedAt < std::chrono::seconds(cache->ttlSeconds);
+            cached = entry.results;
+            if (fresh) cache->stats.hits++;
+        }
+    }
+
+    char msg[128];
+    if (fresh) {
+        deliverResults(cached, onResult, userData);
+        snprintf(msg, sizeof(msg), "C-FIND served from cache, %d matches", (int)cached.size());
+        return makeResult(DB_STATUS_OK, msg);
+    }
+
+    // Stale entry: re-query only the trailing date window when allowed.
+    // An undated study counts as inside every window, and a date range
+    // query cannot return it, so its presence forces a full query.
+    std::string windowStart;
+    DB_DicomTags criteria = *searchCriteria;
+    bool partial = false;
+    bool undated = std::any_of(cached.begin(), cached.end(),
+                               [](const DB_DicomTags& tags) { return tags.studyDate[0] == '\0'; });
+    if (found && refreshTrailingDays > 0 && !undated) {
+        windowStart = dateDaysAgo(refreshTrailingDays);
+        std::string narrowed;
+        if (!narrowDateRange(normalizeValue(searchCriteria->studyDate, false),
+                             windowStart, narrowed)) {
+            // The criteria end before the window; nothing can have changed
+            {
+                std::lock_guard<std::mutex> lock(cache->mutex);
+                auto it = cache->index.find(key);
+                if (it != cache->index.end()) it->second->fetchedAt = Clock::now();
+                cache->stats.partialRefreshes++;
+            }
+            deliverResults(cached, onResult, userData);
+            snprintf(msg, sizeof(msg), "C-FIND served from cache, %d matches", (int)cached.size());
+            return makeResult(DB_STATUS_OK, msg);
+        }
+        strncpy(criteria.studyDate, narrowed.c_str(), sizeof(criteria.studyDate) - 1);
+        criteria.studyDate[sizeof(criteria.studyDate) - 1] = '\0';
+        partial = true;
+    }
+
+    std::vector<DB_DicomTags> fetched;
+    CollectContext ctx{&fetched};
+    DB_NetworkResult result = db_find_studies(localAE, remoteNode, &criteria,
+                                              collectResult, &ctx, timeoutSeconds);
+    if (result.status != DB_STATUS_OK) {
+        return result;
+    }
+
+    std::vector<DB_DicomTags> merged;
+    if (partial) {
+        // Keep older studies; the window's studies come from the fresh query
+        merged.reserve(cached.size() + fetched.size());
+        for (const auto& tags : cached) {
+            if (std::string(tags.studyDate) < windowStart) {
+                merged.push_back(tags);
+            }
+        }
+        merged.insert(merged.end(), fetched.begin(), fetched.end());
+    } else {
+        merged = std::move(fetched);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(cache->mutex);
+        if (partial) {
+            cache->stats.partialRefreshes++;
+        } else {
+            cache->stats.misses++;
+        }
+        storeEntry(cache, key, merged);
+    }
+
+    deliverResults(merged, onResult, userData);
+
+    snprintf(msg, sizeof(msg), "C-FIND %s, %d matches",
+             partial ? "refreshed trailing window" : "completed", (int)merged.size());
+    return makeResult(DB_STATUS_OK, msg, result.dimseStatus);
+}
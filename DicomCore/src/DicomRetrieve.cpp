@@ -0,0 +1,443 @@
+//
+//  DicomRetrieve.cpp
+//  DicomCore
+//
+//  Series/instance level C-FIND and C-GET/C-MOVE primitives.
+//  C-GET sub-operations are received on the same association and
+//  written straight to disk without decoding the dataset.
+//
+
+#include "DicomRetrieve.hpp"
+#include "DicomNetworkUtils.hpp"
+#include "dcmtk/dcmnet/dimse.h"
+#include "dcmtk/dcmnet/diutil.h"
+#include "dcmtk/dcmdata/dcdeftag.h"
+#include "dcmtk/dcmdata/dcuid.h"
+#include "dcmtk/ofstd/ofstd.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace dicomcore {
+
+// --- Helper: Run a C-FIND on an open association ---
+
+struct CollectFindContext {
+    std::function<void(DcmDataset*)> onIdentifiers;
+};
+
+static void collectFindCallback(
+    void* callbackData,
+    T_DIMSE_C_FindRQ* /* request */,
+    int /* responseCount */,
+    T_DIMSE_C_FindRSP* rsp,
+    DcmDataset* responseIdentifiers)
+{
+    auto* ctx = static_cast<CollectFindContext*>(callbackData);
+    if (responseIdentifiers && rsp->DimseStatus == STATUS_Pending) {
+        ctx->onIdentifiers(responseIdentifiers);
+    }
+}
+
+static OFCondition runFind(T_ASC_Association* assoc,
+                           DcmDataset& request,
+                           const std::function<void(DcmDataset*)>& onIdentifiers,
+                           int timeoutSeconds)
+{
+    T_ASC_PresentationContextID presID =
+        ASC_findAcceptedPresentationContextID(assoc,
+            UID_FINDStudyRootQueryRetrieveInformationModel);
+    if (presID == 0) {
+        return makeOFCondition(0, 0, OF_error, "Study Root C-FIND not accepted");
+    }
+
+    T_DIMSE_C_FindRQ findRQ;
+    memset(&findRQ, 0, sizeof(findRQ));
+    findRQ.MessageID = assoc->nextMsgID++;
+    strcpy(findRQ.AffectedSOPClassUID, UID_FINDStudyRootQueryRetrieveInformationModel);
+    findRQ.Priority = DIMSE_PRIORITY_HIGH;
+    findRQ.DataSetType = DIMSE_DATASET_PRESENT;
+
+    CollectFindContext ctx{onIdentifiers};
+    T_DIMSE_C_FindRSP response;
+    DcmDataset* statusDetail = nullptr;
+    int responseCount = 0;
+
+    OFCondition cond = DIMSE_findUser(
+        assoc, presID, &findRQ, &request,
+        responseCount,
+        collectFindCallback, &ctx,
+        DIMSE_BLOCKING, timeoutSeconds,
+        &response, &statusDetail);
+
+    if (statusDetail) {
+        delete statusDetail;
+    }
+    if (cond.good() && response.DimseStatus != STATUS_Success) {
+        return makeOFCondition(0, 0, OF_error, "C-FIND returned a failure status");
+    }
+    return cond;
+}
+
+// --- Helper: Join UIDs for List of UID matching ---
+static std::string joinUIDs(const std::vector<std::string>& uids) {
+    std::string joined;
+    for (size_t i = 0; i < uids.size(); i++) {
+        if (i > 0) joined += '\\';
+        joined += uids[i];
+    }
+    return joined;
+}
+
+static void buildImageIdentifiers(DcmDataset& identifiers,
+                                  const std::string& studyInstanceUID,
+                                  const std::string& seriesInstanceUID,
+                                  const std::vector<std::string>& sopInstanceUIDs)
+{
+    identifiers.putAndInsertString(DCM_QueryRetrieveLevel, "IMAGE");
+    identifiers.putAndInsertString(DCM_StudyInstanceUID, studyInstanceUID.c_str());
+    identifiers.putAndInsertString(DCM_SeriesInstanceUID, seriesInstanceUID.c_str());
+    identifiers.putAndInsertString(DCM_SOPInstanceUID, joinUIDs(sopInstanceUIDs).c_str());
+}
+
+std::string sanitizeUID(const std::string& uid) {
+    std::string name;
+    name.reserve(uid.size());
+    for (char c : uid) {
+        name += (c == '.' || (c >= '0' && c <= '9')) ? c : '_';
+    }
+    return name;
+}
+
+std::string instanceFileName(const std::string& sopInstanceUID) {
+    return sanitizeUID(sopInstanceUID) + ".dcm";
+}
+
+// ========================================================================
+// Journal
+// ========================================================================
+
+static const char* kJournalHeader = "# DicomVmac retrieve journal ";
+
+RetrieveJournal::~RetrieveJournal() {
+    if (file) {
+        fclose(file);
+    }
+}
+
+bool RetrieveJournal::open(const std::string& path, const std::string& studyInstanceUID) {
+    const std::string header = kJournalHeader + studyInstanceUID;
+    bool existed = false;
+
+    if (FILE* existing = fopen(path.c_str(), "r")) {
+        existed = true;
+        char line[256];
+        bool first = true;
+        bool matches = true;
+        while (fgets(line, sizeof(line), existing)) {
+            std::string uid(line);
+            while (!uid.empty() && (uid.back() == '\n' || uid.back() == '\r')) {
+                uid.pop_back();
+            }
+            if (first) {
+                matches = uid == header;
+                first = false;
+                if (!matches) break;
+                continue;
+            }
+            if (!uid.empty()) received.insert(uid);
+        }
+        fclose(existing);
+        if (!matches) return false;
+    }
+
+    file = fopen(path.c_str(), "a");
+    if (!file) return false;
+
+    if (!existed) {
+        fprintf(file, "%s\n", header.c_str());
+        fflush(file);
+    }
+    return true;
+}
+
+bool RetrieveJournal::contains(const std::string& sopInstanceUID) const {
+    return received.count(sopInstanceUID) != 0;
+}
+
+void RetrieveJournal::record(const std::string& sopInstanceUID) {
+    if (!received.insert(sopInstanceUID).second || !file) return;
+    fprintf(file, "%s\n", sopInstanceUID.c_str());
+    fflush(file);
+}
+
+// ========================================================================
+// Association
+// ========================================================================
+
+OFCondition createRetrieveAssociation(const char* localAE,
+                                      const DB_DicomNode* remoteNode,
+                                      DB_RetrieveMode mode,
+                                      T_ASC_Network*& net,
+                                      T_ASC_Association*& assoc,
+                                      int timeoutSeconds)
+{
+    std::vector<PresentationContextSpec> contexts;
+    contexts.push_back({UID_FINDStudyRootQueryRetrieveInformationModel,
+                        ASC_SC_ROLE_DEFAULT, true});
+
+    if (mode == DB_RETRIEVE_MOVE) {
+        contexts.push_back({UID_MOVEStudyRootQueryRetrieveInformationModel,
+                            ASC_SC_ROLE_DEFAULT, true});
+    } else {
+        contexts.push_back({UID_GETStudyRootQueryRetrieveInformationModel,
+                            ASC_SC_ROLE_DEFAULT, true});
+
+        // C-GET delivers instances as C-STORE sub-operations on this
+        // association, so we must accept storage in the SCP role.
+        int storageCount = std::min(numberOfDcmLongSCUStorageSOPClassUIDs,
+                                    128 - (int)contexts.size());
+        for (int i = 0; i < storageCount; i++) {
+            contexts.push_back({dcmLongSCUStorageSOPClassUIDs[i], ASC_SC_ROLE_SCP, false});
+        }
+    }
+
+    return createAssociation(localAE, remoteNode, contexts.data(), contexts.size(),
+                             net, assoc, timeoutSeconds);
+}
+
+// ========================================================================
+// Series / instance discovery
+// ========================================================================
+
+OFCondition findSeries(T_ASC_Association* assoc,
+                       const std::string& studyInstanceUID,
+                       std::vector<SeriesRef>& series,
+                       int timeoutSeconds)
+{
+    DcmDataset request;
+    request.putAndInsertString(DCM_QueryRetrieveLevel, "SERIES");
+    request.putAndInsertString(DCM_StudyInstanceUID, studyInstanceUID.c_str());
+    request.putAndInsertString(DCM_SeriesInstanceUID, "");
+    request.putAndInsertString(DCM_Modality, "");
+    request.putAndInsertString(DCM_SeriesNumber, "");
+    request.putAndInsertString(DCM_NumberOfSeriesRelatedInstances, "");
+
+    return runFind(assoc, request, [&](DcmDataset* ids) {
+        SeriesRef ref;
+        OFString str;
+        if (ids->findAndGetOFString(DCM_SeriesInstanceUID, str).bad() || str.empty()) {
+            return;
+        }
+        ref.seriesInstanceUID = str.c_str();
+        if (ids->findAndGetOFString(DCM_Modality, str).good()) {
+            ref.modality = str.c_str();
+        }
+        Sint32 value = 0;
+        if (ids->findAndGetSint32(DCM_SeriesNumber, value).good()) {
+            ref.seriesNumber = (int)value;
+        }
+        if (ids->findAndGetSint32(DCM_NumberOfSeriesRelatedInstances, value).good()) {
+            ref.instanceCount = (int)value;
+        }
+        series.push_back(ref);
+    }, timeoutSeconds);
+}
+
+OFCondition findInstances(T_ASC_Association* assoc,
+                          const std::string& studyInstanceUID,
+                          const std::string& seriesInstanceUID,
+                          std::vector<InstanceRef>& instances,
+                          int timeoutSeconds)
+{
+    DcmDataset request;
+    request.putAndInsertString(DCM_QueryRetrieveLevel, "IMAGE");
+    request.putAndInsertString(DCM_StudyInstanceUID, studyInstanceUID.c_str());
+    request.putAndInsertString(DCM_SeriesInstanceUID, seriesInstanceUID.c_str());
+    request.putAndInsertString(DCM_SOPInstanceUID, "");
+    request.putAndInsertString(DCM_InstanceNumber, "");
+
+    return runFind(assoc, request, [&](DcmDataset* ids) {
+        InstanceRef ref;
+        OFString str;
+        if (ids->findAndGetOFString(DCM_SOPInstanceUID, str).bad() || str.empty()) {
+            return;
+        }
+        ref.sopInstanceUID = str.c_str();
+        Sint32 value = 0;
+        if (ids->findAndGetSint32(DCM_InstanceNumber, value).good()) {
+            ref.instanceNumber = (int)value;
+        }
+        instances.push_back(ref);
+    }, timeoutSeconds);
+}
+
+// ========================================================================
+// C-GET
+// ========================================================================
+
+OFCondition getInstances(T_ASC_Association* assoc,
+                         const std::string& studyInstanceUID,
+                         const std::string& seriesInstanceUID,
+                         const std::vector<std::string>& sopInstanceUIDs,
+                         const std::string& destinationFolder,
+                         const StoredInstanceHandler& onStored,
+                         RetrieveCounts& counts,
+                         int timeoutSeconds)
+{
+    T_ASC_PresentationContextID presID =
+        ASC_findAcceptedPresentationContextID(assoc,
+            UID_GETStudyRootQueryRetrieveInformationModel);
+    if (presID == 0) {
+        return makeOFCondition(0, 0, OF_error, "Study Root C-GET not accepted");
+    }
+
+    DcmDataset identifiers;
+    buildImageIdentifiers(identifiers, studyInstanceUID, seriesInstanceUID, sopInstanceUIDs);
+
+    T_DIMSE_Message msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.CommandField = DIMSE_C_GET_RQ;
+    T_DIMSE_C_GetRQ& getRQ = msg.msg.CGetRQ;
+    getRQ.MessageID = assoc->nextMsgID++;
+    strcpy(getRQ.AffectedSOPClassUID, UID_GETStudyRootQueryRetrieveInformationModel);
+    getRQ.Priority = DIMSE_PRIORITY_HIGH;
+    getRQ.DataSetType = DIMSE_DATASET_PRESENT;
+
+    OFCondition cond = DIMSE_sendMessageUsingMemoryData(
+        assoc, presID, &msg, nullptr, &identifiers, nullptr, nullptr);
+    if (cond.bad()) return cond;
+
+    // Interleaved C-STORE requests and C-GET responses until a final response
+    while (true) {
+        T_DIMSE_Message incoming;
+        memset(&incoming, 0, sizeof(incoming));
+        T_ASC_PresentationContextID incomingPresID = 0;
+        DcmDataset* statusDetail = nullptr;
+
+        cond = DIMSE_receiveCommand(assoc, DIMSE_BLOCKING, timeoutSeconds,
+                                    &incomingPresID, &incoming, &statusDetail);
+        if (statusDetail) {
+            delete statusDetail;
+        }
+        if (cond.bad()) return cond;
+
+        if (incoming.CommandField == DIMSE_C_STORE_RQ) {
+            T_DIMSE_C_StoreRQ& storeRQ = incoming.msg.CStoreRQ;
+            std::string sopInstanceUID = storeRQ.AffectedSOPInstanceUID;
+            std::string finalPath = destinationFolder + "/" + instanceFileName(sopInstanceUID);
+            std::string partialPath = finalPath + ".part";
+
+            // Written bit-preserving to a partial file, renamed when complete
+            cond = DIMSE_storeProvider(
+                assoc, incomingPresID, &storeRQ,
+                partialPath.c_str(), OFTrue, nullptr,
+                nullptr, nullptr,
+                DIMSE_BLOCKING, timeoutSeconds);
+            if (cond.bad()) {
+                remove(partialPath.c_str());
+                return cond;
+            }
+            if (rename(partialPath.c_str(), finalPath.c_str()) == 0) {
+                if (onStored) onStored(sopInstanceUID, finalPath);
+            } else {
+                remove(partialPath.c_str());
+            }
+        } else if (incoming.CommandField == DIMSE_C_GET_RSP) {
+            T_DIMSE_C_GetRSP& getRSP = incoming.msg.CGetRSP;
+
+            if (getRSP.DataSetType != DIMSE_DATASET_NULL) {
+                DcmDataset* rspIdentifiers = nullptr;
+                DIMSE_receiveDataSetInMemory(assoc, DIMSE_BLOCKING, timeoutSeconds,
+                                             &incomingPresID, &rspIdentifiers,
+                                             nullptr, nullptr);
+                delete rspIdentifiers;
+            }
+
+            if (getRSP.opts & O_GET_NUMBEROFCOMPLETEDSUBOPERATIONS) {
+                counts.completed = getRSP.NumberOfCompletedSubOperations;
+            }
+            if (getRSP.opts & O_GET_NUMBEROFFAILEDSUBOPERATIONS) {
+                counts.failed = getRSP.NumberOfFailedSubOperations;
+            }
+            if (getRSP.opts & O_GET_NUMBEROFWARNINGSUBOPERATIONS) {
+                counts.warning = getRSP.NumberOfWarningSubOperations;
+            }
+
+            if (getRSP.DimseStatus != STATUS_Pending) {
+                counts.dimseStatus = getRSP.DimseStatus;
+                return EC_Normal;
+            }
+        } else {
+            return makeOFCondition(0, 0, OF_error, "Unexpected DIMSE command during C-GET");
+        }
+    }
+}
+
+// ========================================================================
+// C-MOVE
+// ========================================================================
+
+static void moveCountsCallback(
+    void* callbackData,
+    T_DIMSE_C_MoveRQ* /* request */,
+    int /* responseCount */,
+    T_DIMSE_C_MoveRSP* rsp)
+{
+    auto* counts = static_cast<RetrieveCounts*>(callbackData);
+    counts->completed = rsp->NumberOfCompletedSubOperations;
+    counts->failed = rsp->NumberOfFailedSubOperations;
+    counts->warning = rsp->NumberOfWarningSubOperations;
+}
+
+OFCondition moveInstances(T_ASC_Network* net,
+                          T_ASC_Association* assoc,
+                          const std::string& studyInstanceUID,
+                          const std::string& seriesInstanceUID,
+                          const std::vector<std::string>& sopInstanceUIDs,
+                          const char* moveDestination,
+                          RetrieveCounts& counts,
+                          int timeoutSeconds)
+{
+    T_ASC_PresentationContextID presID =
+        ASC_findAcceptedPresentationContextID(assoc,
+            UID_MOVEStudyRootQueryRetrieveInformationModel);
+    if (presID == 0) {
+        return makeOFCondition(0, 0, OF_error, "Study Root C-MOVE not accepted");
+    }
+
+    DcmDataset identifiers;
+    buildImageIdentifiers(identifiers, studyInstanceUID, seriesInstanceUID, sopInstanceUIDs);
+
+    T_DIMSE_C_MoveRQ moveRQ;
+    memset(&moveRQ, 0, sizeof(moveRQ));
+    moveRQ.MessageID = assoc->nextMsgID++;
+    strcpy(moveRQ.AffectedSOPClassUID, UID_MOVEStudyRootQueryRetrieveInformationModel);
+    moveRQ.Priority = DIMSE_PRIORITY_HIGH;
+    moveRQ.DataSetType = DIMSE_DATASET_PRESENT;
+    strncpy(moveRQ.MoveDestination, moveDestination, sizeof(moveRQ.MoveDestination) - 1);
+
+    T_DIMSE_C_MoveRSP response;
+    memset(&response, 0, sizeof(response));
+    DcmDataset* statusDetail = nullptr;
+
+    OFCondition cond = DIMSE_moveUser(
+        assoc, presID, &moveRQ, &identifiers,
+        moveCountsCallback, &counts,
+        DIMSE_BLOCKING, timeoutSeconds,
+        net, nullptr, nullptr,
+        &response, &statusDetail, nullptr);
+
+    if (statusDetail) {
+        delete statusDetail;
+    }
+    if (cond.good()) {
+        counts.completed = response.NumberOfCompletedSubOperations;
+        counts.failed = response.NumberOfFailedSubOperations;
+        counts.warning = response.NumberOfWarningSubOperations;
+        counts.dimseStatus = response.DimseStatus;
+    }
+    return cond;
+}
+
+}  // namespace dicomcore
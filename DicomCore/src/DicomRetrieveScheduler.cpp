@@ -0,0 +1,506 @@
+//
+//  DicomRetrieveScheduler.cpp
+//  DicomCore
+//
+//  Prioritized study retrieval. Instead of one STUDY level C-MOVE, the
+//  study is discovered series by series and fetched in small IMAGE level
+//  batches: the middle slice of every series first, then each series
+//  outward from its middle, with the series the user is looking at
+//  moved to the front of the queue at any time. A series' instances are
+//  queried just before its first fetch, so the first image does not wait
+//  for the whole study to be listed.
+//
+
+#include "DicomBridge.h"
+#include "DicomNetworkUtils.hpp"
+#include "DicomNetworkStats.hpp"
+#include "DicomRetrieve.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace dicomcore;
+namespace fs = std::filesystem;
+
+namespace {
+
+// Series at or below this size (localizers, dose reports) are fetched last
+const int kSmallSeriesInstances = 3;
+
+struct SeriesQueue {
+    SeriesRef series;
+    std::deque<std::string> pending;    // Center-out order
+    bool discovered = false;            // IMAGE level C-FIND done
+    bool firstShown = false;            // Middle instance already requested
+    bool prioritized = false;           // Explicitly requested by the caller
+};
+
+// What the retrieve loop does next
+enum class Step {
+    Discover,   // Query the instances of batch.seriesInstanceUID
+    Fetch,      // Retrieve batch.sopInstanceUIDs
+    Done
+};
+
+struct Batch {
+    std::string seriesInstanceUID;
+    std::vector<std::string> sopInstanceUIDs;
+};
+
+// Order instances by InstanceNumber, then emit middle, middle-1, middle+1, ...
+std::deque<std::string> centerOutOrder(std::vector<InstanceRef> instances) {
+    std::stable_sort(instances.begin(), instances.end(),
+                     [](const InstanceRef& a, const InstanceRef& b) {
+                         return a.instanceNumber < b.instanceNumber;
+                     });
+
+    std::deque<std::string> ordered;
+    if (instances.empty()) return ordered;
+
+    const int count = (int)instances.size();
+    const int middle = count / 2;
+    ordered.push_back(instances[middle].sopInstanceUID);
+    for (int offset = 1; offset <= count; offset++) {
+        if (middle - offset >= 0) ordered.push_back(instances[middle - offset].sopInstanceUID);
+        if (middle + offset < count) ordered.push_back(instances[middle + offset].sopInstanceUID);
+    }
+    return ordered;
+}
+
+}  // namespace
+
+struct DB_RetrieveScheduler {
+    std::string localAE;
+    DB_DicomNode node;
+    std::string studyInstanceUID;
+    std::string destinationFolder;
+    DB_RetrieveMode mode;
+    int batchSize;
+    int timeoutSeconds;
+    bool resume = false;
+    std::string journalPath;
+
+    std::mutex mutex;
+    std::vector<std::string> preferredSeries;   // Most recently prioritized first
+    std::vector<SeriesQueue> queues;            // Current retrieval order
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> running{false};
+
+    // Caller must hold mutex
+    void applyPreferredOrder() {
+        for (auto& queue : queues) {
+            auto found = std::find(preferredSeries.begin(), preferredSeries.end(),
+                                   queue.series.seriesInstanceUID);
+            queue.prioritized = found != preferredSeries.end();
+        }
+        std::stable_sort(queues.begin(), queues.end(),
+                         [&](const SeriesQueue& a, const SeriesQueue& b) {
+                             return rank(a) < rank(b);
+                         });
+    }
+
+    // Caller must hold mutex
+    size_t rank(const SeriesQueue& queue) const {
+        auto found = std::find(preferredSeries.begin(), preferredSeries.end(),
+                               queue.series.seriesInstanceUID);
+        if (found != preferredSeries.end()) {
+            return (size_t)(found - preferredSeries.begin());
+        }
+        size_t base = preferredSeries.size();
+        bool small = queue.series.instanceCount > 0 &&
+                     queue.series.instanceCount <= kSmallSeriesInstances;
+        return base + (small ? 1 : 0);
+    }
+
+    // Caller must hold mutex
+    Step nextStep(Batch& batch) {
+        batch.sopInstanceUIDs.clear();
+
+        // 1. A series the user opened is discovered and streams completely
+        // 2. Otherwise each series in order is discovered and its middle
+        //    slice fetched before the next series is queried
+        // 3. Then each series outward from its middle
+        SeriesQueue* source = nullptr;
+        size_t take = (size_t)batchSize;
+
+        if (!queues.empty() && queues.front().prioritized) {
+            SeriesQueue& front = queues.front();
+            if (!front.discovered) {
+                batch.seriesInstanceUID = front.series.seriesInstanceUID;
+                return Step::Discover;
+            }
+            if (!front.pending.empty()) source = &front;
+        }
+        if (!source) {
+            for (auto& queue : queues) {
+                if (!queue.discovered) {
+                    batch.seriesInstanceUID = queue.series.seriesInstanceUID;
+                    return Step::Discover;
+                }
+                if (!queue.firstShown && !queue.pending.empty()) {
+                    source = &queue;
+                    take = 1;
+                    break;
+                }
+            }
+        }
+        if (!source) {
+            for (auto& queue : queues) {
+                if (!queue.pending.empty()) {
+                    source = &queue;
+                    break;
+                }
+            }
+        }
+        if (!source) return Step::Done;
+
+        batch.seriesInstanceUID = source->series.seriesInstanceUID;
+        while (take-- > 0 && !source->pending.empty()) {
+            batch.sopInstanceUIDs.push_back(source->pending.front());
+            source->pending.pop_front();
+        }
+        source->firstShown = true;
+        return Step::Fetch;
+    }
+
+    // Caller must hold mutex
+    SeriesQueue* findQueue(const std::string& seriesInstanceUID) {
+        for (auto& queue : queues) {
+            if (queue.series.seriesInstanceUID == seriesInstanceUID) return &queue;
+        }
+        return nullptr;
+    }
+};
+
+// ========================================================================
+// Scheduler lifecycle
+// ========================================================================
+
+DB_RetrieveScheduler* db_retrieve_scheduler_create(
+    const char* localAE,
+    const DB_DicomNode* remoteNode,
+    const char* studyInstanceUID,
+    const char* destinationFolder,
+    DB_RetrieveMode mode,
+    int batchSize,
+    int timeoutSeconds)
+{
+    if (!localAE || !remoteNode || !studyInstanceUID || !studyInstanceUID[0] ||
+        !destinationFolder || batchSize <= 0) {
+        return nullptr;
+    }
+
+    auto* scheduler = new DB_RetrieveScheduler();
+    scheduler->localAE = localAE;
+    scheduler->node = *remoteNode;
+    scheduler->studyInstanceUID = studyInstanceUID;
+    scheduler->destinationFolder = destinationFolder;
+    scheduler->mode = mode;
+    scheduler->batchSize = batchSize;
+    scheduler->timeoutSeconds = timeoutSeconds;
+    return scheduler;
+}
+
+void db_retrieve_scheduler_destroy(DB_RetrieveScheduler* scheduler) {
+    delete scheduler;
+}
+
+DB_Status db_retrieve_scheduler_prioritize_series(DB_RetrieveScheduler* scheduler,
+                                                  const char* seriesInstanceUID) {
+    if (!scheduler || !seriesInstanceUID) return DB_STATUS_ERROR;
+
+    std::lock_guard<std::mutex> lock(scheduler->mutex);
+    auto& preferred = scheduler->preferredSeries;
+    preferred.erase(std::remove(preferred.begin(), preferred.end(),
+                                std::string(seriesInstanceUID)),
+                    preferred.end());
+    preferred.insert(preferred.begin(), seriesInstanceUID);
+
+    if (scheduler->queues.empty()) {
+        // Not planned yet; applied once the series list is known
+        return DB_STATUS_OK;
+    }
+
+    scheduler->applyPreferredOrder();
+    bool known = std::any_of(scheduler->queues.begin(), scheduler->queues.end(),
+                             [&](const SeriesQueue& queue) {
+                                 return queue.series.seriesInstanceUID == seriesInstanceUID;
+                             });
+    return known ? DB_STATUS_OK : DB_STATUS_NOT_FOUND;
+}
+
+DB_Status db_retrieve_scheduler_enable_resume(DB_RetrieveScheduler* scheduler,
+                                              const char* journalPath) {
+    if (!scheduler || scheduler->running) return DB_STATUS_ERROR;
+
+    scheduler->resume = true;
+    if (journalPath && journalPath[0]) {
+        scheduler->journalPath = journalPath;
+    } else {
+        scheduler->journalPath = (fs::path(scheduler->destinationFolder) /
+            (".retrieve-" + sanitizeUID(scheduler->studyInstanceUID) + ".journal")).string();
+    }
+    return DB_STATUS_OK;
+}
+
+void db_retrieve_scheduler_cancel(DB_RetrieveScheduler* scheduler) {
+    if (scheduler) {
+        scheduler->cancelled = true;
+    }
+}
+
+// ========================================================================
+// Retrieval
+// ========================================================================
+
+DB_NetworkResult db_retrieve_scheduler_run(
+    DB_RetrieveScheduler* scheduler,
+    DB_RetrieveInstanceCallback onInstance,
+    DB_MoveProgressCallback onProgress,
+    void* userData)
+{
+    if (!scheduler) {
+        return makeResult(DB_STATUS_ERROR, "Invalid parameters");
+    }
+    if (scheduler->running.exchange(true)) {
+        return makeResult(DB_STATUS_ERROR, "Retrieve already running");
+    }
+
+    struct RunningGuard {
+        std::atomic<bool>& flag;
+        ~RunningGuard() { flag = false; }
+    } guard{scheduler->running};
+
+    const auto started = std::chrono::steady_clock::now();
+    const int timeout = scheduler->timeoutSeconds;
+
+    if (scheduler->mode == DB_RETRIEVE_GET || scheduler->resume) {
+        std::error_code ec;
+        fs::create_directories(scheduler->destinationFolder, ec);
+        if (!fs::is_directory(scheduler->destinationFolder, ec)) {
+            return makeResult(DB_STATUS_ERROR, "Destination folder unavailable");
+        }
+    }
+
+    RetrieveJournal journal;
+    if (scheduler->resume &&
+        !journal.open(scheduler->journalPath, scheduler->studyInstanceUID)) {
+        return makeResult(DB_STATUS_ERROR, "Cannot open retrieve journal");
+    }
+
+    // An instance counts as received if journaled, or for C-GET if its
+    // file is already in the destination (renamed only once complete)
+    auto alreadyReceived = [&](const std::string& sopUID) {
+        if (!scheduler->resume) return false;
+        if (journal.contains(sopUID)) return true;
+        if (scheduler->mode != DB_RETRIEVE_GET) return false;
+        std::error_code ec;
+        if (!fs::exists(fs::path(scheduler->destinationFolder) / instanceFileName(sopUID), ec)) {
+            return false;
+        }
+        journal.record(sopUID);
+        return true;
+    };
+
+    NetworkOperation operation(
+        scheduler->mode == DB_RETRIEVE_GET ? DB_NET_OP_GET : DB_NET_OP_MOVE, &scheduler->node);
+    T_ASC_Network* net = nullptr;
+    T_ASC_Association* assoc = nullptr;
+    OFCondition cond = createRetrieveAssociation(
+        scheduler->localAE.c_str(), &scheduler->node, scheduler->mode,
+        net, assoc, timeout);
+    if (cond.bad()) {
+        return operation.finish(conditionToResult(cond, "Association"));
+    }
+
+    // --- Plan: list the series; their instances are queried on demand ---
+    std::vector<SeriesRef> series;
+    cond = findSeries(assoc, scheduler->studyInstanceUID, series, timeout);
+    if (cond.bad()) {
+        releaseAssociation(assoc, net);
+        return operation.finish(conditionToResult(cond, "C-FIND"));
+    }
+
+    // Until a series is queried its NumberOfSeriesRelatedInstances, where
+    // the archive returns it, stands in for the progress total
+    std::vector<SeriesQueue> queues;
+    int total = 0;
+    for (const SeriesRef& ref : series) {
+        SeriesQueue queue;
+        queue.series = ref;
+        total += ref.instanceCount;
+        queues.push_back(std::move(queue));
+    }
+
+    // Default order: series number, small series last
+    std::stable_sort(queues.begin(), queues.end(),
+                     [](const SeriesQueue& a, const SeriesQueue& b) {
+                         return a.series.seriesNumber < b.series.seriesNumber;
+                     });
+    {
+        std::lock_guard<std::mutex> lock(scheduler->mutex);
+        scheduler->queues = std::move(queues);
+        scheduler->applyPreferredOrder();
+    }
+
+    // --- Query and fetch in priority order ---
+    int present = 0;
+    int completed = 0;
+    int failed = 0;
+    double firstImageSeconds = -1.0;
+    bool wasCancelled = false;
+    const char* failedStep = "C-FIND";
+
+    Batch batch;
+    while (true) {
+        if (scheduler->cancelled) {
+            wasCancelled = true;
+            break;
+        }
+
+        Step step;
+        {
+            std::lock_guard<std::mutex> lock(scheduler->mutex);
+            step = scheduler->nextStep(batch);
+        }
+        if (step == Step::Done) break;
+
+        if (step == Step::Discover) {
+            std::vector<InstanceRef> instances;
+            cond = findInstances(assoc, scheduler->studyInstanceUID,
+                                 batch.seriesInstanceUID, instances, timeout);
+            if (cond.bad()) {
+                failedStep = "C-FIND";
+                break;
+            }
+
+            // On resume, only instances missing from the journal are fetched
+            size_t found = instances.size();
+            instances.erase(std::remove_if(instances.begin(), instances.end(),
+                                           [&](const InstanceRef& ref) {
+                                               return alreadyReceived(ref.sopInstanceUID);
+                                           }),
+                            instances.end());
+            int alreadyPresent = (int)(found - instances.size());
+            present += alreadyPresent;
+            completed += alreadyPresent;
+
+            std::lock_guard<std::mutex> lock(scheduler->mutex);
+            SeriesQueue* queue = scheduler->findQueue(batch.seriesInstanceUID);
+            total += (int)found - queue->series.instanceCount;
+            queue->series.instanceCount = (int)found;
+            queue->pending = centerOutOrder(std::move(instances));
+            queue->discovered = true;
+            continue;
+        }
+
+        failedStep = scheduler->mode == DB_RETRIEVE_GET ? "C-GET" : "C-MOVE";
+        RetrieveCounts counts;
+        int stored = 0;
+
+        if (scheduler->mode == DB_RETRIEVE_GET) {
+            const std::string& seriesUID = batch.seriesInstanceUID;
+            cond = getInstances(
+                assoc, scheduler->studyInstanceUID, seriesUID,
+                batch.sopInstanceUIDs, scheduler->destinationFolder,
+                [&](const std::string& sopUID, const std::string& path) {
+                    stored++;
+                    if (scheduler->resume) journal.record(sopUID);
+                    if (firstImageSeconds < 0) {
+                        firstImageSeconds = std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - started).count();
+                    }
+                    if (onInstance) {
+                        onInstance(userData, seriesUID.c_str(), sopUID.c_str(), path.c_str());
+                    }
+                },
+                counts, timeout);
+        } else {
+            cond = moveInstances(
+                net, assoc, scheduler->studyInstanceUID, batch.seriesInstanceUID,
+                batch.sopInstanceUIDs, scheduler->localAE.c_str(),
+                counts, timeout);
+
+            // Individual instances are only confirmed when the whole batch moved
+            stored = counts.completed;
+            if (cond.good() && counts.failed == 0 &&
+                counts.completed == (int)batch.sopInstanceUIDs.size()) {
+                if (firstImageSeconds < 0) {
+                    firstImageSeconds = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - started).count();
+                }
+                for (const auto& sopUID : batch.sopInstanceUIDs) {
+                    if (scheduler->resume) journal.record(sopUID);
+                    if (onInstance) {
+                        onInstance(userData, batch.seriesInstanceUID.c_str(),
+                                   sopUID.c_str(), nullptr);
+                    }
+                }
+            }
+        }
+
+        if (cond.bad()) break;
+
+        completed += stored;
+        operation.addInstances(stored);
+        failed += std::max(0, (int)batch.sopInstanceUIDs.size() - stored);
+
+        if (onProgress) {
+            onProgress(userData, completed, total - completed - failed, failed);
+        }
+    }
+
+    if (cond.bad()) {
+        DB_NetworkResult result = conditionToResult(cond, failedStep);
+        ASC_abortAssociation(assoc);
+        ASC_dropAssociation(assoc);
+        ASC_dropNetwork(&net);
+        return operation.finish(result);
+    }
+
+    releaseAssociation(assoc, net);
+
+    char msg[256];
+    if (wasCancelled) {
+        snprintf(msg, sizeof(msg), "Retrieve cancelled: %d of %d instances", completed, total);
+        return operation.finish(makeResult(DB_STATUS_CANCELLED, msg));
+    }
+    snprintf(msg, sizeof(msg),
+             "Retrieve completed: %d succeeded (%d already present), %d failed, "
+             "first image after %.2f s",
+             completed, present, failed, firstImageSeconds < 0 ? 0.0 : firstImageSeconds);
+    return operation.finish(makeResult(DB_STATUS_OK, msg));
+}
+
+// ========================================================================
+// Resumable whole-study retrieval
+// ========================================================================
+
+DB_NetworkResult db_retrieve_study_resumable(
+    const char* localAE,
+    const DB_DicomNode* remoteNode,
+    const char* studyInstanceUID,
+    const char* destinationFolder,
+    DB_RetrieveMode mode,
+    DB_MoveProgressCallback onProgress,
+    void* userData,
+    int timeoutSeconds)
+{
+    DB_RetrieveScheduler* scheduler = db_retrieve_scheduler_create(
+        localAE, remoteNode, studyInstanceUID, destinationFolder,
+        mode, 64, timeoutSeconds);
+    if (!scheduler) {
+        return makeResult(DB_STATUS_ERROR, "Invalid parameters");
+    }
+
+    db_retrieve_scheduler_enable_resume(scheduler, nullptr);
+    DB_NetworkResult result = db_retrieve_scheduler_run(scheduler, nullptr, onProgress, userData);
+    db_retrieve_scheduler_destroy(scheduler);
+    return result;
+}
@@ -0,0 +1,187 @@
+//
+//  DicomStore.cpp
+//  DicomCore
+//
+//  C-STORE SCU building blocks: identifying files, negotiating the
+//  presentation contexts a batch of files needs, and sending one instance.
+//
+
+#include "DicomStore.hpp"
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/dcmnet/dimse.h"
+#include "dcmtk/dcmdata/dcdeftag.h"
+#include "dcmtk/dcmdata/dcfilefo.h"
+#include "dcmtk/dcmdata/dcuid.h"
+#include "dcmtk/dcmdata/dcxfer.h"
+#include <cstdio>
+#include <cstring>
+
+namespace dicomcore {
+
+// Uncompressed transfer syntaxes in order of preference
+static const char* const kUncompressedSyntaxes[] = {
+    UID_LittleEndianExplicitTransferSyntax,
+    UID_LittleEndianImplicitTransferSyntax,
+    UID_BigEndianExplicitTransferSyntax,
+};
+
+// --- Helper: Transfer syntaxes createAssociation proposes by default ---
+static bool isUncompressed(const std::string& transferSyntaxUID) {
+    return transferSyntaxUID.empty() ||
+           transferSyntaxUID == UID_LittleEndianImplicitTransferSyntax ||
+           transferSyntaxUID == UID_LittleEndianExplicitTransferSyntax ||
+           transferSyntaxUID == UID_BigEndianExplicitTransferSyntax;
+}
+
+bool readStoreItem(const std::string& path, StoreItem& item) {
+    DcmFileFormat fileFormat;
+    OFCondition cond = fileFormat.loadFile(path.c_str(), EXS_Unknown, EGL_noChange,
+                                           DCM_MaxReadLength, ERM_metaOnly);
+    if (cond.bad()) return false;
+
+    OFString sopClass;
+    OFString sopInstance;
+    OFString transferSyntax;
+    DcmMetaInfo* meta = fileFormat.getMetaInfo();
+    meta->findAndGetOFString(DCM_MediaStorageSOPClassUID, sopClass);
+    meta->findAndGetOFString(DCM_MediaStorageSOPInstanceUID, sopInstance);
+    meta->findAndGetOFString(DCM_TransferSyntaxUID, transferSyntax);
+
+    // No meta header: read the dataset itself
+    if (sopClass.empty() || sopInstance.empty()) {
+        if (fileFormat.loadFile(path.c_str()).bad()) return false;
+        DcmDataset* dataset = fileFormat.getDataset();
+        dataset->findAndGetOFString(DCM_SOPClassUID, sopClass);
+        dataset->findAndGetOFString(DCM_SOPInstanceUID, sopInstance);
+        transferSyntax = DcmXfer(dataset->getOriginalXfer()).getXferID();
+    }
+    if (sopClass.empty() || sopInstance.empty()) return false;
+
+    item.path = path;
+    item.sopClassUID = sopClass.c_str();
+    item.sopInstanceUID = sopInstance.c_str();
+    item.transferSyntaxUID = transferSyntax.c_str();
+    return true;
+}
+
+// ========================================================================
+// StoreContexts
+// ========================================================================
+
+bool StoreContexts::add(const StoreItem& item) {
+    std::pair<std::string, std::string> key(
+        item.sopClassUID,
+        isUncompressed(item.transferSyntaxUID) ? std::string() : item.transferSyntaxUID);
+    if (keys.count(key)) return true;
+    if (keys.size() >= 128) return false;
+    keys.insert(key);
+    return true;
+}
+
+std::vector<PresentationContextSpec> StoreContexts::specs() const {
+    std::vector<PresentationContextSpec> result;
+    for (const auto& key : keys) {
+        PresentationContextSpec spec = { key.first.c_str(), ASC_SC_ROLE_DEFAULT, false };
+        if (!key.second.empty()) {
+            spec.transferSyntax = key.second.c_str();
+        }
+        result.push_back(spec);
+    }
+    return result;
+}
+
+// ========================================================================
+// Sending
+// ========================================================================
+
+// --- Helper: Whether a failed exchange left the association unusable ---
+// Anything else (an illegal message, a dataset that cannot be encoded)
+// fails before the request reaches the network.
+static bool isTransportFailure(const OFCondition& cond) {
+    return cond == DIMSE_SENDFAILED || cond == DIMSE_RECEIVEFAILED ||
+           cond == DIMSE_READPDVFAILED || cond == DIMSE_NODATAAVAILABLE ||
+           cond == DUL_PEERABORTEDASSOCIATION || cond == DUL_PEERREQUESTEDRELEASE ||
+           cond == DUL_NETWORKCLOSED || cond == DUL_READTIMEOUT;
+}
+
+StoreOutcome storeInstance(T_ASC_Association* assoc,
+                           const StoreItem& item,
+                           int timeoutSeconds,
+                           std::string& error,
+                           int& dimseStatus)
+{
+    dimseStatus = 0;
+
+    // Matching the SOP class alone could pick a context accepted only for
+    // a compressed syntax, which native data cannot go on
+    T_ASC_PresentationContextID presID = 0;
+    const char* transferSyntax = item.transferSyntaxUID.c_str();
+    if (isUncompressed(item.transferSyntaxUID)) {
+        for (const char* candidate : kUncompressedSyntaxes) {
+            presID = ASC_findAcceptedPresentationContextID(assoc, item.sopClassUID.c_str(), candidate);
+            if (presID != 0) {
+                transferSyntax = candidate;
+                break;
+            }
+        }
+    } else {
+        presID = ASC_findAcceptedPresentationContextID(assoc, item.sopClassUID.c_str(), transferSyntax);
+    }
+    if (presID == 0) {
+        error = "SOP class or transfer syntax not accepted";
+        return StoreOutcome::Rejected;
+    }
+
+    DcmFileFormat fileFormat;
+    if (fileFormat.loadFile(item.path.c_str()).bad()) {
+        error = "Cannot read file";
+        return StoreOutcome::Rejected;
+    }
+    DcmDataset* dataset = fileFormat.getDataset();
+    if (!dataset->canWriteXfer(DcmXfer(transferSyntax).getXfer(), dataset->getOriginalXfer())) {
+        error = "Cannot encode dataset in the accepted transfer syntax";
+        return StoreOutcome::Rejected;
+    }
+
+    T_DIMSE_C_StoreRQ request;
+    memset(&request, 0, sizeof(request));
+    request.MessageID = assoc->nextMsgID++;
+    strncpy(request.AffectedSOPClassUID, item.sopClassUID.c_str(),
+            sizeof(request.AffectedSOPClassUID) - 1);
+    strncpy(request.AffectedSOPInstanceUID, item.sopInstanceUID.c_str(),
+            sizeof(request.AffectedSOPInstanceUID) - 1);
+    request.Priority = DIMSE_PRIORITY_LOW;
+    request.DataSetType = DIMSE_DATASET_PRESENT;
+
+    T_DIMSE_C_StoreRSP response;
+    memset(&response, 0, sizeof(response));
+    DcmDataset* statusDetail = nullptr;
+
+    OFCondition cond = DIMSE_storeUser(
+        assoc, presID, &request, nullptr,
+        dataset, nullptr, nullptr,
+        DIMSE_BLOCKING, timeoutSeconds,
+        &response, &statusDetail, nullptr);
+
+    if (statusDetail) {
+        delete statusDetail;
+    }
+
+    if (cond.bad()) {
+        error = cond.text();
+        return isTransportFailure(cond) ? StoreOutcome::ConnectionLost : StoreOutcome::Rejected;
+    }
+
+    // Warnings (coercion, elements discarded) still mean stored
+    dimseStatus = response.DimseStatus;
+    if (response.DimseStatus == STATUS_Success || (response.DimseStatus & 0xF000) == 0xB000) {
+        return StoreOutcome::Stored;
+    }
+
+    char message[64];
+    snprintf(message, sizeof(message), "C-STORE failed with status 0x%04x", response.DimseStatus);
+    error = message;
+    return StoreOutcome::Rejected;
+}
+
+}  // namespace dicomcore
@@ -0,0 +1,608 @@
+//
+//  DicomStoreQueue.cpp
+//  DicomCore
+//
+//  Store-and-forward queue for outbound C-STORE. Jobs and the state of
+//  each instance are kept in an append-only journal in the queue folder,
+//  so an archive outage or a crash only delays delivery. A worker thread
+//  sends the pending instances of each destination in batches over one
+//  association, and backs off exponentially while a destination fails.
+//
+
+#include "DicomBridge.h"
+#include "DicomNetworkUtils.hpp"
+#include "DicomNetworkStats.hpp"
+#include "DicomStore.hpp"
+#include "DicomFileSync.hpp"
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/dcmnet/assoc.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace dicomcore;
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+static const char* kJournalName = "store-queue.journal";
+static const char* kJournalHeader = "DBSTOREQUEUE\t1";
+
+// Defaults for zero config fields
+static const int kDefaultBatchSize = 256;
+static const int kDefaultMaxAttempts = 5;
+static const int kDefaultInitialBackoff = 5;
+static const int kDefaultMaxBackoff = 600;
+static const int kDefaultTimeout = 30;
+
+// ========================================================================
+// Queue state
+// ========================================================================
+
+namespace {
+
+enum class InstanceState { Pending, Sent, Failed };
+
+struct QueuedInstance {
+    StoreItem item;
+    InstanceState state = InstanceState::Pending;
+    int attempts = 0;
+    Clock::time_point notBefore;        // Retry delay after a rejection
+};
+
+struct StoreJob {
+    uint64_t id = 0;
+    std::string localAE;
+    DB_DicomNode node;
+    std::string destination;            // Key into DB_StoreQueue::destinations
+    std::vector<QueuedInstance> instances;
+    int sent = 0;
+    int failed = 0;
+    std::string lastError;
+
+    int pending() const { return (int)instances.size() - sent - failed; }
+};
+
+/// Retry state of one destination (local AE, remote AE, host and port).
+struct Destination {
+    int failures = 0;                   // Consecutive failed associations
+    Clock::time_point nextAttempt;
+};
+
+/// Instances of one destination to send over one association.
+struct Batch {
+    std::string localAE;
+    DB_DicomNode node;
+    std::string destination;
+    std::vector<std::pair<uint64_t, size_t>> entries;  // Job ID, instance index
+    std::vector<StoreItem> items;
+};
+
+}  // namespace
+
+struct DB_StoreQueue {
+    std::string journalPath;
+    DB_StoreQueueConfig config;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::map<uint64_t, StoreJob> jobs;              // Oldest first
+    std::map<std::string, Destination> destinations;
+    FILE* journal = nullptr;
+    uint64_t nextJobID = 1;
+
+    std::atomic<bool> stopping{false};
+    std::thread worker;
+};
+
+// --- Helper: Destination key of a job ---
+static std::string destinationKey(const std::string& localAE, const DB_DicomNode& node) {
+    return localAE + "\t" + node.aeTitle + "\t" + node.hostname + "\t" + std::to_string(node.port);
+}
+
+// --- Helper: Retry delay after a number of consecutive failures ---
+static Clock::duration backoff(const DB_StoreQueueConfig& config, int failures) {
+    double seconds = config.initialBackoffSeconds;
+    for (int i = 1; i < failures && seconds < config.maxBackoffSeconds; i++) {
+        seconds *= 2.0;
+    }
+    seconds = std::min(seconds, (double)config.maxBackoffSeconds);
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+}
+
+// ========================================================================
+// Journal
+// ========================================================================
+
+// Tab separated lines, appended as things happen:
+//   N <next job>       (written by compaction, which drops finished jobs)
+//   J <job> <localAE> <remoteAE> <host> <port>
+//   I <job> <index> <sopClass> <sopInstance> <transferSyntax> <path>
+//   S <job> <index>
+//   F <job> <index> <error>
+
+static std::vector<std::string> splitTabs(const std::string& line) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    for (;;) {
+        size_t tab = line.find('\t', start);
+        fields.push_back(line.substr(start, tab == std::string::npos ? std::string::npos : tab - start));
+        if (tab == std::string::npos) break;
+        start = tab + 1;
+    }
+    return fields;
+}
+
+static std::string jobLine(const StoreJob& job) {
+    return "J\t" + std::to_string(job.id) + "\t" + job.localAE + "\t" + job.node.aeTitle + "\t" +
+           job.node.hostname + "\t" + std::to_string(job.node.port) + "\n";
+}
+
+static std::string instanceLine(const StoreJob& job, size_t index) {
+    const StoreItem& item = job.instances[index].item;
+    return "I\t" + std::to_string(job.id) + "\t" + std::to_string(index) + "\t" +
+           item.sopClassUID + "\t" + item.sopInstanceUID + "\t" + item.transferSyntaxUID + "\t" +
+           item.path + "\n";
+}
+
+static std::string stateLine(const StoreJob& job, size_t index, const std::string& error) {
+    const QueuedInstance& instance = job.instances[index];
+    std::string line = (instance.state == InstanceState::Sent ? "S\t" : "F\t") +
+                       std::to_string(job.id) + "\t" + std::to_string(index);
+    if (instance.state == InstanceState::Failed) {
+        std::string clean = error;
+        std::replace(clean.begin(), clean.end(), '\t', ' ');
+        std::replace(clean.begin(), clean.end(), '\n', ' ');
+        line += "\t" + clean;
+    }
+    return line + "\n";
+}
+
+// --- Helper: Rebuild the jobs from a journal ---
+// A torn last line from a crash fails to parse and is ignored.
+static void replayJournal(DB_StoreQueue* queue) {
+    FILE* file = fopen(queue->journalPath.c_str(), "r");
+    if (!file) return;
+
+    std::string line;
+    bool first = true;
+    int c;
+    do {
+        c = fgetc(file);
+        if (c != '\n' && c != EOF) {
+            line += (char)c;
+            continue;
+        }
+        if (first) {
+            first = false;
+            if (line != kJournalHeader) break;
+            line.clear();
+            continue;
+        }
+
+        std::vector<std::string> f = splitTabs(line);
+        line.clear();
+        if (f.size() == 2 && f[0] == "N") {
+            uint64_t next = strtoull(f[1].c_str(), nullptr, 10);
+            queue->nextJobID = std::max(queue->nextJobID, next);
+            continue;
+        }
+        if (f.size() < 3) continue;
+        uint64_t id = strtoull(f[1].c_str(), nullptr, 10);
+
+        if (f[0] == "J" && f.size() == 6) {
+            StoreJob& job = queue->jobs[id];
+            job.id = id;
+            job.localAE = f[2];
+            memset(&job.node, 0, sizeof(job.node));
+            strncpy(job.node.aeTitle, f[3].c_str(), sizeof(job.node.aeTitle) - 1);
+            strncpy(job.node.hostname, f[4].c_str(), sizeof(job.node.hostname) - 1);
+            job.node.port = atoi(f[5].c_str());
+            job.destination = destinationKey(job.localAE, job.node);
+            queue->nextJobID = std::max(queue->nextJobID, id + 1);
+            continue;
+        }
+
+        auto it = queue->jobs.find(id);
+        if (it == queue->jobs.end()) continue;
+        StoreJob& job = it->second;
+        size_t index = strtoul(f[2].c_str(), nullptr, 10);
+
+        if (f[0] == "I" && f.size() == 7 && index == job.instances.size()) {
+            QueuedInstance instance;
+            instance.item.sopClassUID = f[3];
+            instance.item.sopInstanceUID = f[4];
+            instance.item.transferSyntaxUID = f[5];
+            instance.item.path = f[6];
+            job.instances.push_back(instance);
+        } else if ((f[0] == "S" || f[0] == "F") && index < job.instances.size() &&
+                   job.instances[index].state == InstanceState::Pending) {
+            if (f[0] == "S") {
+                job.instances[index].state = InstanceState::Sent;
+                job.sent++;
+            } else {
+                job.instances[index].state = InstanceState::Failed;
+                job.failed++;
+                if (f.size() > 3) job.lastError = f[3];
+            }
+        }
+    } while (c != EOF);
+    fclose(file);
+}
+
+// --- Helper: Rewrite the journal with the unfinished jobs only ---
+// Written to a temporary file and renamed, so a crash leaves either the
+// old or the new journal. The next job ID is kept so IDs of dropped jobs
+// are never handed out again.
+static bool compactJournal(DB_StoreQueue* queue) {
+    if (queue->journal) {
+        fclose(queue->journal);
+        queue->journal = nullptr;
+    }
+
+    std::string tempPath = replacementPath(queue->journalPath);
+    FILE* file = fopen(tempPath.c_str(), "w");
+    if (!file) return false;
+
+    fprintf(file, "%s\n", kJournalHeader);
+    fprintf(file, "N\t%llu\n", (unsigned long long)queue->nextJobID);
+    for (const auto& entry : queue->jobs) {
+        const StoreJob& job = entry.second;
+        if (job.pending() == 0) continue;
+        fputs(jobLine(job).c_str(), file);
+        for (size_t i = 0; i < job.instances.size(); i++) {
+            fputs(instanceLine(job, i).c_str(), file);
+            if (job.instances[i].state != InstanceState::Pending) {
+                fputs(stateLine(job, i, job.lastError).c_str(), file);
+            }
+        }
+    }
+
+    bool ok = fflush(file) == 0;
+    ok = fclose(file) == 0 && ok;
+    if (!ok || !replaceFile(tempPath, queue->journalPath)) {
+        remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+static void appendJournal(DB_StoreQueue* queue, const std::string& text, bool sync) {
+    if (!queue->journal) return;
+    fputs(text.c_str(), queue->journal);
+    fflush(queue->journal);
+    if (sync) {
+        fsync(fileno(queue->journal));
+    }
+}
+
+// --- Helper: Record the outcome of one instance (queue locked) ---
+static void settleInstance(DB_StoreQueue* queue, StoreJob& job, size_t index,
+                           InstanceState state, const std::string& error) {
+    QueuedInstance& instance = job.instances[index];
+    instance.state = state;
+    if (state == InstanceState::Sent) {
+        job.sent++;
+    } else {
+        job.failed++;
+        job.lastError = error;
+    }
+    // A lost "sent" record only means the instance is sent again
+    appendJournal(queue, stateLine(job, index, error), false);
+}
+
+// ========================================================================
+// Worker
+// ========================================================================
+
+// --- Helper: Pick the next batch (queue locked) ---
+// Returns false when nothing is due; wakeAt is then when something will be.
+static bool nextBatch(DB_StoreQueue* queue, Batch& batch, Clock::time_point& wakeAt) {
+    Clock::time_point now = Clock::now();
+    wakeAt = Clock::time_point::max();
+    StoreContexts contexts;
+
+    for (auto& entry : queue->jobs) {
+        StoreJob& job = entry.second;
+        if (job.pending() == 0) continue;
+        if (!batch.destination.empty() && job.destination != batch.destination) continue;
+
+        const Destination& destination = queue->destinations[job.destination];
+        if (destination.nextAttempt > now) {
+            wakeAt = std::min(wakeAt, destination.nextAttempt);
+            continue;
+        }
+
+        for (size_t i = 0; i < job.instances.size(); i++) {
+            const QueuedInstance& instance = job.instances[i];
+            if (instance.state != InstanceState::Pending) continue;
+            if (instance.notBefore > now) {
+                wakeAt = std::min(wakeAt, instance.notBefore);
+                continue;
+            }
+            if ((int)batch.entries.size() >= queue->config.batchSize) return true;
+            if (!contexts.add(instance.item)) continue;     // Next association
+
+            if (batch.destination.empty()) {
+                batch.destination = job.destination;
+                batch.localAE = job.localAE;
+                batch.node = job.node;
+            }
+            batch.entries.push_back({job.id, i});
+            batch.items.push_back(instance.item);
+        }
+    }
+    return !batch.entries.empty();
+}
+
+// --- Helper: Back off a destination after a failed association (queue locked) ---
+static void destinationFailed(DB_StoreQueue* queue, const Batch& batch, const std::string& error) {
+    Destination& destination = queue->destinations[batch.destination];
+    destination.failures++;
+    destination.nextAttempt = Clock::now() + backoff(queue->config, destination.failures);
+
+    for (const auto& entry : batch.entries) {
+        auto it = queue->jobs.find(entry.first);
+        if (it != queue->jobs.end()) it->second.lastError = error;
+    }
+}
+
+// --- Helper: Send one batch over one association ---
+static void deliverBatch(DB_StoreQueue* queue, const Batch& batch) {
+    const DB_StoreQueueConfig& config = queue->config;
+    NetworkOperation operation(DB_NET_OP_STORE, &batch.node);
+
+    StoreContexts contexts;
+    for (const StoreItem& item : batch.items) {
+        contexts.add(item);
+    }
+    std::vector<PresentationContextSpec> specs = contexts.specs();
+
+    T_ASC_Network* net = nullptr;
+    T_ASC_Association* assoc = nullptr;
+    OFCondition cond = createAssociation(batch.localAE.c_str(), &batch.node,
+                                         specs.data(), specs.size(),
+                                         net, assoc, config.timeoutSeconds);
+    if (cond.bad()) {
+        DB_NetworkResult result = conditionToResult(cond, "Association");
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        destinationFailed(queue, batch, result.errorMessage);
+        operation.finish(result);
+        return;
+    }
+
+    int sent = 0;
+    bool connectionLost = false;
+    std::string lostError;
+    for (size_t i = 0; i < batch.items.size() && !queue->stopping; i++) {
+        std::string error;
+        int dimseStatus = 0;
+        StoreOutcome outcome = storeInstance(assoc, batch.items[i], config.timeoutSeconds,
+                                             error, dimseStatus);
+
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        if (outcome == StoreOutcome::ConnectionLost) {
+            connectionLost = true;
+            lostError = "C-STORE failed: " + error;
+            destinationFailed(queue, batch, lostError);
+            break;
+        }
+
+        StoreJob& job = queue->jobs[batch.entries[i].first];
+        size_t index = batch.entries[i].second;
+        QueuedInstance& instance = job.instances[index];
+        if (outcome == StoreOutcome::Stored) {
+            settleInstance(queue, job, index, InstanceState::Sent, std::string());
+            sent++;
+        } else if (++instance.attempts >= config.maxAttempts) {
+            settleInstance(queue, job, index, InstanceState::Failed, error);
+        } else {
+            job.lastError = error;
+            instance.notBefore = Clock::now() + backoff(config, instance.attempts);
+        }
+    }
+
+    if (connectionLost) {
+        ASC_abortAssociation(assoc);
+        ASC_dropAssociation(assoc);
+        ASC_dropNetwork(&net);
+    } else {
+        releaseAssociation(assoc, net);
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->destinations[batch.destination].failures = 0;
+    }
+
+    operation.addInstances(sent);
+    operation.finish(connectionLost ? makeResult(DB_STATUS_ERROR, lostError.c_str())
+                                    : makeResult(DB_STATUS_OK));
+}
+
+static void runWorker(DB_StoreQueue* queue) {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    while (!queue->stopping) {
+        Batch batch;
+        Clock::time_point wakeAt;
+        if (!nextBatch(queue, batch, wakeAt)) {
+            if (wakeAt == Clock::time_point::max()) {
+                queue->wake.wait(lock);
+            } else {
+                queue->wake.wait_until(lock, wakeAt);
+            }
+            continue;
+        }
+
+        lock.unlock();
+        deliverBatch(queue, batch);
+        lock.lock();
+    }
+}
+
+// ========================================================================
+// Queue API
+// ========================================================================
+
+DB_StoreQueue* db_store_queue_open(const char* queueFolder, const DB_StoreQueueConfig* config) {
+    if (!queueFolder || !queueFolder[0]) return nullptr;
+
+    std::error_code ec;
+    fs::create_directories(queueFolder, ec);
+    if (!fs::is_directory(queueFolder, ec)) return nullptr;
+
+    DB_StoreQueue* queue = new DB_StoreQueue();
+    queue->journalPath = (fs::path(queueFolder) / kJournalName).string();
+
+    memset(&queue->config, 0, sizeof(queue->config));
+    if (config) queue->config = *config;
+    DB_StoreQueueConfig& c = queue->config;
+    if (c.batchSize <= 0) c.batchSize = kDefaultBatchSize;
+    if (c.maxAttempts <= 0) c.maxAttempts = kDefaultMaxAttempts;
+    if (c.initialBackoffSeconds <= 0) c.initialBackoffSeconds = kDefaultInitialBackoff;
+    if (c.maxBackoffSeconds <= 0) c.maxBackoffSeconds = kDefaultMaxBackoff;
+    c.maxBackoffSeconds = std::max(c.maxBackoffSeconds, c.initialBackoffSeconds);
+    if (c.timeoutSeconds <= 0) c.timeoutSeconds = kDefaultTimeout;
+
+    // Resume what a previous run left, dropping finished jobs
+    replayJournal(queue);
+    if (!compactJournal(queue) || !(queue->journal = fopen(queue->journalPath.c_str(), "a"))) {
+        delete queue;
+        return nullptr;
+    }
+    for (auto it = queue->jobs.begin(); it != queue->jobs.end();) {
+        it = it->second.pending() == 0 ? queue->jobs.erase(it) : std::next(it);
+    }
+
+    queue->worker = std::thread(runWorker, queue);
+    return queue;
+}
+
+void db_store_queue_close(DB_StoreQueue* queue) {
+    if (!queue) return;
+
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->stopping = true;
+    }
+    queue->wake.notify_all();
+    if (queue->worker.joinable()) {
+        queue->worker.join();
+    }
+
+    compactJournal(queue);
+    delete queue;
+}
+
+DB_Status db_store_queue_enqueue(DB_StoreQueue* queue,
+                                 const char* localAE,
+                                 const DB_DicomNode* remoteNode,
+                                 const char* const* filePaths,
+                                 int fileCount,
+                                 uint64_t* outJobID)
+{
+    if (!queue || !localAE || !localAE[0] || !remoteNode || !remoteNode->hostname[0] ||
+        remoteNode->port <= 0 || !filePaths || fileCount <= 0) {
+        return DB_STATUS_ERROR;
+    }
+
+    StoreJob job;
+    job.localAE = localAE;
+    job.node = *remoteNode;
+    job.destination = destinationKey(job.localAE, job.node);
+    if (job.localAE.find('\t') != std::string::npos) return DB_STATUS_ERROR;
+
+    // Identify the files now, outside the lock; unreadable ones fail at once
+    std::vector<bool> readable;
+    for (int i = 0; i < fileCount; i++) {
+        QueuedInstance instance;
+        const char* path = filePaths[i] ? filePaths[i] : "";
+        bool ok = !strpbrk(path, "\t\n") && readStoreItem(path, instance.item);
+        instance.item.path = path;
+        job.instances.push_back(instance);
+        readable.push_back(ok);
+    }
+
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    job.id = queue->nextJobID++;
+
+    std::string text = jobLine(job);
+    for (size_t i = 0; i < job.instances.size(); i++) {
+        text += instanceLine(job, i);
+    }
+    appendJournal(queue, text, true);
+
+    for (size_t i = 0; i < job.instances.size(); i++) {
+        if (!readable[i]) {
+            settleInstance(queue, job, i, InstanceState::Failed, "Not a readable DICOM file");
+        }
+    }
+
+    if (outJobID) *outJobID = job.id;
+    queue->jobs[job.id] = std::move(job);
+    queue->wake.notify_all();
+    return DB_STATUS_OK;
+}
+
+DB_Status db_store_queue_job_status(DB_StoreQueue* queue, uint64_t jobID,
+                                    DB_StoreJobStatus* outStatus)
+{
+    if (!queue || !outStatus) return DB_STATUS_ERROR;
+
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    auto it = queue->jobs.find(jobID);
+    if (it == queue->jobs.end()) return DB_STATUS_NOT_FOUND;
+    const StoreJob& job = it->second;
+
+    memset(outStatus, 0, sizeof(*outStatus));
+    outStatus->total = (int)job.instances.size();
+    outStatus->sent = job.sent;
+    outStatus->failed = job.failed;
+    outStatus->pending = job.pending();
+    strncpy(outStatus->lastError, job.lastError.c_str(), sizeof(outStatus->lastError) - 1);
+
+    // Earliest time a pending instance may be sent, in Unix time
+    Clock::time_point next = queue->destinations[job.destination].nextAttempt;
+    if (job.pending() > 0 && next > Clock::now()) {
+        double delay = std::chrono::duration<double>(next - Clock::now()).count();
+        outStatus->nextAttemptTime = std::chrono::duration<double>(
+            std::chrono::system_clock::now().time_since_epoch()).count() + delay;
+    }
+    return DB_STATUS_OK;
+}
+
+int db_store_queue_pending_count(DB_StoreQueue* queue) {
+    if (!queue) return 0;
+
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    int pending = 0;
+    for (const auto& entry : queue->jobs) {
+        pending += entry.second.pending();
+    }
+    return pending;
+}
+
+void db_store_queue_retry_now(DB_StoreQueue* queue) {
+    if (!queue) return;
+
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        for (auto& entry : queue->destinations) {
+            entry.second.nextAttempt = Clock::time_point();
+        }
+        for (auto& entry : queue->jobs) {
+            for (QueuedInstance& instance : entry.second.instances) {
+                instance.notBefore = Clock::time_point();
+            }
+        }
+    }
+    queue->wake.notify_all();
+}
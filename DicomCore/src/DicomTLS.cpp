@@ -0,0 +1,335 @@
+//
+//  DicomTLS.cpp
+//  DicomCore
+//
+//  DICOM TLS for outgoing associations, using dcmtls connections over
+//  OpenSSL. Each configured node keeps one long-lived SSL context and the
+//  latest session it got from the peer, so repeated associations resume
+//  that session instead of doing a full certificate handshake.
+//
+
+#include "DicomBridge.h"
+#include "DicomTLS.hpp"
+#include "DicomNetworkUtils.hpp"
+#include "DicomTransport.hpp"
+#include "dcmtk/config/osconfig.h"
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#ifdef WITH_OPENSSL
+#include "dcmtk/dcmtls/tlstrans.h"
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#endif
+
+namespace dicomcore {
+
+// --- Helper: Registry key of a node ---
+static std::string nodeKey(const DB_DicomNode* node) {
+    return std::string(node->hostname) + ":" + std::to_string(node->port);
+}
+
+#ifdef WITH_OPENSSL
+
+// ========================================================================
+// TLS node
+// ========================================================================
+
+/// TLS settings and session cache of one configured node.
+struct TLSNode {
+    std::string hostname;
+    bool verifyPeer = true;
+    int sessionLifetime = 0;            // Seconds, 0 = no resumption
+    SSL_CTX* context = nullptr;
+
+    std::mutex mutex;
+    SSL_SESSION* session = nullptr;     // Latest session from the peer, owned
+    time_t sessionExpires = 0;
+    int fullHandshakes = 0;
+    int resumedHandshakes = 0;
+
+    TLSNode() = default;
+    TLSNode(const TLSNode&) = delete;
+    TLSNode& operator=(const TLSNode&) = delete;
+
+    ~TLSNode() {
+        if (session) SSL_SESSION_free(session);
+        if (context) SSL_CTX_free(context);
+    }
+
+    /// Session to offer on the next handshake, with a reference the caller
+    /// must free, or nullptr.
+    SSL_SESSION* acquireSession() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (session && time(nullptr) >= sessionExpires) {
+            SSL_SESSION_free(session);
+            session = nullptr;
+        }
+        if (session) SSL_SESSION_up_ref(session);
+        return session;
+    }
+
+    /// Keep a session received from the peer; takes its reference.
+    void storeSession(SSL_SESSION* newSession) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (session) SSL_SESSION_free(session);
+        session = newSession;
+        sessionExpires = time(nullptr) + sessionLifetime;
+    }
+
+    void recordHandshake(bool succeeded, bool resumed) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!succeeded) {
+            // Do not offer a session again that may have caused the failure
+            if (session) SSL_SESSION_free(session);
+            session = nullptr;
+        } else if (resumed) {
+            resumedHandshakes++;
+        } else {
+            fullHandshakes++;
+        }
+    }
+};
+
+// --- Helper: OpenSSL new session callback ---
+// Called after the handshake (TLS 1.2) or when a ticket arrives (TLS 1.3).
+static int onNewSession(SSL* ssl, SSL_SESSION* session) {
+    TLSNode* node = static_cast<TLSNode*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+    if (!node || node->sessionLifetime <= 0) return 0;
+    node->storeSession(session);
+    return 1;   // The reference is ours now
+}
+
+// --- Helper: Last OpenSSL error as text ---
+static std::string sslErrorText(const char* what) {
+    char detail[256] = "";
+    unsigned long code = ERR_get_error();
+    if (code != 0) {
+        ERR_error_string_n(code, detail, sizeof(detail));
+    }
+    ERR_clear_error();
+    return detail[0] ? std::string(what) + ": " + detail : std::string(what);
+}
+
+// ========================================================================
+// Transport
+// ========================================================================
+
+/// dcmtls connection that reports how its handshake went to the node.
+class TLSNodeConnection : public ForwardingConnection {
+public:
+    TLSNodeConnection(DcmTransportConnection* inner, SSL* ssl, std::shared_ptr<TLSNode> node)
+        : ForwardingConnection(inner),
+          ssl(ssl),
+          node(std::move(node)) {}
+
+    DcmTransportLayerStatus clientSideHandshake() override {
+        DcmTransportLayerStatus status = ForwardingConnection::clientSideHandshake();
+        node->recordHandshake(status == TCS_ok, status == TCS_ok && SSL_session_reused(ssl) == 1);
+        return status;
+    }
+
+private:
+    SSL* ssl;                       // Owned by the DcmTLSConnection
+    std::shared_ptr<TLSNode> node;
+};
+
+/// Creates TLS connections to one node, offering its cached session.
+class TLSNodeTransportLayer : public DcmTransportLayer {
+public:
+    explicit TLSNodeTransportLayer(std::shared_ptr<TLSNode> node) : node(std::move(node)) {}
+
+    DcmTransportConnection* createConnection(DcmNativeSocketType openSocket,
+                                             OFBool /* useSecureLayer */) override {
+        SSL* ssl = SSL_new(node->context);
+        if (!ssl) return nullptr;
+
+        if (node->verifyPeer) {
+            // Certificate must name the host we connect to (IP or DNS name)
+            X509_VERIFY_PARAM* param = SSL_get0_param(ssl);
+            if (X509_VERIFY_PARAM_set1_ip_asc(param, node->hostname.c_str()) != 1) {
+                SSL_set_hostflags(ssl, X509_CHECK_FLAG_NO_PARTIAL_WILDCARDS);
+                SSL_set1_host(ssl, node->hostname.c_str());
+            }
+        }
+        SSL_set_tlsext_host_name(ssl, node->hostname.c_str());
+
+        if (SSL_SESSION* session = node->acquireSession()) {
+            SSL_set_session(ssl, session);
+            SSL_SESSION_free(session);
+        }
+
+        SSL_set_fd(ssl, (int)openSocket);
+        return new TLSNodeConnection(new DcmTLSConnection(openSocket, ssl), ssl, node);
+    }
+
+private:
+    std::shared_ptr<TLSNode> node;
+};
+
+// --- Helper: SSL context for a node configuration ---
+static SSL_CTX* createContext(const DB_TLSConfig* config, TLSNode* node, std::string& error) {
+    static std::once_flag initialized;
+    std::call_once(initialized, [] { OPENSSL_init_ssl(0, nullptr); });
+
+    SSL_CTX* context = SSL_CTX_new(TLS_client_method());
+    if (!context) {
+        error = sslErrorText("Cannot create TLS context");
+        return nullptr;
+    }
+
+    // BCP 195: TLS 1.2 or later with strong ciphers only
+    SSL_CTX_set_min_proto_version(context, TLS1_2_VERSION);
+    SSL_CTX_set_cipher_list(context, "HIGH:!aNULL:!eNULL:!MD5:!RC4:!3DES");
+
+    bool ok = true;
+    if (config->certificateFile && config->certificateFile[0]) {
+        std::string password = config->privateKeyPassword ? config->privateKeyPassword : "";
+        SSL_CTX_set_default_passwd_cb_userdata(context, (void*)password.c_str());
+
+        const char* keyFile = config->privateKeyFile && config->privateKeyFile[0]
+            ? config->privateKeyFile : config->certificateFile;
+        if (SSL_CTX_use_certificate_chain_file(context, config->certificateFile) != 1) {
+            error = sslErrorText("Cannot load certificate");
+            ok = false;
+        } else if (SSL_CTX_use_PrivateKey_file(context, keyFile, SSL_FILETYPE_PEM) != 1) {
+            error = sslErrorText("Cannot load private key");
+            ok = false;
+        } else if (SSL_CTX_check_private_key(context) != 1) {
+            error = sslErrorText("Private key does not match certificate");
+            ok = false;
+        }
+        SSL_CTX_set_default_passwd_cb_userdata(context, nullptr);
+    }
+
+    const char* caFile = config->trustedCertificatesFile && config->trustedCertificatesFile[0]
+        ? config->trustedCertificatesFile : nullptr;
+    const char* caDir = config->trustedCertificatesDir && config->trustedCertificatesDir[0]
+        ? config->trustedCertificatesDir : nullptr;
+    if (ok && (caFile || caDir) && SSL_CTX_load_verify_locations(context, caFile, caDir) != 1) {
+        error = sslErrorText("Cannot load trusted certificates");
+        ok = false;
+    }
+    if (ok && config->verifyPeer && !caFile && !caDir) {
+        error = "Peer verification needs trusted certificates";
+        ok = false;
+    }
+
+    if (!ok) {
+        SSL_CTX_free(context);
+        return nullptr;
+    }
+
+    SSL_CTX_set_verify(context, config->verifyPeer ? SSL_VERIFY_PEER : SSL_VERIFY_NONE, nullptr);
+
+    // Sessions are cached per node by onNewSession, not in OpenSSL's store
+    SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(context, onNewSession);
+    SSL_CTX_set_app_data(context, node);
+    if (config->sessionLifetimeSeconds > 0) {
+        SSL_CTX_set_timeout(context, config->sessionLifetimeSeconds);
+    }
+    return context;
+}
+
+#else
+
+struct TLSNode {
+    int fullHandshakes = 0;
+    int resumedHandshakes = 0;
+};
+
+#endif  // WITH_OPENSSL
+
+// ========================================================================
+// Registry
+// ========================================================================
+
+struct TLSRegistry {
+    std::mutex mutex;
+    std::map<std::string, std::shared_ptr<TLSNode>> nodes;
+};
+
+static TLSRegistry& registry() {
+    static TLSRegistry instance;
+    return instance;
+}
+
+static std::shared_ptr<TLSNode> findNode(const DB_DicomNode* node) {
+    TLSRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    auto it = reg.nodes.find(nodeKey(node));
+    return it != reg.nodes.end() ? it->second : nullptr;
+}
+
+DcmTransportLayer* createTLSTransportLayer(const DB_DicomNode* remoteNode) {
+#ifdef WITH_OPENSSL
+    std::shared_ptr<TLSNode> node = findNode(remoteNode);
+    return node ? new TLSNodeTransportLayer(node) : nullptr;
+#else
+    (void)remoteNode;
+    return nullptr;
+#endif
+}
+
+}  // namespace dicomcore
+
+using namespace dicomcore;
+
+// ========================================================================
+// TLS API
+// ========================================================================
+
+DB_NetworkResult db_tls_configure_node(const DB_DicomNode* node, const DB_TLSConfig* config) {
+    if (!node || !config || !node->hostname[0] || node->port <= 0) {
+        return makeResult(DB_STATUS_ERROR, "Invalid parameters");
+    }
+
+#ifdef WITH_OPENSSL
+    auto tlsNode = std::make_shared<TLSNode>();
+    tlsNode->hostname = node->hostname;
+    tlsNode->verifyPeer = config->verifyPeer != 0;
+    tlsNode->sessionLifetime = config->sessionLifetimeSeconds;
+
+    std::string error;
+    tlsNode->context = createContext(config, tlsNode.get(), error);
+    if (!tlsNode->context) {
+        return makeResult(DB_STATUS_ERROR, error.c_str());
+    }
+
+    // Associations already running keep the previous settings
+    TLSRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.nodes[nodeKey(node)] = tlsNode;
+    return makeResult(DB_STATUS_OK);
+#else
+    return makeResult(DB_STATUS_ERROR, "TLS is not available: DCMTK was built without OpenSSL");
+#endif
+}
+
+void db_tls_remove_node(const DB_DicomNode* node) {
+    if (!node) return;
+
+    TLSRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.nodes.erase(nodeKey(node));
+}
+
+DB_Status db_tls_session_stats(const DB_DicomNode* node, DB_TLSSessionStats* outStats) {
+    if (!node || !outStats) return DB_STATUS_ERROR;
+
+    std::shared_ptr<TLSNode> tlsNode = findNode(node);
+    if (!tlsNode) return DB_STATUS_NOT_FOUND;
+
+#ifdef WITH_OPENSSL
+    std::lock_guard<std::mutex> lock(tlsNode->mutex);
+#endif
+    outStats->fullHandshakes = tlsNode->fullHandshakes;
+    outStats->resumedHandshakes = tlsNode->resumedHandshakes;
+    return DB_STATUS_OK;
+}
@@ -0,0 +1,257 @@
+//
+//  DicomThrottle.cpp
+//  DicomCore
+//
+//  Bandwidth throttling of associations with token buckets: one pair
+//  (send, receive) for all traffic and one per limited node. Reads and
+//  writes are charged after they happen, so a throttled reader stops
+//  draining the socket and TCP flow control slows the sender down.
+//
+
+#include "DicomBridge.h"
+#include "DicomThrottle.hpp"
+#include "DicomNetworkStats.hpp"
+#include "DicomTransport.hpp"
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dicomcore {
+
+// Idle credit a bucket may collect, in seconds of its rate
+static const double kBurstSeconds = 0.25;
+
+// Longest a background caller sleeps before checking for interactive callers again
+static const double kYieldSeconds = 0.05;
+
+// ========================================================================
+// TokenBucket
+// ========================================================================
+
+void TokenBucket::setRate(double bytesPerSecond) {
+    std::lock_guard<std::mutex> lock(mutex);
+    refill(Clock::now());
+    rate = std::max(0.0, bytesPerSecond);
+    tokens = std::min(tokens, rate * kBurstSeconds);
+    changed.notify_all();
+}
+
+void TokenBucket::refill(Clock::time_point now) {
+    double elapsed = std::chrono::duration<double>(now - refilled).count();
+    refilled = now;
+    if (rate > 0.0) {
+        tokens = std::min(rate * kBurstSeconds, tokens + elapsed * rate);
+    }
+}
+
+void TokenBucket::acquire(size_t bytes, DB_TrafficClass trafficClass) {
+    std::unique_lock<std::mutex> lock(mutex);
+    bool interactive = trafficClass == DB_TRAFFIC_INTERACTIVE;
+    if (interactive) interactiveWaiting++;
+
+    while (rate > 0.0) {
+        refill(Clock::now());
+        bool yield = !interactive && interactiveWaiting > 0;
+        if (!yield && tokens > 0.0) break;
+
+        // Wait until the debt is paid off, an interactive caller is done
+        // or the rate changes
+        double wait = yield ? kYieldSeconds : std::max(0.001, -tokens / rate);
+        changed.wait_for(lock, std::chrono::duration<double>(wait));
+    }
+    if (rate > 0.0) {
+        tokens -= (double)bytes;
+    }
+
+    if (interactive) {
+        interactiveWaiting--;
+        changed.notify_all();
+    }
+}
+
+// ========================================================================
+// Registry
+// ========================================================================
+
+namespace {
+
+struct BucketPair {
+    std::shared_ptr<TokenBucket> send = std::make_shared<TokenBucket>();
+    std::shared_ptr<TokenBucket> receive = std::make_shared<TokenBucket>();
+    DB_BandwidthLimit limit = { 0.0, 0.0 };
+
+    void setLimit(const DB_BandwidthLimit& newLimit) {
+        limit = newLimit;
+        send->setRate(limit.sendBytesPerSecond);
+        receive->setRate(limit.receiveBytesPerSecond);
+    }
+};
+
+struct ThrottleRegistry {
+    std::mutex mutex;
+    BucketPair global;
+    std::map<std::string, BucketPair> nodes;    // By host:port
+};
+
+ThrottleRegistry& registry() {
+    static ThrottleRegistry instance;
+    return instance;
+}
+
+thread_local DB_TrafficClass threadClass = DB_TRAFFIC_AUTO;
+
+std::string nodeKey(const DB_DicomNode* node) {
+    return std::string(node->hostname) + ":" + std::to_string(node->port);
+}
+
+bool isValidLimit(const DB_BandwidthLimit* limit) {
+    return !limit || (limit->sendBytesPerSecond >= 0.0 && limit->receiveBytesPerSecond >= 0.0);
+}
+
+// --- Helper: Traffic class of connections opened now ---
+DB_TrafficClass currentTrafficClass() {
+    if (threadClass != DB_TRAFFIC_AUTO) return threadClass;
+
+    // Queries and retrieves wait on a user; uploads, including the store
+    // queue's, can take what is left
+    NetworkOperation* operation = NetworkOperation::current();
+    if (!operation) return DB_TRAFFIC_BACKGROUND;
+    switch (operation->kind()) {
+        case DB_NET_OP_ECHO:
+        case DB_NET_OP_FIND:
+        case DB_NET_OP_GET:
+        case DB_NET_OP_MOVE:
+            return DB_TRAFFIC_INTERACTIVE;
+        case DB_NET_OP_STORE:
+            break;
+    }
+    return DB_TRAFFIC_BACKGROUND;
+}
+
+using Buckets = std::vector<std::shared_ptr<TokenBucket>>;
+
+/// Charges every read and write to its buckets.
+class ThrottledConnection : public ForwardingConnection {
+public:
+    ThrottledConnection(DcmTransportConnection* inner, Buckets send, Buckets receive,
+                        DB_TrafficClass trafficClass)
+        : ForwardingConnection(inner),
+          send(std::move(send)),
+          receive(std::move(receive)),
+          trafficClass(trafficClass) {}
+
+    ssize_t read(void* buf, size_t nbyte) override {
+        ssize_t count = ForwardingConnection::read(buf, nbyte);
+        if (count > 0) charge(receive, (size_t)count);
+        return count;
+    }
+
+    ssize_t write(void* buf, size_t nbyte) override {
+        ssize_t count = ForwardingConnection::write(buf, nbyte);
+        if (count > 0) charge(send, (size_t)count);
+        return count;
+    }
+
+private:
+    void charge(const Buckets& buckets, size_t bytes) {
+        for (const std::shared_ptr<TokenBucket>& bucket : buckets) {
+            bucket->acquire(bytes, trafficClass);
+        }
+    }
+
+    Buckets send;
+    Buckets receive;
+    DB_TrafficClass trafficClass;
+};
+
+class ThrottledTransportLayer : public StackedTransportLayer {
+public:
+    ThrottledTransportLayer(DcmTransportLayer* inner, Buckets send, Buckets receive,
+                            DB_TrafficClass trafficClass)
+        : StackedTransportLayer(inner),
+          send(std::move(send)),
+          receive(std::move(receive)),
+          trafficClass(trafficClass) {}
+
+protected:
+    DcmTransportConnection* wrap(DcmTransportConnection* connection) override {
+        return new ThrottledConnection(connection, send, receive, trafficClass);
+    }
+
+private:
+    Buckets send;
+    Buckets receive;
+    DB_TrafficClass trafficClass;
+};
+
+// --- Helper: Add the limited buckets of a pair ---
+void collectBuckets(const BucketPair& pair, Buckets& send, Buckets& receive) {
+    if (pair.limit.sendBytesPerSecond > 0.0) send.push_back(pair.send);
+    if (pair.limit.receiveBytesPerSecond > 0.0) receive.push_back(pair.receive);
+}
+
+}  // namespace
+
+DcmTransportLayer* createThrottledTransportLayer(const DB_DicomNode* remoteNode,
+                                                 DcmTransportLayer* inner) {
+    Buckets send;
+    Buckets receive;
+    {
+        ThrottleRegistry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        auto it = reg.nodes.find(nodeKey(remoteNode));
+        if (it != reg.nodes.end()) {
+            collectBuckets(it->second, send, receive);
+        }
+        collectBuckets(reg.global, send, receive);
+    }
+
+    if (send.empty() && receive.empty()) return inner;
+    return new ThrottledTransportLayer(inner, std::move(send), std::move(receive),
+                                       currentTrafficClass());
+}
+
+}  // namespace dicomcore
+
+using namespace dicomcore;
+
+// ========================================================================
+// Throttling API
+// ========================================================================
+
+DB_Status db_throttle_set_global_limit(const DB_BandwidthLimit* limit) {
+    if (!isValidLimit(limit)) return DB_STATUS_ERROR;
+
+    ThrottleRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.global.setLimit(limit ? *limit : DB_BandwidthLimit{ 0.0, 0.0 });
+    return DB_STATUS_OK;
+}
+
+DB_Status db_throttle_set_node_limit(const DB_DicomNode* node, const DB_BandwidthLimit* limit) {
+    if (!node || !node->hostname[0] || node->port <= 0 || !isValidLimit(limit)) {
+        return DB_STATUS_ERROR;
+    }
+
+    ThrottleRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    std::string key = nodeKey(node);
+    if (limit) {
+        reg.nodes[key].setLimit(*limit);
+        return DB_STATUS_OK;
+    }
+
+    // Release associations still holding the node's buckets
+    auto it = reg.nodes.find(key);
+    if (it != reg.nodes.end()) {
+        it->second.setLimit(DB_BandwidthLimit{ 0.0, 0.0 });
+        reg.nodes.erase(it);
+    }
+    return DB_STATUS_OK;
+}
+
+void db_throttle_set_thread_class(DB_TrafficClass trafficClass) {
+    threadClass = trafficClass;
+}
@@ -0,0 +1,311 @@
+//
+//  DicomTranscode.cpp
+//  DicomCore
+//
+//  Conversion between transfer syntaxes: uncompressed, JPEG Lossless,
+//  JPEG-LS and RLE. Pixel data is re-encoded one frame at a time and the
+//  rest of the dataset is written as it was read.
+//
+
+#include "DicomBridge.h"
+#include "DicomCodecs.hpp"
+#include "DicomFileSync.hpp"
+#include "DicomTranscode.hpp"
+#include "DicomWorkPool.hpp"
+#include "dcmtk/dcmdata/dcuid.h"
+#include "dcmtk/dcmjpeg/djrplol.h"
+#include "dcmtk/dcmjpls/djrparam.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace dicomcore;
+
+namespace dicomcore {
+
+bool resolveTarget(const DB_TranscodeOptions& options, TargetSyntax& target) {
+    switch (options.transferSyntax) {
+    case DB_TRANSFER_SYNTAX_EXPLICIT_LITTLE:
+        target.xfer = EXS_LittleEndianExplicit;
+        return true;
+    case DB_TRANSFER_SYNTAX_JPEG_LOSSLESS:
+        // First-order prediction, no point transform
+        target.xfer = EXS_JPEGProcess14SV1;
+        target.parameter.reset(new DJ_RPLossless(1, 0));
+        return true;
+    case DB_TRANSFER_SYNTAX_JPEG_LS_LOSSLESS:
+        target.xfer = EXS_JPEGLSLossless;
+        target.parameter.reset(new DJLSRepresentationParameter(0, OFTrue));
+        return true;
+    case DB_TRANSFER_SYNTAX_JPEG_LS_NEAR_LOSSLESS: {
+        if (options.nearLosslessError < 0 || options.nearLosslessError > 255) {
+            return false;
+        }
+        Uint16 nearError = options.nearLosslessError > 0 ? (Uint16)options.nearLosslessError : 2;
+        target.xfer = EXS_JPEGLSLossy;
+        target.parameter.reset(new DJLSRepresentationParameter(nearError, OFFalse));
+        target.lossy = true;
+        return true;
+    }
+    case DB_TRANSFER_SYNTAX_RLE:
+        target.xfer = EXS_RLELossless;
+        return true;
+    }
+    return false;
+}
+
+}  // namespace dicomcore
+
+// ========================================================================
+// Pixel Data
+// ========================================================================
+
+// --- Helper: Replace PixelData and what describes its encoding ---
+static DB_Status replacePixelData(DcmDataset* dataset, DcmPixelData* pixelData,
+                                  const OFString& photometric, Uint16 planar, uint16_t samplesPerPixel) {
+    if (dataset->insert(pixelData, OFTrue).bad()) {
+        delete pixelData;
+        return DB_STATUS_ERROR;
+    }
+    dataset->putAndInsertString(DCM_PhotometricInterpretation, photometric.c_str());
+    if (samplesPerPixel > 1) {
+        dataset->putAndInsertUint16(DCM_PlanarConfiguration, planar);
+    }
+    dataset->findAndDeleteElement(DcmTagKey(0x7FE0, 0x0001));   // Extended Offset Table
+    dataset->findAndDeleteElement(DcmTagKey(0x7FE0, 0x0002));   // Extended Offset Table Lengths
+    return DB_STATUS_OK;
+}
+
+/// Compress every frame of dataset into target on its own and gather the
+/// fragments into one pixel sequence, indexed by a Basic Offset Table.
+/// Only one frame is decoded at a time. ratio: uncompressed size over
+/// compressed size.
+static DB_Status encodeFrames(DcmDataset* dataset, const TargetSyntax& target, double& ratio) {
+    FrameAccess access;
+    if (!access.open(dataset, false)) {
+        return DB_STATUS_ERROR;
+    }
+    const FrameLayout& layout = access.layout();
+
+    std::unique_ptr<DcmPixelSequence> sequence(new DcmPixelSequence(DcmTag(DCM_PixelSequenceTag)));
+    DcmPixelItem* table = new DcmPixelItem(DcmTag(DCM_Item, EVR_OB));
+    sequence->insert(table);
+
+    std::vector<uint64_t> frameOffsets;
+    uint64_t offset = 0;            // From the end of the offset table
+    uint64_t encodedBytes = 0;
+    OFString photometric;
+    Uint16 planar = 0;
+    for (uint32_t index = 0; index < layout.frameCount; index++) {
+        const uint8_t* pixels = access.frame(index);
+        DcmDataset frameSet;
+        DcmPixelSequence* encoded = nullptr;
+        if (!pixels || !encodeFrame(layout, pixels, target.xfer, target.parameter.get(), frameSet, encoded)) {
+            return DB_STATUS_ERROR;
+        }
+
+        // The dataset describes every frame, so they must all come out of
+        // the encoder in the same color space
+        OFString framePhotometric;
+        frameSet.findAndGetOFString(DCM_PhotometricInterpretation, framePhotometric);
+        if (index == 0) {
+            photometric = framePhotometric;
+            frameSet.findAndGetUint16(DCM_PlanarConfiguration, planar);
+        } else if (framePhotometric != photometric) {
+            return DB_STATUS_ERROR;
+        }
+
+        frameOffsets.push_back(offset);
+        while (encoded->card() > 1) {
+            DcmPixelItem* item = nullptr;
+            if (encoded->remove(item, 1).bad()) {
+                return DB_STATUS_ERROR;
+            }
+            offset += 8 + (uint64_t)item->getLength();
+            encodedBytes += item->getLength();
+            sequence->insert(item);
+        }
+    }
+
+    // Offsets are 32-bit; past 4 GB the table stays empty and readers
+    // walk the fragments
+    if (!frameOffsets.empty() && frameOffsets.back() <= UINT32_MAX) {
+        std::vector<Uint8> bytes(frameOffsets.size() * 4);
+        for (size_t i = 0; i < frameOffsets.size(); i++) {
+            for (int b = 0; b < 4; b++) {
+                bytes[i * 4 + b] = (Uint8)(frameOffsets[i] >> (8 * b));
+            }
+        }
+        table->putUint8Array(bytes.data(), (unsigned long)bytes.size());
+    }
+
+    ratio = encodedBytes > 0 ? (double)layout.frameBytes() * layout.frameCount / (double)encodedBytes : 1.0;
+    DcmPixelData* pixelData = new DcmPixelData(DCM_PixelData);
+    pixelData->putOriginalRepresentation(target.xfer, target.parameter.get(), sequence.release());
+    return replacePixelData(dataset, pixelData, photometric, planar, layout.samplesPerPixel);
+}
+
+/// Decompress every frame of dataset into one native PixelData value, a
+/// frame at a time.
+static DB_Status decodeFrames(DcmDataset* dataset) {
+    FrameAccess access;
+    if (!access.open(dataset, false)) {
+        return DB_STATUS_ERROR;
+    }
+    const FrameLayout& layout = access.layout();
+    size_t frameBytes = layout.frameBytes();
+    uint64_t totalBytes = (uint64_t)frameBytes * layout.frameCount;
+    if (totalBytes >= UINT32_MAX) {
+        return DB_STATUS_ERROR;     // Longer than a native value can be
+    }
+
+    std::unique_ptr<DcmPixelData> pixelData(new DcmPixelData(DCM_PixelData));
+    uint8_t* pixels = nullptr;
+    if (layout.bitsAllocated == 8) {
+        Uint8* bytes = nullptr;
+        if (pixelData->createUint8Array((Uint32)totalBytes, bytes).bad()) return DB_STATUS_ERROR;
+        pixels = bytes;
+    } else {
+        Uint16* words = nullptr;
+        if (pixelData->createUint16Array((Uint32)(totalBytes / 2), words).bad()) return DB_STATUS_ERROR;
+        pixels = reinterpret_cast<uint8_t*>(words);
+    }
+    for (uint32_t index = 0; index < layout.frameCount; index++) {
+        const uint8_t* frame = access.frame(index);
+        if (!frame) {
+            return DB_STATUS_ERROR;
+        }
+        memcpy(pixels + (size_t)index * frameBytes, frame, frameBytes);
+    }
+
+    OFString photometric(layout.photometric.c_str());
+    return replacePixelData(dataset, pixelData.release(), photometric, layout.planar ? 1 : 0,
+                            layout.samplesPerPixel);
+}
+
+// --- Helper: Record a lossy compression (PS3.3 C.7.6.1.1.5) ---
+// Earlier lossy steps keep their ratio and method; the result is a new
+// instance, since its pixels are no longer those of the original.
+static void markLossy(DcmFileFormat& fileFormat, double ratio) {
+    DcmDataset* dataset = fileFormat.getDataset();
+    OFString ratios;
+    OFString methods;
+    dataset->findAndGetOFStringArray(DCM_LossyImageCompressionRatio, ratios);
+    dataset->findAndGetOFStringArray(DCM_LossyImageCompressionMethod, methods);
+    char value[32];
+    snprintf(value, sizeof(value), "%.4g", ratio);
+    ratios += ratios.empty() ? value : (OFString("\\") + value);
+    methods += methods.empty() ? "ISO_14495_1" : "\\ISO_14495_1";
+    dataset->putAndInsertString(DCM_LossyImageCompression, "01");
+    dataset->putAndInsertOFStringArray(DCM_LossyImageCompressionRatio, ratios);
+    dataset->putAndInsertOFStringArray(DCM_LossyImageCompressionMethod, methods);
+
+    char uid[100];
+    dcmGenerateUniqueIdentifier(uid, SITE_INSTANCE_UID_ROOT);
+    dataset->putAndInsertString(DCM_SOPInstanceUID, uid);
+    DcmMetaInfo* metaInfo = fileFormat.getMetaInfo();
+    if (metaInfo && metaInfo->tagExists(DCM_MediaStorageSOPInstanceUID)) {
+        metaInfo->putAndInsertString(DCM_MediaStorageSOPInstanceUID, uid);
+    }
+}
+
+// ========================================================================
+// Files
+// ========================================================================
+
+namespace dicomcore {
+
+DB_Status transcodeFile(const char* inputPath, const char* outputPath, const TargetSyntax& target) {
+    if (!inputPath || !outputPath) {
+        return DB_STATUS_ERROR;
+    }
+    // Values longer than DCM_MaxReadLength, PixelData and its fragments
+    // among them, stay in the file until read
+    DcmFileFormat fileFormat;
+    if (fileFormat.loadFile(inputPath).bad()) {
+        return DB_STATUS_NOT_FOUND;
+    }
+    DcmDataset* dataset = fileFormat.getDataset();
+    if (!dataset) {
+        return DB_STATUS_ERROR;
+    }
+
+    E_TransferSyntax source = dataset->getOriginalXfer();
+    bool targetEncapsulated = DcmXfer(target.xfer).isEncapsulated();
+    E_TransferSyntax written = target.xfer;
+    DB_Status status = DB_STATUS_OK;
+    if (!dataset->tagExists(DCM_PixelData)) {
+        // Compressed syntaxes only concern pixel data
+        if (targetEncapsulated) {
+            written = EXS_LittleEndianExplicit;
+        }
+    } else if (source != target.xfer) {
+        if (targetEncapsulated) {
+            double ratio = 1.0;
+            status = encodeFrames(dataset, target, ratio);
+            if (status == DB_STATUS_OK && target.lossy) {
+                markLossy(fileFormat, ratio);
+            }
+        } else if (DcmXfer(source).isEncapsulated()) {
+            status = decodeFrames(dataset);
+        }
+        // Native to native only changes the byte encoding, which saving does
+    }
+
+    // Written beside the output and renamed over it, so the input can be
+    // its own output
+    std::string tempPath = replacementPath(outputPath);
+    if (status == DB_STATUS_OK &&
+        (fileFormat.saveFile(tempPath.c_str(), written).bad() || !replaceFile(tempPath, outputPath))) {
+        status = DB_STATUS_ERROR;
+    }
+    if (status != DB_STATUS_OK) {
+        remove(tempPath.c_str());
+    }
+    return status;
+}
+
+}  // namespace dicomcore
+
+DB_Status db_transcode_files(const char* const* inputPaths,
+                             const char* const* outputPaths,
+                             int fileCount,
+                             const DB_TranscodeOptions* options,
+                             DB_Status* outStatuses,
+                             DB_TranscodeProgressCallback onProgress,
+                             void* userData) {
+    if (!inputPaths || !outputPaths || fileCount < 0 || !options) {
+        return DB_STATUS_ERROR;
+    }
+    TargetSyntax target;
+    if (!resolveTarget(*options, target)) {
+        return DB_STATUS_ERROR;
+    }
+    registerCodecs();
+
+    std::mutex progressMutex;
+    int filesDone = 0;
+    int failures = 0;
+
+    parallelFor((size_t)fileCount, options->threadCount, [&](size_t index) {
+        DB_Status status = transcodeFile(inputPaths[index], outputPaths[index], target);
+        if (outStatuses) {
+            outStatuses[index] = status;
+        }
+
+        std::lock_guard<std::mutex> lock(progressMutex);
+        filesDone++;
+        if (status != DB_STATUS_OK) {
+            failures++;
+        }
+        if (onProgress) {
+            onProgress(userData, filesDone, fileCount, (int)index, status);
+        }
+    });
+
+    return failures == 0 ? DB_STATUS_OK : DB_STATUS_ERROR;
+}
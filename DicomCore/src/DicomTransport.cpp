@@ -0,0 +1,130 @@
+//
+//  DicomTransport.cpp
+//  DicomCore
+//
+//  Transport connections and layers stacked over DCMTK's.
+//
+
+#include "DicomTransport.hpp"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace dicomcore {
+
+// ========================================================================
+// ForwardingConnection
+// ========================================================================
+
+ForwardingConnection::ForwardingConnection(DcmTransportConnection* inner)
+    : DcmTransportConnection(inner->getSocket()),
+      inner(inner) {}
+
+ForwardingConnection::~ForwardingConnection() {
+    delete inner;
+}
+
+DcmTransportLayerStatus ForwardingConnection::serverSideHandshake() {
+    return inner->serverSideHandshake();
+}
+
+DcmTransportLayerStatus ForwardingConnection::clientSideHandshake() {
+    return inner->clientSideHandshake();
+}
+
+DcmTransportLayerStatus ForwardingConnection::renegotiate(const char* newSuite) {
+    return inner->renegotiate(newSuite);
+}
+
+ssize_t ForwardingConnection::read(void* buf, size_t nbyte) {
+    return inner->read(buf, nbyte);
+}
+
+ssize_t ForwardingConnection::write(void* buf, size_t nbyte) {
+    return inner->write(buf, nbyte);
+}
+
+void ForwardingConnection::close() {
+    inner->close();
+}
+
+unsigned long ForwardingConnection::getPeerCertificateLength() {
+    return inner->getPeerCertificateLength();
+}
+
+unsigned long ForwardingConnection::getPeerCertificate(void* buf, unsigned long bufLen) {
+    return inner->getPeerCertificate(buf, bufLen);
+}
+
+OFBool ForwardingConnection::networkDataAvailable(int timeout) {
+    return inner->networkDataAvailable(timeout);
+}
+
+OFBool ForwardingConnection::isTransparentConnection() {
+    return inner->isTransparentConnection();
+}
+
+OFString& ForwardingConnection::dumpConnectionParameters(OFString& str) {
+    return inner->dumpConnectionParameters(str);
+}
+
+const char* ForwardingConnection::errorString(DcmTransportLayerStatus code) {
+    return inner->errorString(code);
+}
+
+// ========================================================================
+// PacedConnection
+// ========================================================================
+
+static double monotonicSeconds() {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+PacedConnection::PacedConnection(DcmTransportConnection* inner, double bytesPerSecond)
+    : ForwardingConnection(inner),
+      bytesPerSecond(bytesPerSecond),
+      linkFreeAt(0.0) {}
+
+void PacedConnection::pace(size_t bytes) {
+    if (bytesPerSecond <= 0.0) return;
+
+    // Both directions share the link. An idle link earns no credit.
+    double now = monotonicSeconds();
+    linkFreeAt = std::max(linkFreeAt, now) + bytes / bytesPerSecond;
+    std::this_thread::sleep_for(std::chrono::duration<double>(linkFreeAt - now));
+}
+
+ssize_t PacedConnection::read(void* buf, size_t nbyte) {
+    ssize_t count = ForwardingConnection::read(buf, nbyte);
+    if (count > 0) pace((size_t)count);
+    return count;
+}
+
+ssize_t PacedConnection::write(void* buf, size_t nbyte) {
+    ssize_t count = ForwardingConnection::write(buf, nbyte);
+    if (count > 0) pace((size_t)count);
+    return count;
+}
+
+DcmTransportConnection* PacedTransportLayer::wrap(DcmTransportConnection* connection) {
+    return new PacedConnection(connection, bytesPerSecond);
+}
+
+// ========================================================================
+// StackedTransportLayer
+// ========================================================================
+
+StackedTransportLayer::~StackedTransportLayer() {
+    delete inner;
+}
+
+DcmTransportConnection* StackedTransportLayer::createConnection(DcmNativeSocketType openSocket,
+                                                               OFBool useSecureLayer) {
+    DcmTransportConnection* connection = inner
+        ? inner->createConnection(openSocket, useSecureLayer)
+        : new DcmTCPConnection(openSocket);
+    return connection ? wrap(connection) : nullptr;
+}
+
+}  // namespace dicomcore
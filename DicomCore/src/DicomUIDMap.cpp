@@ -0,0 +1,161 @@
+//
+//  DicomUIDMap.cpp
+//  DicomCore
+//
+//  Batch-scoped UID map. Persisted maps are a tab separated file of
+//  original and replacement UIDs, appended to as UIDs are assigned.
+//
+
+#include "DicomBridge.h"
+#include "DicomUIDMap.hpp"
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/dcmdata/dcuid.h"
+#include <cstring>
+#include <functional>
+#include <memory>
+
+#include <unistd.h>
+
+using namespace dicomcore;
+
+static const char* kMapHeader = "DBUIDMAP\t1";
+
+namespace dicomcore {
+
+UIDMap::~UIDMap() {
+    if (file) {
+        sync();
+        fclose(file);
+    }
+}
+
+bool UIDMap::open(const std::string& path) {
+    FILE* existing = fopen(path.c_str(), "r");
+    bool hasHeader = false;
+    if (existing) {
+        char line[256];
+        if (fgets(line, sizeof(line), existing)) {
+            line[strcspn(line, "\r\n")] = '\0';
+            if (strcmp(line, kMapHeader) != 0) {
+                fclose(existing);
+                return false;
+            }
+            hasHeader = true;
+        }
+        // A torn last line (crash mid-append) has no tab and is skipped
+        while (fgets(line, sizeof(line), existing)) {
+            line[strcspn(line, "\r\n")] = '\0';
+            char* tab = strchr(line, '\t');
+            if (!tab || tab[1] == '\0') continue;
+            *tab = '\0';
+            std::string original(line);
+            shardFor(original).uids[original] = tab + 1;
+        }
+        fclose(existing);
+    }
+
+    file = fopen(path.c_str(), "a");
+    if (!file) return false;
+    if (!hasHeader) {
+        fprintf(file, "%s\n", kMapHeader);
+        fflush(file);
+    }
+    return true;
+}
+
+UIDMap::Shard& UIDMap::shardFor(const std::string& original) {
+    return shards[std::hash<std::string>()(original) % kShardCount];
+}
+
+std::string UIDMap::map(const std::string& original,
+                        const std::function<std::string(const std::string&)>& assign) {
+    Shard& shard = shardFor(original);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.uids.find(original);
+    if (it != shard.uids.end()) {
+        return it->second;
+    }
+
+    std::string uid;
+    if (assign) {
+        uid = assign(original);
+    } else {
+        char generated[100];
+        dcmGenerateUniqueIdentifier(generated, SITE_INSTANCE_UID_ROOT);
+        uid = generated;
+    }
+    shard.uids[original] = uid;
+
+    if (file) {
+        std::lock_guard<std::mutex> fileLock(fileMutex);
+        fprintf(file, "%s\t%s\n", original.c_str(), uid.c_str());
+        fflush(file);
+    }
+    return uid;
+}
+
+bool UIDMap::find(const std::string& original, std::string& replacement) {
+    Shard& shard = shardFor(original);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.uids.find(original);
+    if (it == shard.uids.end()) return false;
+    replacement = it->second;
+    return true;
+}
+
+size_t UIDMap::size() {
+    size_t count = 0;
+    for (Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        count += shard.uids.size();
+    }
+    return count;
+}
+
+void UIDMap::sync() {
+    std::lock_guard<std::mutex> lock(fileMutex);
+    if (file) {
+        fflush(file);
+        fsync(fileno(file));
+    }
+}
+
+bool isStandardUID(const char* uid) {
+    return strncmp(uid, "1.2.840.10008.", 14) == 0;
+}
+
+}  // namespace dicomcore
+
+// ========================================================================
+// UID Map API
+// ========================================================================
+
+DB_UIDMap* db_uid_map_create(const char* persistPath) {
+    std::unique_ptr<DB_UIDMap> uidMap(new DB_UIDMap());
+    if (persistPath && !uidMap->map.open(persistPath)) {
+        return nullptr;
+    }
+    return uidMap.release();
+}
+
+void db_uid_map_destroy(DB_UIDMap* uidMap) {
+    delete uidMap;
+}
+
+DB_Status db_uid_map_get(DB_UIDMap* uidMap,
+                         const char* originalUID,
+                         char* outUID,
+                         size_t outSize) {
+    if (!uidMap || !originalUID || !originalUID[0] || !outUID || outSize < 65) {
+        return DB_STATUS_ERROR;
+    }
+
+    std::string replacement = uidMap->map.map(originalUID);
+    strncpy(outUID, replacement.c_str(), outSize - 1);
+    outUID[outSize - 1] = '\0';
+    return DB_STATUS_OK;
+}
+
+int db_uid_map_count(DB_UIDMap* uidMap) {
+    return uidMap ? (int)uidMap->map.size() : 0;
+}
@@ -0,0 +1,47 @@
+//
+//  DicomWorkPool.cpp
+//  DicomCore
+//
+//  Fan-out of independent per-file work over a fixed set of threads.
+//
+
+#include "DicomWorkPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace dicomcore {
+
+int resolveThreadCount(int threadCount) {
+    if (threadCount > 0) return threadCount;
+    unsigned int cores = std::thread::hardware_concurrency();
+    return cores > 0 ? (int)cores : 4;
+}
+
+void parallelFor(size_t count, int threadCount,
+                 const std::function<void(size_t)>& body)
+{
+    if (count == 0) return;
+
+    size_t workers = std::min((size_t)resolveThreadCount(threadCount), count);
+    std::atomic<size_t> next{0};
+    auto run = [&] {
+        for (size_t index = next++; index < count; index = next++) {
+            body(index);
+        }
+    };
+
+    // The calling thread is one of the workers
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (size_t i = 1; i < workers; i++) {
+        threads.emplace_back(run);
+    }
+    run();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+}  // namespace dicomcore
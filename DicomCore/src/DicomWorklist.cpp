@@ -0,0 +1,642 @@
+//
+//  DicomWorklist.cpp
+//  DicomCore
+//
+//  Modality Worklist C-FIND client. The poller keeps the last result set
+//  with a hash per item and reports only what was added, changed or
+//  removed. Most polls cover today's scheduled date only; every Nth poll
+//  covers the whole window. Also the MPPS N-CREATE/N-SET client that
+//  reports a scheduled step as performed.
+//
+
+#include "DicomBridge.h"
+#include "DicomNetworkUtils.hpp"
+#include "DicomNetworkStats.hpp"
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/dcmnet/dimse.h"
+#include "dcmtk/dcmnet/assoc.h"
+#include "dcmtk/dcmdata/dcdeftag.h"
+#include "dcmtk/dcmdata/dcuid.h"
+#include "dcmtk/dcmdata/dcdatset.h"
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace dicomcore;
+
+struct DB_WorklistPoller {
+    struct Known {
+        DB_WorklistItem item;
+        uint64_t hash;
+    };
+
+    std::string localAE;
+    DB_DicomNode node;
+    DB_WorklistQuery query;
+    int timeoutSeconds;
+
+    std::mutex mutex;
+    std::map<std::string, Known> items;     // By procedure step key
+    int polls = 0;
+};
+
+namespace {
+
+// Local calendar date `dayOffset` days from today, as YYYYMMDD.
+std::string localDate(int dayOffset) {
+    time_t now = time(nullptr);
+    struct tm local;
+    localtime_r(&now, &local);
+    local.tm_mday += dayOffset;
+    local.tm_hour = 12;     // Stay clear of DST transitions
+    mktime(&local);
+
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%04d%02d%02d",
+             local.tm_year + 1900, local.tm_mon + 1, local.tm_mday);
+    return buf;
+}
+
+// --- Helper: Copy a string value into a fixed field ---
+void copyValue(DcmItem* item, const DcmTagKey& tag, char* out, size_t size) {
+    OFString value;
+    if (item && item->findAndGetOFString(tag, value).good()) {
+        strncpy(out, value.c_str(), size - 1);
+        out[size - 1] = '\0';
+    }
+}
+
+// --- Helper: Build the MWL C-FIND identifier ---
+void buildWorklistRequest(const DB_WorklistQuery& query, const std::string& dateRange,
+                          DcmDataset& request) {
+    request.putAndInsertString(DCM_PatientName, "");
+    request.putAndInsertString(DCM_PatientID, "");
+    request.putAndInsertString(DCM_PatientBirthDate, "");
+    request.putAndInsertString(DCM_PatientSex, "");
+    request.putAndInsertString(DCM_AccessionNumber, "");
+    request.putAndInsertString(DCM_StudyInstanceUID, "");
+    request.putAndInsertString(DCM_ReferringPhysicianName, "");
+    request.putAndInsertString(DCM_RequestedProcedureID, "");
+    request.putAndInsertString(DCM_RequestedProcedureDescription, "");
+
+    DcmItem* step = nullptr;
+    if (request.findOrCreateSequenceItem(DCM_ScheduledProcedureStepSequence, step).good()) {
+        std::string station(query.scheduledStationAETitle,
+                            strnlen(query.scheduledStationAETitle, sizeof(query.scheduledStationAETitle)));
+        std::string modality(query.modality, strnlen(query.modality, sizeof(query.modality)));
+        step->putAndInsertString(DCM_ScheduledStationAETitle, station.c_str());
+        step->putAndInsertString(DCM_ScheduledProcedureStepStartDate, dateRange.c_str());
+        step->putAndInsertString(DCM_ScheduledProcedureStepStartTime, "");
+        step->putAndInsertString(DCM_Modality, modality.c_str());
+        step->putAndInsertString(DCM_ScheduledPerformingPhysicianName, "");
+        step->putAndInsertString(DCM_ScheduledProcedureStepDescription, "");
+        step->putAndInsertString(DCM_ScheduledProcedureStepID, "");
+        step->putAndInsertString(DCM_ScheduledProcedureStepStatus, "");
+    }
+}
+
+void extractWorklistItem(DcmDataset* identifiers, DB_WorklistItem& item) {
+    memset(&item, 0, sizeof(item));
+    copyValue(identifiers, DCM_PatientName, item.patientName, sizeof(item.patientName));
+    copyValue(identifiers, DCM_PatientID, item.patientID, sizeof(item.patientID));
+    copyValue(identifiers, DCM_PatientBirthDate, item.birthDate, sizeof(item.birthDate));
+    copyValue(identifiers, DCM_PatientSex, item.patientSex, sizeof(item.patientSex));
+    copyValue(identifiers, DCM_AccessionNumber, item.accessionNumber, sizeof(item.accessionNumber));
+    copyValue(identifiers, DCM_StudyInstanceUID, item.studyInstanceUID, sizeof(item.studyInstanceUID));
+    copyValue(identifiers, DCM_ReferringPhysicianName, item.referringPhysician,
+              sizeof(item.referringPhysician));
+    copyValue(identifiers, DCM_RequestedProcedureID, item.requestedProcedureID,
+              sizeof(item.requestedProcedureID));
+    copyValue(identifiers, DCM_RequestedProcedureDescription, item.requestedProcedureDescription,
+              sizeof(item.requestedProcedureDescription));
+
+    DcmItem* step = nullptr;
+    if (identifiers->findAndGetSequenceItem(DCM_ScheduledProcedureStepSequence, step).good()) {
+        copyValue(step, DCM_ScheduledStationAETitle, item.scheduledStationAETitle,
+                  sizeof(item.scheduledStationAETitle));
+        copyValue(step, DCM_ScheduledProcedureStepStartDate, item.scheduledStartDate,
+                  sizeof(item.scheduledStartDate));
+        copyValue(step, DCM_ScheduledProcedureStepStartTime, item.scheduledStartTime,
+                  sizeof(item.scheduledStartTime));
+        copyValue(step, DCM_Modality, item.modality, sizeof(item.modality));
+        copyValue(step, DCM_ScheduledPerformingPhysicianName, item.performingPhysician,
+                  sizeof(item.performingPhysician));
+        copyValue(step, DCM_ScheduledProcedureStepDescription, item.stepDescription,
+                  sizeof(item.stepDescription));
+        copyValue(step, DCM_ScheduledProcedureStepID, item.stepID, sizeof(item.stepID));
+        copyValue(step, DCM_ScheduledProcedureStepStatus, item.stepStatus, sizeof(item.stepStatus));
+    }
+}
+
+// Identity of a scheduled procedure step across polls. SCPs that return
+// none of the step's identifiers are keyed by patient and start instead,
+// or every such step would collapse into one.
+std::string itemKey(const DB_WorklistItem& item) {
+    std::string key = std::string(item.stepID) + "|" + item.requestedProcedureID + "|" +
+                      item.accessionNumber + "|" + item.studyInstanceUID;
+    if (key == "|||") {
+        key += std::string("|") + item.patientID + "|" + item.scheduledStartDate + "|" +
+               item.scheduledStartTime + "|" + item.scheduledStationAETitle + "|" + item.modality;
+    }
+    return key;
+}
+
+// FNV-1a over every field, so any changed value changes the hash. Items
+// are zero-filled before extraction, so the bytes past each value match.
+uint64_t itemHash(const DB_WorklistItem& item) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&item);
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < sizeof(item); i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+struct WorklistFindContext {
+    std::vector<DB_WorklistItem> items;
+};
+
+void worklistFindCallback(
+    void* callbackData,
+    T_DIMSE_C_FindRQ* /* request */,
+    int /* responseCount */,
+    T_DIMSE_C_FindRSP* rsp,
+    DcmDataset* responseIdentifiers)
+{
+    if (!responseIdentifiers || !DICOM_PENDING_STATUS(rsp->DimseStatus)) {
+        return;
+    }
+    WorklistFindContext* ctx = static_cast<WorklistFindContext*>(callbackData);
+    DB_WorklistItem item;
+    extractWorklistItem(responseIdentifiers, item);
+    ctx->items.push_back(item);
+}
+
+// --- Helper: One MWL C-FIND over a scheduled date range ---
+DB_NetworkResult findWorklist(const char* localAE,
+                              const DB_DicomNode* remoteNode,
+                              const DB_WorklistQuery& query,
+                              const std::string& dateRange,
+                              std::vector<DB_WorklistItem>& items,
+                              int timeoutSeconds)
+{
+    NetworkOperation operation(DB_NET_OP_FIND, remoteNode);
+    T_ASC_Network* net = nullptr;
+    T_ASC_Association* assoc = nullptr;
+
+    OFCondition cond = createAssociation(
+        localAE, remoteNode, UID_FINDModalityWorklistInformationModel,
+        net, assoc, timeoutSeconds);
+    if (cond.bad()) {
+        return operation.finish(conditionToResult(cond, "Association"));
+    }
+
+    DcmDataset findRequest;
+    buildWorklistRequest(query, dateRange, findRequest);
+
+    T_ASC_PresentationContextID presID =
+        ASC_findAcceptedPresentationContextID(assoc, UID_FINDModalityWorklistInformationModel);
+
+    T_DIMSE_C_FindRQ request;
+    memset(&request, 0, sizeof(request));
+    request.MessageID = assoc->nextMsgID++;
+    strcpy(request.AffectedSOPClassUID, UID_FINDModalityWorklistInformationModel);
+    request.Priority = DIMSE_PRIORITY_MEDIUM;
+    request.DataSetType = DIMSE_DATASET_PRESENT;
+
+    WorklistFindContext ctx;
+    T_DIMSE_C_FindRSP response;
+    memset(&response, 0, sizeof(response));
+    DcmDataset* statusDetail = nullptr;
+    int responseCount = 0;
+
+    cond = DIMSE_findUser(
+        assoc, presID, &request, &findRequest,
+        responseCount,
+        worklistFindCallback, &ctx,
+        DIMSE_BLOCKING, timeoutSeconds,
+        &response, &statusDetail);
+
+    if (statusDetail) {
+        delete statusDetail;
+    }
+    releaseAssociation(assoc, net);
+    operation.addInstances((int)ctx.items.size());
+
+    if (cond.bad()) {
+        return operation.finish(conditionToResult(cond, "Worklist C-FIND"));
+    }
+    if (response.DimseStatus != STATUS_Success) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Worklist C-FIND failed with status 0x%04x",
+                 response.DimseStatus);
+        return operation.finish(makeResult(DB_STATUS_ERROR, msg, response.DimseStatus));
+    }
+
+    items.swap(ctx.items);
+    return operation.finish(makeResult(DB_STATUS_OK, "", response.DimseStatus));
+}
+
+bool isValidQuery(const DB_WorklistQuery* query) {
+    return query && query->daysBefore >= 0 && query->daysAfter >= 0;
+}
+
+}  // namespace
+
+// ========================================================================
+// Worklist API
+// ========================================================================
+
+DB_NetworkResult db_worklist_find(const char* localAE,
+                                  const DB_DicomNode* remoteNode,
+                                  const DB_WorklistQuery* query,
+                                  DB_WorklistCallback onItem,
+                                  void* userData,
+                                  int timeoutSeconds)
+{
+    if (!localAE || !remoteNode || !isValidQuery(query)) {
+        return makeResult(DB_STATUS_ERROR, "Invalid parameters");
+    }
+
+    std::string dateRange = localDate(-query->daysBefore) + "-" + localDate(query->daysAfter);
+    std::vector<DB_WorklistItem> items;
+    DB_NetworkResult result = findWorklist(localAE, remoteNode, *query, dateRange, items,
+                                           timeoutSeconds);
+    if (result.status != DB_STATUS_OK) return result;
+
+    if (onItem) {
+        for (const DB_WorklistItem& item : items) {
+            onItem(userData, &item);
+        }
+    }
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Worklist C-FIND completed, %d items found", (int)items.size());
+    return makeResult(DB_STATUS_OK, msg, result.dimseStatus);
+}
+
+DB_WorklistPoller* db_worklist_poller_create(const char* localAE,
+                                             const DB_DicomNode* remoteNode,
+                                             const DB_WorklistQuery* query,
+                                             int timeoutSeconds)
+{
+    if (!localAE || !remoteNode || !isValidQuery(query) || timeoutSeconds <= 0) {
+        return nullptr;
+    }
+
+    DB_WorklistPoller* poller = new DB_WorklistPoller();
+    poller->localAE = localAE;
+    poller->node = *remoteNode;
+    poller->query = *query;
+    poller->timeoutSeconds = timeoutSeconds;
+    return poller;
+}
+
+void db_worklist_poller_destroy(DB_WorklistPoller* poller) {
+    delete poller;
+}
+
+DB_NetworkResult db_worklist_poller_poll(DB_WorklistPoller* poller,
+                                         DB_WorklistChangeCallback onChange,
+                                         void* userData)
+{
+    if (!poller) {
+        return makeResult(DB_STATUS_ERROR, "Invalid parameters");
+    }
+
+    std::lock_guard<std::mutex> lock(poller->mutex);
+    const DB_WorklistQuery& query = poller->query;
+
+    // Whole window on the first poll and every Nth one, else today only
+    bool full = poller->polls == 0 || query.fullRefreshInterval <= 1 ||
+                poller->polls % query.fullRefreshInterval == 0;
+    std::string from = full ? localDate(-query.daysBefore) : localDate(0);
+    std::string to = full ? localDate(query.daysAfter) : localDate(0);
+
+    std::vector<DB_WorklistItem> fresh;
+    DB_NetworkResult result = findWorklist(poller->localAE.c_str(), &poller->node, query,
+                                           from + "-" + to, fresh, poller->timeoutSeconds);
+    if (result.status != DB_STATUS_OK) return result;
+    poller->polls++;
+
+    int added = 0;
+    int changed = 0;
+    int removed = 0;
+
+    std::map<std::string, DB_WorklistPoller::Known> seen;
+    for (const DB_WorklistItem& item : fresh) {
+        seen[itemKey(item)] = { item, itemHash(item) };
+    }
+
+    for (const auto& entry : seen) {
+        auto known = poller->items.find(entry.first);
+        if (known == poller->items.end()) {
+            added++;
+            if (onChange) onChange(userData, DB_WORKLIST_ADDED, &entry.second.item);
+        } else if (known->second.hash != entry.second.hash) {
+            changed++;
+            if (onChange) onChange(userData, DB_WORKLIST_CHANGED, &entry.second.item);
+        }
+        poller->items[entry.first] = entry.second;
+    }
+
+    // Items the query covered but did not return are gone; so are items
+    // the sliding window has left
+    std::string windowStart = localDate(-query.daysBefore);
+    for (auto it = poller->items.begin(); it != poller->items.end();) {
+        const std::string date = it->second.item.scheduledStartDate;
+        bool covered = full || (date >= from && date <= to);
+        bool expired = !date.empty() && date < windowStart;
+        if (seen.count(it->first) == 0 && (covered || expired)) {
+            removed++;
+            if (onChange) onChange(userData, DB_WORKLIST_REMOVED, &it->second.item);
+            it = poller->items.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "Worklist %s poll: %d items, %d added, %d changed, %d removed",
+             full ? "full" : "today", (int)fresh.size(), added, changed, removed);
+    return makeResult(DB_STATUS_OK, msg, result.dimseStatus);
+}
+
+int db_worklist_poller_items(DB_WorklistPoller* poller, DB_WorklistItem* outItems, int maxCount) {
+    if (!poller) return 0;
+
+    std::lock_guard<std::mutex> lock(poller->mutex);
+    if (!outItems) return (int)poller->items.size();
+
+    int count = 0;
+    for (const auto& entry : poller->items) {
+        if (count >= maxCount) break;
+        outItems[count++] = entry.second.item;
+    }
+    return count;
+}
+
+// ========================================================================
+// Modality Performed Procedure Step
+// ========================================================================
+
+namespace {
+
+const char* mppsStatusString(DB_MppsStatus status) {
+    switch (status) {
+        case DB_MPPS_IN_PROGRESS: return "IN PROGRESS";
+        case DB_MPPS_COMPLETED: return "COMPLETED";
+        case DB_MPPS_DISCONTINUED: return "DISCONTINUED";
+    }
+    return nullptr;
+}
+
+// --- Helper: Local date and time now, as DA and TM ---
+void localNow(std::string& outDate, std::string& outTime) {
+    time_t now = time(nullptr);
+    struct tm local;
+    localtime_r(&now, &local);
+
+    char buf[16];
+    strftime(buf, sizeof(buf), "%Y%m%d", &local);
+    outDate = buf;
+    strftime(buf, sizeof(buf), "%H%M%S", &local);
+    outTime = buf;
+}
+
+// --- Helper: Build the N-CREATE attributes of a step started now ---
+// Every type 1 and 2 attribute of PS3.4 F.7.2.2.1 the SCU must supply.
+void buildMppsCreate(const DB_WorklistItem& step, const char* localAE, DcmDataset& attributes) {
+    std::string date;
+    std::string timeOfDay;
+    localNow(date, timeOfDay);
+
+    DcmItem* scheduled = nullptr;
+    if (attributes.findOrCreateSequenceItem(DCM_ScheduledStepAttributesSequence, scheduled).good()) {
+        scheduled->putAndInsertString(DCM_StudyInstanceUID, step.studyInstanceUID);
+        scheduled->insertEmptyElement(DCM_ReferencedStudySequence);
+        scheduled->putAndInsertString(DCM_AccessionNumber, step.accessionNumber);
+        scheduled->putAndInsertString(DCM_RequestedProcedureID, step.requestedProcedureID);
+        scheduled->putAndInsertString(DCM_RequestedProcedureDescription, step.requestedProcedureDescription);
+        scheduled->putAndInsertString(DCM_ScheduledProcedureStepID, step.stepID);
+        scheduled->putAndInsertString(DCM_ScheduledProcedureStepDescription, step.stepDescription);
+        scheduled->insertEmptyElement(DCM_ScheduledProtocolCodeSequence);
+    }
+
+    attributes.putAndInsertString(DCM_PatientName, step.patientName);
+    attributes.putAndInsertString(DCM_PatientID, step.patientID);
+    attributes.putAndInsertString(DCM_PatientBirthDate, step.birthDate);
+    attributes.putAndInsertString(DCM_PatientSex, step.patientSex);
+    attributes.insertEmptyElement(DCM_ReferencedPatientSequence);
+
+    attributes.putAndInsertString(DCM_PerformedProcedureStepID, (date + timeOfDay).c_str());
+    attributes.putAndInsertString(DCM_PerformedStationAETitle, localAE);
+    attributes.putAndInsertString(DCM_PerformedStationName, "");
+    attributes.putAndInsertString(DCM_PerformedLocation, "");
+    attributes.putAndInsertString(DCM_PerformedProcedureStepStartDate, date.c_str());
+    attributes.putAndInsertString(DCM_PerformedProcedureStepStartTime, timeOfDay.c_str());
+    attributes.putAndInsertString(DCM_PerformedProcedureStepStatus, mppsStatusString(DB_MPPS_IN_PROGRESS));
+    attributes.putAndInsertString(DCM_PerformedProcedureStepDescription, step.stepDescription);
+    attributes.putAndInsertString(DCM_PerformedProcedureTypeDescription, step.requestedProcedureDescription);
+    attributes.insertEmptyElement(DCM_ProcedureCodeSequence);
+    attributes.putAndInsertString(DCM_PerformedProcedureStepEndDate, "");
+    attributes.putAndInsertString(DCM_PerformedProcedureStepEndTime, "");
+    attributes.putAndInsertString(DCM_Modality, step.modality[0] ? step.modality : "OT");
+    attributes.putAndInsertString(DCM_StudyID, "");
+    attributes.insertEmptyElement(DCM_PerformedProtocolCodeSequence);
+    attributes.insertEmptyElement(DCM_PerformedSeriesSequence);
+}
+
+// --- Helper: Build the N-SET attributes of a status change ---
+void buildMppsSet(DB_MppsStatus status, const DB_MppsSeries* series, int seriesCount,
+                  DcmDataset& attributes) {
+    attributes.putAndInsertString(DCM_PerformedProcedureStepStatus, mppsStatusString(status));
+    if (status != DB_MPPS_IN_PROGRESS) {
+        std::string date;
+        std::string timeOfDay;
+        localNow(date, timeOfDay);
+        attributes.putAndInsertString(DCM_PerformedProcedureStepEndDate, date.c_str());
+        attributes.putAndInsertString(DCM_PerformedProcedureStepEndTime, timeOfDay.c_str());
+    }
+    if (!series) return;
+
+    attributes.insertEmptyElement(DCM_PerformedSeriesSequence);
+    for (int i = 0; i < seriesCount; i++) {
+        const DB_MppsSeries& performed = series[i];
+        DcmItem* item = nullptr;
+        if (attributes.findOrCreateSequenceItem(DCM_PerformedSeriesSequence, item, -2).bad()) continue;
+        item->putAndInsertString(DCM_SeriesInstanceUID, performed.seriesInstanceUID);
+        item->putAndInsertString(DCM_SeriesDescription, performed.seriesDescription);
+        item->putAndInsertString(DCM_ProtocolName, performed.protocolName[0] ? performed.protocolName
+                                                                             : performed.seriesDescription);
+        item->putAndInsertString(DCM_PerformingPhysicianName, "");
+        item->putAndInsertString(DCM_OperatorsName, "");
+        item->putAndInsertString(DCM_RetrieveAETitle, "");
+        item->insertEmptyElement(DCM_ReferencedImageSequence);
+        item->insertEmptyElement(DCM_ReferencedNonImageCompositeSOPInstanceSequence);
+        for (int j = 0; j < performed.instanceCount; j++) {
+            DcmItem* reference = nullptr;
+            if (item->findOrCreateSequenceItem(DCM_ReferencedImageSequence, reference, -2).good()) {
+                reference->putAndInsertString(DCM_ReferencedSOPClassUID, performed.sopClassUID);
+                reference->putAndInsertString(DCM_ReferencedSOPInstanceUID, performed.sopInstanceUIDs[j]);
+            }
+        }
+    }
+}
+
+bool isValidSeries(const DB_MppsSeries* series, int seriesCount) {
+    if (!series) return seriesCount == 0;
+    if (seriesCount < 0) return false;
+    for (int i = 0; i < seriesCount; i++) {
+        const DB_MppsSeries& performed = series[i];
+        if (!performed.seriesInstanceUID[0] || performed.instanceCount < 0 ||
+            (performed.instanceCount > 0 && (!performed.sopInstanceUIDs || !performed.sopClassUID[0]))) {
+            return false;
+        }
+        for (int j = 0; j < performed.instanceCount; j++) {
+            if (!performed.sopInstanceUIDs[j]) return false;
+        }
+    }
+    return true;
+}
+
+// --- Helper: Send one N-CREATE or N-SET and wait for its response ---
+DB_NetworkResult mppsExchange(const char* localAE,
+                              const DB_DicomNode* remoteNode,
+                              T_DIMSE_Message& request,
+                              DcmDataset& attributes,
+                              const char* operationName,
+                              int timeoutSeconds)
+{
+    T_ASC_Network* net = nullptr;
+    T_ASC_Association* assoc = nullptr;
+
+    OFCondition cond = createAssociation(
+        localAE, remoteNode, UID_ModalityPerformedProcedureStepSOPClass,
+        net, assoc, timeoutSeconds);
+    if (cond.bad()) {
+        return conditionToResult(cond, "Association");
+    }
+
+    T_ASC_PresentationContextID presID =
+        ASC_findAcceptedPresentationContextID(assoc, UID_ModalityPerformedProcedureStepSOPClass);
+    if (request.CommandField == DIMSE_N_CREATE_RQ) {
+        request.msg.NCreateRQ.MessageID = assoc->nextMsgID++;
+    } else {
+        request.msg.NSetRQ.MessageID = assoc->nextMsgID++;
+    }
+    cond = DIMSE_sendMessageUsingMemoryData(
+        assoc, presID, &request, nullptr, &attributes, nullptr, nullptr);
+
+    T_DIMSE_Message response;
+    memset(&response, 0, sizeof(response));
+    if (cond.good()) {
+        T_ASC_PresentationContextID responsePresID = 0;
+        DcmDataset* statusDetail = nullptr;
+        cond = DIMSE_receiveCommand(assoc, DIMSE_BLOCKING, timeoutSeconds,
+                                    &responsePresID, &response, &statusDetail);
+        if (statusDetail) {
+            delete statusDetail;
+        }
+
+        // The SCP may echo the attributes back; they are not needed
+        bool attributesFollow = response.CommandField == DIMSE_N_CREATE_RSP
+            ? response.msg.NCreateRSP.DataSetType != DIMSE_DATASET_NULL
+            : response.msg.NSetRSP.DataSetType != DIMSE_DATASET_NULL;
+        if (cond.good() && attributesFollow) {
+            DcmDataset* echoed = nullptr;
+            cond = DIMSE_receiveDataSetInMemory(assoc, DIMSE_BLOCKING, timeoutSeconds,
+                                                &responsePresID, &echoed, nullptr, nullptr);
+            delete echoed;
+        }
+    }
+    releaseAssociation(assoc, net);
+
+    if (cond.bad()) {
+        return conditionToResult(cond, operationName);
+    }
+    Uint16 status = response.CommandField == DIMSE_N_CREATE_RSP ? response.msg.NCreateRSP.DimseStatus
+                  : response.CommandField == DIMSE_N_SET_RSP ? response.msg.NSetRSP.DimseStatus
+                  : 0xFFFF;
+
+    // Warnings: attribute list error, attribute value out of range
+    char msg[128];
+    if (status != STATUS_Success && status != 0x0001 && status != 0x0107 && status != 0x0116) {
+        snprintf(msg, sizeof(msg), "%s failed with status 0x%04x", operationName, status);
+        return makeResult(DB_STATUS_ERROR, msg, status);
+    }
+    snprintf(msg, sizeof(msg), "%s completed", operationName);
+    return makeResult(DB_STATUS_OK, msg, status);
+}
+
+}  // namespace
+
+// ========================================================================
+// MPPS API
+// ========================================================================
+
+DB_NetworkResult db_mpps_create(const char* localAE,
+                                const DB_DicomNode* remoteNode,
+                                const DB_WorklistItem* step,
+                                char* outSOPInstanceUID,
+                                int timeoutSeconds)
+{
+    if (!localAE || !remoteNode || !step || !outSOPInstanceUID) {
+        return makeResult(DB_STATUS_ERROR, "Invalid parameters");
+    }
+
+    char sopInstanceUID[100];
+    dcmGenerateUniqueIdentifier(sopInstanceUID, SITE_INSTANCE_UID_ROOT);
+
+    DcmDataset attributes;
+    buildMppsCreate(*step, localAE, attributes);
+
+    T_DIMSE_Message request;
+    memset(&request, 0, sizeof(request));
+    request.CommandField = DIMSE_N_CREATE_RQ;
+    T_DIMSE_N_CreateRQ& createRQ = request.msg.NCreateRQ;
+    strcpy(createRQ.AffectedSOPClassUID, UID_ModalityPerformedProcedureStepSOPClass);
+    strcpy(createRQ.AffectedSOPInstanceUID, sopInstanceUID);
+    createRQ.opts = O_NCREATE_AFFECTEDSOPINSTANCEUID;
+    createRQ.DataSetType = DIMSE_DATASET_PRESENT;
+
+    DB_NetworkResult result = mppsExchange(localAE, remoteNode, request, attributes,
+                                           "MPPS N-CREATE", timeoutSeconds);
+    if (result.status == DB_STATUS_OK) {
+        strcpy(outSOPInstanceUID, sopInstanceUID);
+    }
+    return result;
+}
+
+DB_NetworkResult db_mpps_set(const char* localAE,
+                             const DB_DicomNode* remoteNode,
+                             const char* sopInstanceUID,
+                             DB_MppsStatus status,
+                             const DB_MppsSeries* series,
+                             int seriesCount,
+                             int timeoutSeconds)
+{
+    if (!localAE || !remoteNode || !sopInstanceUID || !sopInstanceUID[0] ||
+        strlen(sopInstanceUID) > 64 || !mppsStatusString(status) ||
+        !isValidSeries(series, seriesCount)) {
+        return makeResult(DB_STATUS_ERROR, "Invalid parameters");
+    }
+
+    DcmDataset attributes;
+    buildMppsSet(status, series, seriesCount, attributes);
+
+    T_DIMSE_Message request;
+    memset(&request, 0, sizeof(request));
+    request.CommandField = DIMSE_N_SET_RQ;
+    T_DIMSE_N_SetRQ& setRQ = request.msg.NSetRQ;
+    strcpy(setRQ.RequestedSOPClassUID, UID_ModalityPerformedProcedureStepSOPClass);
+    strcpy(setRQ.RequestedSOPInstanceUID, sopInstanceUID);
+    setRQ.DataSetType = DIMSE_DATASET_PRESENT;
+
+    return mppsExchange(localAE, remoteNode, request, attributes, "MPPS N-SET", timeoutSeconds);
+}
@@ -0,0 +1,248 @@
+//
+//  main.cpp
+//  dicom-netbench
+//
+//  Network benchmark driver. Starts two local PACS simulators (a source
+//  serving a folder and a sink receiving C-STORE and C-MOVE traffic) and
+//  measures C-ECHO, C-FIND, C-MOVE, C-GET and C-STORE through DicomCore.
+//
+
+#include "DicomPacsSimulator.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+static const char* kLocalAE = "NETBENCH";
+static const char* kSourceAE = "BENCHPACS";
+static const char* kSinkAE = "BENCHSINK";
+static const int kTimeoutSeconds = 60;
+
+/// Aggregated stats of one benchmarked operation kind.
+struct Summary {
+    const char* name;
+    int runs = 0;
+    int failures = 0;
+    double totalSeconds = 0.0;
+    double minSeconds = 0.0;
+    double maxSeconds = 0.0;
+    double associationSeconds = 0.0;
+    double firstResponseSeconds = 0.0;
+    uint64_t bytes = 0;
+    int instances = 0;
+
+    explicit Summary(const char* name) : name(name) {}
+
+    void add(const DB_NetworkResult& result) {
+        DB_NetworkStats stats;
+        if (db_network_stats_last(&stats) != DB_STATUS_OK) return;
+
+        if (runs == 0 || stats.totalSeconds < minSeconds) minSeconds = stats.totalSeconds;
+        if (runs == 0 || stats.totalSeconds > maxSeconds) maxSeconds = stats.totalSeconds;
+        runs++;
+        if (result.status != DB_STATUS_OK) {
+            failures++;
+            fprintf(stderr, "  %s: %s\n", name, result.errorMessage);
+        }
+        totalSeconds += stats.totalSeconds;
+        associationSeconds += std::max(0.0, stats.connectSeconds) +
+                              std::max(0.0, stats.negotiateSeconds);
+        firstResponseSeconds += std::max(0.0, stats.firstResponseSeconds);
+        bytes += stats.bytesSent + stats.bytesReceived;
+        instances += stats.instances;
+    }
+
+    void print() const {
+        if (runs == 0) {
+            printf("%-8s %5s\n", name, "-");
+            return;
+        }
+        double seconds = totalSeconds > 0.0 ? totalSeconds : 1e-9;
+        printf("%-8s %5d %5d %9.1f %9.1f %9.1f %9.1f %9.1f %9.2f %9.1f\n",
+               name, runs, failures,
+               totalSeconds / runs * 1000.0, minSeconds * 1000.0, maxSeconds * 1000.0,
+               associationSeconds / runs * 1000.0, firstResponseSeconds / runs * 1000.0,
+               bytes / seconds / (1024.0 * 1024.0), instances / seconds);
+    }
+};
+
+struct StudyCollector {
+    std::vector<std::string> studyUIDs;
+};
+
+static void collectStudy(void* userData, const DB_DicomTags* tags) {
+    static_cast<StudyCollector*>(userData)->studyUIDs.push_back(tags->studyInstanceUID);
+}
+
+static void collectFile(void* userData, const DB_DicomTags* /* tags */, const char* filePath) {
+    static_cast<std::vector<std::string>*>(userData)->push_back(filePath);
+}
+
+static DB_DicomNode makeNode(const char* aeTitle, int port) {
+    DB_DicomNode node;
+    memset(&node, 0, sizeof(node));
+    strncpy(node.aeTitle, aeTitle, sizeof(node.aeTitle) - 1);
+    strncpy(node.hostname, "127.0.0.1", sizeof(node.hostname) - 1);
+    node.port = port;
+    return node;
+}
+
+static void usage() {
+    fprintf(stderr,
+            "usage: dicom-netbench <folder> [options]\n"
+            "  --port <n>            First of two local ports to use (default 11112)\n"
+            "  --latency <ms>        Simulated latency per response (default 0)\n"
+            "  --bandwidth <MB/s>    Simulated link speed (default unlimited)\n"
+            "  --iterations <n>      Runs per operation (default 5)\n"
+            "  --log <file>          Also write per-operation JSON lines to file\n");
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argv[1][0] == '-') {
+        usage();
+        return 2;
+    }
+
+    const char* folder = argv[1];
+    int port = 11112;
+    int iterations = 5;
+    const char* logPath = nullptr;
+
+    DB_PacsSimulatorConfig config;
+    memset(&config, 0, sizeof(config));
+
+    for (int i = 2; i + 1 < argc; i += 2) {
+        const char* option = argv[i];
+        const char* value = argv[i + 1];
+        if (strcmp(option, "--port") == 0) {
+            port = atoi(value);
+        } else if (strcmp(option, "--latency") == 0) {
+            config.latencyMs = atoi(value);
+        } else if (strcmp(option, "--bandwidth") == 0) {
+            config.bandwidthMBps = atof(value);
+        } else if (strcmp(option, "--iterations") == 0) {
+            iterations = std::max(1, atoi(value));
+        } else if (strcmp(option, "--log") == 0) {
+            logPath = value;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (argc % 2 != 0) {
+        usage();
+        return 2;
+    }
+
+    // Scratch space for the sink and for C-GET destinations
+    fs::path work = fs::temp_directory_path() / ("dicom-netbench-" + std::to_string(getpid()));
+    fs::path sinkFolder = work / "sink";
+    fs::path getFolder = work / "get";
+    std::error_code ec;
+    fs::create_directories(sinkFolder, ec);
+    fs::create_directories(getFolder, ec);
+
+    DB_PacsSimulatorConfig sourceConfig = config;
+    strncpy(sourceConfig.aeTitle, kSourceAE, sizeof(sourceConfig.aeTitle) - 1);
+    sourceConfig.port = port;
+
+    DB_PacsSimulatorConfig sinkConfig = config;
+    strncpy(sinkConfig.aeTitle, kSinkAE, sizeof(sinkConfig.aeTitle) - 1);
+    sinkConfig.port = port + 1;
+
+    DB_PacsSimulator* source = db_pacs_simulator_start(&sourceConfig, folder);
+    DB_PacsSimulator* sink = db_pacs_simulator_start(&sinkConfig, sinkFolder.c_str());
+    if (!source || !sink) {
+        fprintf(stderr, "Cannot start simulators on ports %d-%d\n", port, port + 1);
+        db_pacs_simulator_stop(source);
+        db_pacs_simulator_stop(sink);
+        fs::remove_all(work, ec);
+        return 1;
+    }
+
+    DB_DicomNode sourceNode = makeNode(kSourceAE, port);
+    DB_DicomNode sinkNode = makeNode(kSinkAE, port + 1);
+    db_pacs_simulator_add_move_destination(source, &sinkNode);
+
+    if (logPath && db_network_stats_set_log(logPath) != DB_STATUS_OK) {
+        fprintf(stderr, "Cannot open log %s\n", logPath);
+    }
+
+    std::vector<std::string> files;
+    db_scan_folder(folder, collectFile, nullptr, &files);
+
+    printf("Serving %d instances, latency %d ms, bandwidth %s, %d iterations\n\n",
+           db_pacs_simulator_instance_count(source), config.latencyMs,
+           config.bandwidthMBps > 0.0 ? (std::to_string(config.bandwidthMBps) + " MB/s").c_str()
+                                      : "unlimited",
+           iterations);
+
+    DB_DicomTags anyStudy;
+    memset(&anyStudy, 0, sizeof(anyStudy));
+
+    Summary echo("echo");
+    Summary find("find");
+    Summary move("move");
+    Summary get("get");
+    Summary store("store");
+
+    StudyCollector studies;
+    for (int i = 0; i < iterations; i++) {
+        echo.add(db_echo(kLocalAE, &sourceNode, kTimeoutSeconds));
+
+        StudyCollector found;
+        find.add(db_find_studies(kLocalAE, &sourceNode, &anyStudy,
+                                 collectStudy, &found, kTimeoutSeconds));
+        if (i == 0) studies = found;
+    }
+
+    for (int i = 0; i < iterations; i++) {
+        for (const std::string& studyUID : studies.studyUIDs) {
+            // C-MOVE to the sink: the move destination is the local AE argument
+            move.add(db_move_study(kSinkAE, &sourceNode, studyUID.c_str(),
+                                   sinkFolder.c_str(), nullptr, nullptr, kTimeoutSeconds));
+
+            fs::path destination = getFolder / std::to_string(i);
+            fs::create_directories(destination, ec);
+            DB_RetrieveScheduler* scheduler = db_retrieve_scheduler_create(
+                kLocalAE, &sourceNode, studyUID.c_str(), destination.c_str(),
+                DB_RETRIEVE_GET, 64, kTimeoutSeconds);
+            if (scheduler) {
+                get.add(db_retrieve_scheduler_run(scheduler, nullptr, nullptr, nullptr));
+                db_retrieve_scheduler_destroy(scheduler);
+            }
+            fs::remove_all(destination, ec);
+        }
+    }
+
+    if (!files.empty()) {
+        std::vector<const char*> paths;
+        for (const std::string& file : files) paths.push_back(file.c_str());
+        for (int i = 0; i < iterations; i++) {
+            store.add(db_store_study(kLocalAE, &sinkNode, paths.data(), (int)paths.size(),
+                                     nullptr, nullptr, kTimeoutSeconds));
+        }
+    }
+
+    printf("%-8s %5s %5s %9s %9s %9s %9s %9s %9s %9s\n",
+           "op", "runs", "fail", "mean ms", "min ms", "max ms",
+           "assoc ms", "first ms", "MB/s", "inst/s");
+    echo.print();
+    find.print();
+    move.print();
+    get.print();
+    store.print();
+
+    db_network_stats_set_log(nullptr);
+    db_pacs_simulator_stop(source);
+    db_pacs_simulator_stop(sink);
+    fs::remove_all(work, ec);
+    return 0;
+}
@@ -0,0 +1,116 @@
+//
+//  main.cpp
+//  dicom-pacs-sim
+//
+//  Command line front end for the local PACS simulator.
+//  Serves a folder of DICOM files until interrupted.
+//
+
+#include "DicomPacsSimulator.h"
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+static std::atomic<bool> interrupted{false};
+
+static void onSignal(int) {
+    interrupted = true;
+}
+
+static void usage() {
+    fprintf(stderr,
+            "usage: dicom-pacs-sim <folder> [options]\n"
+            "  --ae <title>              Called AE title (default SIMPACS)\n"
+            "  --port <n>                Listen port (default 11112)\n"
+            "  --latency <ms>            Delay per response (default 0)\n"
+            "  --bandwidth <MB/s>        Link speed per association (default unlimited)\n"
+            "  --move-dest <AE@host:port>  Allow C-MOVE to this destination (repeatable)\n");
+}
+
+// --- Helper: Parse AE@host:port ---
+static bool parseNode(const char* text, DB_DicomNode& node) {
+    memset(&node, 0, sizeof(node));
+    const char* at = strchr(text, '@');
+    const char* colon = strrchr(text, ':');
+    if (!at || !colon || colon < at || at == text ||
+        (size_t)(at - text) >= sizeof(node.aeTitle)) {
+        return false;
+    }
+    memcpy(node.aeTitle, text, at - text);
+    std::string host(at + 1, colon);
+    strncpy(node.hostname, host.c_str(), sizeof(node.hostname) - 1);
+    node.port = atoi(colon + 1);
+    return node.port > 0 && !host.empty();
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argv[1][0] == '-') {
+        usage();
+        return 2;
+    }
+
+    DB_PacsSimulatorConfig config;
+    memset(&config, 0, sizeof(config));
+    strncpy(config.aeTitle, "SIMPACS", sizeof(config.aeTitle) - 1);
+    config.port = 11112;
+
+    const char* folder = argv[1];
+    DB_DicomNode destinations[16];
+    int destinationCount = 0;
+
+    for (int i = 2; i < argc; i++) {
+        const char* option = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            usage();
+            return 2;
+        }
+        i++;
+
+        if (strcmp(option, "--ae") == 0) {
+            strncpy(config.aeTitle, value, sizeof(config.aeTitle) - 1);
+        } else if (strcmp(option, "--port") == 0) {
+            config.port = atoi(value);
+        } else if (strcmp(option, "--latency") == 0) {
+            config.latencyMs = atoi(value);
+        } else if (strcmp(option, "--bandwidth") == 0) {
+            config.bandwidthMBps = atof(value);
+        } else if (strcmp(option, "--move-dest") == 0 && destinationCount < 16) {
+            if (!parseNode(value, destinations[destinationCount])) {
+                fprintf(stderr, "Invalid move destination: %s\n", value);
+                return 2;
+            }
+            destinationCount++;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    DB_PacsSimulator* simulator = db_pacs_simulator_start(&config, folder);
+    if (!simulator) {
+        fprintf(stderr, "Cannot start simulator on port %d for %s\n", config.port, folder);
+        return 1;
+    }
+    for (int i = 0; i < destinationCount; i++) {
+        db_pacs_simulator_add_move_destination(simulator, &destinations[i]);
+    }
+
+    printf("%s listening on port %d, serving %d instances from %s\n",
+           config.aeTitle, config.port, db_pacs_simulator_instance_count(simulator), folder);
+    fflush(stdout);
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    while (!interrupted) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+
+    db_pacs_simulator_stop(simulator);
+    return 0;
+}
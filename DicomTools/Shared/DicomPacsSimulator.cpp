@@ -0,0 +1,821 @@
+//
+//  DicomPacsSimulator.cpp
+//  DicomTools
+//
+//  In-process Query/Retrieve + Storage SCP serving a folder of DICOM files.
+//  Stands in for a real PACS in tests and network benchmarks, with
+//  artificial latency and link bandwidth.
+//
+
+#include "DicomPacsSimulator.h"
+#include "DicomNetworkUtils.hpp"
+#include "DicomRetrieve.hpp"
+#include "DicomTransport.hpp"
+#include "dcmtk/config/osconfig.h"
+#include "dcmtk/dcmnet/dimse.h"
+#include "dcmtk/dcmnet/diutil.h"
+#include "dcmtk/dcmdata/dcdeftag.h"
+#include "dcmtk/dcmdata/dcfilefo.h"
+#include "dcmtk/dcmdata/dcmetinf.h"
+#include "dcmtk/dcmdata/dcuid.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace dicomcore;
+namespace fs = std::filesystem;
+
+namespace {
+
+const int kTimeoutSeconds = 30;
+
+// DIMSE statuses used by the Q/R providers (PS3.4 C.4)
+const DIC_US kStatusCancel = 0xFE00;
+const DIC_US kStatusSubOperationsFailed = 0xB000;
+const DIC_US kStatusOutOfResources = 0xA702;
+const DIC_US kStatusMoveDestinationUnknown = 0xA801;
+const DIC_US kStatusUnableToProcess = 0xC000;
+
+struct ServedInstance {
+    std::string path;
+    std::string sopClassUID;
+    DB_DicomTags tags;
+};
+
+}  // namespace
+
+struct DB_PacsSimulator {
+    DB_PacsSimulatorConfig config;
+    std::string folder;
+    T_ASC_Network* net = nullptr;
+    std::thread acceptThread;
+    std::atomic<bool> stopping{false};
+
+    std::mutex mutex;       // Guards everything below
+    std::vector<ServedInstance> instances;
+    std::unordered_map<std::string, size_t> bySOPInstanceUID;
+    std::map<std::string, DB_DicomNode> moveDestinations;
+    int activeAssociations = 0;
+    std::condition_variable idle;
+
+    void delay() const {
+        if (config.latencyMs > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(config.latencyMs));
+        }
+    }
+
+    /// Add or replace an instance. Caller holds the lock.
+    void addInstance(ServedInstance instance) {
+        std::string uid = instance.tags.sopInstanceUID;
+        auto it = bySOPInstanceUID.find(uid);
+        if (it != bySOPInstanceUID.end()) {
+            instances[it->second] = std::move(instance);
+        } else {
+            bySOPInstanceUID[uid] = instances.size();
+            instances.push_back(std::move(instance));
+        }
+    }
+};
+
+namespace {
+
+// ========================================================================
+// Index
+// ========================================================================
+
+bool indexFile(const std::string& path, ServedInstance& instance) {
+    if (db_extract_tags(path.c_str(), &instance.tags) != DB_STATUS_OK ||
+        instance.tags.sopInstanceUID[0] == '\0') {
+        return false;
+    }
+
+    DcmMetaInfo meta;
+    OFString sopClassUID;
+    if (meta.loadFile(path.c_str()).bad() ||
+        meta.findAndGetOFString(DCM_MediaStorageSOPClassUID, sopClassUID).bad()) {
+        return false;
+    }
+    instance.path = path;
+    instance.sopClassUID = sopClassUID.c_str();
+    return true;
+}
+
+// --- Helper: Attribute of an instance usable as a matching or return key ---
+bool attributeValue(const ServedInstance& instance, const DcmTagKey& tag, std::string& value) {
+    const DB_DicomTags& t = instance.tags;
+    if (tag == DCM_PatientID) value = t.patientID;
+    else if (tag == DCM_PatientName) value = t.patientName;
+    else if (tag == DCM_PatientBirthDate) value = t.birthDate;
+    else if (tag == DCM_StudyInstanceUID) value = t.studyInstanceUID;
+    else if (tag == DCM_StudyDate) value = t.studyDate;
+    else if (tag == DCM_StudyDescription) value = t.studyDescription;
+    else if (tag == DCM_AccessionNumber) value = t.accessionNumber;
+    else if (tag == DCM_SeriesInstanceUID) value = t.seriesInstanceUID;
+    else if (tag == DCM_SeriesDescription) value = t.seriesDescription;
+    else if (tag == DCM_Modality || tag == DCM_ModalitiesInStudy) value = t.seriesModality;
+    else if (tag == DCM_SeriesNumber) value = std::to_string(t.seriesNumber);
+    else if (tag == DCM_SOPInstanceUID) value = t.sopInstanceUID;
+    else if (tag == DCM_SOPClassUID) value = instance.sopClassUID;
+    else if (tag == DCM_InstanceNumber) value = std::to_string(t.instanceNumber);
+    else return false;
+    return true;
+}
+
+std::string trimmed(const std::string& value) {
+    size_t first = value.find_first_not_of(' ');
+    if (first == std::string::npos) return "";
+    size_t last = value.find_last_not_of(' ');
+    return value.substr(first, last - first + 1);
+}
+
+bool wildcardMatch(const char* pattern, const char* value) {
+    if (*pattern == '\0') return *value == '\0';
+    if (*pattern == '*') {
+        for (const char* v = value; ; v++) {
+            if (wildcardMatch(pattern + 1, v)) return true;
+            if (*v == '\0') return false;
+        }
+    }
+    if (*value == '\0') return false;
+    return (*pattern == '?' || *pattern == *value) && wildcardMatch(pattern + 1, value + 1);
+}
+
+// --- Helper: PS3.4 C.2.2.2 matching of one key (single value, list,
+//     wildcard and range matching) ---
+bool matchesKey(const std::string& rawPattern, const std::string& rawValue, DcmEVR vr) {
+    std::string pattern = trimmed(rawPattern);
+    std::string value = trimmed(rawValue);
+    if (pattern.empty() || pattern == "*") return true;
+
+    size_t separator = pattern.find('\\');
+    if (separator != std::string::npos) {
+        size_t start = 0;
+        while (true) {
+            size_t end = pattern.find('\\', start);
+            if (matchesKey(pattern.substr(start, end - start), value, vr)) return true;
+            if (end == std::string::npos) return false;
+            start = end + 1;
+        }
+    }
+
+    size_t dash = pattern.find('-');
+    if ((vr == EVR_DA || vr == EVR_TM || vr == EVR_DT) && dash != std::string::npos) {
+        std::string lower = pattern.substr(0, dash);
+        std::string upper = pattern.substr(dash + 1);
+        return (lower.empty() || value >= lower) && (upper.empty() || value <= upper);
+    }
+
+    if (pattern.find_first_of("*?") != std::string::npos) {
+        return wildcardMatch(pattern.c_str(), value.c_str());
+    }
+    return pattern == value;
+}
+
+std::string levelKey(const ServedInstance& instance, const std::string& level) {
+    if (level == "STUDY") return instance.tags.studyInstanceUID;
+    if (level == "SERIES") return instance.tags.seriesInstanceUID;
+    return instance.tags.sopInstanceUID;
+}
+
+/// Instances matching every non-empty key of the identifier.
+/// Keys the simulator does not index are ignored.
+std::vector<ServedInstance> selectInstances(DB_PacsSimulator* sim, DcmDataset* identifiers) {
+    struct Key {
+        DcmTagKey tag;
+        DcmEVR vr;
+        std::string pattern;
+    };
+
+    std::vector<Key> keys;
+    for (unsigned long i = 0; i < identifiers->card(); i++) {
+        DcmElement* element = identifiers->getElement(i);
+        OFString pattern;
+        if (element->getTag() == DCM_QueryRetrieveLevel ||
+            element->getOFStringArray(pattern).bad() || pattern.empty()) {
+            continue;
+        }
+        keys.push_back({element->getTag(), element->ident(), pattern.c_str()});
+    }
+
+    std::vector<ServedInstance> selected;
+    std::lock_guard<std::mutex> lock(sim->mutex);
+    for (const ServedInstance& instance : sim->instances) {
+        bool matches = std::all_of(keys.begin(), keys.end(), [&](const Key& key) {
+            std::string value;
+            return !attributeValue(instance, key.tag, value) ||
+                   matchesKey(key.pattern, value, key.vr);
+        });
+        if (matches) selected.push_back(instance);
+    }
+    return selected;
+}
+
+// ========================================================================
+// C-FIND
+// ========================================================================
+
+struct FindJob {
+    DB_PacsSimulator* sim;
+    std::vector<std::unique_ptr<DcmDataset>> responses;
+    size_t next = 0;
+    bool invalid = false;
+};
+
+/// Aggregate of all served instances belonging to one matched entity.
+struct EntityGroup {
+    const ServedInstance* first = nullptr;
+    std::set<std::string> modalities;
+    std::set<std::string> series;
+    int instanceCount = 0;
+};
+
+void buildFindResponses(FindJob& job, DcmDataset* request) {
+    OFString levelString;
+    request->findAndGetOFString(DCM_QueryRetrieveLevel, levelString);
+    std::string level = trimmed(levelString.c_str());
+    if (level != "STUDY" && level != "SERIES" && level != "IMAGE") {
+        job.invalid = true;
+        return;
+    }
+
+    // Entities with at least one matching instance, in index order
+    std::vector<std::string> matched;
+    std::set<std::string> matchedSet;
+    for (const ServedInstance& instance : selectInstances(job.sim, request)) {
+        std::string key = levelKey(instance, level);
+        if (matchedSet.insert(key).second) matched.push_back(key);
+    }
+
+    // Counts and ModalitiesInStudy cover the whole entity, not just the matches
+    std::lock_guard<std::mutex> lock(job.sim->mutex);
+    std::map<std::string, EntityGroup> groups;
+    for (const ServedInstance& instance : job.sim->instances) {
+        std::string key = levelKey(instance, level);
+        if (!matchedSet.count(key)) continue;
+        EntityGroup& group = groups[key];
+        if (!group.first) group.first = &instance;
+        group.modalities.insert(instance.tags.seriesModality);
+        group.series.insert(instance.tags.seriesInstanceUID);
+        group.instanceCount++;
+    }
+
+    for (const std::string& key : matched) {
+        const EntityGroup& group = groups[key];
+        auto response = std::make_unique<DcmDataset>();
+        response->putAndInsertString(DCM_QueryRetrieveLevel, level.c_str());
+
+        for (unsigned long i = 0; i < request->card(); i++) {
+            DcmElement* element = request->getElement(i);
+            DcmTagKey tag = element->getTag();
+            if (tag == DCM_QueryRetrieveLevel || element->ident() == EVR_SQ) continue;
+
+            std::string value;
+            if (tag == DCM_ModalitiesInStudy) {
+                for (const std::string& modality : group.modalities) {
+                    if (modality.empty()) continue;
+                    if (!value.empty()) value += '\\';
+                    value += modality;
+                }
+            } else if (tag == DCM_NumberOfStudyRelatedSeries) {
+                value = std::to_string(group.series.size());
+            } else if (tag == DCM_NumberOfStudyRelatedInstances ||
+                       tag == DCM_NumberOfSeriesRelatedInstances) {
+                value = std::to_string(group.instanceCount);
+            } else {
+                attributeValue(*group.first, tag, value);
+            }
+            response->putAndInsertString(tag, value.c_str());
+        }
+        job.responses.push_back(std::move(response));
+    }
+}
+
+void findProviderCallback(
+    void* callbackData,
+    OFBool cancelled,
+    T_DIMSE_C_FindRQ* /* request */,
+    DcmDataset* requestIdentifiers,
+    int responseCount,
+    T_DIMSE_C_FindRSP* response,
+    DcmDataset** responseIdentifiers,
+    DcmDataset** /* statusDetail */)
+{
+    FindJob* job = static_cast<FindJob*>(callbackData);
+    *responseIdentifiers = nullptr;
+
+    if (responseCount == 1) {
+        buildFindResponses(*job, requestIdentifiers);
+        job->sim->delay();
+    }
+
+    if (job->invalid) {
+        response->DimseStatus = kStatusUnableToProcess;
+    } else if (cancelled || job->sim->stopping) {
+        response->DimseStatus = kStatusCancel;
+    } else if (job->next < job->responses.size()) {
+        // DIMSE_findProvider deletes the identifiers once sent
+        *responseIdentifiers = job->responses[job->next++].release();
+        response->DimseStatus = STATUS_Pending;
+    } else {
+        response->DimseStatus = STATUS_Success;
+    }
+}
+
+// ========================================================================
+// C-GET / C-MOVE sub-operations
+// ========================================================================
+
+bool storeSubOperation(T_ASC_Association* assoc,
+                       const ServedInstance& instance,
+                       const char* moveOriginatorAE,
+                       DIC_US moveOriginatorID)
+{
+    T_ASC_PresentationContextID presID =
+        ASC_findAcceptedPresentationContextID(assoc, instance.sopClassUID.c_str());
+    if (presID == 0) return false;
+
+    DcmFileFormat file;
+    if (file.loadFile(instance.path.c_str()).bad()) return false;
+
+    T_DIMSE_C_StoreRQ request;
+    memset(&request, 0, sizeof(request));
+    request.MessageID = assoc->nextMsgID++;
+    strncpy(request.AffectedSOPClassUID, instance.sopClassUID.c_str(),
+            sizeof(request.AffectedSOPClassUID) - 1);
+    strncpy(request.AffectedSOPInstanceUID, instance.tags.sopInstanceUID,
+            sizeof(request.AffectedSOPInstanceUID) - 1);
+    request.Priority = DIMSE_PRIORITY_MEDIUM;
+    request.DataSetType = DIMSE_DATASET_PRESENT;
+    if (moveOriginatorAE) {
+        request.opts = O_STORE_MOVEORIGINATORAETITLE | O_STORE_MOVEORIGINATORID;
+        strncpy(request.MoveOriginatorApplicationEntityTitle, moveOriginatorAE,
+                sizeof(request.MoveOriginatorApplicationEntityTitle) - 1);
+        request.MoveOriginatorID = moveOriginatorID;
+    }
+
+    T_DIMSE_C_StoreRSP response;
+    memset(&response, 0, sizeof(response));
+    DcmDataset* statusDetail = nullptr;
+
+    OFCondition cond = DIMSE_storeUser(
+        assoc, presID, &request, nullptr,
+        file.getDataset(), nullptr, nullptr,
+        DIMSE_BLOCKING, kTimeoutSeconds,
+        &response, &statusDetail, nullptr);
+
+    if (statusDetail) {
+        delete statusDetail;
+    }
+    return cond.good() &&
+           (response.DimseStatus == STATUS_Success || (response.DimseStatus & 0xF000) == 0xB000);
+}
+
+struct RetrieveJob {
+    DB_PacsSimulator* sim;
+    T_ASC_Association* assoc = nullptr; // Association the sub-operations run on
+    std::vector<ServedInstance> selected;
+    size_t next = 0;
+    int completed = 0;
+    int failed = 0;
+    bool started = false;
+    DIC_US finalStatus = 0;             // Set when the job must end early
+
+    // C-MOVE only
+    T_ASC_Network* subNet = nullptr;
+    std::string originatorAE;
+    DIC_US originatorID = 0;
+
+    /// Run the next sub-operation and return the status to report.
+    DIC_US step(bool cancelled) {
+        if (finalStatus != 0) return finalStatus;
+        if (cancelled || sim->stopping) return kStatusCancel;
+        if (next >= selected.size()) {
+            return failed > 0 ? kStatusSubOperationsFailed : STATUS_Success;
+        }
+
+        sim->delay();
+        const char* originator = subNet ? originatorAE.c_str() : nullptr;
+        if (storeSubOperation(assoc, selected[next++], originator, originatorID)) {
+            completed++;
+        } else {
+            failed++;
+        }
+        return STATUS_Pending;
+    }
+
+    int remaining() const { return (int)(selected.size() - next); }
+};
+
+void getProviderCallback(
+    void* callbackData,
+    OFBool cancelled,
+    T_DIMSE_C_GetRQ* /* request */,
+    DcmDataset* requestIdentifiers,
+    int /* responseCount */,
+    T_DIMSE_C_GetRSP* response,
+    DcmDataset** /* statusDetail */,
+    DcmDataset** responseIdentifiers)
+{
+    RetrieveJob* job = static_cast<RetrieveJob*>(callbackData);
+    *responseIdentifiers = nullptr;
+
+    if (!job->started) {
+        job->started = true;
+        job->selected = selectInstances(job->sim, requestIdentifiers);
+    }
+
+    response->DimseStatus = job->step(cancelled);
+    response->NumberOfCompletedSubOperations = job->completed;
+    response->NumberOfFailedSubOperations = job->failed;
+    response->NumberOfWarningSubOperations = 0;
+    response->opts = O_GET_NUMBEROFCOMPLETEDSUBOPERATIONS | O_GET_NUMBEROFFAILEDSUBOPERATIONS |
+                     O_GET_NUMBEROFWARNINGSUBOPERATIONS;
+    if (response->DimseStatus == STATUS_Pending) {
+        response->NumberOfRemainingSubOperations = job->remaining();
+        response->opts |= O_GET_NUMBEROFREMAININGSUBOPERATIONS;
+    }
+}
+
+// --- Helper: Open the sub-operation association to a C-MOVE destination ---
+DIC_US startMove(RetrieveJob& job, T_DIMSE_C_MoveRQ* request, DcmDataset* identifiers) {
+    job.selected = selectInstances(job.sim, identifiers);
+
+    DB_DicomNode destination;
+    {
+        std::lock_guard<std::mutex> lock(job.sim->mutex);
+        auto it = job.sim->moveDestinations.find(trimmed(request->MoveDestination));
+        if (it == job.sim->moveDestinations.end()) {
+            return kStatusMoveDestinationUnknown;
+        }
+        destination = it->second;
+    }
+    if (job.selected.empty()) return 0;
+
+    std::set<std::string> sopClasses;
+    for (const ServedInstance& instance : job.selected) {
+        sopClasses.insert(instance.sopClassUID);
+    }
+    std::vector<PresentationContextSpec> contexts;
+    for (const std::string& sopClass : sopClasses) {
+        if (contexts.size() == 128) break;
+        contexts.push_back({sopClass.c_str(), ASC_SC_ROLE_DEFAULT, false});
+    }
+
+    OFCondition cond = createAssociation(
+        job.sim->config.aeTitle, &destination, contexts.data(), contexts.size(),
+        job.subNet, job.assoc, kTimeoutSeconds);
+    if (cond.bad()) {
+        job.subNet = nullptr;
+        job.assoc = nullptr;
+        return kStatusOutOfResources;
+    }
+    return 0;
+}
+
+void moveProviderCallback(
+    void* callbackData,
+    OFBool cancelled,
+    T_DIMSE_C_MoveRQ* request,
+    DcmDataset* requestIdentifiers,
+    int /* responseCount */,
+    T_DIMSE_C_MoveRSP* response,
+    DcmDataset** /* statusDetail */,
+    DcmDataset** responseIdentifiers)
+{
+    RetrieveJob* job = static_cast<RetrieveJob*>(callbackData);
+    *responseIdentifiers = nullptr;
+
+    if (!job->started) {
+        job->started = true;
+        job->originatorID = request->MessageID;
+        job->finalStatus = startMove(*job, request, requestIdentifiers);
+    }
+
+    response->DimseStatus = job->step(cancelled);
+    response->NumberOfCompletedSubOperations = job->completed;
+    response->NumberOfFailedSubOperations = job->failed;
+    response->NumberOfWarningSubOperations = 0;
+    response->opts = O_MOVE_NUMBEROFCOMPLETEDSUBOPERATIONS | O_MOVE_NUMBEROFFAILEDSUBOPERATIONS |
+                     O_MOVE_NUMBEROFWARNINGSUBOPERATIONS;
+    if (response->DimseStatus == STATUS_Pending) {
+        response->NumberOfRemainingSubOperations = job->remaining();
+        response->opts |= O_MOVE_NUMBEROFREMAININGSUBOPERATIONS;
+    }
+}
+
+// ========================================================================
+// C-STORE
+// ========================================================================
+
+void storeProviderCallback(
+    void* callbackData,
+    T_DIMSE_StoreProgress* progress,
+    T_DIMSE_C_StoreRQ* /* request */,
+    char* /* imageFileName */,
+    DcmDataset** /* imageDataSet */,
+    T_DIMSE_C_StoreRSP* /* response */,
+    DcmDataset** /* statusDetail */)
+{
+    if (progress->state == DIMSE_StoreEnd) {
+        static_cast<DB_PacsSimulator*>(callbackData)->delay();
+    }
+}
+
+OFCondition handleStore(DB_PacsSimulator* sim,
+                        T_ASC_Association* assoc,
+                        T_ASC_PresentationContextID presID,
+                        T_DIMSE_C_StoreRQ& request)
+{
+    std::string finalPath = (fs::path(sim->folder) /
+                             instanceFileName(request.AffectedSOPInstanceUID)).string();
+    std::string partialPath = finalPath + ".part";
+
+    OFCondition cond = DIMSE_storeProvider(
+        assoc, presID, &request,
+        partialPath.c_str(), OFTrue, nullptr,
+        storeProviderCallback, sim,
+        DIMSE_BLOCKING, kTimeoutSeconds);
+
+    ServedInstance instance;
+    if (cond.good() && rename(partialPath.c_str(), finalPath.c_str()) == 0 &&
+        indexFile(finalPath, instance)) {
+        std::lock_guard<std::mutex> lock(sim->mutex);
+        sim->addInstance(std::move(instance));
+    } else {
+        remove(partialPath.c_str());
+    }
+    return cond;
+}
+
+// ========================================================================
+// Associations
+// ========================================================================
+
+bool isSupportedSyntax(const char* abstractSyntax) {
+    static const char* const services[] = {
+        UID_VerificationSOPClass,
+        UID_FINDStudyRootQueryRetrieveInformationModel,
+        UID_MOVEStudyRootQueryRetrieveInformationModel,
+        UID_GETStudyRootQueryRetrieveInformationModel
+    };
+    for (const char* uid : services) {
+        if (strcmp(uid, abstractSyntax) == 0) return true;
+    }
+    return dcmIsaStorageSOPClassUID(abstractSyntax);
+}
+
+// --- Helper: Accept supported contexts, mirroring the proposed role so
+//     C-GET requestors can take the storage SCP role ---
+OFCondition negotiateContexts(T_ASC_Parameters* params) {
+    static const char* const transferSyntaxes[] = {
+        UID_LittleEndianExplicitTransferSyntax,
+        UID_LittleEndianImplicitTransferSyntax,
+        UID_BigEndianExplicitTransferSyntax
+    };
+
+    OFCondition cond = EC_Normal;
+    int count = ASC_countPresentationContexts(params);
+    for (int i = 0; i < count && cond.good(); i++) {
+        T_ASC_PresentationContext pc;
+        cond = ASC_getPresentationContext(params, i, &pc);
+        if (cond.bad()) break;
+
+        const char* chosen = nullptr;
+        if (isSupportedSyntax(pc.abstractSyntax)) {
+            for (const char* ts : transferSyntaxes) {
+                for (int j = 0; j < (int)pc.transferSyntaxCount && !chosen; j++) {
+                    if (strcmp(pc.proposedTransferSyntaxes[j], ts) == 0) chosen = ts;
+                }
+                if (chosen) break;
+            }
+        }
+
+        if (chosen) {
+            T_ASC_SC_ROLE role = pc.proposedRole == ASC_SC_ROLE_SCP ? ASC_SC_ROLE_SCP
+                                                                    : ASC_SC_ROLE_DEFAULT;
+            cond = ASC_acceptPresentationContext(params, pc.presentationContextID, chosen, role);
+        } else {
+            cond = ASC_refusePresentationContext(params, pc.presentationContextID,
+                                                 ASC_P_ABSTRACTSYNTAXNOTSUPPORTED);
+        }
+    }
+    return cond;
+}
+
+void serveAssociation(DB_PacsSimulator* sim, T_ASC_Association* assoc) {
+    bool open = false;
+
+    T_ASC_RejectParameters reject = {
+        ASC_RESULT_REJECTEDPERMANENT,
+        ASC_SOURCE_SERVICEUSER,
+        ASC_REASON_SU_NOREASON
+    };
+    if (trimmed(assoc->params->DULparams.calledAPTitle) != sim->config.aeTitle) {
+        reject.reason = ASC_REASON_SU_CALLEDAETITLENOTRECOGNIZED;
+        ASC_rejectAssociation(assoc, &reject);
+    } else if (negotiateContexts(assoc->params).bad()) {
+        ASC_rejectAssociation(assoc, &reject);
+    } else {
+        ASC_setAPTitles(assoc->params, nullptr, nullptr, sim->config.aeTitle);
+        sim->delay();
+        open = ASC_acknowledgeAssociation(assoc).good();
+    }
+
+    while (open && !sim->stopping) {
+        T_DIMSE_Message msg;
+        memset(&msg, 0, sizeof(msg));
+        T_ASC_PresentationContextID presID = 0;
+
+        OFCondition cond = DIMSE_receiveCommand(assoc, DIMSE_NONBLOCKING, 1,
+                                                &presID, &msg, nullptr);
+        if (cond == DIMSE_NODATAAVAILABLE) continue;
+        if (cond == DUL_PEERREQUESTEDRELEASE) {
+            ASC_acknowledgeRelease(assoc);
+            open = false;
+            break;
+        }
+        if (cond.bad()) break;
+
+        switch (msg.CommandField) {
+            case DIMSE_C_ECHO_RQ:
+                sim->delay();
+                cond = DIMSE_sendEchoResponse(assoc, presID, &msg.msg.CEchoRQ,
+                                              STATUS_Success, nullptr);
+                break;
+
+            case DIMSE_C_STORE_RQ:
+                cond = handleStore(sim, assoc, presID, msg.msg.CStoreRQ);
+                break;
+
+            case DIMSE_C_FIND_RQ: {
+                FindJob job;
+                job.sim = sim;
+                cond = DIMSE_findProvider(assoc, presID, &msg.msg.CFindRQ,
+                                          findProviderCallback, &job,
+                                          DIMSE_BLOCKING, kTimeoutSeconds);
+                break;
+            }
+
+            case DIMSE_C_GET_RQ: {
+                RetrieveJob job;
+                job.sim = sim;
+                job.assoc = assoc;
+                cond = DIMSE_getProvider(assoc, presID, &msg.msg.CGetRQ,
+                                         getProviderCallback, &job,
+                                         DIMSE_BLOCKING, kTimeoutSeconds);
+                break;
+            }
+
+            case DIMSE_C_MOVE_RQ: {
+                RetrieveJob job;
+                job.sim = sim;
+                job.assoc = nullptr;
+                job.originatorAE = assoc->params->DULparams.callingAPTitle;
+                cond = DIMSE_moveProvider(assoc, presID, &msg.msg.CMoveRQ,
+                                          moveProviderCallback, &job,
+                                          DIMSE_BLOCKING, kTimeoutSeconds);
+                if (job.subNet) {
+                    releaseAssociation(job.assoc, job.subNet);
+                }
+                break;
+            }
+
+            default:
+                cond = DIMSE_BADCOMMANDTYPE;
+                break;
+        }
+        if (cond.bad()) break;
+    }
+
+    if (open) {
+        ASC_abortAssociation(assoc);
+    }
+    ASC_dropSCPAssociation(assoc);
+    ASC_destroyAssociation(&assoc);
+
+    std::lock_guard<std::mutex> lock(sim->mutex);
+    sim->activeAssociations--;
+    sim->idle.notify_all();
+}
+
+void acceptLoop(DB_PacsSimulator* sim) {
+    const bool paced = sim->config.bandwidthMBps > 0.0;
+
+    while (!sim->stopping) {
+        T_ASC_Association* assoc = nullptr;
+        OFCondition cond = ASC_receiveAssociation(
+            sim->net, &assoc, ASC_DEFAULTMAXPDU, nullptr, nullptr,
+            paced ? OFTrue : OFFalse, DUL_NOBLOCK, 1);
+
+        if (cond.bad()) {
+            if (assoc) {
+                ASC_dropSCPAssociation(assoc);
+                ASC_destroyAssociation(&assoc);
+            }
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(sim->mutex);
+            sim->activeAssociations++;
+        }
+        std::thread(serveAssociation, sim, assoc).detach();
+    }
+}
+
+}  // namespace
+
+// ========================================================================
+// Lifecycle
+// ========================================================================
+
+DB_PacsSimulator* db_pacs_simulator_start(const DB_PacsSimulatorConfig* config,
+                                          const char* storageFolder) {
+    if (!config || !storageFolder || config->aeTitle[0] == '\0' ||
+        config->port <= 0 || config->port > 65535 ||
+        config->latencyMs < 0 || config->bandwidthMBps < 0.0) {
+        return nullptr;
+    }
+
+    std::error_code ec;
+    if (!fs::is_directory(storageFolder, ec)) {
+        return nullptr;
+    }
+
+    auto sim = std::make_unique<DB_PacsSimulator>();
+    sim->config = *config;
+    sim->config.aeTitle[sizeof(sim->config.aeTitle) - 1] = '\0';
+    sim->folder = storageFolder;
+
+    for (const auto& entry : fs::recursive_directory_iterator(
+             storageFolder, fs::directory_options::skip_permission_denied, ec)) {
+        if (!entry.is_regular_file(ec)) continue;
+        ServedInstance instance;
+        if (indexFile(entry.path().string(), instance)) {
+            sim->addInstance(std::move(instance));
+        }
+    }
+
+    OFCondition cond = ASC_initializeNetwork(NET_ACCEPTOR, config->port,
+                                             kTimeoutSeconds, &sim->net);
+    if (cond.bad()) {
+        return nullptr;
+    }
+
+    if (config->bandwidthMBps > 0.0) {
+        double bytesPerSecond = config->bandwidthMBps * 1024.0 * 1024.0;
+        cond = ASC_setTransportLayer(sim->net, new PacedTransportLayer(bytesPerSecond), OFTrue);
+        if (cond.bad()) {
+            ASC_dropNetwork(&sim->net);
+            return nullptr;
+        }
+    }
+
+    sim->acceptThread = std::thread(acceptLoop, sim.get());
+    return sim.release();
+}
+
+void db_pacs_simulator_stop(DB_PacsSimulator* simulator) {
+    if (!simulator) return;
+
+    simulator->stopping = true;
+    if (simulator->acceptThread.joinable()) {
+        simulator->acceptThread.join();
+    }
+    {
+        std::unique_lock<std::mutex> lock(simulator->mutex);
+        simulator->idle.wait(lock, [&] { return simulator->activeAssociations == 0; });
+    }
+    ASC_dropNetwork(&simulator->net);
+    delete simulator;
+}
+
+DB_Status db_pacs_simulator_add_move_destination(DB_PacsSimulator* simulator,
+                                                 const DB_DicomNode* destination) {
+    if (!simulator || !destination || destination->aeTitle[0] == '\0') {
+        return DB_STATUS_ERROR;
+    }
+
+    std::lock_guard<std::mutex> lock(simulator->mutex);
+    simulator->moveDestinations[trimmed(destination->aeTitle)] = *destination;
+    return DB_STATUS_OK;
+}
+
+int db_pacs_simulator_instance_count(DB_PacsSimulator* simulator) {
+    if (!simulator) return 0;
+
+    std::lock_guard<std::mutex> lock(simulator->mutex);
+    return (int)simulator->instances.size();
+}
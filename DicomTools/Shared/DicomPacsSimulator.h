@@ -0,0 +1,53 @@
+//
+//  DicomPacsSimulator.h
+//  DicomTools
+//
+//  C interface of the local PACS simulator shared by the dicom-pacs-sim
+//  and dicom-netbench tools. Built into the tools only, not DicomCore.
+//
+
+#ifndef DICOM_PACS_SIMULATOR_H
+#define DICOM_PACS_SIMULATOR_H
+
+#include "DicomBridge.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Opaque handle to an in-process Query/Retrieve + Storage SCP used for
+/// testing and benchmarking without a real PACS.
+typedef struct DB_PacsSimulator DB_PacsSimulator;
+
+/// PACS simulator configuration
+typedef struct {
+    char aeTitle[17];           // Called AE title the simulator answers to
+    int port;                   // TCP port to listen on
+    int latencyMs;              // Delay before association accept, each first
+                                // response and each sub-operation
+    double bandwidthMBps;       // Link speed per association, both directions
+                                // combined (0 = unlimited)
+} DB_PacsSimulatorConfig;
+
+/// Start serving the DICOM files found under storageFolder (recursively).
+/// Supports C-ECHO, Study Root C-FIND/C-MOVE/C-GET and C-STORE; received
+/// instances are written to storageFolder and served as well.
+/// Returns NULL if the folder does not exist or the port cannot be bound.
+DB_PacsSimulator* db_pacs_simulator_start(const DB_PacsSimulatorConfig* config,
+                                          const char* storageFolder);
+
+/// Stop listening, abort open associations and free the simulator.
+void db_pacs_simulator_stop(DB_PacsSimulator* simulator);
+
+/// Register an AE title the simulator may send C-MOVE sub-operations to.
+DB_Status db_pacs_simulator_add_move_destination(DB_PacsSimulator* simulator,
+                                                 const DB_DicomNode* destination);
+
+/// Number of instances currently served.
+int db_pacs_simulator_instance_count(DB_PacsSimulator* simulator);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DICOM_PACS_SIMULATOR_H */
@@ -15,6 +15,8 @@ enum TagAction: String, Codable, Sendable {
     case keep           // Keep the original value
     case empty          // Replace with an empty string
     case generateUID    // Generate a new UID
+    case dummy          // Replace with a dummy value valid for the VR
+    case clean          // Shift dates, remap UIDs, clean sequence items
 }
 
 /// Rule for handling a specific DICOM tag
@@ -40,6 +42,30 @@ struct TagRule: Codable, Sendable, Identifiable {
     }
 }
 
+/// Private attribute kept when private tags are removed, named by its
+/// Private Creator and its offset within the creator's block
+struct PrivateTagRule: Codable, Sendable, Identifiable {
+    let id: UUID
+    let tagName: String           // e.g., "DiffusionBValue"
+    let group: UInt16             // Odd private group, e.g., 0x0019
+    let privateCreator: String    // e.g., "SIEMENS MR HEADER"
+    let offset: UInt8             // Low byte of the element, e.g., 0x0C
+
+    init(
+        id: UUID = UUID(),
+        tagName: String,
+        group: UInt16,
+        privateCreator: String,
+        offset: UInt8
+    ) {
+        self.id = id
+        self.tagName = tagName
+        self.group = group
+        self.privateCreator = privateCreator
+        self.offset = offset
+    }
+}
+
 /// Date shifting strategy
 enum DateShiftStrategy: String, Codable, CaseIterable, Sendable {
     case none           = "No Date Shifting"
@@ -105,6 +131,7 @@ struct AnonymizationProfile: Codable, Identifiable, Sendable {
 
     // Additional options
     var removePrivateTags: Bool
+    var keptPrivateTags: [PrivateTagRule]  // Kept despite removePrivateTags
     var removeCurves: Bool
     var removeOverlays: Bool
 
@@ -122,6 +149,7 @@ struct AnonymizationProfile: Codable, Identifiable, Sendable {
         replaceSeriesInstanceUID: Bool = true,
         replaceSOPInstanceUID: Bool = true,
         removePrivateTags: Bool = true,
+        keptPrivateTags: [PrivateTagRule] = [],
         removeCurves: Bool = true,
         removeOverlays: Bool = true
     ) {
@@ -138,6 +166,7 @@ struct AnonymizationProfile: Codable, Identifiable, Sendable {
         self.replaceSeriesInstanceUID = replaceSeriesInstanceUID
         self.replaceSOPInstanceUID = replaceSOPInstanceUID
         self.removePrivateTags = removePrivateTags
+        self.keptPrivateTags = keptPrivateTags
         self.removeCurves = removeCurves
         self.removeOverlays = removeOverlays
     }
@@ -206,6 +235,13 @@ struct AnonymizationProfile: Codable, Identifiable, Sendable {
             patientIDStrategy: .sequential,
             maintainPatientMapping: true,
             removePrivateTags: true,
+            keptPrivateTags: [
+                // Diffusion b-values, needed to read DWI series
+                PrivateTagRule(tagName: "SiemensDiffusionBValue", group: 0x0019,
+                               privateCreator: "SIEMENS MR HEADER", offset: 0x0C),
+                PrivateTagRule(tagName: "GEDiffusionBValue", group: 0x0043,
+                               privateCreator: "GEMS_PARM_01", offset: 0x39),
+            ],
             removeCurves: true,
             removeOverlays: true
         )
@@ -6,15 +6,20 @@
 //
 
 import Foundation
+import Security
 
 /// Service for DICOM anonymization operations
 final class DicomAnonymizationService: Sendable {
 
     private let database: DatabaseManager
-    private let patientMappings = PatientMappingStore()
+    private let patientMappings: PatientMappingStore
+    private let hashKey: String
 
     init(database: DatabaseManager) {
         self.database = database
+        let hashKey = InstallationKey.hashKey()
+        self.hashKey = hashKey
+        self.patientMappings = PatientMappingStore(hashKey: hashKey)
     }
 
     // MARK: - Anonymization Operations
@@ -27,7 +32,8 @@ final class DicomAnonymizationService: Sendable {
     ) async throws {
         try await Task.detached {
             // Build configuration from profile
-            var config = try self.buildConfiguration(from: profile, inputPath: inputPath)
+            var config = self.buildConfiguration(from: profile)
+            defer { self.releaseConfiguration(config) }
 
             // Perform anonymization
             let status = db_anonymize_file(inputPath, outputPath, &config)
@@ -44,7 +50,8 @@ final class DicomAnonymizationService: Sendable {
         profile: AnonymizationProfile
     ) async throws {
         try await Task.detached {
-            var config = try self.buildConfiguration(from: profile, inputPath: filePath)
+            var config = self.buildConfiguration(from: profile)
+            defer { self.releaseConfiguration(config) }
 
             let status = db_anonymize_file_inplace(filePath, &config)
 
@@ -60,35 +67,82 @@ final class DicomAnonymizationService: Sendable {
         profile: AnonymizationProfile,
         onProgress: @escaping @Sendable (Int, Int) -> Void
     ) async throws -> AnonymizationResult {
-        var successCount = 0
-        var failureCount = 0
-        var processedFiles: [URL] = []
-        var errors: [String] = []
-
-        for (index, filePair) in files.enumerated() {
-            do {
-                try await anonymizeFile(
-                    inputPath: filePair.input,
-                    outputPath: filePair.output,
-                    profile: profile
-                )
-                processedFiles.append(URL(fileURLWithPath: filePair.output))
-                successCount += 1
-            } catch {
-                failureCount += 1
-                errors.append("\(filePair.input): \(error.localizedDescription)")
+        try await Task.detached {
+            // One batch for all patients: the core asks for each patient's
+            // ID mapping and date shift as it reads their first file
+            var config = self.buildConfiguration(from: profile)
+            defer { self.releaseConfiguration(config) }
+
+            // One UID map for the whole batch keeps studies and series
+            // together and references between files intact
+            let replacesUIDs = profile.replaceStudyInstanceUID ||
+                profile.replaceSeriesInstanceUID || profile.replaceSOPInstanceUID
+            let uidMap = replacesUIDs ? db_uid_map_create(nil) : nil
+            defer { db_uid_map_destroy(uidMap) }
+            config.uidMap = uidMap
+
+            let inputs = files.map { strdup($0.input) }
+            let outputs = files.map { strdup($0.output) }
+            defer {
+                inputs.forEach { free($0) }
+                outputs.forEach { free($0) }
             }
+            let inputPtrs: [UnsafePointer<CChar>?] = inputs.map { $0.map { UnsafePointer($0) } }
+            let outputPtrs: [UnsafePointer<CChar>?] = outputs.map { $0.map { UnsafePointer($0) } }
+            var statuses = [DB_Status](repeating: DB_STATUS_ERROR, count: files.count)
 
-            onProgress(index + 1, files.count)
-        }
+            let context = BatchProgressContext(total: files.count, onProgress: onProgress)
+            let contextPtr = Unmanaged.passRetained(context).toOpaque()
+            defer { Unmanaged<BatchProgressContext>.fromOpaque(contextPtr).release() }
 
-        return AnonymizationResult(
-            successCount: successCount,
-            failureCount: failureCount,
-            processedFiles: processedFiles,
-            patientMappings: patientMappings.getAllMappings(),
-            errors: errors
-        )
+            let cCallback: DB_AnonymizeProgressCallback = { userData, filesDone, _, _, _ in
+                guard let userData = userData else { return }
+
+                let context = Unmanaged<BatchProgressContext>.fromOpaque(userData)
+                    .takeUnretainedValue()
+
+                context.onProgress(Int(filesDone), context.total)
+            }
+
+            _ = inputPtrs.withUnsafeBufferPointer { inputBuffer in
+                outputPtrs.withUnsafeBufferPointer { outputBuffer in
+                    db_anonymize_batch(
+                        inputBuffer.baseAddress,
+                        outputBuffer.baseAddress,
+                        Int32(files.count),
+                        &config,
+                        0,
+                        &statuses,
+                        cCallback,
+                        contextPtr
+                    )
+                }
+            }
+
+            var successCount = 0
+            var failureCount = 0
+            var processedFiles: [URL] = []
+            var errors: [String] = []
+
+            for (index, filePair) in files.enumerated() {
+                if statuses[index] == DB_STATUS_OK {
+                    processedFiles.append(URL(fileURLWithPath: filePair.output))
+                    successCount += 1
+                } else {
+                    failureCount += 1
+                    let error = AnonymizationError.operationFailed(path: filePair.input)
+                    errors.append("\(filePair.input): \(error.localizedDescription)")
+                }
+            }
+
+            return AnonymizationResult(
+                successCount: successCount,
+                failureCount: failureCount,
+                processedFiles: processedFiles,
+                patientMappings: self.patientMappings.getAllMappings(),
+                errors: errors
+            )
+        }.value
     }
 
     /// Anonymize all instances in a series
@@ -127,12 +181,9 @@ final class DicomAnonymizationService: Sendable {
 
     // MARK: - Configuration Building
 
-    private func buildConfiguration(
-        from profile: AnonymizationProfile,
-        inputPath: String
-    ) throws -> DB_AnonymizationConfig {
+    private func buildConfiguration(from profile: AnonymizationProfile) -> DB_AnonymizationConfig {
         // Convert tag rules to C structs
-        var cTagRules = profile.tagRules.map { rule -> DB_TagRule in
+        let cTagRules = profile.tagRules.map { rule -> DB_TagRule in
             var cRule = DB_TagRule()
 
             // Parse tag code (e.g., "(0010,0010)")
@@ -157,44 +208,11 @@ final class DicomAnonymizationService: Sendable {
             return cRule
         }
 
-        // Handle patient ID mapping for hash strategy
-        if profile.patientIDStrategy == .hash {
-            // Get original patient ID from file
-            if let originalID = try? extractPatientID(from: inputPath) {
-                let anonymizedID = patientMappings.getOrCreateMapping(
-                    originalID: originalID,
-                    strategy: profile.patientIDStrategy,
-                    prefix: profile.patientIDPrefix
-                )
-
-                // Add rule to replace patient ID with mapped value
-                var patientIDRule = DB_TagRule()
-                patientIDRule.group = 0x0010
-                patientIDRule.element = 0x0020
-                patientIDRule.action = DB_TAG_ACTION_REPLACE
-
-                withUnsafeMutableBytes(of: &patientIDRule.replacementValue) { buffer in
-                    let count = min(anonymizedID.count, buffer.count - 1)
-                    anonymizedID.utf8.prefix(count).enumerated().forEach { index, byte in
-                        buffer[index] = byte
-                    }
-                    buffer[count] = 0
-                }
-
-                cTagRules.append(patientIDRule)
-            }
-        }
-
-        // Calculate date shift days
+        // Calculate date shift days; a random shift is per patient
         var dateShiftDays: Int32 = 0
         switch profile.dateShiftStrategy {
-        case .none:
+        case .none, .random:
             dateShiftDays = 0
-        case .random:
-            // Use a consistent random shift per patient
-            if let originalID = try? extractPatientID(from: inputPath) {
-                dateShiftDays = Int32(patientMappings.getDateShift(forPatientID: originalID))
-            }
         case .fixed:
             dateShiftDays = Int32(profile.dateShiftDays ?? 0)
         case .remove:
@@ -210,15 +228,65 @@ final class DicomAnonymizationService: Sendable {
         config.replaceSeriesUID = profile.replaceSeriesInstanceUID
         config.replaceSOPUID = profile.replaceSOPInstanceUID
         config.dateShiftDays = dateShiftDays
+        // Compressed studies stay compressed, pixel data is copied as is
+        config.preserveTransferSyntax = true
+        // Hashed values and new UIDs cannot be recomputed without the key
+        config.hashKey = UnsafePointer(strdup(hashKey))
 
         // Copy tag rules
         for (index, rule) in cTagRules.enumerated() {
             config.tagRules[index] = rule
         }
 
+        // Private attributes kept when private tags are removed
+        let privateRules = UnsafeMutablePointer<DB_PrivateTagRule>.allocate(
+            capacity: profile.keptPrivateTags.count)
+        for (index, rule) in profile.keptPrivateTags.enumerated() {
+            var cRule = DB_PrivateTagRule()
+            cRule.group = rule.group
+            cRule.offset = rule.offset
+            withUnsafeMutableBytes(of: &cRule.privateCreator) { buffer in
+                let count = min(rule.privateCreator.utf8.count, buffer.count - 1)
+                rule.privateCreator.utf8.prefix(count).enumerated().forEach { index, byte in
+                    buffer[index] = byte
+                }
+                buffer[count] = 0
+            }
+            privateRules[index] = cRule
+        }
+        config.privateTagRules = UnsafePointer(privateRules)
+        config.privateTagRuleCount = Int32(profile.keptPrivateTags.count)
+
+        // Hashed patient IDs and random date shifts are consistent per
+        // patient; the core resolves them from each file's PatientID
+        if profile.patientIDStrategy == .hash || profile.dateShiftStrategy == .random {
+            let context = PatientOverrideContext(mappings: patientMappings, profile: profile)
+            config.patientOverrideUserData = Unmanaged.passRetained(context).toOpaque()
+            config.patientOverride = { userData, patientID, outOverride in
+                guard let userData = userData, let outOverride = outOverride else { return false }
+
+                let context = Unmanaged<PatientOverrideContext>.fromOpaque(userData)
+                    .takeUnretainedValue()
+
+                let originalID = patientID.map { String(cString: $0) } ?? ""
+                context.resolve(originalID: originalID.isEmpty ? "UNKNOWN" : originalID,
+                                into: &outOverride.pointee)
+                return true
+            }
+        }
+
         return config
     }
 
+    private func releaseConfiguration(_ config: DB_AnonymizationConfig) {
+        config.tagRules.deallocate()
+        UnsafeMutablePointer(mutating: config.privateTagRules)?.deallocate()
+        free(UnsafeMutablePointer(mutating: config.hashKey))
+        if let userData = config.patientOverrideUserData {
+            Unmanaged<PatientOverrideContext>.fromOpaque(userData).release()
+        }
+    }
+
     // MARK: - Helper Methods
 
     private func parseTagCode(_ code: String) -> (group: UInt16, element: UInt16) {
@@ -245,25 +313,10 @@ final class DicomAnonymizationService: Sendable {
         case .keep: return DB_TAG_ACTION_KEEP
         case .empty: return DB_TAG_ACTION_EMPTY
         case .generateUID: return DB_TAG_ACTION_GENERATE_UID
+        case .dummy: return DB_TAG_ACTION_DUMMY
+        case .clean: return DB_TAG_ACTION_CLEAN
         }
     }
-
-    private func extractPatientID(from filePath: String) throws -> String {
-        // Extract patient ID from DICOM file
-        var tags = DB_DicomTags()
-        let status = db_extract_tags(filePath, &tags)
-
-        guard status == DB_STATUS_OK else {
-            return "UNKNOWN"
-        }
-
-        let patientID = withUnsafeBytes(of: &tags.patientID) { buffer in
-            let bytes = buffer.bindMemory(to: UInt8.self)
-            return String(decoding: bytes, as: UTF8.self)
-        }.trimmingCharacters(in: CharacterSet(charactersIn: "\0"))
-
-        return patientID.isEmpty ? "UNKNOWN" : patientID
-    }
 }
 
 // MARK: - Patient Mapping Store
@@ -274,6 +327,11 @@ final class PatientMappingStore: @unchecked Sendable {
     private var dateShifts: [String: Int] = [:]
     private var sequentialCounter = 0
     private let lock = NSLock()
+    private let hashKey: String
+
+    init(hashKey: String) {
+        self.hashKey = hashKey
+    }
 
     func getOrCreateMapping(
         originalID: String,
@@ -294,8 +352,9 @@ final class PatientMappingStore: @unchecked Sendable {
             anonymizedID = String(format: "%@%04d", prefix, sequentialCounter)
 
         case .hash:
+            // Keyed, so an ID cannot be recovered by hashing candidates
             var hashOutput = [CChar](repeating: 0, count: 65)
-            db_generate_hash(originalID, &hashOutput, 65)
+            db_generate_keyed_hash(hashKey, originalID, &hashOutput, 65)
             let fullHash = hashOutput.withUnsafeBytes { buffer in
                 let bytes = buffer.bindMemory(to: UInt8.self)
                 return String(decoding: bytes, as: UTF8.self)
@@ -344,6 +403,98 @@ final class PatientMappingStore: @unchecked Sendable {
     }
 }
 
+// MARK: - Installation Key
+
+/// Secret for keyed hashing, generated once per installation and kept in
+/// the keychain
+enum InstallationKey {
+    private static let service = "com.mystudio.DicomVmac.anonymization"
+    private static let account = "hash-key"
+
+    static func hashKey() -> String {
+        let query: [String: Any] = [
+            kSecClass as String: kSecClassGenericPassword,
+            kSecAttrService as String: service,
+            kSecAttrAccount as String: account,
+            kSecReturnData as String: true,
+            kSecMatchLimit as String: kSecMatchLimitOne
+        ]
+        var item: CFTypeRef?
+        if SecItemCopyMatching(query as CFDictionary, &item) == errSecSuccess,
+           let data = item as? Data,
+           let key = String(data: data, encoding: .utf8), !key.isEmpty {
+            return key
+        }
+
+        // 256 random bits, hex encoded
+        var bytes = [UInt8](repeating: 0, count: 32)
+        if SecRandomCopyBytes(kSecRandomDefault, bytes.count, &bytes) != errSecSuccess {
+            bytes = (0..<32).map { _ in UInt8.random(in: 0...255) }
+        }
+        let key = bytes.map { String(format: "%02x", $0) }.joined()
+
+        let attributes: [String: Any] = [
+            kSecClass as String: kSecClassGenericPassword,
+            kSecAttrService as String: service,
+            kSecAttrAccount as String: account,
+            kSecAttrAccessible as String: kSecAttrAccessibleAfterFirstUnlockThisDeviceOnly,
+            kSecValueData as String: Data(key.utf8)
+        ]
+        let status = SecItemAdd(attributes as CFDictionary, nil)
+        if status != errSecSuccess {
+            NSLog("[DicomVmac] Failed to store anonymization key: %d", status)
+        }
+        return key
+    }
+}
+
+// MARK: - Batch Progress
+
+/// Context for db_anonymize_batch progress callbacks
+private final class BatchProgressContext: @unchecked Sendable {
+    let total: Int
+    let onProgress: @Sendable (Int, Int) -> Void
+
+    init(total: Int, onProgress: @escaping @Sendable (Int, Int) -> Void) {
+        self.total = total
+        self.onProgress = onProgress
+    }
+}
+
+// MARK: - Patient Overrides
+
+/// Context for the core's per-patient callback: mapped IDs and date shifts
+/// come from the service's mapping store
+private final class PatientOverrideContext: @unchecked Sendable {
+    let mappings: PatientMappingStore
+    let profile: AnonymizationProfile
+
+    init(mappings: PatientMappingStore, profile: AnonymizationProfile) {
+        self.mappings = mappings
+        self.profile = profile
+    }
+
+    func resolve(originalID: String, into values: inout DB_PatientOverride) {
+        if profile.patientIDStrategy == .hash {
+            let anonymizedID = mappings.getOrCreateMapping(
+                originalID: originalID,
+                strategy: profile.patientIDStrategy,
+                prefix: profile.patientIDPrefix
+            )
+            withUnsafeMutableBytes(of: &values.patientID) { buffer in
+                let count = min(anonymizedID.utf8.count, buffer.count - 1)
+                anonymizedID.utf8.prefix(count).enumerated().forEach { index, byte in
+                    buffer[index] = byte
+                }
+                buffer[count] = 0
+            }
+        }
+        if profile.dateShiftStrategy == .random {
+            values.dateShiftDays = Int32(mappings.getDateShift(forPatientID: originalID))
+        }
+    }
+}
+
 // MARK: - Errors
 
 enum AnonymizationError: Error, LocalizedError {
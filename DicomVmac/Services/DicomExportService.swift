@@ -6,7 +6,6 @@
 //
 
 import Foundation
-import AppKit
 
 /// Service for DICOM export and format conversion
 final class DicomExportService: Sendable {
@@ -21,7 +20,8 @@ final class DicomExportService: Sendable {
 
     // MARK: - Export Operations
 
-    /// Export images based on options
+    /// Export images based on options. Decoding, windowing and encoding
+    /// run concurrently in DicomCore.
     func export(
         instances: [Instance],
         options: DicomExportOptions,
@@ -37,69 +37,79 @@ final class DicomExportService: Sendable {
             withIntermediateDirectories: true
         )
 
-        var successCount = 0
-        var failureCount = 0
-        var exportedFiles: [URL] = []
-        var errors: [String] = []
-
-        // Export each instance
-        for (index, instance) in instances.enumerated() {
-            do {
-                let fileURL = try await exportInstance(
-                    instance,
-                    options: options,
-                    index: index,
-                    totalCount: instances.count
+        let outputURLs = try instances.enumerated().map { index, instance in
+            try outputURL(for: instance, index: index, options: options, destinationURL: destinationURL)
+        }
+
+        return await Task.detached {
+            let inputs = instances.map { strdup($0.filePath) }
+            let outputs = outputURLs.map { strdup($0.path) }
+            defer {
+                inputs.forEach { free($0) }
+                outputs.forEach { free($0) }
+            }
+            let items = zip(inputs, outputs).map { input, output in
+                DB_ExportItem(
+                    inputPath: input.map { UnsafePointer($0) },
+                    frameIndex: 0,
+                    outputPath: output.map { UnsafePointer($0) }
                 )
-                exportedFiles.append(fileURL)
-                successCount += 1
-            } catch {
-                failureCount += 1
-                errors.append("\(instance.sopInstanceUID): \(error.localizedDescription)")
             }
+            var exportOptions = self.exportOptions(from: options)
+            var statuses = [DB_Status](repeating: DB_STATUS_ERROR, count: items.count)
 
-            // Report progress
-            onProgress(index + 1, instances.count)
-        }
+            let context = BatchProgressContext(onProgress: onProgress)
+            let contextPtr = Unmanaged.passRetained(context).toOpaque()
+            defer { Unmanaged<BatchProgressContext>.fromOpaque(contextPtr).release() }
 
-        return ExportResult(
-            successCount: successCount,
-            failureCount: failureCount,
-            exportedFiles: exportedFiles,
-            errors: errors
-        )
-    }
+            let cCallback: DB_ExportProgressCallback = { userData, itemsDone, itemCount, _, _ in
+                guard let userData = userData else { return }
 
-    // MARK: - Single Instance Export
+                let context = Unmanaged<BatchProgressContext>.fromOpaque(userData)
+                    .takeUnretainedValue()
 
-    private func exportInstance(
-        _ instance: Instance,
-        options: DicomExportOptions,
-        index: Int,
-        totalCount: Int
-    ) async throws -> URL {
-        // Load DICOM frame
-        let frame = try await loadFrame(from: instance.filePath)
-
-        // Apply window/level
-        let processedPixels = applyWindowLevel(
-            pixels: frame.pixels,
-            width: Int(frame.width),
-            height: Int(frame.height),
-            bitsStored: Int(frame.bitsStored),
-            windowCenter: frame.windowCenter,
-            windowWidth: frame.windowWidth,
-            options: options
-        )
+                context.onProgress(Int(itemsDone), Int(itemCount))
+            }
 
-        // Convert to output format
-        let imageData = try createImageData(
-            pixels: processedPixels,
-            width: Int(frame.width),
-            height: Int(frame.height),
-            options: options
-        )
+            _ = db_export_images(
+                items,
+                Int32(items.count),
+                &exportOptions,
+                &statuses,
+                cCallback,
+                contextPtr
+            )
+
+            var exportedFiles: [URL] = []
+            var errors: [String] = []
+            for (index, status) in statuses.enumerated() {
+                if status == DB_STATUS_OK {
+                    exportedFiles.append(outputURLs[index])
+                } else {
+                    let error: ExportError = status == DB_STATUS_NOT_FOUND
+                        ? .decodeFailed(path: instances[index].filePath)
+                        : .conversionFailed(format: options.format.rawValue)
+                    errors.append("\(instances[index].sopInstanceUID): \(error.localizedDescription)")
+                }
+            }
+
+            return ExportResult(
+                successCount: exportedFiles.count,
+                failureCount: errors.count,
+                exportedFiles: exportedFiles,
+                errors: errors
+            )
+        }.value
+    }
+
+    // MARK: - Export Settings
 
+    private func outputURL(
+        for instance: Instance,
+        index: Int,
+        options: DicomExportOptions,
+        destinationURL: URL
+    ) throws -> URL {
         // Generate filename
         let filename = options.generateFilename(
             patientID: instance.sopInstanceUID,  // TODO: Get from study/patient
@@ -110,180 +120,51 @@ final class DicomExportService: Sendable {
             index: index
         )
 
-        // Determine output URL
-        var outputURL = options.destinationURL!.appendingPathComponent(filename)
-
         // Create subfolders if requested
-        if options.includeSubfolders {
-            let seriesFolder = options.destinationURL!
-                .appendingPathComponent("Series_\(instance.seriesRowID)")
-            try FileManager.default.createDirectory(
-                at: seriesFolder,
-                withIntermediateDirectories: true
-            )
-            outputURL = seriesFolder.appendingPathComponent(filename)
+        guard options.includeSubfolders else {
+            return destinationURL.appendingPathComponent(filename)
         }
-
-        // Write to file
-        try imageData.write(to: outputURL)
-
-        // Clean up frame buffer
-        db_free_buffer(frame.pixels)
-
-        return outputURL
+        let seriesFolder = destinationURL
+            .appendingPathComponent("Series_\(instance.seriesRowID)")
+        try FileManager.default.createDirectory(
+            at: seriesFolder,
+            withIntermediateDirectories: true
+        )
+        return seriesFolder.appendingPathComponent(filename)
     }
 
-    // MARK: - Image Processing
-
-    private func loadFrame(from filePath: String) async throws -> DB_Frame16 {
-        return try await withCheckedThrowingContinuation { continuation in
-            Task.detached {
-                var frame = DB_Frame16()
-                let status = db_decode_frame16(filePath, 0, &frame)
+    private func exportOptions(from options: DicomExportOptions) -> DB_ExportOptions {
+        var exportOptions = DB_ExportOptions()
 
-                guard status == DB_STATUS_OK else {
-                    continuation.resume(throwing: ExportError.decodeFailed(path: filePath))
-                    return
-                }
-
-                guard frame.pixels != nil else {
-                    continuation.resume(throwing: ExportError.noPixelData)
-                    return
-                }
-
-                continuation.resume(returning: frame)
-            }
+        switch options.format {
+        case .jpeg:
+            exportOptions.format = DB_EXPORT_FORMAT_JPEG
+        case .png:
+            exportOptions.format = DB_EXPORT_FORMAT_PNG
+        case .tiff:
+            exportOptions.format = DB_EXPORT_FORMAT_TIFF
         }
-    }
-
-    private func applyWindowLevel(
-        pixels: UnsafeMutablePointer<UInt16>,
-        width: Int,
-        height: Int,
-        bitsStored: Int,
-        windowCenter: Double,
-        windowWidth: Double,
-        options: DicomExportOptions
-    ) -> [UInt8] {
-        let pixelCount = width * height
-        var output = [UInt8](repeating: 0, count: pixelCount)
-
-        // Determine window/level to use
-        var wc = windowCenter
-        var ww = windowWidth
+        exportOptions.quality = Int32((options.quality * 100).rounded())
+        exportOptions.bitDepth = options.use16Bit && options.format.supports16Bit ? 16 : 8
 
+        // Window/level in modality units (Hounsfield for CT)
         switch options.windowPreset {
-        case .custom:
-            wc = options.customWindowCenter
-            ww = options.customWindowWidth
         case .original:
-            // Use values from DICOM (already set)
-            break
+            exportOptions.windowMode = DB_EXPORT_WINDOW_FILE
         case .fullRange:
-            // Calculate min/max from pixel data
-            let buffer = UnsafeBufferPointer(start: pixels, count: pixelCount)
-            let minVal = Double(buffer.min() ?? 0)
-            let maxVal = Double(buffer.max() ?? 0)
-            wc = (minVal + maxVal) / 2.0
-            ww = maxVal - minVal
+            exportOptions.windowMode = DB_EXPORT_WINDOW_FULL_RANGE
+        case .custom:
+            exportOptions.windowMode = DB_EXPORT_WINDOW_CUSTOM
+            exportOptions.windowCenter = options.customWindowCenter
+            exportOptions.windowWidth = options.customWindowWidth
         default:
-            // Use preset values
+            exportOptions.windowMode = DB_EXPORT_WINDOW_CUSTOM
             if let preset = options.windowPreset.windowValues {
-                wc = preset.center
-                ww = preset.width
+                exportOptions.windowCenter = preset.center
+                exportOptions.windowWidth = preset.width
             }
         }
-
-        // Apply window/level transformation
-        let minValue = wc - ww / 2.0
-        let maxValue = wc + ww / 2.0
-        let range = maxValue - minValue
-
-        guard range > 0 else {
-            return output
-        }
-
-        for i in 0..<pixelCount {
-            let pixelValue = Double(pixels[i])
-            var normalized: Double
-
-            if pixelValue <= minValue {
-                normalized = 0
-            } else if pixelValue >= maxValue {
-                normalized = 1
-            } else {
-                normalized = (pixelValue - minValue) / range
-            }
-
-            output[i] = UInt8(normalized * 255.0)
-        }
-
-        return output
-    }
-
-    private func createImageData(
-        pixels: [UInt8],
-        width: Int,
-        height: Int,
-        options: DicomExportOptions
-    ) throws -> Data {
-        // Create CGImage from pixel data
-        guard let dataProvider = CGDataProvider(
-            data: Data(pixels) as CFData
-        ) else {
-            throw ExportError.imageCreationFailed
-        }
-
-        let colorSpace = CGColorSpaceCreateDeviceGray()
-
-        guard let cgImage = CGImage(
-            width: width,
-            height: height,
-            bitsPerComponent: 8,
-            bitsPerPixel: 8,
-            bytesPerRow: width,
-            space: colorSpace,
-            bitmapInfo: CGBitmapInfo(rawValue: 0),
-            provider: dataProvider,
-            decode: nil,
-            shouldInterpolate: true,
-            intent: .defaultIntent
-        ) else {
-            throw ExportError.imageCreationFailed
-        }
-
-        // Create NSBitmapImageRep
-        let bitmapRep = NSBitmapImageRep(cgImage: cgImage)
-
-        // Convert to desired format
-        switch options.format {
-        case .jpeg:
-            guard let data = bitmapRep.representation(
-                using: .jpeg,
-                properties: [.compressionFactor: NSNumber(value: options.quality)]
-            ) else {
-                throw ExportError.conversionFailed(format: "JPEG")
-            }
-            return data
-
-        case .png:
-            guard let data = bitmapRep.representation(
-                using: .png,
-                properties: [:]
-            ) else {
-                throw ExportError.conversionFailed(format: "PNG")
-            }
-            return data
-
-        case .tiff:
-            guard let data = bitmapRep.representation(
-                using: .tiff,
-                properties: [.compressionMethod: NSNumber(value: NSBitmapImageRep.TIFFCompression.none.rawValue)]
-            ) else {
-                throw ExportError.conversionFailed(format: "TIFF")
-            }
-            return data
-        }
+        return exportOptions
     }
 
     // MARK: - Batch Export Helpers
@@ -325,6 +206,16 @@ final class DicomExportService: Sendable {
     }
 }
 
+// MARK: - Progress Context
+
+private final class BatchProgressContext: @unchecked Sendable {
+    let onProgress: @Sendable (Int, Int) -> Void
+
+    init(onProgress: @escaping @Sendable (Int, Int) -> Void) {
+        self.onProgress = onProgress
+    }
+}
+
 // MARK: - Errors
 
 enum ExportError: Error, LocalizedError {
@@ -5,6 +5,7 @@
 //  Tests for DICOM networking functionality.
 //
 
+import Foundation
 import Testing
 @testable import DicomVmac
 
@@ -409,6 +410,505 @@ struct DicomNetworkTests {
         #expect(criteriaError.errorTitle == "Invalid Input")
     }
 
+    // MARK: - Federated Query Tests
+
+    @Test("Federated C-FIND rejects empty node list")
+    func federatedQueryRejectsEmptyNodeList() {
+        var criteria = DB_DicomTags()
+        let result = db_find_studies_federated(
+            "DICOMVMAC", nil, 0, &criteria, nil, nil, 5, nil
+        )
+        #expect(result.status == DB_STATUS_ERROR)
+    }
+
+    @Test("Federated C-FIND rejects non-positive timeout")
+    func federatedQueryRejectsZeroTimeout() {
+        var criteria = DB_DicomTags()
+        var node = DB_DicomNode()
+        node.port = 104
+        let result = db_find_studies_federated(
+            "DICOMVMAC", &node, 1, &criteria, nil, nil, 0, nil
+        )
+        #expect(result.status == DB_STATUS_ERROR)
+    }
+
+    @Test("Federated C-FIND abandons a node that misses its deadline")
+    func federatedQueryTimesOutSlowNode() throws {
+        let folder = FileManager.default.temporaryDirectory
+            .appendingPathComponent(UUID().uuidString)
+        try FileManager.default.createDirectory(at: folder, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: folder) }
+
+        let pacs = try #require(SimulatedPacs(folder: folder, aeTitle: "SLOWPACS", port: 11194, latencyMs: 5000))
+        defer { pacs.stop() }
+
+        var node = pacs.node
+
+        var criteria = DB_DicomTags()
+        var nodeResult = DB_FederatedNodeResult()
+        let started = Date()
+        let result = db_find_studies_federated(
+            "DICOMVMAC", &node, 1, &criteria, nil, nil, 1, &nodeResult
+        )
+        #expect(Date().timeIntervalSince(started) < 3)
+        #expect(result.status == DB_STATUS_TIMEOUT)
+        #expect(nodeResult.timedOut == 1)
+        #expect(nodeResult.result.status == DB_STATUS_TIMEOUT)
+    }
+
+    // MARK: - Query Cache Tests
+
+    @Test("Query cache rejects invalid bounds")
+    func queryCacheRejectsInvalidBounds() {
+        #expect(db_query_cache_create(0, 0, 60) == nil)
+        #expect(db_query_cache_create(16, 0, -1) == nil)
+    }
+
+    @Test("Query cache starts empty")
+    func queryCacheStartsEmpty() throws {
+        let cache = try #require(db_query_cache_create(16, 1000, 60))
+        defer { db_query_cache_destroy(cache) }
+
+        var stats = DB_QueryCacheStats()
+        db_query_cache_get_stats(cache, &stats)
+        #expect(stats.entryCount == 0)
+        #expect(stats.hits == 0)
+        #expect(stats.misses == 0)
+    }
+
+    @Test("Cached C-FIND rejects null cache")
+    func cachedQueryRejectsNullCache() {
+        var criteria = DB_DicomTags()
+        var node = DB_DicomNode()
+        let result = db_find_studies_cached(
+            nil, "DICOMVMAC", &node, &criteria, 0, nil, nil, 5
+        )
+        #expect(result.status == DB_STATUS_ERROR)
+    }
+
+    @Test("Cached C-FIND re-runs the full query when cached studies are undated")
+    func cachedQueryRefreshesUndatedStudies() throws {
+        let folder = FileManager.default.temporaryDirectory
+            .appendingPathComponent(UUID().uuidString)
+        try FileManager.default.createDirectory(at: folder, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: folder) }
+
+        var first = TestDicomFile.image(width: 4, height: 4)
+        first.remove(0x0008_0020)
+        try first.write(to: folder.appendingPathComponent("first.dcm"))
+
+        let pacs = try #require(SimulatedPacs(folder: folder, port: 11193))
+        defer { pacs.stop() }
+
+        var node = pacs.node
+
+        // TTL 0: every lookup finds a stale entry
+        let cache = try #require(db_query_cache_create(16, 1000, 0))
+        defer { db_query_cache_destroy(cache) }
+
+        var criteria = DB_DicomTags()
+        var matches = 0
+        let countMatch: DB_QueryCallback = { userData, _ in
+            userData!.assumingMemoryBound(to: Int.self).pointee += 1
+        }
+        var result = db_find_studies_cached(cache, "DICOMVMAC", &node, &criteria, 30,
+                                            countMatch, &matches, 10)
+        #expect(result.status == DB_STATUS_OK)
+        #expect(matches == 1)
+
+        // A second undated study only a full query can return
+        let upload = FileManager.default.temporaryDirectory
+            .appendingPathComponent(UUID().uuidString + ".dcm")
+        defer { try? FileManager.default.removeItem(at: upload) }
+        var second = TestDicomFile.image(width: 4, height: 4)
+        second.remove(0x0008_0020)
+        try second.write(to: upload)
+        let uploadPath = strdup(upload.path)
+        defer { free(uploadPath) }
+        let paths: [UnsafePointer<CChar>?] = [uploadPath.map { UnsafePointer($0) }]
+        let store = db_store_study("DICOMVMAC", &node, paths, 1, nil, nil, 10)
+        #expect(store.status == DB_STATUS_OK)
+
+        matches = 0
+        result = db_find_studies_cached(cache, "DICOMVMAC", &node, &criteria, 30,
+                                        countMatch, &matches, 10)
+        #expect(result.status == DB_STATUS_OK)
+        #expect(matches == 2)
+
+        var stats = DB_QueryCacheStats()
+        db_query_cache_get_stats(cache, &stats)
+        #expect(stats.misses == 2)
+        #expect(stats.partialRefreshes == 0)
+    }
+
+    // MARK: - Retrieve Scheduler Tests
+
+    @Test("Retrieve scheduler rejects missing study UID and batch size")
+    func retrieveSchedulerRejectsInvalidParameters() {
+        var node = DB_DicomNode()
+        #expect(db_retrieve_scheduler_create(
+            "DICOMVMAC", &node, "", "/tmp", DB_RETRIEVE_GET, 16, 30) == nil)
+        #expect(db_retrieve_scheduler_create(
+            "DICOMVMAC", &node, "1.2.3", "/tmp", DB_RETRIEVE_GET, 0, 30) == nil)
+    }
+
+    @Test("Retrieve scheduler accepts priorities before planning")
+    func retrieveSchedulerPrioritizeBeforeRun() throws {
+        var node = DB_DicomNode()
+        let scheduler = try #require(db_retrieve_scheduler_create(
+            "DICOMVMAC", &node, "1.2.3", "/tmp", DB_RETRIEVE_GET, 16, 30))
+        defer { db_retrieve_scheduler_destroy(scheduler) }
+
+        #expect(db_retrieve_scheduler_prioritize_series(scheduler, "1.2.3.4") == DB_STATUS_OK)
+        #expect(db_retrieve_scheduler_prioritize_series(nil, "1.2.3.4") == DB_STATUS_ERROR)
+    }
+
+    @Test("Retrieve scheduler fetches every series of a study with C-GET")
+    func retrieveSchedulerFetchesStudy() throws {
+        let folder = FileManager.default.temporaryDirectory
+            .appendingPathComponent(UUID().uuidString)
+        let destination = folder.appendingPathComponent("received")
+        let served = folder.appendingPathComponent("served")
+        try FileManager.default.createDirectory(at: served, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: folder) }
+
+        let studyUID = TestDicomFile.makeUID()
+        for series in 0..<2 {
+            let seriesUID = TestDicomFile.makeUID()
+            for instance in 0..<3 {
+                var file = TestDicomFile.image(width: 4, height: 4,
+                                               studyUID: studyUID, seriesUID: seriesUID)
+                file.set(TestDicomElement(0x0020_0011, "IS", String(series + 1)))
+                file.set(TestDicomElement(0x0020_0013, "IS", String(instance + 1)))
+                try file.write(to: served.appendingPathComponent("\(series)-\(instance).dcm"))
+            }
+        }
+
+        let pacs = try #require(SimulatedPacs(folder: served, port: 11192))
+        defer { pacs.stop() }
+
+        var node = pacs.node
+
+        let scheduler = try #require(db_retrieve_scheduler_create(
+            "DICOMVMAC", &node, studyUID, destination.path, DB_RETRIEVE_GET, 2, 10))
+        defer { db_retrieve_scheduler_destroy(scheduler) }
+
+        var received = 0
+        let result = db_retrieve_scheduler_run(scheduler, { userData, _, _, _ in
+            userData!.assumingMemoryBound(to: Int.self).pointee += 1
+        }, nil, &received)
+
+        #expect(result.status == DB_STATUS_OK)
+        #expect(received == 6)
+        let files = try FileManager.default.contentsOfDirectory(atPath: destination.path)
+        #expect(files.filter { $0.hasSuffix(".dcm") }.count == 6)
+    }
+
+    @Test("Resumable retrieve validates parameters")
+    func resumableRetrieveValidatesParameters() {
+        var node = DB_DicomNode()
+        #expect(db_retrieve_scheduler_enable_resume(nil, nil) == DB_STATUS_ERROR)
+
+        let result = db_retrieve_study_resumable(
+            "DICOMVMAC", &node, "", "/tmp", DB_RETRIEVE_GET, nil, nil, 30)
+        #expect(result.status == DB_STATUS_ERROR)
+    }
+
+    // MARK: - Network Stats Tests
+
+    @Test("Network stats API validates parameters")
+    func networkStatsValidatesParameters() {
+        #expect(db_network_stats_last(nil) == DB_STATUS_ERROR)
+        #expect(db_network_stats_recent(nil, 8) == 0)
+
+        var stats = [DB_NetworkStats](repeating: DB_NetworkStats(), count: 4)
+        #expect(db_network_stats_recent(&stats, 0) == 0)
+    }
+
+    @Test("Network stats log can be enabled and disabled")
+    func networkStatsLogToggle() {
+        let path = FileManager.default.temporaryDirectory
+            .appendingPathComponent("dicomvmac-net-\(UUID().uuidString).jsonl").path
+        defer { try? FileManager.default.removeItem(atPath: path) }
+
+        #expect(db_network_stats_set_log(path) == DB_STATUS_OK)
+        #expect(db_network_stats_set_log(nil) == DB_STATUS_OK)
+        #expect(db_network_stats_set_log("/nonexistent-dir/net.jsonl") == DB_STATUS_ERROR)
+    }
+
+    // MARK: - PACS Simulator Tests
+
+    @Test("PACS simulator rejects invalid configuration")
+    func pacsSimulatorRejectsInvalidConfig() {
+        let tmp = URL(fileURLWithPath: "/tmp")
+        #expect(SimulatedPacs(folder: tmp, aeTitle: "", port: 11197) == nil)
+        #expect(SimulatedPacs(folder: URL(fileURLWithPath: "/nonexistent-dicom-folder"),
+                              port: 11197) == nil)
+    }
+
+    @Test("PACS simulator answers C-ECHO and C-FIND on loopback")
+    func pacsSimulatorEchoAndFind() throws {
+        let folder = FileManager.default.temporaryDirectory
+            .appendingPathComponent(UUID().uuidString)
+        try FileManager.default.createDirectory(at: folder, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: folder) }
+
+        let pacs = try #require(SimulatedPacs(folder: folder, port: 11198))
+        defer { pacs.stop() }
+        #expect(pacs.instanceCount == 0)
+
+        var node = pacs.node
+
+        let echo = db_echo("DICOMVMAC", &node, 10)
+        #expect(echo.status == DB_STATUS_OK)
+
+        var criteria = DB_DicomTags()
+        let find = db_find_studies("DICOMVMAC", &node, &criteria, nil, nil, 10)
+        #expect(find.status == DB_STATUS_OK)
+
+        var stats = DB_NetworkStats()
+        #expect(db_network_stats_last(&stats) == DB_STATUS_OK)
+        #expect(stats.operation == DB_NET_OP_FIND)
+        #expect(stats.instances == 0)
+        #expect(stats.bytesSent > 0 && stats.bytesReceived > 0)
+    }
+
+    // MARK: - TLS Tests
+
+    @Test("TLS configuration validates parameters and certificate files")
+    func tlsConfigurationValidates() {
+        var node = DB_DicomNode()
+        withUnsafeMutablePointer(to: &node.hostname.0) { ptr in
+            _ = strncpy(ptr, "pacs.example.org", 255)
+        }
+        node.port = 2762
+
+        var config = DB_TLSConfig()
+        #expect(db_tls_configure_node(nil, &config).status == DB_STATUS_ERROR)
+        #expect(db_tls_configure_node(&node, nil).status == DB_STATUS_ERROR)
+
+        let result = "/nonexistent/client.pem".withCString { path -> DB_NetworkResult in
+            config.certificateFile = path
+            return db_tls_configure_node(&node, &config)
+        }
+        #expect(result.status == DB_STATUS_ERROR)
+
+        var stats = DB_TLSSessionStats()
+        #expect(db_tls_session_stats(&node, &stats) == DB_STATUS_NOT_FOUND)
+        db_tls_remove_node(&node)
+    }
+
+    // MARK: - Throttling Tests
+
+    @Test("Bandwidth limits reject negative rates")
+    func throttleRejectsNegativeRates() {
+        var node = DB_DicomNode()
+        withUnsafeMutablePointer(to: &node.hostname.0) { ptr in
+            _ = strncpy(ptr, "127.0.0.1", 255)
+        }
+        node.port = 11199
+
+        var limit = DB_BandwidthLimit(sendBytesPerSecond: -1, receiveBytesPerSecond: 0)
+        #expect(db_throttle_set_global_limit(&limit) == DB_STATUS_ERROR)
+        #expect(db_throttle_set_node_limit(&node, &limit) == DB_STATUS_ERROR)
+        #expect(db_throttle_set_node_limit(nil, nil) == DB_STATUS_ERROR)
+        #expect(db_throttle_set_node_limit(&node, nil) == DB_STATUS_OK)
+    }
+
+    @Test("Throttled node still completes C-ECHO")
+    func throttledEcho() throws {
+        let folder = FileManager.default.temporaryDirectory
+            .appendingPathComponent(UUID().uuidString)
+        try FileManager.default.createDirectory(at: folder, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: folder) }
+
+        let pacs = try #require(SimulatedPacs(folder: folder, port: 11199))
+        defer { pacs.stop() }
+
+        var node = pacs.node
+
+        var limit = DB_BandwidthLimit(sendBytesPerSecond: 64 * 1024, receiveBytesPerSecond: 64 * 1024)
+        #expect(db_throttle_set_node_limit(&node, &limit) == DB_STATUS_OK)
+        defer { _ = db_throttle_set_node_limit(&node, nil) }
+
+        db_throttle_set_thread_class(DB_TRAFFIC_BACKGROUND)
+        defer { db_throttle_set_thread_class(DB_TRAFFIC_AUTO) }
+
+        let echo = db_echo("DICOMVMAC", &node, 10)
+        #expect(echo.status == DB_STATUS_OK)
+    }
+
+    @Test("Under AUTO a C-GET retrieve is served ahead of a concurrent upload")
+    func throttledRetrieveAheadOfStore() throws {
+        let folder = FileManager.default.temporaryDirectory
+            .appendingPathComponent(UUID().uuidString)
+        let destination = folder.appendingPathComponent("received")
+        let served = folder.appendingPathComponent("served")
+        try FileManager.default.createDirectory(at: served, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: folder) }
+
+        let studyUID = TestDicomFile.makeUID()
+        let seriesUID = TestDicomFile.makeUID()
+        for instance in 0..<4 {
+            var file = TestDicomFile.image(width: 4, height: 4, studyUID: studyUID, seriesUID: seriesUID)
+            file.set(TestDicomElement(0x0020_0013, "IS", String(instance + 1)))
+            try file.write(to: served.appendingPathComponent("\(instance).dcm"))
+        }
+        // 2 MB: half a minute at the limit below
+        let upload = folder.appendingPathComponent("upload.dcm")
+        try TestDicomFile.image(width: 512, height: 512, frames: 4).write(to: upload)
+
+        let pacs = try #require(SimulatedPacs(folder: served, port: 11191))
+        defer { pacs.stop() }
+
+        var node = pacs.node
+        var limit = DB_BandwidthLimit(sendBytesPerSecond: 64 * 1024, receiveBytesPerSecond: 64 * 1024)
+        #expect(db_throttle_set_node_limit(&node, &limit) == DB_STATUS_OK)
+        defer { _ = db_throttle_set_node_limit(&node, nil) }
+
+        let store = BackgroundStore(node: node, files: [upload])
+        Thread.sleep(forTimeInterval: 1)
+
+        // The retrieve's requests and responses share the send bucket the
+        // upload is draining; the upload yields to them
+        let start = Date()
+        let result = db_retrieve_study_resumable("DICOMVMAC", &node, studyUID, destination.path,
+                                                 DB_RETRIEVE_GET, nil, nil, 20)
+        #expect(result.status == DB_STATUS_OK)
+        #expect(Date().timeIntervalSince(start) < 10)
+        #expect(!store.isFinished)
+
+        // Unlimited again, the upload finishes at once
+        #expect(db_throttle_set_node_limit(&node, nil) == DB_STATUS_OK)
+        #expect(store.wait().status == DB_STATUS_OK)
+    }
+
+    // MARK: - Store Queue Tests
+
+    @Test("Store queue fails unreadable files at once and forgets finished jobs")
+    func storeQueueUnreadableFile() throws {
+        let folder = FileManager.default.temporaryDirectory
+            .appendingPathComponent(UUID().uuidString)
+        try FileManager.default.createDirectory(at: folder, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: folder) }
+
+        let notDicom = folder.appendingPathComponent("note.txt")
+        try "not a DICOM file".write(to: notDicom, atomically: true, encoding: .utf8)
+
+        var node = DB_DicomNode()
+        withUnsafeMutablePointer(to: &node.aeTitle.0) { ptr in
+            _ = strncpy(ptr, "ARCHIVE", 16)
+        }
+        withUnsafeMutablePointer(to: &node.hostname.0) { ptr in
+            _ = strncpy(ptr, "127.0.0.1", 255)
+        }
+        node.port = 11196
+
+        let queuePath = folder.appendingPathComponent("queue").path
+        let queue = try #require(db_store_queue_open(queuePath, nil))
+        #expect(db_store_queue_enqueue(queue, "DICOMVMAC", &node, nil, 0, nil) == DB_STATUS_ERROR)
+
+        var jobID: UInt64 = 0
+        let status = notDicom.path.withCString { path -> DB_Status in
+            var paths: [UnsafePointer<CChar>?] = [path]
+            return db_store_queue_enqueue(queue, "DICOMVMAC", &node, &paths, 1, &jobID)
+        }
+        #expect(status == DB_STATUS_OK)
+
+        var job = DB_StoreJobStatus()
+        #expect(db_store_queue_job_status(queue, jobID, &job) == DB_STATUS_OK)
+        #expect(job.total == 1 && job.failed == 1 && job.pending == 0)
+        #expect(db_store_queue_pending_count(queue) == 0)
+        db_store_queue_close(queue)
+
+        let reopened = try #require(db_store_queue_open(queuePath, nil))
+        #expect(db_store_queue_job_status(reopened, jobID, &job) == DB_STATUS_NOT_FOUND)
+
+        // The dropped job's ID is not handed out again
+        var nextJobID: UInt64 = 0
+        let requeued = notDicom.path.withCString { path -> DB_Status in
+            var paths: [UnsafePointer<CChar>?] = [path]
+            return db_store_queue_enqueue(reopened, "DICOMVMAC", &node, &paths, 1, &nextJobID)
+        }
+        #expect(requeued == DB_STATUS_OK)
+        #expect(nextJobID > jobID)
+        db_store_queue_close(reopened)
+    }
+
+    // MARK: - Worklist Tests
+
+    @Test("Worklist poller rejects invalid queries")
+    func worklistPollerRejectsInvalidQuery() {
+        var node = DB_DicomNode()
+        node.port = 104
+        var query = DB_WorklistQuery()
+        query.daysBefore = -1
+        #expect(db_worklist_poller_create("DICOMVMAC", &node, &query, 10) == nil)
+        #expect(db_worklist_poller_create("DICOMVMAC", &node, nil, 10) == nil)
+        #expect(db_worklist_find("DICOMVMAC", &node, &query, nil, nil, 10).status == DB_STATUS_ERROR)
+    }
+
+    @Test("Failed worklist poll keeps the worklist unchanged")
+    func worklistFailedPollKeepsItems() throws {
+        var node = DB_DicomNode()
+        withUnsafeMutablePointer(to: &node.aeTitle.0) { ptr in
+            _ = strncpy(ptr, "RIS", 16)
+        }
+        withUnsafeMutablePointer(to: &node.hostname.0) { ptr in
+            _ = strncpy(ptr, "127.0.0.1", 255)
+        }
+        node.port = 11195   // Nothing listens here
+
+        var query = DB_WorklistQuery()
+        query.daysAfter = 1
+        query.fullRefreshInterval = 10
+        let poller = try #require(db_worklist_poller_create("DICOMVMAC", &node, &query, 5))
+        defer { db_worklist_poller_destroy(poller) }
+
+        let result = db_worklist_poller_poll(poller, nil, nil)
+        #expect(result.status != DB_STATUS_OK)
+        #expect(db_worklist_poller_items(poller, nil, 0) == 0)
+    }
+
+    @Test("MPPS client validates parameters and leaves the UID unset on failure")
+    func mppsValidatesParameters() {
+        var node = DB_DicomNode()
+        withUnsafeMutablePointer(to: &node.aeTitle.0) { ptr in
+            _ = strncpy(ptr, "RIS", 16)
+        }
+        withUnsafeMutablePointer(to: &node.hostname.0) { ptr in
+            _ = strncpy(ptr, "127.0.0.1", 255)
+        }
+        node.port = 11195   // Nothing listens here
+
+        var step = DB_WorklistItem()
+        var uid = [CChar](repeating: 0, count: 65)
+        #expect(db_mpps_create("DICOMVMAC", &node, nil, &uid, 5).status == DB_STATUS_ERROR)
+        #expect(db_mpps_create("DICOMVMAC", &node, &step, nil, 5).status == DB_STATUS_ERROR)
+        #expect(db_mpps_create("DICOMVMAC", &node, &step, &uid, 5).status != DB_STATUS_OK)
+        #expect(uid[0] == 0)
+
+        // A listed instance needs its SOP class
+        var series = DB_MppsSeries()
+        withUnsafeMutableBytes(of: &series.seriesInstanceUID) { bytes in
+            _ = strcpy(bytes.baseAddress!.assumingMemoryBound(to: CChar.self), "1.2.3.4")
+        }
+        let instance = strdup("1.2.3.4.5")
+        defer { free(instance) }
+        let instances: [UnsafePointer<CChar>?] = [UnsafePointer(instance)]
+        instances.withUnsafeBufferPointer { buffer in
+            series.sopInstanceUIDs = buffer.baseAddress
+            series.instanceCount = 1
+            #expect(db_mpps_set("DICOMVMAC", &node, "1.2.3", DB_MPPS_COMPLETED, &series, 1, 5).status
+                    == DB_STATUS_ERROR)
+        }
+        #expect(db_mpps_set("DICOMVMAC", &node, "", DB_MPPS_COMPLETED, nil, 0, 5).status == DB_STATUS_ERROR)
+        #expect(db_mpps_set("DICOMVMAC", &node, "1.2.3", DB_MPPS_COMPLETED, nil, 1, 5).status
+                == DB_STATUS_ERROR)
+        #expect(db_mpps_set("DICOMVMAC", &node, "1.2.3", DB_MPPS_DISCONTINUED, nil, 0, 5).status
+                != DB_STATUS_OK)
+    }
+
     // MARK: - Integration Test Notes
 
     /*
@@ -448,3 +948,37 @@ struct DicomNetworkTests {
      3. Run tests with integration tests enabled
      */
 }
+
+/// A db_store_study call running on its own thread
+private final class BackgroundStore: @unchecked Sendable {
+    private let lock = NSLock()
+    private let done = DispatchSemaphore(value: 0)
+    private var outcome: DB_NetworkResult?
+
+    init(node: DB_DicomNode, files: [URL]) {
+        Thread { [self] in
+            var node = node
+            let paths = files.map { strdup($0.path) }
+            defer { paths.forEach { free($0) } }
+            let pathPtrs: [UnsafePointer<CChar>?] = paths.map { $0.map { UnsafePointer($0) } }
+            let result = db_store_study("DICOMVMAC", &node, pathPtrs, Int32(pathPtrs.count), nil, nil, 60)
+            lock.lock()
+            outcome = result
+            lock.unlock()
+            done.signal()
+        }.start()
+    }
+
+    var isFinished: Bool {
+        lock.lock()
+        defer { lock.unlock() }
+        return outcome != nil
+    }
+
+    func wait() -> DB_NetworkResult {
+        done.wait()
+        lock.lock()
+        defer { lock.unlock() }
+        return outcome!
+    }
+}
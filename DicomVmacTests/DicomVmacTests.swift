@@ -642,3 +642,843 @@ struct VolumeRenderingTests {
         #expect(MPRPlane.projection.rawValue == 3)
     }
 }
+
+// MARK: - Anonymization Tests
+
+/// Counts db_anonymize_batch progress callbacks
+private final class AnonymizeProgressCounter {
+    var calls = 0
+    var lastDone = 0
+}
+
+/// Records the patients db_anonymize_batch asked for overrides
+private final class PatientOverrideRecorder {
+    var patientIDs: [String] = []
+}
+
+/// Transcode one file with db_transcode_files
+private func transcodeFile(_ input: URL, to output: URL, syntax: DB_TransferSyntax,
+                           nearLosslessError: Int32 = 0) -> DB_Status {
+    let inputPath = strdup(input.path)
+    let outputPath = strdup(output.path)
+    defer {
+        free(inputPath)
+        free(outputPath)
+    }
+    let inputPtrs: [UnsafePointer<CChar>?] = [UnsafePointer(inputPath)]
+    let outputPtrs: [UnsafePointer<CChar>?] = [UnsafePointer(outputPath)]
+    var options = DB_TranscodeOptions()
+    options.transferSyntax = syntax
+    options.nearLosslessError = nearLosslessError
+    return db_transcode_files(inputPtrs, outputPtrs, 1, &options, nil, nil, nil)
+}
+
+/// Anonymize a generated image carrying the given date elements with a
+/// fixed date shift; returns the output file
+private func anonymizeWithDateShift(_ elements: [TestDicomElement], days: Int32,
+                                    in directory: URL) throws -> URL {
+    var file = TestDicomFile.image(width: 4, height: 4)
+    elements.forEach { file.set($0) }
+    let input = directory.appendingPathComponent(UUID().uuidString + ".dcm")
+    let output = directory.appendingPathComponent(UUID().uuidString + ".dcm")
+    try file.write(to: input)
+
+    var config = DB_AnonymizationConfig()
+    config.dateShiftDays = days
+    #expect(db_anonymize_file(input.path, output.path, &config) == DB_STATUS_OK)
+    return output
+}
+
+@Suite("Anonymization Tests")
+struct AnonymizationTests {
+
+    @Test("db_anonymize_batch rejects null configuration")
+    func batchNullConfig() {
+        let inputs: [UnsafePointer<CChar>?] = []
+        let outputs: [UnsafePointer<CChar>?] = []
+        let status = db_anonymize_batch(inputs, outputs, 0, nil, 0, nil, nil, nil)
+        #expect(status == DB_STATUS_ERROR)
+    }
+
+    @Test("db_anonymize_batch with no files succeeds")
+    func batchEmpty() {
+        var config = DB_AnonymizationConfig()
+        let inputs: [UnsafePointer<CChar>?] = []
+        let outputs: [UnsafePointer<CChar>?] = []
+        let status = db_anonymize_batch(inputs, outputs, 0, &config, 0, nil, nil, nil)
+        #expect(status == DB_STATUS_OK)
+    }
+
+    @Test("Streaming anonymization of non-existent file returns NOT_FOUND")
+    func streamingMissingFile() {
+        var config = DB_AnonymizationConfig()
+        config.preserveTransferSyntax = true
+        let output = FileManager.default.temporaryDirectory
+            .appendingPathComponent(UUID().uuidString + ".dcm").path
+        let status = db_anonymize_file("/nonexistent/file.dcm", output, &config)
+        #expect(status == DB_STATUS_NOT_FOUND)
+        #expect(!FileManager.default.fileExists(atPath: output))
+    }
+
+    @Test("db_anonymize_batch reports each missing file")
+    func batchMissingFiles() {
+        let tmpDir = FileManager.default.temporaryDirectory
+            .appendingPathComponent(UUID().uuidString)
+        let inputs = (0..<8).map { strdup("/nonexistent/anon-\($0).dcm") }
+        let outputs = (0..<8).map { strdup(tmpDir.appendingPathComponent("\($0).dcm").path) }
+        defer {
+            inputs.forEach { free($0) }
+            outputs.forEach { free($0) }
+        }
+        let inputPtrs: [UnsafePointer<CChar>?] = inputs.map { $0.map { UnsafePointer($0) } }
+        let outputPtrs: [UnsafePointer<CChar>?] = outputs.map { $0.map { UnsafePointer($0) } }
+
+        var config = DB_AnonymizationConfig()
+        config.removePrivateTags = true
+        var statuses = [DB_Status](repeating: DB_STATUS_OK, count: 8)
+        let counter = AnonymizeProgressCounter()
+
+        let status = db_anonymize_batch(
+            inputPtrs, outputPtrs, 8, &config, 4, &statuses,
+            { userData, filesDone, _, _, _ in
+                let counter = Unmanaged<AnonymizeProgressCounter>.fromOpaque(userData!)
+                    .takeUnretainedValue()
+                counter.calls += 1
+                counter.lastDone = Int(filesDone)
+            },
+            Unmanaged.passUnretained(counter).toOpaque()
+        )
+
+        #expect(status == DB_STATUS_ERROR)
+        #expect(statuses.allSatisfy { $0 == DB_STATUS_NOT_FOUND })
+        #expect(counter.calls == 8)
+        #expect(counter.lastDone == 8)
+    }
+
+    @Test("UID map assigns one replacement per original UID")
+    func uidMapConsistent() {
+        let uidMap = db_uid_map_create(nil)
+        defer { db_uid_map_destroy(uidMap) }
+
+        var first = [CChar](repeating: 0, count: 65)
+        var again = [CChar](repeating: 0, count: 65)
+        var other = [CChar](repeating: 0, count: 65)
+        #expect(db_uid_map_get(uidMap, "1.2.3.4.5", &first, 65) == DB_STATUS_OK)
+        #expect(db_uid_map_get(uidMap, "1.2.3.4.5", &again, 65) == DB_STATUS_OK)
+        #expect(db_uid_map_get(uidMap, "1.2.3.4.6", &other, 65) == DB_STATUS_OK)
+
+        #expect(String(cString: first) == String(cString: again))
+        #expect(String(cString: first) != String(cString: other))
+        #expect(String(cString: first) != "1.2.3.4.5")
+        #expect(db_uid_map_count(uidMap) == 2)
+    }
+
+    @Test("Persisted UID map is reloaded")
+    func uidMapPersisted() {
+        let path = FileManager.default.temporaryDirectory
+            .appendingPathComponent(UUID().uuidString + ".uidmap").path
+        defer { try? FileManager.default.removeItem(atPath: path) }
+
+        var first = [CChar](repeating: 0, count: 65)
+        let uidMap = db_uid_map_create(path)
+        #expect(uidMap != nil)
+        #expect(db_uid_map_get(uidMap, "1.2.3.4.5", &first, 65) == DB_STATUS_OK)
+        db_uid_map_destroy(uidMap)
+
+        var reloaded = [CChar](repeating: 0, count: 65)
+        let reopened = db_uid_map_create(path)
+        defer { db_uid_map_destroy(reopened) }
+        #expect(db_uid_map_count(reopened) == 1)
+        #expect(db_uid_map_get(reopened, "1.2.3.4.5", &reloaded, 65) == DB_STATUS_OK)
+        #expect(String(cString: first) == String(cString: reloaded))
+    }
+
+    @Test("db_generate_hash is SHA-256")
+    func hashIsSha256() {
+        var output = [CChar](repeating: 0, count: 65)
+        db_generate_hash("abc", &output, 65)
+        #expect(String(cString: output) ==
+                "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad")
+    }
+
+    @Test("Keyed hash is HMAC-SHA256")
+    func keyedHash() {
+        var output = [CChar](repeating: 0, count: 65)
+        let status = db_generate_keyed_hash(
+            "key", "The quick brown fox jumps over the lazy dog", &output, 65)
+        #expect(status == DB_STATUS_OK)
+        #expect(String(cString: output) ==
+                "f7bc83f430538424b13298e6aa6fb143ef4d59a14946175997479dbc2d1a3cd8")
+        #expect(db_generate_keyed_hash(nil, "abc", &output, 65) == DB_STATUS_ERROR)
+    }
+
+    @Test("Derived UIDs are deterministic and under the root")
+    func derivedUID() {
+        var first = [CChar](repeating: 0, count: 65)
+        var again = [CChar](repeating: 0, count: 65)
+        var defaultRoot = [CChar](repeating: 0, count: 65)
+        #expect(db_generate_derived_uid("secret", "1.2.826.0.1.3680043.10.999", "1.2.3.4", &first, 65) == DB_STATUS_OK)
+        #expect(db_generate_derived_uid("secret", "1.2.826.0.1.3680043.10.999", "1.2.3.4", &again, 65) == DB_STATUS_OK)
+        #expect(db_generate_derived_uid("secret", nil, "1.2.3.4", &defaultRoot, 65) == DB_STATUS_OK)
+
+        let uid = String(cString: first)
+        #expect(uid == String(cString: again))
+        #expect(uid.hasPrefix("1.2.826.0.1.3680043.10.999."))
+        #expect(uid.count <= 64)
+        #expect(String(cString: defaultRoot).hasPrefix("2.25."))
+    }
+
+    @Test("PS3.15 action codes map to tag actions")
+    func profileActionCodes() {
+        var action = DB_TAG_ACTION_KEEP
+        #expect(db_tag_action_from_profile_code("X", &action) == DB_STATUS_OK)
+        #expect(action == DB_TAG_ACTION_REMOVE)
+        #expect(db_tag_action_from_profile_code("D", &action) == DB_STATUS_OK)
+        #expect(action == DB_TAG_ACTION_DUMMY)
+        #expect(db_tag_action_from_profile_code("C", &action) == DB_STATUS_OK)
+        #expect(action == DB_TAG_ACTION_CLEAN)
+        #expect(db_tag_action_from_profile_code("X/Z", &action) == DB_STATUS_OK)
+        #expect(action == DB_TAG_ACTION_EMPTY)
+        #expect(db_tag_action_from_profile_code("X/Z/U*", &action) == DB_STATUS_OK)
+        #expect(action == DB_TAG_ACTION_GENERATE_UID)
+        #expect(db_tag_action_from_profile_code("Q", &action) == DB_STATUS_ERROR)
+    }
+
+    @Test("Burned-in text scan validates its input")
+    func burnedInTextScanErrors() {
+        var flags = [UInt8](repeating: 0, count: 4)
+        var frameCount: Int32 = -1
+        #expect(db_detect_burned_in_text(nil, 32, &flags, 4, &frameCount) == DB_STATUS_ERROR)
+        #expect(db_detect_burned_in_text("/nonexistent/image.dcm", 0, &flags, 4, &frameCount) == DB_STATUS_ERROR)
+        #expect(db_detect_burned_in_text("/nonexistent/image.dcm", 32, &flags, 4, &frameCount) == DB_STATUS_NOT_FOUND)
+        #expect(frameCount == -1)
+    }
+
+    @Test("Dry run reports missing files without writing")
+    func dryRunMissingFiles() {
+        let inputs = (0..<3).map { strdup("/nonexistent/dry_\($0).dcm") }
+        defer { inputs.forEach { free($0) } }
+        let inputPtrs: [UnsafePointer<CChar>?] = inputs.map { $0.map { UnsafePointer($0) } }
+
+        var config = DB_AnonymizationConfig()
+        config.removePrivateTags = true
+        var reports = [DB_AnonymizationFileReport](repeating: DB_AnonymizationFileReport(), count: 3)
+        var summary = DB_AnonymizationSummary()
+
+        #expect(db_anonymize_dry_run(inputPtrs, 3, nil, 2, &reports, &summary, nil, nil) == DB_STATUS_ERROR)
+        let status = db_anonymize_dry_run(inputPtrs, 3, &config, 2, &reports, &summary, nil, nil)
+        #expect(status == DB_STATUS_ERROR)
+        #expect(reports.allSatisfy { $0.status == DB_STATUS_NOT_FOUND })
+        #expect(summary.filesScanned == 3)
+        #expect(summary.filesFailed == 3)
+        #expect(summary.tagChangeCount == 0)
+    }
+
+    @Test("In-place batch keeps its journal until every file succeeds")
+    func inPlaceBatchJournal() throws {
+        let directory = FileManager.default.temporaryDirectory
+            .appendingPathComponent(UUID().uuidString)
+        try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: directory) }
+        let journal = directory.appendingPathComponent("inplace.journal").path
+
+        let files = (0..<2).map { strdup(directory.appendingPathComponent("missing_\($0).dcm").path) }
+        defer { files.forEach { free($0) } }
+        let filePtrs: [UnsafePointer<CChar>?] = files.map { $0.map { UnsafePointer($0) } }
+        var config = DB_AnonymizationConfig()
+        var statuses = [DB_Status](repeating: DB_STATUS_OK, count: 2)
+
+        let status = db_anonymize_batch_inplace(filePtrs, 2, &config, journal, 2, &statuses, nil, nil)
+        #expect(status == DB_STATUS_ERROR)
+        #expect(statuses.allSatisfy { $0 == DB_STATUS_NOT_FOUND })
+        #expect(FileManager.default.fileExists(atPath: journal))
+
+        // A file that is not an in-place journal is never appended to
+        let foreign = directory.appendingPathComponent("foreign.journal").path
+        try "not a journal\n".write(toFile: foreign, atomically: true, encoding: .utf8)
+        #expect(db_anonymize_batch_inplace(filePtrs, 2, &config, foreign, 2, nil, nil, nil) == DB_STATUS_ERROR)
+        #expect(try String(contentsOfFile: foreign, encoding: .utf8) == "not a journal\n")
+    }
+
+    @Test("Streaming anonymization copies PixelData and drops its group length")
+    func streamingCopiesPixelData() throws {
+        let directory = FileManager.default.temporaryDirectory
+            .appendingPathComponent(UUID().uuidString)
+        try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: directory) }
+
+        // A (7FE0,0000) written for the input would be stale once streamed
+        var file = TestDicomFile.image(width: 16, height: 8, frames: 3)
+        var groupLength = Data()
+        groupLength.appendLE(UInt32(12 + 16 * 8 * 3 * 2))
+        file.set(TestDicomElement(0x7FE0_0000, "UL", bytes: groupLength))
+        let input = directory.appendingPathComponent("in.dcm")
+        let output = directory.appendingPathComponent("out.dcm")
+        try file.write(to: input)
+
+        var config = DB_AnonymizationConfig()
+        config.preserveTransferSyntax = true
+        config.replaceSOPUID = true
+        #expect(db_anonymize_file(input.path, output.path, &config) == DB_STATUS_OK)
+
+        let original = try #require(TestDicomFile.pixelDataElement(at: input))
+        let copied = try #require(TestDicomFile.pixelDataElement(at: output))
+        #expect(copied == original)
+        #expect(!TestDicomFile.fileContains(output, file.sopInstanceUID))
+
+        let written = try Data(contentsOf: output)
+        #expect(written.range(of: Data([0xE0, 0x7F, 0x00, 0x00])) == nil)
+    }
+
+    @Test("Replace flags remap only their own UIDs and references to them")
+    func uidFlagsMixed() throws {
+        let directory = FileManager.default.temporaryDirectory
+            .appendingPathComponent(UUID().uuidString)
+        try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: directory) }
+
+        let studyUID = TestDicomFile.makeUID()
+        let seriesUID = TestDicomFile.makeUID()
+        let frameOfReferenceUID = TestDicomFile.makeUID()
+        let referencedImageUID = TestDicomFile.makeUID()
+        var file = TestDicomFile.image(width: 4, height: 4, studyUID: studyUID, seriesUID: seriesUID)
+        file.set(TestDicomElement(0x0020_0052, "UI", frameOfReferenceUID))
+        file.set(TestDicomElement(0x0008_1140, sequence: [[
+            TestDicomElement(0x0008_1150, "UI", TestDicomFile.secondaryCaptureClass),
+            TestDicomElement(0x0008_1155, "UI", referencedImageUID)
+        ]]))
+        // Referenced Study Sequence refers to the study, which is kept
+        file.set(TestDicomElement(0x0008_1110, sequence: [[
+            TestDicomElement(0x0008_1150, "UI", "1.2.840.10008.3.1.2.3.1"),
+            TestDicomElement(0x0008_1155, "UI", studyUID)
+        ]]))
+        let input = directory.appendingPathComponent("in.dcm")
+        let output = directory.appendingPathComponent("out.dcm")
+        try file.write(to: input)
+
+        let uidMap = db_uid_map_create(nil)
+        defer { db_uid_map_destroy(uidMap) }
+        var config = DB_AnonymizationConfig()
+        config.replaceSOPUID = true
+        config.uidMap = uidMap
+        #expect(db_anonymize_file(input.path, output.path, &config) == DB_STATUS_OK)
+
+        var mappedReference = [CChar](repeating: 0, count: 65)
+        #expect(db_uid_map_get(uidMap, referencedImageUID, &mappedReference, 65) == DB_STATUS_OK)
+        #expect(db_uid_map_count(uidMap) == 2)
+        #expect(!TestDicomFile.fileContains(output, file.sopInstanceUID))
+        #expect(!TestDicomFile.fileContains(output, referencedImageUID))
+        #expect(TestDicomFile.fileContains(output, String(cString: mappedReference)))
+        #expect(TestDicomFile.fileContains(output, studyUID))
+        #expect(TestDicomFile.fileContains(output, seriesUID))
+        #expect(TestDicomFile.fileContains(output, frameOfReferenceUID))
+    }
+
+    @Test("Private tag keep list keeps one element of a block and removes the rest")
+    func privateTagKeepList() throws {
+        let directory = FileManager.default.temporaryDirectory
+            .appendingPathComponent(UUID().uuidString)
+        try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: directory) }
+
+        // Block 10 of SIEMENS MR HEADER, block 11 of another creator
+        var file = TestDicomFile.image(width: 4, height: 4)
+        file.set(TestDicomElement(0x0019_0010, "LO", "SIEMENS MR HEADER"))
+        file.set(TestDicomElement(0x0019_0011, "LO", "OTHER CREATOR"))
+        file.set(TestDicomElement(0x0019_100B, "LO", "NEIGHBOUR_BEFORE"))
+        file.set(TestDicomElement(0x0019_100C, "LO", "KEPT_BVALUE"))
+        file.set(TestDicomElement(0x0019_100D, "LO", "NEIGHBOUR_AFTER"))
+        file.set(TestDicomElement(0x0019_110C, "LO", "OTHER_BLOCK"))
+        let input = directory.appendingPathComponent("in.dcm")
+        let output = directory.appendingPathComponent("out.dcm")
+        try file.write(to: input)
+
+        var keep = DB_PrivateTagRule()
+        keep.group = 0x0019
+        keep.offset = 0x0C
+        withUnsafeMutableBytes(of: &keep.privateCreator) { buffer in
+            _ = strcpy(buffer.baseAddress!.assumingMemoryBound(to: CChar.self), "SIEMENS MR HEADER")
+        }
+        let keeps = [keep]
+        let status = keeps.withUnsafeBufferPointer { buffer -> DB_Status in
+            var config = DB_AnonymizationConfig()
+            config.removePrivateTags = true
+            config.privateTagRules = buffer.baseAddress
+            config.privateTagRuleCount = 1
+            return db_anonymize_file(input.path, output.path, &config)
+        }
+        #expect(status == DB_STATUS_OK)
+
+        #expect(TestDicomFile.fileContains(output, "SIEMENS MR HEADER"))
+        #expect(TestDicomFile.fileContains(output, "KEPT_BVALUE"))
+        #expect(!TestDicomFile.fileContains(output, "NEIGHBOUR_BEFORE"))
+        #expect(!TestDicomFile.fileContains(output, "NEIGHBOUR_AFTER"))
+        #expect(!TestDicomFile.fileContains(output, "OTHER CREATOR"))
+        #expect(!TestDicomFile.fileContains(output, "OTHER_BLOCK"))
+    }
+
+    @Test("Redaction re-encodes only the frames it changes")
+    func redactionKeepsUntouchedFragments() throws {
+        let directory = FileManager.default.temporaryDirectory
+            .appendingPathComponent(UUID().uuidString)
+        try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: directory) }
+
+        // Frames 0 and 2 are already black where the rectangle is
+        let width = 16, height = 8, frames = 3
+        var file = TestDicomFile.image(width: width, height: height, frames: frames)
+        var pixels = Data()
+        for frame in 0..<frames {
+            for y in 0..<height {
+                for x in 0..<width {
+                    let blank = frame != 1 && x < 4 && y < 2
+                    pixels.appendLE(UInt16(blank ? 0 : 100 + (x * 37 + y * 11 + frame * 101) % 4000))
+                }
+            }
+        }
+        file.set(TestDicomElement(0x7FE0_0010, "OW", bytes: pixels))
+        let native = directory.appendingPathComponent("native.dcm")
+        let rle = directory.appendingPathComponent("rle.dcm")
+        let output = directory.appendingPathComponent("redacted.dcm")
+        try file.write(to: native)
+        #expect(transcodeFile(native, to: rle, syntax: DB_TRANSFER_SYNTAX_RLE) == DB_STATUS_OK)
+
+        let rects = [DB_RedactionRect(x: 0, y: 0, width: 4, height: 2)]
+        let status = rects.withUnsafeBufferPointer { rectBuffer -> DB_Status in
+            var rules = [DB_RedactionRule()]
+            rules[0].rects = rectBuffer.baseAddress
+            rules[0].rectCount = 1
+            return rules.withUnsafeBufferPointer { ruleBuffer in
+                var config = DB_AnonymizationConfig()
+                config.preserveTransferSyntax = true
+                config.redactionRules = ruleBuffer.baseAddress
+                config.redactionRuleCount = 1
+                return db_anonymize_file(rle.path, output.path, &config)
+            }
+        }
+        #expect(status == DB_STATUS_OK)
+
+        let original = try #require(TestDicomFile.pixelFragments(at: rle))
+        let redacted = try #require(TestDicomFile.pixelFragments(at: output))
+        #expect(original.count == frames)
+        #expect(redacted.count == frames)
+        #expect(redacted[0] == original[0])
+        #expect(redacted[1] != original[1])
+        #expect(redacted[2] == original[2])
+
+        var frame = DB_Frame16()
+        #expect(db_decode_frame16(output.path, 1, &frame) == DB_STATUS_OK)
+        defer { db_free_buffer(frame.pixels) }
+        #expect(frame.pixels[0] == 0)
+        #expect(frame.pixels[width + 3] == 0)
+        #expect(frame.pixels[4] != 0)
+    }
+
+    @Test("Date shift crosses month ends and leap days both ways")
+    func dateShiftCalendar() throws {
+        let directory = FileManager.default.temporaryDirectory
+            .appendingPathComponent(UUID().uuidString)
+        try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: directory) }
+
+        let forward = try anonymizeWithDateShift([
+            TestDicomElement(0x0008_0020, "DA", "20000229"),
+            TestDicomElement(0x0008_0021, "DA", "19991231")
+        ], days: 365, in: directory)
+        #expect(TestDicomFile.fileContains(forward, "20010228"))
+        #expect(TestDicomFile.fileContains(forward, "20001230"))
+
+        let back = try anonymizeWithDateShift([
+            TestDicomElement(0x0008_0020, "DA", "20000229"),
+            TestDicomElement(0x0008_0021, "DA", "20010101")
+        ], days: -365, in: directory)
+        #expect(TestDicomFile.fileContains(back, "19990301"))
+        #expect(TestDicomFile.fileContains(back, "20000102"))
+
+        let dayForward = try anonymizeWithDateShift([
+            TestDicomElement(0x0008_0020, "DA", "20240131"),
+            TestDicomElement(0x0008_0021, "DA", "19991231")
+        ], days: 1, in: directory)
+        #expect(TestDicomFile.fileContains(dayForward, "20240201"))
+        #expect(TestDicomFile.fileContains(dayForward, "20000101"))
+
+        let dayBack = try anonymizeWithDateShift([
+            TestDicomElement(0x0008_0020, "DA", "20240301"),
+            TestDicomElement(0x0008_0021, "DA", "19000301")
+        ], days: -1, in: directory)
+        #expect(TestDicomFile.fileContains(dayBack, "20240229"))
+        #expect(TestDicomFile.fileContains(dayBack, "19000228"))
+    }
+
+    @Test("Date shift keeps DT fractions and UTC offsets")
+    func dateShiftDateTime() throws {
+        let directory = FileManager.default.temporaryDirectory
+            .appendingPathComponent(UUID().uuidString)
+        try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: directory) }
+
+        let forward = try anonymizeWithDateShift([
+            TestDicomElement(0x0008_002A, "DT", "20240131235959.123456+0100")
+        ], days: 1, in: directory)
+        #expect(TestDicomFile.fileContains(forward, "20240201235959.123456+0100"))
+
+        let back = try anonymizeWithDateShift([
+            TestDicomElement(0x0008_002A, "DT", "20240301083000.5-0500"),
+            TestDicomElement(0x0018_1202, "DT", "202503")
+        ], days: -1, in: directory)
+        #expect(TestDicomFile.fileContains(back, "20240229083000.5-0500"))
+        #expect(TestDicomFile.fileContains(back, "202502"))
+    }
+
+    @Test("Date shift handles open ranges and multiple values")
+    func dateShiftRangesAndValues() throws {
+        let directory = FileManager.default.temporaryDirectory
+            .appendingPathComponent(UUID().uuidString)
+        try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: directory) }
+
+        let output = try anonymizeWithDateShift([
+            TestDicomElement(0x0008_0020, "DA", "19900101-"),
+            TestDicomElement(0x0008_0021, "DA", "-19900201"),
+            TestDicomElement(0x0008_0022, "DA", "20240131\\20240229"),
+            TestDicomElement(0x0008_002A, "DT", "19900301-"),
+            TestDicomElement(0x0018_1202, "DT", "-19900401"),
+            TestDicomElement(0x0040_A120, "DT", "19900501120000-0500-19900502")
+        ], days: 1, in: directory)
+        #expect(TestDicomFile.fileContains(output, "19900102-"))
+        #expect(TestDicomFile.fileContains(output, "-19900202"))
+        #expect(TestDicomFile.fileContains(output, "20240201\\20240301"))
+        #expect(TestDicomFile.fileContains(output, "19900302-"))
+        #expect(TestDicomFile.fileContains(output, "-19900402"))
+        #expect(TestDicomFile.fileContains(output, "19900502120000-0500-19900503"))
+
+        // A year range, not 1990 at UTC-10:00
+        let years = try anonymizeWithDateShift([
+            TestDicomElement(0x0008_002A, "DT", "1990-1000")
+        ], days: -1, in: directory)
+        #expect(TestDicomFile.fileContains(years, "1989-0999"))
+    }
+
+    @Test("One batch resolves each patient's ID and date shift once")
+    func batchPatientOverrides() throws {
+        let directory = FileManager.default.temporaryDirectory
+            .appendingPathComponent(UUID().uuidString)
+        try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: directory) }
+
+        // Two files of PATIENTA, one of PATIENTB
+        let patients = ["PATIENTA", "PATIENTB", "PATIENTA"]
+        var inputURLs: [URL] = []
+        for (index, patientID) in patients.enumerated() {
+            var file = TestDicomFile.image(width: 4, height: 4)
+            file.set(TestDicomElement(0x0010_0020, "LO", patientID))
+            let url = directory.appendingPathComponent("in_\(index).dcm")
+            try file.write(to: url)
+            inputURLs.append(url)
+        }
+        let outputURLs = patients.indices.map { directory.appendingPathComponent("out_\($0).dcm") }
+
+        let inputs = inputURLs.map { strdup($0.path) }
+        let outputs = outputURLs.map { strdup($0.path) }
+        defer {
+            inputs.forEach { free($0) }
+            outputs.forEach { free($0) }
+        }
+        let inputPtrs: [UnsafePointer<CChar>?] = inputs.map { $0.map { UnsafePointer($0) } }
+        let outputPtrs: [UnsafePointer<CChar>?] = outputs.map { $0.map { UnsafePointer($0) } }
+
+        let recorder = PatientOverrideRecorder()
+        var config = DB_AnonymizationConfig()
+        config.preserveTransferSyntax = true
+        config.patientOverrideUserData = Unmanaged.passUnretained(recorder).toOpaque()
+        config.patientOverride = { userData, patientID, outOverride in
+            let recorder = Unmanaged<PatientOverrideRecorder>.fromOpaque(userData!)
+                .takeUnretainedValue()
+            let original = String(cString: patientID!)
+            recorder.patientIDs.append(original)
+
+            let replacement = "ANON-" + original
+            withUnsafeMutableBytes(of: &outOverride!.pointee.patientID) { buffer in
+                replacement.utf8.enumerated().forEach { buffer[$0] = $1 }
+                buffer[replacement.utf8.count] = 0
+            }
+            outOverride!.pointee.dateShiftDays = original == "PATIENTA" ? 1 : -1
+            return true
+        }
+        var statuses = [DB_Status](repeating: DB_STATUS_ERROR, count: 3)
+
+        let status = db_anonymize_batch(inputPtrs, outputPtrs, 3, &config, 3, &statuses, nil, nil)
+        #expect(status == DB_STATUS_OK)
+        #expect(statuses.allSatisfy { $0 == DB_STATUS_OK })
+        #expect(recorder.patientIDs.sorted() == ["PATIENTA", "PATIENTB"])
+
+        // StudyDate 20240115 shifted by each patient's days
+        for (index, patientID) in patients.enumerated() {
+            #expect(TestDicomFile.fileContains(outputURLs[index], "ANON-" + patientID))
+            #expect(!TestDicomFile.fileContains(outputURLs[index], "20240115"))
+            #expect(TestDicomFile.fileContains(outputURLs[index],
+                                               patientID == "PATIENTA" ? "20240116" : "20240114"))
+        }
+    }
+}
+
+// MARK: - Image Export Tests
+
+@Suite("Image Export Tests")
+struct ImageExportTests {
+
+    @Test("Vectorized PNG filters match their scalar definitions", arguments: [8, 16])
+    func pngFiltersMatchScalar(bitDepth: Int) {
+        #expect(db_png_filters_self_check(Int32(bitDepth)) == DB_STATUS_OK)
+    }
+
+    @Test("PNG filter check rejects other bit depths")
+    func pngFiltersBadDepth() {
+        #expect(db_png_filters_self_check(12) == DB_STATUS_ERROR)
+    }
+
+    @Test("Export reports unreadable items and keeps going")
+    func exportMissingFiles() {
+        let output = FileManager.default.temporaryDirectory
+            .appendingPathComponent(UUID().uuidString + ".png").path
+        var options = DB_ExportOptions()
+        options.format = DB_EXPORT_FORMAT_PNG
+        options.threadCount = 4
+        options.queueDepth = 1
+
+        #expect(db_export_images(nil, 0, &options, nil, nil, nil) == DB_STATUS_ERROR)
+
+        let input = strdup("/nonexistent/export.dcm")
+        let outputPath = strdup(output)
+        defer {
+            free(input)
+            free(outputPath)
+        }
+        let items = (0..<6).map { _ in
+            DB_ExportItem(inputPath: UnsafePointer(input), frameIndex: 0, outputPath: UnsafePointer(outputPath))
+        }
+        var statuses = [DB_Status](repeating: DB_STATUS_OK, count: items.count)
+        #expect(db_export_images(items, Int32(items.count), nil, &statuses, nil, nil) == DB_STATUS_ERROR)
+        #expect(db_export_images(items, 0, &options, &statuses, nil, nil) == DB_STATUS_OK)
+        #expect(db_export_images(items, Int32(items.count), &options, &statuses, nil, nil) == DB_STATUS_ERROR)
+        #expect(statuses.allSatisfy { $0 == DB_STATUS_NOT_FOUND })
+        #expect(!FileManager.default.fileExists(atPath: output))
+    }
+
+    @Test("Cine export rejects bad options and leaves no file for unreadable inputs")
+    func cineMissingFiles() {
+        let output = FileManager.default.temporaryDirectory
+            .appendingPathComponent(UUID().uuidString + ".avi").path
+        let inputs = [strdup("/nonexistent/cine1.dcm"), strdup("/nonexistent/cine2.dcm")]
+        defer { inputs.forEach { free($0) } }
+        let inputPtrs: [UnsafePointer<CChar>?] = inputs.map { $0.map { UnsafePointer($0) } }
+
+        var options = DB_CineOptions()
+        options.format = DB_CINE_FORMAT_AVI_MJPEG
+        options.framesPerSecond = -1
+        #expect(db_export_cine(inputPtrs, 2, output, nil, nil, nil) == DB_STATUS_ERROR)
+        #expect(db_export_cine(inputPtrs, 0, output, &options, nil, nil) == DB_STATUS_ERROR)
+        #expect(db_export_cine(inputPtrs, 2, output, &options, nil, nil) == DB_STATUS_ERROR)
+
+        options.framesPerSecond = 0
+        options.threadCount = 2
+        #expect(db_export_cine(inputPtrs, 2, output, &options, nil, nil) == DB_STATUS_NOT_FOUND)
+        #expect(!FileManager.default.fileExists(atPath: output))
+    }
+
+    @Test("Cine export replaces an existing file and paces APNG frames by FrameTimeVector")
+    func cineFrameTimeVector() throws {
+        let dir = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString)
+        try FileManager.default.createDirectory(at: dir, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: dir) }
+
+        var file = TestDicomFile.image(width: 8, height: 6, frames: 3)
+        file.set(TestDicomElement(0x0018_1065, "DS", "0\\40\\120"))
+        let input = dir.appendingPathComponent("cine.dcm")
+        try file.write(to: input)
+        let output = dir.appendingPathComponent("cine.png")
+        try Data("earlier export".utf8).write(to: output)
+
+        let inputs = [strdup(input.path)]
+        defer { inputs.forEach { free($0) } }
+        let inputPtrs: [UnsafePointer<CChar>?] = inputs.map { $0.map { UnsafePointer($0) } }
+        var options = DB_CineOptions()
+        options.format = DB_CINE_FORMAT_APNG
+        options.threadCount = 2
+        #expect(db_export_cine(inputPtrs, 1, output.path, &options, nil, nil) == DB_STATUS_OK)
+        #expect(!FileManager.default.fileExists(atPath: output.path + ".replace.tmp"))
+
+        let png = try Data(contentsOf: output)
+        #expect(png.prefix(8) == Data([0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A]))
+        func big(_ offset: Int, _ bytes: Int) -> Int {
+            (0..<bytes).reduce(0) { $0 << 8 | Int(png[png.startIndex + offset + $1]) }
+        }
+        // Each frame shows until the next one's increment; the last for the mean
+        var frameCount = 0
+        var delays: [Double] = []
+        var offset = 8
+        while offset + 12 <= png.count {
+            let length = big(offset, 4)
+            let type = String(decoding: png.subdata(in: offset + 4..<offset + 8), as: UTF8.self)
+            if type == "acTL" {
+                frameCount = big(offset + 8, 4)
+            } else if type == "fcTL" {
+                delays.append(Double(big(offset + 28, 2)) / Double(big(offset + 30, 2)))
+            }
+            offset += 12 + length
+        }
+        #expect(frameCount == 3)
+        #expect(delays == [0.04, 0.12, 0.08])
+    }
+}
+
+// MARK: - Transcoding Tests
+
+@Suite("Transcoding Tests")
+struct TranscodingTests {
+
+    @Test("Transcoding rejects bad options and reports unreadable files")
+    func transcodeMissingFiles() {
+        let output = FileManager.default.temporaryDirectory
+            .appendingPathComponent(UUID().uuidString + ".dcm").path
+        let inputs = [strdup("/nonexistent/a.dcm"), strdup("/nonexistent/b.dcm")]
+        let outputs = [strdup(output), strdup(output)]
+        defer { (inputs + outputs).forEach { free($0) } }
+        let inputPtrs: [UnsafePointer<CChar>?] = inputs.map { $0.map { UnsafePointer($0) } }
+        let outputPtrs: [UnsafePointer<CChar>?] = outputs.map { $0.map { UnsafePointer($0) } }
+
+        var options = DB_TranscodeOptions()
+        options.transferSyntax = DB_TRANSFER_SYNTAX_JPEG_LS_NEAR_LOSSLESS
+        options.nearLosslessError = 300
+        #expect(db_transcode_files(inputPtrs, outputPtrs, 2, nil, nil, nil, nil) == DB_STATUS_ERROR)
+        #expect(db_transcode_files(inputPtrs, outputPtrs, 2, &options, nil, nil, nil) == DB_STATUS_ERROR)
+
+        options.nearLosslessError = 0
+        options.threadCount = 2
+        var statuses = [DB_Status](repeating: DB_STATUS_OK, count: 2)
+        #expect(db_transcode_files(inputPtrs, outputPtrs, 0, &options, &statuses, nil, nil) == DB_STATUS_OK)
+        #expect(db_transcode_files(inputPtrs, outputPtrs, 2, &options, &statuses, nil, nil) == DB_STATUS_ERROR)
+        #expect(statuses.allSatisfy { $0 == DB_STATUS_NOT_FOUND })
+        #expect(!FileManager.default.fileExists(atPath: output))
+    }
+
+    @Test("Lossless transcoding round-trips multi-frame pixels exactly",
+          arguments: [DB_TRANSFER_SYNTAX_JPEG_LOSSLESS, DB_TRANSFER_SYNTAX_JPEG_LS_LOSSLESS,
+                      DB_TRANSFER_SYNTAX_RLE])
+    func losslessRoundTrip(syntax: DB_TransferSyntax) throws {
+        let directory = FileManager.default.temporaryDirectory
+            .appendingPathComponent(UUID().uuidString)
+        try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: directory) }
+
+        let frames = 4
+        let file = TestDicomFile.image(width: 33, height: 17, frames: frames)
+        let native = directory.appendingPathComponent("native.dcm")
+        let compressed = directory.appendingPathComponent("compressed.dcm")
+        let restored = directory.appendingPathComponent("restored.dcm")
+        try file.write(to: native)
+
+        #expect(transcodeFile(native, to: compressed, syntax: syntax) == DB_STATUS_OK)
+        let fragments = try #require(TestDicomFile.pixelFragments(at: compressed))
+        #expect(fragments.count >= frames)
+        #expect(TestDicomFile.fileContains(compressed, file.sopInstanceUID))
+        #expect(!TestDicomFile.fileContains(compressed, "ISO_"))
+
+        #expect(transcodeFile(compressed, to: restored, syntax: DB_TRANSFER_SYNTAX_EXPLICIT_LITTLE) == DB_STATUS_OK)
+        let original = try #require(TestDicomFile.pixelDataElement(at: native))
+        let roundTripped = try #require(TestDicomFile.pixelDataElement(at: restored))
+        #expect(roundTripped == original)
+    }
+
+    @Test("Near-lossless JPEG-LS marks the image lossy under a new SOP Instance UID")
+    func nearLosslessMarksLossy() throws {
+        let directory = FileManager.default.temporaryDirectory
+            .appendingPathComponent(UUID().uuidString)
+        try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: directory) }
+
+        let file = TestDicomFile.image(width: 32, height: 16, frames: 2)
+        let native = directory.appendingPathComponent("native.dcm")
+        let lossy = directory.appendingPathComponent("lossy.dcm")
+        try file.write(to: native)
+
+        #expect(transcodeFile(native, to: lossy, syntax: DB_TRANSFER_SYNTAX_JPEG_LS_NEAR_LOSSLESS,
+                              nearLosslessError: 2) == DB_STATUS_OK)
+
+        // (0028,2110) LossyImageCompression CS "01"
+        var lossyFlag = Data([0x28, 0x00, 0x10, 0x21])
+        lossyFlag.append(contentsOf: Array("CS".utf8))
+        lossyFlag.appendLE(UInt16(2))
+        lossyFlag.append(contentsOf: Array("01".utf8))
+        let written = try Data(contentsOf: lossy)
+        #expect(written.range(of: lossyFlag) != nil)
+        #expect(TestDicomFile.fileContains(lossy, "ISO_14495_1"))
+        #expect(!TestDicomFile.fileContains(lossy, file.sopInstanceUID))
+    }
+}
+
+// MARK: - Media Export Tests
+
+@Suite("Media Export Tests")
+struct MediaExportTests {
+
+    @Test("Media export writes a DICOMDIR only on success and skips repeated instances")
+    func mediaMissingFiles() throws {
+        let directory = FileManager.default.temporaryDirectory
+            .appendingPathComponent(UUID().uuidString)
+        defer { try? FileManager.default.removeItem(at: directory) }
+        let input = strdup("/nonexistent/media.dcm")
+        defer { free(input) }
+
+        var item = DB_MediaItem()
+        item.inputPath = UnsafePointer(input)
+        withUnsafeMutableBytes(of: &item.tags.sopInstanceUID) { bytes in
+            _ = strcpy(bytes.baseAddress!.assumingMemoryBound(to: CChar.self), "1.2.3.4")
+        }
+        let items = [item, item]
+
+        var options = DB_MediaOptions()
+        #expect(db_export_media(items, 2, directory.path, nil, nil, nil, nil) == DB_STATUS_ERROR)
+        let badID = strdup("lower case")
+        defer { free(badID) }
+        options.fileSetID = UnsafePointer(badID)
+        #expect(db_export_media(items, 2, directory.path, &options, nil, nil, nil) == DB_STATUS_ERROR)
+
+        options.fileSetID = nil
+        options.threadCount = 2
+        var statuses = [DB_Status](repeating: DB_STATUS_ERROR, count: 2)
+        #expect(db_export_media(items, 2, directory.path, &options, &statuses, nil, nil) == DB_STATUS_ERROR)
+        #expect(statuses == [DB_STATUS_NOT_FOUND, DB_STATUS_NOT_FOUND])
+        let dicomdir = directory.appendingPathComponent("DICOMDIR")
+        #expect(!FileManager.default.fileExists(atPath: dicomdir.path))
+
+        // A retry into the same directory completes the file set, with each
+        // instance under the record its SOP class calls for
+        let imageURL = directory.appendingPathComponent("image.dcm")
+        try TestDicomFile.image(width: 4, height: 4).write(to: imageURL)
+        let reportURL = directory.appendingPathComponent("report.dcm")
+        var report = TestDicomFile(sopClassUID: "1.2.840.10008.5.1.4.1.1.88.11")
+        report.set(TestDicomElement(0x0040_A491, "CS", "COMPLETE"))
+        report.set(TestDicomElement(0x0040_A493, "CS", "UNVERIFIED"))
+        try report.write(to: reportURL)
+        let paths = [strdup(imageURL.path), strdup(reportURL.path)]
+        defer { paths.forEach { free($0) } }
+        var image = item
+        image.inputPath = UnsafePointer(paths[0])
+        var document = item
+        document.inputPath = UnsafePointer(paths[1])
+        withUnsafeMutableBytes(of: &document.tags.sopInstanceUID) { bytes in
+            _ = strcpy(bytes.baseAddress!.assumingMemoryBound(to: CChar.self), "1.2.3.5")
+        }
+        statuses = [DB_Status](repeating: DB_STATUS_ERROR, count: 3)
+        #expect(db_export_media([image, document, image], 3, directory.path, &options, &statuses,
+                                nil, nil) == DB_STATUS_OK)
+        #expect(statuses == [DB_STATUS_OK, DB_STATUS_OK, DB_STATUS_OK])
+        #expect(TestDicomFile.fileContains(dicomdir, "IMAGE"))
+        #expect(TestDicomFile.fileContains(dicomdir, "SR DOCUMENT"))
+        #expect(TestDicomFile.fileContains(dicomdir, "COMPLETE"))
+
+        // An existing file set is never overwritten
+        #expect(db_export_media(items, 0, directory.path, &options, nil, nil, nil) == DB_STATUS_ERROR)
+    }
+}
@@ -0,0 +1,84 @@
+//
+//  SimulatedPacs.swift
+//  DicomVmacTests
+//
+//  Runs the dicom-pacs-sim tool as a child process, giving network tests a
+//  Query/Retrieve + Storage SCP on loopback. The simulator is not part of
+//  DicomCore, so tests talk to it over the network like to a real PACS.
+//
+
+import Foundation
+
+final class SimulatedPacs {
+    let aeTitle: String
+    let port: Int
+    let instanceCount: Int
+    private let process: Process
+
+    /// The tool is built next to the app by the DicomPacsSim target.
+    static var toolURL: URL {
+        Bundle.main.bundleURL.deletingLastPathComponent()
+            .appendingPathComponent("dicom-pacs-sim")
+    }
+
+    /// Serve the DICOM files under folder; returns nil if the simulator
+    /// exits instead of listening (unknown folder, port in use, ...).
+    init?(folder: URL, aeTitle: String = "SIMPACS", port: Int, latencyMs: Int = 0) {
+        let process = Process()
+        process.executableURL = SimulatedPacs.toolURL
+        process.arguments = [folder.path, "--ae", aeTitle, "--port", String(port),
+                             "--latency", String(latencyMs)]
+        let output = Pipe()
+        process.standardOutput = output
+        process.standardError = FileHandle.nullDevice
+        do {
+            try process.run()
+        } catch {
+            return nil
+        }
+
+        // The tool prints one line once it is listening:
+        // "<AE> listening on port <n>, serving <count> instances from <folder>"
+        var line = Data()
+        while !line.contains(UInt8(ascii: "\n")) {
+            let chunk = output.fileHandleForReading.availableData
+            if chunk.isEmpty { break }
+            line.append(chunk)
+        }
+        let text = String(decoding: line, as: UTF8.self)
+        guard let range = text.range(of: #"serving (\d+) instances"#, options: .regularExpression) else {
+            process.waitUntilExit()
+            return nil
+        }
+        let count = text[range].split(separator: " ")[1]
+
+        self.aeTitle = aeTitle
+        self.port = port
+        self.instanceCount = Int(count) ?? 0
+        self.process = process
+    }
+
+    deinit {
+        stop()
+    }
+
+    /// Node configuration that reaches the simulator.
+    var node: DB_DicomNode {
+        var node = DB_DicomNode()
+        withUnsafeMutablePointer(to: &node.aeTitle.0) { ptr in
+            _ = strncpy(ptr, aeTitle, 16)
+        }
+        withUnsafeMutablePointer(to: &node.hostname.0) { ptr in
+            _ = strncpy(ptr, "127.0.0.1", 255)
+        }
+        node.port = Int32(port)
+        return node
+    }
+
+    func stop() {
+        if process.isRunning {
+            process.interrupt()
+            process.waitUntilExit()
+        }
+    }
+}
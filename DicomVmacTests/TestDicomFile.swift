@@ -0,0 +1,224 @@
+//
+//  TestDicomFile.swift
+//  DicomVmacTests
+//
+//  Minimal Part 10 writer used to generate test inputs on the fly.
+//  Writes explicit VR little endian datasets with defined length sequences.
+//
+
+import Foundation
+
+struct TestDicomElement {
+    let tag: UInt32
+    let vr: String
+    let value: Data
+    var items: [[TestDicomElement]] = []
+
+    /// String value padded to even length (UI with NUL, others with space).
+    init(_ tag: UInt32, _ vr: String, _ string: String) {
+        var data = Data(string.utf8)
+        if data.count % 2 == 1 {
+            data.append(vr == "UI" ? 0 : 0x20)
+        }
+        self.tag = tag
+        self.vr = vr
+        self.value = data
+    }
+
+    init(_ tag: UInt32, us value: UInt16) {
+        self.tag = tag
+        self.vr = "US"
+        self.value = withUnsafeBytes(of: value.littleEndian) { Data($0) }
+    }
+
+    init(_ tag: UInt32, _ vr: String, bytes: Data) {
+        self.tag = tag
+        self.vr = vr
+        self.value = bytes
+    }
+
+    init(_ tag: UInt32, sequence items: [[TestDicomElement]]) {
+        self.tag = tag
+        self.vr = "SQ"
+        self.value = Data()
+        self.items = items
+    }
+
+    func encoded() -> Data {
+        var data = Data()
+        data.appendLE(UInt16(tag >> 16))
+        data.appendLE(UInt16(tag & 0xFFFF))
+        data.append(contentsOf: Array(vr.utf8))
+
+        var body = value
+        if vr == "SQ" {
+            body = Data()
+            for item in items {
+                let itemBody = TestDicomElement.encode(item)
+                body.appendLE(UInt16(0xFFFE))
+                body.appendLE(UInt16(0xE000))
+                body.appendLE(UInt32(itemBody.count))
+                body.append(itemBody)
+            }
+        }
+
+        if ["OB", "OW", "OF", "SQ", "UT", "UN"].contains(vr) {
+            data.appendLE(UInt16(0))
+            data.appendLE(UInt32(body.count))
+        } else {
+            data.appendLE(UInt16(body.count))
+        }
+        data.append(body)
+        return data
+    }
+
+    static func encode(_ elements: [TestDicomElement]) -> Data {
+        var data = Data()
+        for element in elements.sorted(by: { $0.tag < $1.tag }) {
+            data.append(element.encoded())
+        }
+        return data
+    }
+}
+
+struct TestDicomFile {
+    static let explicitLittleEndian = "1.2.840.10008.1.2.1"
+    static let secondaryCaptureClass = "1.2.840.10008.5.1.4.1.1.7"
+    static let multiFrameGrayscaleWordClass = "1.2.840.10008.5.1.4.1.1.7.3"
+
+    var sopClassUID: String
+    var sopInstanceUID: String
+    var elements: [TestDicomElement] = []
+
+    init(sopClassUID: String = TestDicomFile.secondaryCaptureClass,
+         sopInstanceUID: String = TestDicomFile.makeUID()) {
+        self.sopClassUID = sopClassUID
+        self.sopInstanceUID = sopInstanceUID
+        elements.append(TestDicomElement(0x0008_0016, "UI", sopClassUID))
+        elements.append(TestDicomElement(0x0008_0018, "UI", sopInstanceUID))
+    }
+
+    /// Add or replace a top-level element.
+    mutating func set(_ element: TestDicomElement) {
+        elements.removeAll { $0.tag == element.tag }
+        elements.append(element)
+    }
+
+    mutating func remove(_ tag: UInt32) {
+        elements.removeAll { $0.tag == tag }
+    }
+
+    /// A 16-bit grayscale image whose pixel values differ in every frame,
+    /// with patient, study and series attributes filled in.
+    static func image(width: Int, height: Int, frames: Int = 1,
+                      studyUID: String = makeUID(), seriesUID: String = makeUID(),
+                      sopInstanceUID: String = makeUID()) -> TestDicomFile {
+        var file = TestDicomFile(sopClassUID: frames > 1 ? multiFrameGrayscaleWordClass
+                                                         : secondaryCaptureClass,
+                                 sopInstanceUID: sopInstanceUID)
+        file.set(TestDicomElement(0x0008_0020, "DA", "20240115"))
+        file.set(TestDicomElement(0x0008_0060, "CS", "OT"))
+        file.set(TestDicomElement(0x0010_0010, "PN", "TEST^PATIENT"))
+        file.set(TestDicomElement(0x0010_0020, "LO", "PID0001"))
+        file.set(TestDicomElement(0x0020_000D, "UI", studyUID))
+        file.set(TestDicomElement(0x0020_000E, "UI", seriesUID))
+        file.set(TestDicomElement(0x0020_0013, "IS", "1"))
+        file.set(TestDicomElement(0x0028_0002, us: 1))
+        file.set(TestDicomElement(0x0028_0004, "CS", "MONOCHROME2"))
+        if frames > 1 {
+            file.set(TestDicomElement(0x0028_0008, "IS", String(frames)))
+        }
+        file.set(TestDicomElement(0x0028_0010, us: UInt16(height)))
+        file.set(TestDicomElement(0x0028_0011, us: UInt16(width)))
+        file.set(TestDicomElement(0x0028_0100, us: 16))
+        file.set(TestDicomElement(0x0028_0101, us: 12))
+        file.set(TestDicomElement(0x0028_0102, us: 11))
+        file.set(TestDicomElement(0x0028_0103, us: 0))
+
+        var pixels = Data(capacity: width * height * frames * 2)
+        for frame in 0..<frames {
+            for y in 0..<height {
+                for x in 0..<width {
+                    pixels.appendLE(UInt16((x * 37 + y * 11 + frame * 101) % 4096))
+                }
+            }
+        }
+        file.set(TestDicomElement(0x7FE0_0010, "OW", bytes: pixels))
+        return file
+    }
+
+    func write(to url: URL) throws {
+        var meta: [TestDicomElement] = [
+            TestDicomElement(0x0002_0001, "OB", bytes: Data([0x00, 0x01])),
+            TestDicomElement(0x0002_0002, "UI", sopClassUID),
+            TestDicomElement(0x0002_0003, "UI", sopInstanceUID),
+            TestDicomElement(0x0002_0010, "UI", TestDicomFile.explicitLittleEndian),
+            TestDicomElement(0x0002_0012, "UI", "1.2.826.0.1.3680043.9.7433.1")
+        ]
+        let metaBody = TestDicomElement.encode(meta)
+        var groupLength = Data()
+        groupLength.appendLE(UInt32(metaBody.count))
+        meta.append(TestDicomElement(0x0002_0000, "UL", bytes: groupLength))
+
+        var data = Data(count: 128)
+        data.append(contentsOf: Array("DICM".utf8))
+        data.append(TestDicomElement.encode(meta))
+        data.append(TestDicomElement.encode(elements))
+        try data.write(to: url)
+    }
+
+    static func makeUID() -> String {
+        "2.25.\(UInt64.random(in: 1...UInt64.max))\(UInt32.random(in: 0...99999))"
+    }
+
+    /// Bytes of the PixelData element through the end of the file (header,
+    /// value or fragments), or nil if there is none. The tag cannot occur in
+    /// the text and UID values that precede it in generated files.
+    static func pixelDataElement(at url: URL) -> Data? {
+        guard let data = try? Data(contentsOf: url) else { return nil }
+        let header = Data([0xE0, 0x7F, 0x10, 0x00])
+        guard let range = data.range(of: header, in: 132..<data.count) else { return nil }
+        return data.subdata(in: range.lowerBound..<data.count)
+    }
+
+    /// Fragments of an encapsulated PixelData element, without the Basic
+    /// Offset Table item; nil if the pixel data is not encapsulated.
+    static func pixelFragments(at url: URL) -> [Data]? {
+        guard let element = pixelDataElement(at: url), element.count >= 12,
+              element.readLE32(at: 8) == 0xFFFF_FFFF else { return nil }
+        var items: [Data] = []
+        var offset = 12
+        while offset + 8 <= element.count {
+            let tag = element.readLE32(at: offset)
+            let length = Int(element.readLE32(at: offset + 4))
+            offset += 8
+            if tag == 0xE0DD_FFFE { break }     // Sequence Delimitation Item
+            guard tag == 0xE000_FFFE, offset + length <= element.count else { return nil }
+            items.append(element.subdata(in: element.startIndex + offset..<element.startIndex + offset + length))
+            offset += length
+        }
+        return Array(items.dropFirst())
+    }
+
+    /// Whether the file contains the given string anywhere in its bytes.
+    static func fileContains(_ url: URL, _ string: String) -> Bool {
+        guard let data = try? Data(contentsOf: url) else { return false }
+        return data.range(of: Data(string.utf8)) != nil
+    }
+}
+
+extension Data {
+    mutating func appendLE(_ value: UInt16) {
+        Swift.withUnsafeBytes(of: value.littleEndian) { append(contentsOf: $0) }
+    }
+
+    mutating func appendLE(_ value: UInt32) {
+        Swift.withUnsafeBytes(of: value.littleEndian) { append(contentsOf: $0) }
+    }
+
+    func readLE32(at offset: Int) -> UInt32 {
+        (0..<4).reduce(UInt32(0)) { value, byte in
+            value | UInt32(self[startIndex + offset + byte]) << (8 * byte)
+        }
+    }
+}